@@ -128,6 +128,7 @@ class GenDependenciesBase(gen_base.GeneratorBase):
 
         # So optional, we don't even have any code to detect them on Windows
         'magic',
+        'zstd',
         'macos-plist',
         'macos-keychain',
   ]
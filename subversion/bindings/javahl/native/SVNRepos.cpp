@@ -641,9 +641,10 @@ SVNRepos::verify(File &path, Revision &revisionStart, Revision &revisionEnd,
       (SVN_ERR_INCORRECT_PARAMS, NULL,
        _("Start revision cannot be higher than end revision")), );
 
-  SVN_JNI_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_JNI_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                    checkNormalization,
                                    metadataOnly,
+                                   1 /* jobs */,
                                    (!notifyCallback ? NULL
                                     : ReposNotifyCallback::notify),
                                    notifyCallback,
@@ -669,7 +670,7 @@ void SVNRepos::pack(File &path, ReposNotifyCallback *notifyCallback)
                               path.getInternalStyle(requestPool), NULL,
                               requestPool.getPool(), requestPool.getPool()), );
 
-  SVN_JNI_ERR(svn_repos_fs_pack2(repos,
+  SVN_JNI_ERR(svn_repos_fs_pack3(repos, 1,
                                  notifyCallback != NULL
                                     ? ReposNotifyCallback::notify
                                     : NULL,
@@ -148,6 +148,41 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t failures;
 
+  /** Number of items that the admission policy did not allow to be kept
+   * long-term, e.g. because they were part of a bulk scan.
+   * May be 0 if the cache has no such policy.
+   */
+  apr_uint64_t rejects;
+
+  /** Number of items that have been stored in compressed form.
+   * May be 0 if the cache does not support compression.
+   */
+  apr_uint64_t compressions;
+
+  /** Total size of the items counted in @a compressions before and
+   * after compression.  Their ratio is the compression rate achieved.
+   */
+  apr_uint64_t uncompressed_size;
+  apr_uint64_t compressed_size;
+
+  /** Number of times that compressed items had to be expanded when
+   * being read.  This is a measure of the CPU overhead of compression.
+   */
+  apr_uint64_t decompressions;
+
+  /** Number of times that a lock on (a part of) the cache was acquired
+   * and how many of these had to wait for another thread to release it.
+   * May be 0 if the cache does not use locks or can't tell.
+   */
+  apr_uint64_t lock_acquisitions;
+  apr_uint64_t lock_contentions;
+
+  /** Number of lock-free reads that collided with a concurrent writer and
+   * had to be repeated or fall back to locking.
+   * May be 0 if the cache does not support lock-free reads.
+   */
+  apr_uint64_t read_retries;
+
   /** Size of the data currently stored in the cache.
    * May be 0 if that information is not available.
    */
@@ -181,6 +216,40 @@ typedef struct svn_cache__info_t
   apr_uint64_t histogram[32];
 } svn_cache__info_t;
 
+/**
+ * A cache usage statistics summary for all cache entries with the same
+ * key prefix, i.e. usually for one kind of data of one repository.
+ * See svn_cache__membuffer_get_prefix_info().
+ */
+typedef struct svn_cache__prefix_info_t
+{
+  /** The key prefix as passed to svn_cache__create_membuffer_cache().
+   * @c NULL for the summary over all prefixes that don't have separate
+   * statistics, e.g. because they belong to short-lived caches.
+   */
+  const char *prefix;
+
+  /** Number of getter calls (svn_cache__get() or
+   * svn_cache__get_partial()) and how many of them returned data.
+   */
+  apr_uint64_t gets;
+  apr_uint64_t hits;
+
+  /** Number of setter calls (svn_cache__set()).
+   */
+  apr_uint64_t sets;
+
+  /** Number of entries that had to be removed to make room for others.
+   */
+  apr_uint64_t evictions;
+
+  /** Size of the data currently stored in the cache, including keys,
+   * and the number of entries.  Their quotient is the average item size.
+   */
+  apr_uint64_t used_size;
+  apr_uint64_t used_entries;
+} svn_cache__prefix_info_t;
+
 /**
  * Creates a new cache in @a *cache_p.  This cache will use @a pool
  * for all of its storage needs.  The elements in the cache will be
@@ -200,8 +269,19 @@ typedef struct svn_cache__info_t
  * @a pages and @a items_per_page must be positive (though they both
  * may certainly be 1).
  *
+ * If @a max_size is not 0, the cache will also evict the least recently
+ * used pages to keep the total size of the serialized values, their keys
+ * and the per-entry bookkeeping below @a max_size bytes.  This includes
+ * old values that have been replaced but not yet evicted.  Items that
+ * would not fit at all will not be cached.
+ *
  * If @a thread_safe is true, and APR is compiled with threads, all
- * accesses to the cache will be protected with a mutex. The @a id
+ * accesses to the cache will be protected with a mutex.  To reduce lock
+ * contention, the key space is then split into multiple shards, each
+ * with its own mutex, LRU list and share of @a pages and @a max_size.
+ * Each shard then allocates its entries from a private root pool that
+ * gets destroyed together with @a pool.
+ * The @a id
  * is a purely user-visible information that will allow coders to
  * identify this cache instance in a #svn_cache__info_t struct.
  * It does not influence the behavior of the cache itself.
@@ -219,6 +299,7 @@ svn_cache__create_inprocess(svn_cache__t **cache_p,
                             apr_ssize_t klen,
                             apr_int64_t pages,
                             apr_int64_t items_per_page,
+                            apr_size_t max_size,
                             svn_boolean_t thread_safe,
                             const char *id,
                             apr_pool_t *pool);
@@ -310,6 +391,80 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but allocate all cache data in
+ * shared memory such that processes forked from the caller after this
+ * call will access the same cache contents.  If @a shm_file is not @c NULL,
+ * the shared memory will be backed by that file, replacing any stale file
+ * of that name; otherwise anonymous shared memory will be used.
+ *
+ * The cache uses system-wide locks and is always thread-safe.  Each child
+ * process must call svn_cache__membuffer_child_init() before accessing
+ * the cache.  Because the cache contains native pointers, it can only be
+ * shared with processes that inherit it through fork(); unrelated
+ * processes cannot attach to it.
+ *
+ * Allocations will be made in @a result_pool.  Destroying that pool in
+ * the creating process releases the shared memory and the locks.  Forked
+ * children may destroy their copy of @a result_pool or exit at any time
+ * without affecting the cache for the other processes.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         const char *shm_file,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Attach the current child process to the locks of the shared @a cache.
+ * Call this once in every process forked after the creation of @a cache.
+ * This is a no-op if @a cache is @c NULL or not shared.  Use @a pool for
+ * child-local allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool);
+
+/**
+ * Write the contents of the membuffer @a cache to a snapshot file at
+ * @a path such that svn_cache__membuffer_load() can restore them after
+ * a restart.  An existing file at @a path will be replaced atomically.
+ * Concurrent writers and readers in other processes are serialized
+ * through the lock file "@a path.lock", which will be created as needed.
+ *
+ * The cache remains fully usable while the snapshot is being taken but
+ * every segment will be locked while it is being written.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Add the contents of the snapshot file at @a path, created by
+ * svn_cache__membuffer_save(), to the membuffer @a cache.  Do nothing if
+ * there is no such file.  Like svn_cache__membuffer_save(), this takes the
+ * snapshot's lock file such that the file cannot be replaced while it is
+ * being read.
+ *
+ * Snapshots contain the items in their serialized, platform-dependent
+ * form.  Only those written by the same version and build configuration
+ * will be accepted.  It is up to the cache users to make their key
+ * prefixes unique enough that restored entries will never be mistaken
+ * for data of a different origin.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -445,6 +600,27 @@ svn_cache__has_key(svn_boolean_t *found,
                    const void *key,
                    apr_pool_t *scratch_pool);
 
+/**
+ * Batched version of svn_cache__get(): for each of the @a count keys in
+ * @a keys, fetch the value indexed by it from @a cache into @a values[i]
+ * and set @a found[i] to TRUE iff it is in the cache.  Individual keys
+ * may be NULL, in which case the respective @a found[i] will be FALSE.
+ * If @a values is NULL, only check for the presence of the keys as
+ * svn_cache__has_key() would.  The values are copied into @a result_pool
+ * using the deserialize function provided to the cache's constructor.
+ *
+ * Cache implementations that involve a round-trip per request, such as
+ * memcached, will pipeline all lookups.  Others simply fall back to
+ * fetching one key after the other.
+ */
+svn_error_t *
+svn_cache__get_multi(void **values,
+                     svn_boolean_t *found,
+                     svn_cache__t *cache,
+                     const void *const *keys,
+                     int count,
+                     apr_pool_t *result_pool);
+
 /**
  * Stores the value @a value under the key @a key in @a cache.  Uses @a
  * scratch_pool for temporary allocations.  The cache makes copies of
@@ -544,6 +720,15 @@ svn_cache__format_info(const svn_cache__info_t *info,
                        svn_boolean_t access_only,
                        apr_pool_t *result_pool);
 
+/**
+ * Return the array of #svn_cache__prefix_info_t * given in @a info
+ * formatted as a multi-line string.  Allocations take place in
+ * @a result_pool.
+ */
+svn_string_t *
+svn_cache__format_prefix_info(const apr_array_header_t *info,
+                              apr_pool_t *result_pool);
+
 /**
  * Access the process-global (singleton) membuffer cache. The first call
  * will automatically allocate the cache using the current cache config.
@@ -554,6 +739,27 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * If @a shared is set, let the first call to
+ * svn_cache__get_global_membuffer_cache() create the cache in shared memory
+ * using @a shm_file (may be @c NULL) as backing store.  See
+ * svn_cache__membuffer_cache_create_shared() for the restrictions.  Must
+ * be called before the global cache gets created to have any effect.
+ * @a shm_file must remain valid for the lifetime of the process.
+ */
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared,
+                                       const char *shm_file);
+
+/**
+ * Let the first call to svn_cache__get_global_membuffer_cache() enable
+ * compression of items of @a threshold bytes or more in the new cache.
+ * See svn_cache__membuffer_set_compression().  Must be called before the
+ * global cache gets created to have any effect.
+ */
+void
+svn_cache__set_global_membuffer_compression(apr_size_t threshold);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -561,6 +767,38 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Set @a *info to an array of #svn_cache__prefix_info_t *, one for each
+ * key prefix used with the membuffer @a cache, sorted by prefix.  The
+ * summary for prefixes without separate statistics comes last.
+ *
+ * Access counts are collected by the current process only, even if
+ * @a cache is shared between processes.  Sizes are being determined by
+ * scanning all cache contents, so don't call this too frequently.
+ *
+ * Allocate the result in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_get_prefix_info(apr_array_header_t **info,
+                                     svn_membuffer_t *cache,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
+
+/**
+ * Make the membuffer @a cache compress serialized items of @a threshold
+ * bytes or more using LZ4 before storing them.  They will be expanded
+ * again transparently when being read.  This trades CPU time for a
+ * larger effective cache size.  Items that don't compress well are
+ * being stored as they are.
+ *
+ * Use 0 to disable compression, which is also the default.  Items that
+ * have already been stored are not affected.
+ */
+void
+svn_cache__membuffer_set_compression(svn_membuffer_t *cache,
+                                     apr_size_t threshold);
+
 /**
  * Remove all current contents from CACHE.
  *
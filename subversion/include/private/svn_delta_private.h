@@ -101,13 +101,123 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              struct svn_delta__extra_baton *exb,
                              apr_pool_t *pool);
 
+/* The largest delta window that may be requested from
+ * svn_txdelta__with_window_size() and svn_txdelta__target_push() and that
+ * svn_txdelta__read_large_svndiff_window() accepts.  Windows created by
+ * svn_txdelta() and friends use the standard size of 100kB.
+ *
+ * The public svndiff parsers, as well as older releases, reject windows
+ * larger than the standard size, so data using larger windows must never
+ * be sent over the wire or be written to dump files.
+ */
+#define SVN_DELTA__MAX_WINDOW_SIZE (1024 * 1024)
+
+/* Like svn_txdelta2() but use windows of up to WINDOW_SIZE bytes of source
+ * and target data each.  WINDOW_SIZE must be in the range of 1 to
+ * SVN_DELTA__MAX_WINDOW_SIZE.
+ */
+void
+svn_txdelta__with_window_size(svn_txdelta_stream_t **stream,
+                              svn_stream_t *source,
+                              svn_stream_t *target,
+                              svn_boolean_t calculate_checksum,
+                              apr_size_t window_size,
+                              apr_pool_t *pool);
+
+/* Like svn_txdelta_target_push() but use windows of up to WINDOW_SIZE bytes
+ * of source and target data each.  WINDOW_SIZE must be in the range of 1 to
+ * SVN_DELTA__MAX_WINDOW_SIZE.
+ */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool);
+
+/* Like svn_txdelta_to_svndiff3() but compress up to MAX_THREADS windows
+ * concurrently on a process-wide pool of worker threads.  The windows
+ * are still written to OUTPUT in their original order and the svndiff
+ * data is identical to what svn_txdelta_to_svndiff3() would produce.
+ *
+ * The returned *HANDLER takes a copy of each window it receives, so
+ * callers may continue to reuse the window memory.
+ *
+ * Without thread support, if MAX_THREADS is 1 or less or if SVNDIFF_VERSION
+ * is 0 (i.e. nothing to compress), this is equivalent to calling
+ * svn_txdelta_to_svndiff3().  Allocate the handler data in POOL.
+ */
+svn_error_t *
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int max_threads,
+                                 apr_pool_t *pool);
+
+/* Compose the chain of delta WINDOWS (an array of svn_txdelta_window_t *)
+ * into a single window.  WINDOWS[0] is the newest window, i.e. the one
+ * whose target is requested, and every WINDOWS[I+1] produces the source
+ * view of WINDOWS[I], as when reading a skip-delta chain.  The result
+ * produces the target of WINDOWS[0] from the source view of the last
+ * window.
+ *
+ * This gives the same target as calling svn_txdelta_compose_windows()
+ * for each pair from the bottom up but resolves every range through all
+ * windows in a single pass, without building intermediate composites.
+ *
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_txdelta_window_t *
+svn_txdelta__compose_window_chain(const apr_array_header_t *windows,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
+/* Like svn_txdelta_read_svndiff_window() but accept windows of up to
+ * SVN_DELTA__MAX_WINDOW_SIZE bytes, as stored by FSFS format 9.
+ */
+svn_error_t *
+svn_txdelta__read_large_svndiff_window(svn_txdelta_window_t **window,
+                                       svn_stream_t *stream,
+                                       int svndiff_version,
+                                       apr_pool_t *pool);
+
 /** Read the txdelta window header from @a stream and return the total
-    length of the unparsed window data in @a *window_len. */
+    length of the unparsed window data in @a *window_len.  Windows of up
+    to SVN_DELTA__MAX_WINDOW_SIZE bytes are accepted. */
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/* Read one svndiff window in SOURCE_VERSION format from STREAM and append
+ * it to OUTPUT, re-encoded for svndiff TARGET_VERSION with
+ * COMPRESSION_LEVEL.  Only the compression of the instruction and new data
+ * sections changes; the instructions themselves are copied without being
+ * parsed or validated.  Set *WINDOW_LEN to the number of bytes read from
+ * STREAM.
+ *
+ * If KEEP_LENGTH is set, TARGET_VERSION must be 3 and the re-encoded window
+ * will take exactly *WINDOW_LEN bytes, padded with skippable Zstandard
+ * frames and non-minimally encoded header fields.  This allows for
+ * replacing the window in place.  Set *FITS to FALSE and leave OUTPUT
+ * untouched if the window does not fit into the original length.
+ * Otherwise, set *FITS to TRUE.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_txdelta__transcode_svndiff_window(svn_stringbuf_t *output,
+                                      svn_boolean_t *fits,
+                                      apr_size_t *window_len,
+                                      svn_stream_t *stream,
+                                      int source_version,
+                                      int target_version,
+                                      int compression_level,
+                                      svn_boolean_t keep_length,
+                                      apr_pool_t *scratch_pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
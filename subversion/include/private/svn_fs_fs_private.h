@@ -353,6 +353,70 @@ typedef struct svn_fs_fs__ioctl_revision_size_output_t
 /* See svn_fs_fs__revision_size(). */
 SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_REVISION_SIZE, SVN_FS_TYPE_FSFS, 1003);
 
+/* Statistics returned by svn_fs_fs__recompress(). */
+typedef struct svn_fs_fs__recompress_stats_t
+{
+  /* Number of representations that got re-encoded. */
+  apr_int64_t reps_recompressed;
+
+  /* Number of representations left as they were, e.g. because they are
+   * not deltas, already use the latest svndiff version or would not fit
+   * into their current length after re-encoding. */
+  apr_int64_t reps_kept;
+} svn_fs_fs__recompress_stats_t;
+
+typedef struct svn_fs_fs__ioctl_recompress_input_t
+{
+  svn_fs_progress_notify_func_t progress_func;
+  void *progress_baton;
+} svn_fs_fs__ioctl_recompress_input_t;
+
+typedef struct svn_fs_fs__ioctl_recompress_output_t
+{
+  svn_fs_fs__recompress_stats_t *stats;
+} svn_fs_fs__ioctl_recompress_output_t;
+
+/* See svn_fs_fs__recompress(). */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_RECOMPRESS, SVN_FS_TYPE_FSFS, 1004);
+
+/* Statistics on the asynchronous readahead for block reads, accumulated
+ * over all FSFS repositories in this process. */
+typedef struct svn_fs_fs__readahead_stats_t
+{
+  /* Number of prefetch requests handed to the background threads. */
+  apr_int64_t requests;
+
+  /* Number of prefetch requests dropped because too many were pending,
+   * the same data was already being fetched or threads are unavailable. */
+  apr_int64_t dropped;
+
+  /* Number of prefetch requests that have been processed. */
+  apr_int64_t completed;
+
+  /* Bytes read by completed prefetch requests. */
+  apr_int64_t bytes_read;
+
+  /* Total time in microseconds that the background threads spent reading. */
+  apr_int64_t prefetch_usecs;
+
+  /* Number of synchronous block reads, i.e. cache misses that made the
+   * caller read from a rev / pack file. */
+  apr_int64_t block_reads;
+
+  /* Total time in microseconds that callers spent in these block reads.
+   * Effective readahead reduces the average. */
+  apr_int64_t block_read_usecs;
+} svn_fs_fs__readahead_stats_t;
+
+typedef struct svn_fs_fs__ioctl_get_readahead_stats_output_t
+{
+  svn_fs_fs__readahead_stats_t *stats;
+} svn_fs_fs__ioctl_get_readahead_stats_output_t;
+
+/* See svn_fs_fs__get_readahead_stats(). */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_GET_READAHEAD_STATS,
+                          SVN_FS_TYPE_FSFS, 1005);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
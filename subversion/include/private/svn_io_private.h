@@ -135,6 +135,48 @@ svn_stream__from_aprfile(apr_file_t *file,
                          svn_boolean_t truncate_on_seek,
                          apr_pool_t *pool);
 
+/* Read handler for svn_stream__view().  Set *DATA to the next *LEN bytes
+   of the stream behind BATON, in memory owned by the stream, and advance
+   the read position accordingly.  Set *LEN to fewer bytes only at EOF.
+   Return SVN_ERR_STREAM_NOT_SUPPORTED without consuming any data if the
+   stream cannot provide such a view.  */
+typedef svn_error_t *(*svn_stream__view_fn_t)(void *baton,
+                                              const char **data,
+                                              apr_size_t *len);
+
+/* Set STREAM's view function to VIEW_FN. */
+void
+svn_stream__set_view(svn_stream_t *stream,
+                     svn_stream__view_fn_t view_fn);
+
+/* Like svn_stream_read_full() but instead of copying *LEN bytes into a
+   caller-provided buffer, set *DATA to point to them in memory owned by
+   STREAM.  That memory remains valid until STREAM gets closed and the data
+   returned by consecutive calls is contiguous, i.e. *DATA of every call
+   directly follows the data returned by the previous call.
+
+   Return SVN_ERR_STREAM_NOT_SUPPORTED, without consuming any data, if
+   STREAM does not support this.  In-memory and memory-mapped streams do. */
+svn_error_t *
+svn_stream__view(svn_stream_t *stream,
+                 const char **data,
+                 apr_size_t *len);
+
+/* Return a read-only stream in *STREAM that reads the whole contents of
+   FILE from a memory mapping, allowing for svn_stream__view().  If
+   DISOWN is FALSE, FILE gets closed together with the stream.
+
+   If FILE can't be mapped, e.g. because it is empty or memory mapping is
+   not available, fall back to svn_stream_from_aprfile2().
+
+   Note that on Windows, mapped files can't be deleted while the stream
+   is open.  Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_stream__from_mapped_file(svn_stream_t **stream,
+                             apr_file_t *file,
+                             svn_boolean_t disown,
+                             apr_pool_t *result_pool);
+
 #if defined(WIN32)
 
 /* ### Move to something like io.h or subr.h, to avoid making it
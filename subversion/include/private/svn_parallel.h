@@ -0,0 +1,124 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_parallel.h
+ * @brief Running independent jobs on worker threads
+ */
+
+#ifndef SVN_PARALLEL_H
+#define SVN_PARALLEL_H
+
+#include <apr_pools.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_pool.h>
+#endif
+
+#include "svn_types.h"
+#include "svn_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Execute job number @a index for svn_parallel__run_jobs(), using
+ * the @a baton given to it.  This may get called from any thread,
+ * concurrently with other jobs.
+ *
+ * @a pool is private to this job.  It may be used for temporary data
+ * as well as for results, which remain valid until the respective
+ * #svn_parallel__job_done_t returned.
+ */
+typedef svn_error_t *
+(*svn_parallel__job_func_t)(void *baton,
+                            int index,
+                            apr_pool_t *pool);
+
+/**
+ * Process the results of job number @a index for svn_parallel__run_jobs(),
+ * using the @a baton given to it.  @a job_err is the error returned by
+ * the job; this function takes ownership of it.  @a pool is the one that
+ * the job got.
+ *
+ * This will be called from the thread that called svn_parallel__run_jobs()
+ * and strictly in ascending order of @a index.
+ */
+typedef svn_error_t *
+(*svn_parallel__job_done_t)(void *baton,
+                            int index,
+                            svn_error_t *job_err,
+                            apr_pool_t *pool);
+
+/**
+ * Run the jobs number 0 to @a job_count-1 by calling @a job_func with
+ * @a baton for each of them, using up to @a max_threads worker threads
+ * from a process-wide thread pool.  Pass the results of each job to
+ * @a done_func with @a baton, in the order of the job numbers.
+ *
+ * Only a limited number of jobs will be started ahead of the oldest one
+ * that has not been processed by @a done_func, yet.  So, callers may
+ * rely on that to limit memory usage.
+ *
+ * If @a done_func returns an error, stop starting new jobs, wait for the
+ * ones still running, discard their results and return that error.
+ *
+ * Without thread support or if @a max_threads is 1 or less, simply run
+ * each job in turn, followed by its @a done_func.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_parallel__run_jobs(int job_count,
+                       int max_threads,
+                       svn_parallel__job_func_t job_func,
+                       svn_parallel__job_done_t done_func,
+                       void *baton,
+                       apr_pool_t *scratch_pool);
+
+#if APR_HAS_THREADS
+
+/** Maximum number of threads in the pool returned by
+ * svn_parallel__get_thread_pool().
+ */
+#define SVN_PARALLEL__MAX_THREADS 64
+
+/**
+ * Set @a *thread_pool to the process-wide pool of worker threads, creating
+ * it upon first use.  It runs at most #SVN_PARALLEL__MAX_THREADS tasks at
+ * a time and refuses to queue any more, i.e. apr_thread_pool_push() will
+ * fail if all threads are busy.  Callers should then run the task
+ * themselves and must limit the number of tasks they have in flight.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_parallel__get_thread_pool(apr_thread_pool_t **thread_pool,
+                              apr_pool_t *scratch_pool);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_PARALLEL_H */
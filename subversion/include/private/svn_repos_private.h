@@ -390,6 +390,21 @@ svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
                            const char *update_anchor_relpath,
                            apr_pool_t *pool);
 
+/**
+ * Parse the list of cache warm-up targets in @a text and return them in
+ * @a *targets as an array of #svn_repos_warm_cache_target_t *, allocated
+ * in @a result_pool.
+ *
+ * Every line of @a text names one target as "PATH[@REV]".  REV may also
+ * be "HEAD".  Leading and trailing whitespace is ignored, as are empty
+ * lines and lines starting with '#'.  The paths will be returned as they
+ * are, i.e. it is up to the caller to interpret and canonicalize them.
+ */
+svn_error_t *
+svn_repos__parse_warm_cache_targets(apr_array_header_t **targets,
+                                    const char *text,
+                                    apr_pool_t *result_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
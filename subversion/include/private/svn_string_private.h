@@ -254,6 +254,20 @@ svn_string__similarity(const svn_string_t *stringa,
                        svn_membuf_t *buffer, apr_size_t *rlcs);
 
 
+/* Defined to 1 if the compiler targets a CPU that is guaranteed to support
+ * the SSE2 instruction set, i.e. any x86-64 and explicitly configured x86
+ * builds.  Code using the SSE2 intrinsics from <emmintrin.h> must provide
+ * a portable fallback for the other platforms.
+ */
+#ifndef SVN__SSE2_AVAILABLE
+# if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) \
+     || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SVN__SSE2_AVAILABLE 1
+# else
+#  define SVN__SSE2_AVAILABLE 0
+# endif
+#endif
+
 /* Return the lowest position at which A and B differ. If no difference
  * can be found in the first MAX_LEN characters, MAX_LEN will be returned.
  */
@@ -591,6 +591,35 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* Return TRUE if Subversion has been built with Zstandard support.
+ * If this returns FALSE, svn__compress_zstd() and svn__decompress_zstd()
+ * fail with SVN_ERR_UNSUPPORTED_FEATURE.
+ */
+svn_boolean_t
+svn__zstd_available(void);
+
+/* Same as svn__compress_zlib(), but use Zstandard compression at
+ * COMPRESSION_LEVEL, which must be within 1 .. SVN__ZSTD_MAX_LEVEL.
+ */
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_level);
+
+/* Same as svn__decompress_zlib(), but use Zstandard compression.
+ */
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit);
+
+/* Zstandard compression level used when no explicit level is given. */
+#define SVN__ZSTD_DEFAULT_LEVEL 3
+
+/* Highest Zstandard compression level we accept.  Higher levels exist
+ * but need much more memory per window for little gain. */
+#define SVN__ZSTD_MAX_LEVEL 19
+
 /** @} */
 
 /**
@@ -746,6 +775,16 @@ const char *svn_lz4__compiled_version(void);
  */
 int svn_lz4__runtime_version(void);
 
+/* Return the zstd version we compiled against or NULL if we have been
+ * built without zstd support. */
+const char *svn_zstd__compiled_version(void);
+
+/* Return the zstd version we run against as a composed value:
+ * major * 100 * 100 + minor * 100 + release, or 0 if we have been
+ * built without zstd support.
+ */
+int svn_zstd__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
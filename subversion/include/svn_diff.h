@@ -455,6 +455,29 @@ typedef enum svn_diff_file_ignore_space_t
   svn_diff_file_ignore_space_all
 } svn_diff_file_ignore_space_t;
 
+/** The algorithm used to find the longest common subsequence of lines.
+ *
+ * @since New in 1.14.
+ */
+typedef enum svn_diff_algorithm_t
+{
+  /** Use #svn_diff_algorithm_myers but switch to
+   * #svn_diff_algorithm_histogram when the number of differences makes
+   * the former too expensive. */
+  svn_diff_algorithm_auto,
+
+  /** Always find a minimal diff, using the O(NP) algorithm by Wu, Manber,
+   * Myers and Miller.  Its run time grows with the product of the input
+   * size and the number of differences. */
+  svn_diff_algorithm_myers,
+
+  /** Histogram diff: recursively match the rarest common lines first,
+   * similar to patience diff.  This is fast even for large files with
+   * many repeated lines and tends to keep blocks of code together, but
+   * the result is not necessarily minimal. */
+  svn_diff_algorithm_histogram
+} svn_diff_algorithm_t;
+
 /** Options to control the behaviour of the file diff routines.
  *
  * @since New in 1.4.
@@ -487,6 +510,17 @@ typedef struct svn_diff_file_options_t
    *
    * @since New in 1.9 */
   int context_size;
+
+  /** The algorithm to use.  The default is #svn_diff_algorithm_auto.
+   *
+   * @since New in 1.14 */
+  svn_diff_algorithm_t algorithm;
+
+  /** The approximate amount of memory in bytes that svn_diff_file_merge3()
+   * may use for the merge.  The default of 0 means no limit.
+   *
+   * @since New in 1.14 */
+  apr_size_t memory_budget;
 } svn_diff_file_options_t;
 
 /** Allocate a @c svn_diff_file_options_t structure in @a pool, initializing
@@ -510,6 +544,10 @@ svn_diff_file_options_create(apr_pool_t *pool);
  * - --ignore-eol-style
  * - --show-c-function, -p @since New in 1.5.
  * - --context, -U ARG @since New in 1.9.
+ * - --diff-algorithm ARG, with ARG being one of "auto", "myers" and
+ *   "histogram" @since New in 1.14.
+ * - --memory-budget ARG, with ARG being the memory budget for merges
+ *   in megabytes @since New in 1.14.
  * - --unified, -u (for compatibility, does nothing).
  */
 svn_error_t *
@@ -734,6 +772,56 @@ svn_diff_file_output_merge3(svn_stream_t *output_stream,
                             void *cancel_baton,
                             apr_pool_t *scratch_pool);
 
+/** A convenience function to merge three files without keeping all of
+ * them in memory at once.
+ *
+ * Merge the changes between @a original_path and @a latest_path into
+ * @a modified_path and write the result to @a output_stream, just like
+ * calling svn_diff_file_diff3_2() followed by svn_diff_file_output_merge3()
+ * would.  The conflict markers and @a conflict_style are interpreted as
+ * for svn_diff_file_output_merge3().
+ *
+ * If @a options->memory_budget is not 0, the files are read in segments
+ * that fit into roughly that much memory.  The segments are cut at lines
+ * that are identical and unique in all three files and get merged one
+ * after another, writing the output as we go.  Identical lines at the
+ * start of a segment are copied to the output without being diffed at
+ * all.  If no such line can be found within a segment, the files are cut
+ * at the segment ends, which may produce conflicts that a merge of the
+ * whole files would not report.  A single line must always fit into a
+ * segment, so very long lines may exceed the budget.
+ *
+ * Without a memory budget or with @a conflict_style being
+ * #svn_diff_conflict_display_only_conflicts, the files get merged as a
+ * whole.
+ *
+ * If not @c NULL, set @a *contains_diffs and @a *contains_conflicts to
+ * whether the merge found any differences and conflicts, respectively.
+ *
+ * If not @c NULL, call @a cancel_func with @a cancel_baton once or multiple
+ * times while processing larger files.
+ *
+ * Uses @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.14.
+ */
+svn_error_t *
+svn_diff_file_merge3(svn_boolean_t *contains_diffs,
+                     svn_boolean_t *contains_conflicts,
+                     svn_stream_t *output_stream,
+                     const char *original_path,
+                     const char *modified_path,
+                     const char *latest_path,
+                     const svn_diff_file_options_t *options,
+                     const char *conflict_original,
+                     const char *conflict_modified,
+                     const char *conflict_latest,
+                     const char *conflict_separator,
+                     svn_diff_conflict_display_style_t conflict_style,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
 /** Similar to svn_diff_file_output_merge3, but without cancel support.
  *
  * @since New in 1.6.
@@ -1492,6 +1492,16 @@ SVN_ERROR_START
              SVN_ERR_MISC_CATEGORY_START + 47,
              "Could not canonicalize path or URI")
 
+  /** @since New in 1.14. */
+  SVN_ERRDEF(SVN_ERR_ZSTD_COMPRESSION_FAILED,
+             SVN_ERR_MISC_CATEGORY_START + 48,
+             "Zstandard compression failed")
+
+  /** @since New in 1.14. */
+  SVN_ERRDEF(SVN_ERR_ZSTD_DECOMPRESSION_FAILED,
+             SVN_ERR_MISC_CATEGORY_START + 49,
+             "Zstandard decompression failed")
+
   /* command-line client errors */
 
   SVN_ERRDEF(SVN_ERR_CL_ARG_PARSING_ERROR,
@@ -146,6 +146,39 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_BLOCK_READ           "fsfs-block-read"
 
+/** Enable / disable asynchronous readahead of FSFS format 7 rev and pack
+ * file blocks.  If enabled, background threads will fetch the blocks that
+ * the current read is likely to be followed by.  This option is ignored
+ * unless #SVN_FS_CONFIG_FSFS_BLOCK_READ is enabled as well and defaults
+ * to the value of that option.
+ *
+ * @since New in 1.14.
+ */
+#define SVN_FS_CONFIG_FSFS_READAHEAD            "fsfs-readahead"
+
+/** String with a decimal representation of the maximum number of bytes
+ * that FSFS may memory-map in this process.  If non-zero, read-only pack
+ * files will be mapped as a whole as long as the total size of all
+ * mappings stays within that limit.  Reads from these files then don't
+ * require any system calls.  All readers of a pack file in this process
+ * share the same mapping.  The default is "0", i.e. no mapping.
+ *
+ * @since New in 1.14.
+ */
+#define SVN_FS_CONFIG_FSFS_MMAP_BUDGET          "fsfs-mmap-budget"
+
+/** Enable / disable the in-memory Bloom filter in front of the FSFS
+ * rep-cache database.  If enabled, lookups of representations that are
+ * definitely not in the rep-cache will not query the database.  The
+ * filter is shared within the process and persisted next to the database.
+ * Building it for the first time requires reading the whole database.
+ * If not set, the "enable-rep-cache-filter" option in the repository's
+ * fsfs.conf applies, which defaults to "false".
+ *
+ * @since New in 1.14.
+ */
+#define SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER     "fsfs-rep-cache-filter"
+
 /** String with a decimal representation of the FSFS format shard size.
  * Zero ("0") means that a repository with linear layout should be created.
  *
@@ -227,6 +260,26 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_NO_FLUSH_TO_DISK          "no-flush-to-disk"
 
+/** Number of threads that svn_fs_verify() may use to check independent
+ * parts of the filesystem concurrently.  Backends that don't support this
+ * ignore the option.  If it is larger than "1", the @c cancel_func passed
+ * to svn_fs_verify() may be called from any of these threads.  Defaults
+ * to "1".
+ *
+ * @since New in 1.14.
+ */
+#define SVN_FS_CONFIG_VERIFY_JOBS               "verify-jobs"
+
+/** Number of threads that svn_fs_pack2() may use to pack independent
+ * shards concurrently.  Backends that don't support this ignore the
+ * option.  If it is larger than "1", the @c cancel_func passed to
+ * svn_fs_pack2() may be called from any of these threads.  Defaults
+ * to "1".
+ *
+ * @since New in 1.14.
+ */
+#define SVN_FS_CONFIG_PACK_JOBS                 "pack-jobs"
+
 /** @} */
 
 
@@ -3302,10 +3355,32 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
 
 /**
  * Possibly update the filesystem located in the directory @a path
- * to use disk space more efficiently.
+ * to use disk space more efficiently.  Use the backend-specific
+ * configuration @a fs_config when opening the filesystem.  @a NULL is
+ * valid for all backends.
+ *
+ * Shards are always made visible to readers in ascending order, even
+ * if #SVN_FS_CONFIG_PACK_JOBS lets the backend pack several of them at
+ * once.  @a notify_func will only be called from the current thread.
+ *
+ * @since New in 1.14.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a fs_config set to @c NULL.
  *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.13 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
@@ -250,7 +250,10 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A path has been loaded into the caches. @since New in 1.14. */
+  svn_repos_notify_warm_cache_path
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -317,8 +320,8 @@ typedef struct svn_repos_notify_t
   /** Action that describes what happened in the repository. */
   svn_repos_notify_action_t action;
 
-  /** For #svn_repos_notify_dump_rev_end and #svn_repos_notify_verify_rev_end,
-   * the revision which just completed.
+  /** For #svn_repos_notify_dump_rev_end, #svn_repos_notify_verify_rev_end
+   * and #svn_repos_notify_warm_cache_path, the revision which just completed.
    * For #svn_fs_upgrade_format_bumped, the new format version. */
   svn_revnum_t revision;
 
@@ -348,7 +351,8 @@ typedef struct svn_repos_notify_t
       node. */
   enum svn_node_action node_action;
 
-  /** For #svn_repos_notify_load_node_start, the path of the node. */
+  /** For #svn_repos_notify_load_node_start and
+      #svn_repos_notify_warm_cache_path, the path of the node. */
   const char *path;
 
   /** For #svn_repos_notify_hotcopy_rev_range, the start of the copied
@@ -728,10 +732,31 @@ svn_repos_hotcopy(const char *src_path,
 
 /**
  * Possibly update the repository, @a repos, to use a more efficient
- * filesystem representation.  Use @a pool for allocations.
+ * filesystem representation.  Use up to @a jobs threads to pack
+ * independent parts of the repository concurrently; notifications are
+ * still sent in order from the current thread but @a cancel_func may be
+ * called from any of these threads.  When using more than one thread,
+ * the caches must not be configured for single-threaded access, see
+ * svn_cache_config_set().  Use @a pool for allocations.
+ *
+ * @since New in 1.14.
+ */
+svn_error_t *
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Like svn_repos_fs_pack3(), but with @a jobs set to 1.
  *
  * @since New in 1.7.
+ * @deprecated Provided for backward compatibility with the 1.13 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_fs_pack2(svn_repos_t *repos,
                    svn_repos_notify_func_t notify_func,
@@ -740,6 +765,65 @@ svn_repos_fs_pack2(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool);
 
+/**
+ * A path in a specific revision, to be loaded into the caches by
+ * svn_repos_warm_cache().
+ *
+ * @since New in 1.14.
+ */
+typedef struct svn_repos_warm_cache_target_t
+{
+  /** The absolute path of the node within the repository. */
+  const char *path;
+
+  /** The revision to read @a path in.  #SVN_INVALID_REVNUM means HEAD. */
+  svn_revnum_t revision;
+} svn_repos_warm_cache_target_t;
+
+/**
+ * Preload the in-memory caches of the filesystem in @a repos with the
+ * data that will be needed to access the nodes given in @a targets,
+ * an array of #svn_repos_warm_cache_target_t *.  This reads the node
+ * revisions, properties, directory contents and file contents of those
+ * nodes and, depending on @a depth, of the nodes below them.
+ *
+ * If @a recent_revisions is larger than 0, also load all nodes that got
+ * added or modified below the respective target path in the
+ * @a recent_revisions revisions up to and including the target revision.
+ * That is a useful heuristic when no list of actually used paths is
+ * available.
+ *
+ * The caches being filled are those of the current process.  This is
+ * useful for servers at startup but also to create a cache snapshot that
+ * servers can load.  Make sure to open @a repos with the same cache
+ * settings, in particular the same cache namespace, as the server.
+ *
+ * Targets that do not exist in the given revision will be ignored.
+ *
+ * If @a notify_func is not @c NULL, call it with @a notify_baton after
+ * each target or changed path with
+ *   @c action = #svn_repos_notify_warm_cache_path
+ *   @c path = the path loaded
+ *   @c revision = its revision
+ *
+ * If @a cancel_func is not @c NULL, call it periodically with
+ * @a cancel_baton as argument to see if the caller wishes to cancel.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.14.
+ */
+svn_error_t *
+svn_repos_warm_cache(svn_repos_t *repos,
+                     const apr_array_header_t *targets,
+                     svn_depth_t depth,
+                     int recent_revisions,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
 /**
  * Similar to svn_repos_fs_pack2(), but with a #svn_fs_pack_notify_t instead
  * of a #svn_repos_notify_t.
@@ -3134,10 +3218,10 @@ enum svn_repos_load_uuid
   svn_repos_load_uuid_force
 };
 
-/** Callback type for use with svn_repos_verify_fs3().  @a revision
+/** Callback type for use with svn_repos_verify_fs4().  @a revision
  * and @a verify_err are the details of a single verification failure
- * that occurred during the svn_repos_verify_fs3() call.  @a baton is
- * the same baton given to svn_repos_verify_fs3().  @a scratch_pool is
+ * that occurred during the svn_repos_verify_fs4() call.  @a baton is
+ * the same baton given to svn_repos_verify_fs4().  @a scratch_pool is
  * provided for the convenience of the implementor, who should not
  * expect it to live longer than a single callback call.
  *
@@ -3147,7 +3231,7 @@ enum svn_repos_load_uuid
  * should also call svn_error_dup() for @a verify_err.  Implementors of this
  * callback are forbidden to call svn_error_clear() for @a verify_err.
  *
- * @see svn_repos_verify_fs3
+ * @see svn_repos_verify_fs4
  *
  * @since New in 1.9.
  */
@@ -3176,6 +3260,14 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * file context reconstruction and verification.  For FSFS format 7+ and
  * FSX, this allows for a very fast check against external corruption.
  *
+ * Use up to @a jobs threads to verify independent revisions concurrently;
+ * the file system backend may use as many threads for its own checks.
+ * Notifications, @a verify_callback invocations and the reported errors
+ * will be the same and in the same order as for a single thread but
+ * @a cancel_func may be called from any of these threads.  When using
+ * more than one thread, the caches must not be configured for
+ * single-threaded access, see svn_cache_config_set().
+ *
  * If @a verify_callback is not @c NULL, call it with @a verify_baton upon
  * receiving an FS-specific structure failure or a revision verification
  * failure.  Set @c revision callback argument to #SVN_INVALID_REVNUM or
@@ -3224,8 +3316,30 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.14.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.13 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -3283,7 +3397,7 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * Dump the contents of the filesystem within already-open @a repos into
  * writable @a dumpstream.  If @a dumpstream is
  * @c NULL, this is effectively a primitive verify.  It is not complete,
- * however; see instead svn_repos_verify_fs3().
+ * however; see instead svn_repos_verify_fs4().
  *
  * Begin at revision @a start_rev, and dump every revision up through
  * @a end_rev.  If @a start_rev is #SVN_INVALID_REVNUM, start at revision
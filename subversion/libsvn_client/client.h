@@ -682,6 +682,72 @@ svn_client__get_diff_editor2(const svn_delta_editor_t **editor,
 /* ---------------------------------------------------------------- */
 
 
+/*** Concurrent file diffs ***/
+
+/* A queue of file content diffs that get computed on worker threads while
+   the diff drive continues.  All output, whether it comes from the queued
+   diffs or has been written to the queue's stream, appears in the order in
+   which it has been queued. */
+typedef struct svn_client__diff_queue_t svn_client__diff_queue_t;
+
+/* Set *QUEUE to a new diff queue that writes to OUTSTREAM and computes up
+   to MAX_THREADS diffs concurrently.  Set *QUEUE_STREAM to a stream that
+   writes to OUTSTREAM behind the output of all diffs queued so far.
+   Closing *QUEUE_STREAM does not close OUTSTREAM.
+
+   Without thread support or if MAX_THREADS is 1 or less, set *QUEUE to
+   NULL and *QUEUE_STREAM to OUTSTREAM.
+
+   Pending diffs will be waited for when RESULT_POOL gets cleaned up.
+   Allocate *QUEUE in RESULT_POOL.
+ */
+svn_error_t *
+svn_client__diff_queue_create(svn_client__diff_queue_t **queue,
+                              svn_stream_t **queue_stream,
+                              svn_stream_t *outstream,
+                              int max_threads,
+                              apr_pool_t *result_pool);
+
+/* Set *FITS to TRUE if the contents of FILE1 and FILE2 are small enough
+   to be diffed in QUEUE.  Otherwise, set it to FALSE and write the output
+   of all queued diffs, so the caller may produce the diff by itself
+   without its output being buffered.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_client__diff_queue_fits(svn_boolean_t *fits,
+                            svn_client__diff_queue_t *queue,
+                            const char *file1,
+                            const char *file2,
+                            apr_pool_t *scratch_pool);
+
+/* Read FILE1 and FILE2 and queue a unified diff of them with LABEL1 and
+   LABEL2 as the file labels in QUEUE, like svn_diff_file_diff_2() and
+   svn_diff_file_output_unified4() with OPTIONS and HEADER_ENCODING would.
+   OPTIONS must remain valid and unchanged until all diffs in QUEUE have
+   been written.  The diff is preceded by HEADER, unless the files don't
+   differ and WRITE_HEADER_ALWAYS is FALSE.
+
+   Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_client__diff_queue_push(svn_client__diff_queue_t *queue,
+                            const char *file1,
+                            const char *file2,
+                            const char *label1,
+                            const char *label2,
+                            const svn_string_t *header,
+                            svn_boolean_t write_header_always,
+                            const svn_diff_file_options_t *options,
+                            const char *header_encoding,
+                            apr_pool_t *scratch_pool);
+
+/* Wait for all diffs in QUEUE and write their output. */
+svn_error_t *
+svn_client__diff_queue_finish(svn_client__diff_queue_t *queue);
+
+/* ---------------------------------------------------------------- */
+
+
 /*** Copy Stuff ***/
 
 /* This structure is used to associate a specific copy or move SRC with a
@@ -49,6 +49,7 @@
 #include "svn_config.h"
 #include "svn_props.h"
 #include "svn_subst.h"
+#include "svn_sorts.h"
 #include "client.h"
 
 #include "private/svn_wc_private.h"
@@ -742,6 +743,10 @@ typedef struct diff_writer_info_t
   /* Empty files for creating diffs or NULL if not used yet */
   const char *empty_file;
 
+  /* If not NULL, file diffs may be computed concurrently through this
+     queue.  OUTSTREAM writes into it then. */
+  svn_client__diff_queue_t *queue;
+
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
 
@@ -860,7 +865,10 @@ transform_link_to_git(const char **new_tmpfile,
 
    If FORCE_DIFF is TRUE, always write a diff, even for empty diffs.
 
-   Set *WROTE_HEADER to TRUE if a diff header was written */
+   Set *WROTE_HEADER to TRUE if a diff header was written.  WROTE_HEADER
+   may be NULL if the caller does not need to know.  Only then may the
+   diff be computed asynchronously, unless FORCE_DIFF is set or git diffs
+   are written (because the header will be written anyway). */
 static svn_error_t *
 diff_content_changed(svn_boolean_t *wrote_header,
                      const char *diff_relpath,
@@ -886,11 +894,15 @@ diff_content_changed(svn_boolean_t *wrote_header,
   const char *mimetype1 = svn_prop_get_value(left_props, SVN_PROP_MIME_TYPE);
   const char *mimetype2 = svn_prop_get_value(right_props, SVN_PROP_MIME_TYPE);
   const char *index_shas = NULL;
+  svn_boolean_t unused_wrote_header;
 
   /* If only property differences are shown, there's nothing to do. */
   if (dwi->properties_only)
     return SVN_NO_ERROR;
 
+  if (!wrote_header)
+    wrote_header = &unused_wrote_header;
+
   /* Generate the diff headers. */
   SVN_ERR(adjust_paths_for_diff_labels(&index_path,
                                        &label_path1, &label_path2,
@@ -1076,6 +1088,54 @@ diff_content_changed(svn_boolean_t *wrote_header,
   else   /* use libsvn_diff to generate the diff  */
     {
       svn_diff_t *diff;
+      svn_boolean_t queue_diff = FALSE;
+
+      /* Can we let the queue compute the diff?  It does not support
+         showing C function names and we can't tell whether it will
+         write a header, if it is optional. */
+      if (   dwi->queue
+          && !dwi->options.for_internal->show_c_function
+          && (   force_diff
+              || dwi->use_git_diff_format
+              || wrote_header == &unused_wrote_header))
+        SVN_ERR(svn_client__diff_queue_fits(&queue_diff, dwi->queue,
+                                            tmpfile1, tmpfile2,
+                                            scratch_pool));
+
+      if (queue_diff)
+        {
+          svn_stringbuf_t *header = svn_stringbuf_create_empty(scratch_pool);
+          svn_stream_t *header_stream
+            = svn_stream_from_stringbuf(header, scratch_pool);
+          svn_boolean_t write_header_always
+            = force_diff || dwi->use_git_diff_format;
+
+          SVN_ERR(print_diff_index_header(header_stream, dwi->header_encoding,
+                                          index_path, "", scratch_pool));
+          if (dwi->use_git_diff_format)
+            SVN_ERR(print_git_diff_header(header_stream,
+                                          &label1, &label2,
+                                          operation,
+                                          rev1, rev2,
+                                          diff_relpath,
+                                          copyfrom_path, copyfrom_rev,
+                                          left_props, right_props,
+                                          index_shas,
+                                          dwi->header_encoding,
+                                          &dwi->ddi, scratch_pool));
+
+          SVN_ERR(svn_client__diff_queue_push(dwi->queue, tmpfile1, tmpfile2,
+                                              label1, label2,
+                                              svn_string_create_from_buf(
+                                                header, scratch_pool),
+                                              write_header_always,
+                                              dwi->options.for_internal,
+                                              dwi->header_encoding,
+                                              scratch_pool));
+          *wrote_header = write_header_always;
+
+          return SVN_NO_ERROR;
+        }
 
       SVN_ERR(svn_diff_file_diff_2(&diff, tmpfile1, tmpfile2,
                                    dwi->options.for_internal,
@@ -1138,7 +1198,9 @@ diff_file_changed(const char *relpath,
   svn_boolean_t wrote_header = FALSE;
 
   if (file_modified)
-    SVN_ERR(diff_content_changed(&wrote_header, relpath,
+    SVN_ERR(diff_content_changed(prop_changes->nelts > 0 ? &wrote_header
+                                                         : NULL,
+                                 relpath,
                                  left_file, right_file,
                                  left_source->revision,
                                  right_source->revision,
@@ -1289,7 +1351,9 @@ diff_file_deleted(const char *relpath,
                                          dwi->pool, scratch_pool));
 
       if (left_file)
-        SVN_ERR(diff_content_changed(&wrote_header, relpath,
+        SVN_ERR(diff_content_changed((left_props && apr_hash_count(left_props))
+                                       ? &wrote_header : NULL,
+                                     relpath,
                                      left_file, dwi->empty_file,
                                      left_source->revision,
                                      DIFF_REVNUM_NONEXISTENT,
@@ -2618,10 +2682,15 @@ create_diff_writer_info(diff_writer_info_t *dwi,
 
 /* Set up *DIFF_PROCESSOR and *DDI for normal and git-style diffs (but not
  * summary diffs).
+ *
+ * If QUEUE is not NULL, the file diffs may be computed concurrently, as
+ * configured in CTX.  Set *QUEUE to the svn_client__diff_queue_t that the
+ * caller must finish after driving the processor then, or to NULL.
  */
 static svn_error_t *
 get_diff_processor(svn_diff_tree_processor_t **diff_processor,
                    struct diff_driver_info_t **ddi,
+                   svn_client__diff_queue_t **queue,
                    const apr_array_header_t *options,
                    const char *relative_to_dir,
                    svn_boolean_t no_diff_added,
@@ -2660,6 +2729,26 @@ get_diff_processor(svn_diff_tree_processor_t **diff_processor,
   dwi->show_copies_as_adds = show_copies_as_adds;
   dwi->pretty_print_mergeinfo = pretty_print_mergeinfo;
 
+  if (queue)
+    {
+      apr_int64_t max_threads = 1;
+
+      if (ctx->config && !dwi->diff_cmd)
+        {
+          svn_config_t *cfg = svn_hash_gets(ctx->config,
+                                            SVN_CONFIG_CATEGORY_CONFIG);
+          SVN_ERR(svn_config_get_int64(cfg, &max_threads,
+                                       SVN_CONFIG_SECTION_MISCELLANY,
+                                       SVN_CONFIG_OPTION_DIFF_THREADS, 1));
+        }
+
+      SVN_ERR(svn_client__diff_queue_create(&dwi->queue, &dwi->outstream,
+                                            outstream,
+                                            (int)MIN(max_threads, APR_INT32_MAX),
+                                            pool));
+      *queue = dwi->queue;
+    }
+
   dwi->cancel_func = ctx->cancel_func;
   dwi->cancel_baton = ctx->cancel_baton;
 
@@ -2705,7 +2794,7 @@ svn_client__get_diff_writer_svn(
 {
   struct diff_driver_info_t *ddi;
 
-  SVN_ERR(get_diff_processor(diff_processor, &ddi,
+  SVN_ERR(get_diff_processor(diff_processor, &ddi, NULL,
                              options,
                              relative_to_dir,
                              no_diff_added,
@@ -2788,6 +2877,7 @@ svn_client_diff7(const apr_array_header_t *options,
   svn_opt_revision_t peg_revision;
   svn_diff_tree_processor_t *diff_processor;
   struct diff_driver_info_t *ddi;
+  svn_client__diff_queue_t *queue;
 
   if (ignore_properties && properties_only)
     return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
@@ -2801,7 +2891,7 @@ svn_client_diff7(const apr_array_header_t *options,
   if (show_copies_as_adds || use_git_diff_format)
     ignore_ancestry = FALSE;
 
-  SVN_ERR(get_diff_processor(&diff_processor, &ddi,
+  SVN_ERR(get_diff_processor(&diff_processor, &ddi, &queue,
                              options,
                              relative_to_dir,
                              no_diff_added,
@@ -2816,13 +2906,18 @@ svn_client_diff7(const apr_array_header_t *options,
                              outstream, errstream,
                              ctx, pool));
 
-  return svn_error_trace(do_diff(ddi,
-                                 path_or_url1, path_or_url2,
-                                 revision1, revision2,
-                                 &peg_revision, TRUE /* no_peg_revision */,
-                                 depth, ignore_ancestry, changelists,
-                                 TRUE /* text_deltas */,
-                                 diff_processor, ctx, pool, pool));
+  SVN_ERR(do_diff(ddi,
+                  path_or_url1, path_or_url2,
+                  revision1, revision2,
+                  &peg_revision, TRUE /* no_peg_revision */,
+                  depth, ignore_ancestry, changelists,
+                  TRUE /* text_deltas */,
+                  diff_processor, ctx, pool, pool));
+
+  if (queue)
+    SVN_ERR(svn_client__diff_queue_finish(queue));
+
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
@@ -2851,6 +2946,7 @@ svn_client_diff_peg7(const apr_array_header_t *options,
 {
   svn_diff_tree_processor_t *diff_processor;
   struct diff_driver_info_t *ddi;
+  svn_client__diff_queue_t *queue;
 
   if (ignore_properties && properties_only)
     return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
@@ -2861,7 +2957,7 @@ svn_client_diff_peg7(const apr_array_header_t *options,
   if (show_copies_as_adds || use_git_diff_format)
     ignore_ancestry = FALSE;
 
-  SVN_ERR(get_diff_processor(&diff_processor, &ddi,
+  SVN_ERR(get_diff_processor(&diff_processor, &ddi, &queue,
                              options,
                              relative_to_dir,
                              no_diff_added,
@@ -2876,13 +2972,18 @@ svn_client_diff_peg7(const apr_array_header_t *options,
                              outstream, errstream,
                              ctx, pool));
 
-  return svn_error_trace(do_diff(ddi,
-                                 path_or_url, path_or_url,
-                                 start_revision, end_revision,
-                                 peg_revision, FALSE /* no_peg_revision */,
-                                 depth, ignore_ancestry, changelists,
-                                 TRUE /* text_deltas */,
-                                 diff_processor, ctx, pool, pool));
+  SVN_ERR(do_diff(ddi,
+                  path_or_url, path_or_url,
+                  start_revision, end_revision,
+                  peg_revision, FALSE /* no_peg_revision */,
+                  depth, ignore_ancestry, changelists,
+                  TRUE /* text_deltas */,
+                  diff_processor, ctx, pool, pool));
+
+  if (queue)
+    SVN_ERR(svn_client__diff_queue_finish(queue));
+
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
@@ -0,0 +1,469 @@
+/*
+ * diff_parallel.c: computing file diffs on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ==================================================================== */
+
+
+
+/*** Includes. ***/
+
+#include <apr_pools.h>
+
+#include "svn_pools.h"
+#include "svn_diff.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_parallel.h"
+#include "private/svn_string_private.h"
+#include "private/svn_thread_cond.h"
+
+#include "client.h"
+#include "svn_private_config.h"
+
+
+/*
+ * The tree processor callbacks that produce 'svn diff' output get called
+ * one node at a time, and the temporary files that they get to see only
+ * live until the callback returns.  So, we read both files into memory,
+ * diff them on a worker thread and let the diff drive continue meanwhile.
+ *
+ * To keep the output in order, all output goes through a ring buffer of
+ * entries.  An entry either holds a diff in progress or the text that the
+ * callbacks wrote to the queue's stream after the previous diff had been
+ * queued.  Entries get written to the actual output stream strictly in
+ * ring buffer order, as soon as they are complete.
+ */
+
+/* Files that are larger than this in total don't get queued. */
+#define MAX_QUEUED_DIFF_SIZE (16 * 1024 * 1024)
+
+/* Maximum number of bytes of file contents that all diffs in a queue may
+ * hold in memory together. */
+#define MAX_QUEUED_CONTENTS (64 * 1024 * 1024)
+
+/* Maximum number of files that a single queue diffs concurrently. */
+#define MAX_DIFF_THREADS 16
+
+/* One element of the ring buffer in a svn_client__diff_queue_t. */
+typedef struct queue_entry_t
+{
+  /* Private pool for all data of this entry.  It gets cleared whenever
+     the entry has been written. */
+  apr_pool_t *pool;
+
+  /* The text to write for this entry, allocated in POOL. */
+  svn_stringbuf_t *output;
+
+  /* The file contents to diff or NULL if this entry only holds text. */
+  svn_string_t *original;
+  svn_string_t *modified;
+
+  /* Parameters of the diff, as passed to svn_client__diff_queue_push(). */
+  const char *label1;
+  const char *label2;
+  const svn_string_t *header;
+  svn_boolean_t write_header_always;
+  const svn_diff_file_options_t *options;
+  const char *header_encoding;
+
+  /* Result of the diff. */
+  svn_error_t *result;
+
+  /* Set once OUTPUT is complete.  Protected by the mutex in QUEUE. */
+  svn_boolean_t done;
+
+  /* The queue that this entry belongs to. */
+  svn_client__diff_queue_t *queue;
+} queue_entry_t;
+
+struct svn_client__diff_queue_t
+{
+  /* Where all output finally goes to. */
+  svn_stream_t *outstream;
+
+#if APR_HAS_THREADS
+  /* The shared worker threads. */
+  apr_thread_pool_t *thread_pool;
+#endif
+
+  /* Thread-safe root pool, parent of all entry pools. */
+  apr_pool_t *pool;
+
+  /* Ring buffer of ENTRY_COUNT entries.  The oldest unwritten entry is in
+     slot FIRST and there are PENDING entries in use. */
+  queue_entry_t *entries;
+  int entry_count;
+  int first;
+  int pending;
+
+  /* Sum of the sizes of all file contents in pending entries. */
+  apr_size_t queued_contents;
+
+  /* Synchronize the workers with the thread waiting for results. */
+  svn_mutex__t *mutex;
+  svn_thread_cond__t *cond;
+};
+
+/* Diff the contents in ENTRY and write the result to its output. */
+static svn_error_t *
+diff_contents(queue_entry_t *entry)
+{
+  svn_stream_t *stream = svn_stream_from_stringbuf(entry->output,
+                                                   entry->pool);
+  svn_diff_t *diff;
+
+  SVN_ERR(svn_diff_mem_string_diff(&diff, entry->original, entry->modified,
+                                   entry->options, entry->pool));
+  if (!entry->write_header_always && !svn_diff_contains_diffs(diff))
+    return SVN_NO_ERROR;
+
+  if (entry->header)
+    svn_stringbuf_appendbytes(entry->output, entry->header->data,
+                              entry->header->len);
+
+  return svn_error_trace(svn_diff_mem_string_output_unified3(
+                           stream, diff, TRUE, NULL,
+                           entry->label1, entry->label2,
+                           entry->header_encoding,
+                           entry->original, entry->modified,
+                           entry->options->context_size,
+                           NULL, NULL, entry->pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Thread-pool task: Diff the queue_entry_t given by DATA. */
+static void * APR_THREAD_FUNC
+diff_task(apr_thread_t *tid,
+          void *data)
+{
+  queue_entry_t *entry = data;
+  svn_client__diff_queue_t *queue = entry->queue;
+  svn_error_t *err;
+
+  entry->result = diff_contents(entry);
+
+  /* Once DONE has been set, ENTRY may be reused by the queue.  There is
+     no way to tell the queue about synchronization problems, so they
+     will simply be ignored here. */
+  err = svn_mutex__lock(queue->mutex);
+  if (!err)
+    {
+      entry->done = TRUE;
+      err = svn_thread_cond__broadcast(queue->cond);
+      err = svn_mutex__unlock(queue->mutex, err);
+    }
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+#endif
+
+/* Set *DONE to whether ENTRY in QUEUE is complete.  If WAIT is set, wait
+   for that to happen. */
+static svn_error_t *
+check_entry(svn_boolean_t *done,
+            svn_client__diff_queue_t *queue,
+            queue_entry_t *entry,
+            svn_boolean_t wait)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__lock(queue->mutex));
+
+  /* This loop implicitly handles spurious wake-ups. */
+  while (wait && !entry->done && !err)
+    err = svn_thread_cond__wait(queue->cond, queue->mutex);
+
+  *done = entry->done;
+
+  return svn_error_trace(svn_mutex__unlock(queue->mutex, err));
+}
+
+/* Wait for the oldest pending entry in QUEUE, write it to the output
+   stream and release it. */
+static svn_error_t *
+write_oldest_entry(svn_client__diff_queue_t *queue)
+{
+  queue_entry_t *entry = &queue->entries[queue->first];
+  svn_boolean_t done;
+  svn_error_t *err;
+
+  SVN_ERR(check_entry(&done, queue, entry, TRUE));
+
+  queue->first = (queue->first + 1) % queue->entry_count;
+  queue->pending--;
+  if (entry->original)
+    queue->queued_contents -= entry->original->len + entry->modified->len;
+
+  err = entry->result;
+  entry->result = SVN_NO_ERROR;
+  if (!err)
+    {
+      apr_size_t len = entry->output->len;
+      err = svn_stream_write(queue->outstream, entry->output->data, &len);
+    }
+
+  svn_pool_clear(entry->pool);
+  entry->output = NULL;
+  entry->original = NULL;
+  entry->modified = NULL;
+
+  return svn_error_trace(err);
+}
+
+/* Write all leading entries of QUEUE that are complete already. */
+static svn_error_t *
+write_finished_entries(svn_client__diff_queue_t *queue)
+{
+  while (queue->pending)
+    {
+      svn_boolean_t done;
+
+      SVN_ERR(check_entry(&done, queue, &queue->entries[queue->first],
+                          FALSE));
+      if (!done)
+        break;
+
+      SVN_ERR(write_oldest_entry(queue));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *ENTRY_P to a new, empty entry at the end of QUEUE.  Make room for
+   it first, if necessary. */
+static svn_error_t *
+append_entry(queue_entry_t **entry_p,
+             svn_client__diff_queue_t *queue)
+{
+  queue_entry_t *entry;
+
+  if (queue->pending == queue->entry_count)
+    SVN_ERR(write_oldest_entry(queue));
+
+  entry = &queue->entries[(queue->first + queue->pending)
+                          % queue->entry_count];
+  entry->output = svn_stringbuf_create_empty(entry->pool);
+  entry->original = NULL;
+  entry->modified = NULL;
+  entry->result = SVN_NO_ERROR;
+  entry->done = TRUE;
+  queue->pending++;
+
+  *entry_p = entry;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t for the stream returned by
+   svn_client__diff_queue_create().  BATON is the svn_client__diff_queue_t.
+ */
+static svn_error_t *
+queue_write(void *baton,
+            const char *data,
+            apr_size_t *len)
+{
+  svn_client__diff_queue_t *queue = baton;
+  queue_entry_t *entry;
+
+  /* Write through if we don't have to wait for anything. */
+  SVN_ERR(write_finished_entries(queue));
+  if (!queue->pending)
+    return svn_error_trace(svn_stream_write(queue->outstream, data, len));
+
+  /* Append to the last text entry or start a new one. */
+  entry = &queue->entries[(queue->first + queue->pending - 1)
+                          % queue->entry_count];
+  if (entry->original)
+    SVN_ERR(append_entry(&entry, queue));
+
+  svn_stringbuf_appendbytes(entry->output, data, *len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function for svn_client__diff_queue_t DATA.  Wait for all
+   workers to finish and release the queue's root pool. */
+static apr_status_t
+diff_queue_cleanup(void *data)
+{
+  svn_client__diff_queue_t *queue = data;
+  int i;
+
+  for (i = 0; i < queue->entry_count; ++i)
+    {
+      queue_entry_t *entry = &queue->entries[i];
+      svn_boolean_t done;
+
+      /* We can't do anything about errors at this point. */
+      svn_error_clear(check_entry(&done, queue, entry, TRUE));
+      svn_error_clear(entry->result);
+    }
+
+  svn_pool_destroy(queue->pool);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_client__diff_queue_create(svn_client__diff_queue_t **queue,
+                              svn_stream_t **queue_stream,
+                              svn_stream_t *outstream,
+                              int max_threads,
+                              apr_pool_t *result_pool)
+{
+  svn_client__diff_queue_t *q;
+  int i;
+
+  *queue = NULL;
+  *queue_stream = outstream;
+
+#if APR_HAS_THREADS
+  if (max_threads <= 1)
+    return SVN_NO_ERROR;
+
+  q = apr_pcalloc(result_pool, sizeof(*q));
+  SVN_ERR(svn_parallel__get_thread_pool(&q->thread_pool, result_pool));
+#else
+  return SVN_NO_ERROR;
+#endif
+
+  q->outstream = outstream;
+  SVN_ERR(svn_mutex__init(&q->mutex, TRUE, result_pool));
+  SVN_ERR(svn_thread_cond__create(&q->cond, result_pool));
+
+  /* Allow for a second set of diffs being queued while the first ones
+     are being computed and for text between every two of them. */
+  q->entry_count = 4 * MIN(max_threads, MAX_DIFF_THREADS);
+  q->entries = apr_pcalloc(result_pool, q->entry_count * sizeof(*q->entries));
+
+  /* The workers and this thread allocate memory at the same time, so the
+     entry pools need a common, thread-safe allocator. */
+  q->pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  for (i = 0; i < q->entry_count; ++i)
+    {
+      q->entries[i].pool = svn_pool_create(q->pool);
+      q->entries[i].done = TRUE;
+      q->entries[i].queue = q;
+    }
+
+  /* Registered after creating the mutex and the condition variable, so
+     this runs before their cleanups. */
+  apr_pool_cleanup_register(result_pool, q, diff_queue_cleanup,
+                            apr_pool_cleanup_null);
+
+  *queue_stream = svn_stream_create(q, result_pool);
+  svn_stream_set_write(*queue_stream, queue_write);
+  *queue = q;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_client__diff_queue_fits(svn_boolean_t *fits,
+                            svn_client__diff_queue_t *queue,
+                            const char *file1,
+                            const char *file2,
+                            apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo1, finfo2;
+
+  SVN_ERR(svn_io_stat(&finfo1, file1, APR_FINFO_SIZE, scratch_pool));
+  SVN_ERR(svn_io_stat(&finfo2, file2, APR_FINFO_SIZE, scratch_pool));
+
+  *fits = finfo1.size + finfo2.size <= MAX_QUEUED_DIFF_SIZE;
+  if (!*fits)
+    SVN_ERR(svn_client__diff_queue_finish(queue));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_client__diff_queue_push(svn_client__diff_queue_t *queue,
+                            const char *file1,
+                            const char *file2,
+                            const char *label1,
+                            const char *label2,
+                            const svn_string_t *header,
+                            svn_boolean_t write_header_always,
+                            const svn_diff_file_options_t *options,
+                            const char *header_encoding,
+                            apr_pool_t *scratch_pool)
+{
+  queue_entry_t *entry;
+  svn_stringbuf_t *original, *modified;
+  apr_size_t size;
+  apr_status_t status = APR_ENOTIMPL;
+
+  SVN_ERR(write_finished_entries(queue));
+  SVN_ERR(append_entry(&entry, queue));
+
+  /* Until both files have been read, ENTRY is just an empty text entry. */
+  SVN_ERR(svn_stringbuf_from_file2(&original, file1, entry->pool));
+  SVN_ERR(svn_stringbuf_from_file2(&modified, file2, entry->pool));
+  entry->original = svn_stringbuf__morph_into_string(original);
+  entry->modified = svn_stringbuf__morph_into_string(modified);
+
+  entry->label1 = apr_pstrdup(entry->pool, label1);
+  entry->label2 = apr_pstrdup(entry->pool, label2);
+  entry->header = header ? svn_string_dup(header, entry->pool) : NULL;
+  entry->write_header_always = write_header_always;
+  entry->options = options;
+  entry->header_encoding = apr_pstrdup(entry->pool, header_encoding);
+
+  /* Limit the memory used by the diffs in flight.  This entry is the last
+     one in the queue, so we never wait for it here. */
+  size = entry->original->len + entry->modified->len;
+  while (   queue->queued_contents + size > MAX_QUEUED_CONTENTS
+         && queue->pending > 1)
+    SVN_ERR(write_oldest_entry(queue));
+  queue->queued_contents += size;
+
+  entry->done = FALSE;
+
+#if APR_HAS_THREADS
+  status = apr_thread_pool_push(queue->thread_pool, diff_task, entry, 0,
+                                queue);
+#endif
+  if (status)
+    {
+      /* Diff it ourselves then. */
+      entry->result = diff_contents(entry);
+      entry->done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_client__diff_queue_finish(svn_client__diff_queue_t *queue)
+{
+  while (queue->pending)
+    SVN_ERR(write_oldest_entry(queue));
+
+  return SVN_NO_ERROR;
+}
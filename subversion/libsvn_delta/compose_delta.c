@@ -30,10 +30,15 @@
 #include "svn_pools.h"
 #include "delta.h"
 
-/* Define a MIN macro if this platform doesn't already have one. */
+#include "private/svn_delta_private.h"
+
+/* Define MIN / MAX macros if this platform doesn't already have them. */
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 
 
 /* ==================================================================== */
@@ -627,22 +632,38 @@ build_range_list(apr_size_t offset, apr_size_t limit, range_index_t *ndx)
 }
 
 
-/* Copy the instructions from WINDOW that define the range [OFFSET,
-   LIMIT) in WINDOW's target stream to TARGET_OFFSET in the window
-   represented by BUILD_BATON. HINT is a position in the instructions
-   array that helps finding the position for OFFSET. A safe default
-   is 0. Use NDX to find the instructions in WINDOW. Allocate space
-   in BUILD_BATON from POOL. */
+/* One of the windows that the ranges of the top-most window get
+   resolved against, together with the offset index for its ops. */
+typedef struct compose_level_t
+{
+  const svn_txdelta_window_t *window;
+  offset_index_t *ndx;
+} compose_level_t;
+
+/* Copy the instructions from the window in LEVEL[0] that define the
+   range [OFFSET, LIMIT) in that window's target stream to TARGET_OFFSET
+   in the window represented by BUILD_BATON. HINT is a position in the
+   instructions array that helps finding the position for OFFSET. A safe
+   default is 0.
+
+   DEPTH is the number of windows below LEVEL[0], i.e. LEVEL[1] up to
+   LEVEL[DEPTH] are the windows that produced LEVEL[0]'s source view, the
+   respective next one producing the previous one's source view.  Source
+   copies in LEVEL[0] will be resolved against those windows in the same
+   pass.  Only the source copies in LEVEL[DEPTH] make it into the result.
+   Allocate space in BUILD_BATON from POOL. */
 
 static void
 copy_source_ops(apr_size_t offset, apr_size_t limit,
                 apr_size_t target_offset,
                 apr_size_t hint,
                 svn_txdelta__ops_baton_t *build_baton,
-                const svn_txdelta_window_t *window,
-                const offset_index_t *ndx,
+                const compose_level_t *level,
+                int depth,
                 apr_pool_t *pool)
 {
+  const svn_txdelta_window_t *const window = level->window;
+  const offset_index_t *const ndx = level->ndx;
   apr_size_t op_ndx = search_offset_index(ndx, offset, hint);
   for (;; ++op_ndx)
     {
@@ -663,7 +684,16 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
       /* It would be extremely weird if the fixed-up op had zero length. */
       assert(fix_offset + fix_limit < op->length);
 
-      if (op->action_code != svn_txdelta_target)
+      if (op->action_code == svn_txdelta_source && depth > 0)
+        {
+          /* The source is yet another delta window.  Descend into it
+             instead of going through an intermediate composite. */
+          copy_source_ops(op->offset + fix_offset,
+                          op->offset + op->length - fix_limit,
+                          target_offset, 0,
+                          build_baton, level + 1, depth - 1, pool);
+        }
+      else if (op->action_code != svn_txdelta_target)
         {
           /* Delta ops that don't depend on the virtual target can be
              copied to the composite unchanged. */
@@ -691,7 +721,7 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                               op->offset + op->length - fix_limit,
                               target_offset,
                               op_ndx,
-                              build_baton, window, ndx, pool);
+                              build_baton, level, depth, pool);
             }
           else
             {
@@ -716,7 +746,7 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                                 op->offset + ptn_overlap + length,
                                 tgt_off,
                                 op_ndx,
-                                build_baton, window, ndx, pool);
+                                build_baton, level, depth, pool);
                 fix_off += length;
                 tgt_off += length;
               }
@@ -732,7 +762,7 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                                   op->offset + length,
                                   tgt_off,
                                   op_ndx,
-                                  build_baton, window, ndx, pool);
+                                  build_baton, level, depth, pool);
                   fix_off += length;
                   tgt_off += length;
                 }
@@ -760,23 +790,37 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
 /* Bringing it all together. */
 
 
-svn_txdelta_window_t *
-svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
-                            const svn_txdelta_window_t *window_B,
-                            apr_pool_t *pool)
+/* Compose WINDOW_B with the windows in LEVEL[0] ... LEVEL[DEPTH], i.e.
+   return a window that produces WINDOW_B's target from the source view
+   of the window in LEVEL[DEPTH].  See copy_source_ops() for the order
+   of the LEVEL array.  Allocate the result in RESULT_POOL and use
+   SCRATCH_POOL for temporaries. */
+static svn_txdelta_window_t *
+compose_windows(const svn_txdelta_window_t *window_B,
+                const compose_level_t *level,
+                int depth,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
 {
   svn_txdelta__ops_baton_t build_baton = { 0 };
   svn_txdelta_window_t *composite;
-  apr_pool_t *subpool = svn_pool_create(pool);
-  offset_index_t *offset_index = create_offset_index(window_A, subpool);
-  range_index_t *range_index = create_range_index(subpool);
+  const svn_txdelta_window_t *bottom = level[depth].window;
+  range_index_t *range_index = create_range_index(scratch_pool);
   apr_size_t target_offset = 0;
   int i;
 
+  /* Most compositions produce somewhat more ops than WINDOW_B has.
+     Reserve that space up-front instead of growing the array step by
+     step and leaving the smaller copies behind in RESULT_POOL. */
+  build_baton.ops_size = MAX(16, 2 * window_B->num_ops);
+  build_baton.ops = apr_palloc(result_pool,
+                               build_baton.ops_size
+                                 * sizeof(*build_baton.ops));
+
   /* Read the description of the delta composition algorithm in
      notes/fs-improvements.txt before going any further.
      You have been warned. */
-  build_baton.new_data = svn_stringbuf_create_empty(pool);
+  build_baton.new_data = svn_stringbuf_create_empty(result_pool);
   for (i = 0; i < window_B->num_ops; ++i)
     {
       const svn_txdelta_op_t *const op = &window_B->ops[i];
@@ -790,7 +834,7 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
              : NULL);
           svn_txdelta__insert_op(&build_baton, op->action_code,
                                  op->offset, op->length,
-                                 new_data, pool);
+                                 new_data, result_pool);
         }
       else
         {
@@ -811,11 +855,10 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
                 svn_txdelta__insert_op(&build_baton, svn_txdelta_target,
                                        range->target_offset,
                                        range->limit - range->offset,
-                                       NULL, pool);
+                                       NULL, result_pool);
               else
                 copy_source_ops(range->offset, range->limit, tgt_off, 0,
-                                &build_baton, window_A, offset_index,
-                                pool);
+                                &build_baton, level, depth, result_pool);
 
               tgt_off += range->limit - range->offset;
             }
@@ -829,11 +872,59 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
       target_offset += op->length;
     }
 
+  composite = svn_txdelta__make_window(&build_baton, result_pool);
+  composite->sview_offset = bottom->sview_offset;
+  composite->sview_len = bottom->sview_len;
+  composite->tview_len = window_B->tview_len;
+  return composite;
+}
+
+svn_txdelta_window_t *
+svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
+                            const svn_txdelta_window_t *window_B,
+                            apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_txdelta_window_t *composite;
+  compose_level_t level;
+
+  level.window = window_A;
+  level.ndx = create_offset_index(window_A, subpool);
+  composite = compose_windows(window_B, &level, 0, pool, subpool);
+
   svn_pool_destroy(subpool);
+  return composite;
+}
 
-  composite = svn_txdelta__make_window(&build_baton, pool);
-  composite->sview_offset = window_A->sview_offset;
-  composite->sview_len = window_A->sview_len;
-  composite->tview_len = window_B->tview_len;
+svn_txdelta_window_t *
+svn_txdelta__compose_window_chain(const apr_array_header_t *windows,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  const svn_txdelta_window_t *top
+    = APR_ARRAY_IDX(windows, 0, const svn_txdelta_window_t *);
+  apr_pool_t *subpool;
+  compose_level_t *levels;
+  svn_txdelta_window_t *composite;
+  int i;
+
+  if (windows->nelts == 1)
+    return svn_txdelta_window_dup(top, result_pool);
+
+  /* The offset indexes for all windows below the top one are all we
+     need to resolve any range in a single pass. */
+  subpool = svn_pool_create(scratch_pool);
+  levels = apr_palloc(subpool, (windows->nelts - 1) * sizeof(*levels));
+  for (i = 1; i < windows->nelts; ++i)
+    {
+      levels[i - 1].window
+        = APR_ARRAY_IDX(windows, i, const svn_txdelta_window_t *);
+      levels[i - 1].ndx = create_offset_index(levels[i - 1].window, subpool);
+    }
+
+  composite = compose_windows(top, levels, windows->nelts - 2,
+                              result_pool, subpool);
+
+  svn_pool_destroy(subpool);
   return composite;
 }
@@ -24,28 +24,37 @@
 
 #include <assert.h>
 #include <string.h>
+
 #include "svn_delta.h"
 #include "svn_io.h"
 #include "delta.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_error_private.h"
 #include "private/svn_delta_private.h"
+#include "private/svn_io_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_mutex.h"
+#include "private/svn_parallel.h"
+#include "private/svn_thread_cond.h"
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -70,9 +79,11 @@ struct encoder_baton {
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+   section for windows of up to WINDOW_SIZE bytes: in theory, the
+   instructions could be WINDOW_SIZE 1-byte copy-from-source instructions
+   (though this is very unlikely). */
+#define MAX_INSTRUCTION_SECTION_LEN(window_size) \
+  ((window_size)*MAX_INSTRUCTION_LEN)
 
 
 /* Append an encoded integer to a string.  */
@@ -150,6 +161,18 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Return the Zstandard level to use for the svndiff COMPRESSION_LEVEL.
+   Non-positive values select the library default; the rest is clamped to
+   the range svn__compress_zstd() accepts. */
+static int
+zstd_level(int compression_level)
+{
+  if (compression_level <= SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    return SVN__ZSTD_DEFAULT_LEVEL;
+
+  return MIN(compression_level, SVN__ZSTD_MAX_LEVEL);
+}
+
 /* Encodes delta window WINDOW to svndiff-format.
    The svndiff version is VERSION. COMPRESSION_LEVEL is the
    compression level to use.
@@ -198,7 +221,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed_instructions;
+      compressed_instructions = svn_stringbuf_create_empty(pool);
+      SVN_ERR(svn__compress_zstd(instructions->data, instructions->len,
+                                 compressed_instructions,
+                                 zstd_level(compression_level)));
+      instructions = compressed_instructions;
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +249,15 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__compress_zstd(window->new_data->data, window->new_data->len,
+                                 compressed, zstd_level(compression_level)));
+      newdata = svn_stringbuf__morph_into_string(compressed);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -245,6 +285,32 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+/* Write the svndiff data of a window, as produced by encode_window(),
+   i.e. HEADER, INSTRUCTIONS and NEWDATA, to the output of EB. */
+static svn_error_t *
+write_encoded_window(struct encoder_baton *eb,
+                     const svn_stringbuf_t *header,
+                     const svn_stringbuf_t *instructions,
+                     const svn_string_t *newdata)
+{
+  apr_size_t len;
+
+  len = header->len;
+  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
+  if (instructions->len > 0)
+    {
+      len = instructions->len;
+      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+    }
+  if (newdata->len > 0)
+    {
+      len = newdata->len;
+      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -286,20 +352,8 @@ window_handler(svn_txdelta_window_t *window, void *baton)
                         eb->scratch_pool));
 
   /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
-  if (instructions->len > 0)
-    {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
-    }
-  if (newdata->len > 0)
-    {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
-    }
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(write_encoded_window(eb, header, instructions,
+                                              newdata));
 }
 
 void
@@ -323,6 +377,259 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
   *handler_baton = eb;
 }
 
+
+/* ----- Text delta to svndiff, compressing windows concurrently ----- */
+
+#if APR_HAS_THREADS
+
+/* Maximum number of windows that a single parallel svndiff encoder
+ * compresses concurrently. */
+#define MAX_ENCODER_THREADS 16
+
+/* A delta window being compressed by a worker thread. */
+typedef struct encoder_job_t
+{
+  /* Private, thread-safe pool for all data of this job.  It gets cleared
+     whenever the job slot is being reused. */
+  apr_pool_t *pool;
+
+  /* Copy of the window to encode, allocated in POOL. */
+  svn_txdelta_window_t *window;
+
+  /* Encoded data as returned by encode_window(). */
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+
+  /* Result of the encoding. */
+  svn_error_t *result;
+
+  /* Set once the worker is done with this job.  Protected by the mutex
+     in PEB. */
+  svn_boolean_t done;
+
+  /* The encoder that this job belongs to. */
+  struct parallel_encoder_baton *peb;
+} encoder_job_t;
+
+/* Baton of the parallel window handler. */
+struct parallel_encoder_baton
+{
+  /* The serial encoder, used for the output and the svndiff header. */
+  struct encoder_baton *eb;
+
+  /* The shared worker threads. */
+  apr_thread_pool_t *thread_pool;
+
+  /* Ring buffer of JOB_COUNT job slots.  The oldest unwritten window is
+     in slot FIRST and there are PENDING windows in flight. */
+  encoder_job_t *jobs;
+  int job_count;
+  int first;
+  int pending;
+
+  /* Synchronize the workers with the handler waiting for results. */
+  svn_mutex__t *mutex;
+  svn_thread_cond__t *cond;
+};
+
+/* Thread-pool task: Encode the encoder_job_t given by DATA. */
+static void * APR_THREAD_FUNC
+encode_task(apr_thread_t *tid,
+            void *data)
+{
+  encoder_job_t *job = data;
+  struct parallel_encoder_baton *peb = job->peb;
+  svn_error_t *err;
+
+  job->result = encode_window(&job->instructions, &job->header,
+                              &job->newdata, job->window,
+                              peb->eb->version, peb->eb->compression_level,
+                              job->pool);
+
+  /* Once DONE has been set, JOB may be reused by the handler.  There is
+     no way to tell the handler about synchronization problems, so they
+     will simply be ignored here. */
+  err = svn_mutex__lock(peb->mutex);
+  if (!err)
+    {
+      job->done = TRUE;
+      err = svn_thread_cond__broadcast(peb->cond);
+      err = svn_mutex__unlock(peb->mutex, err);
+    }
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+/* Wait for the worker thread processing JOB in PEB to finish. */
+static svn_error_t *
+wait_for_job(struct parallel_encoder_baton *peb,
+             encoder_job_t *job)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__lock(peb->mutex));
+
+  /* This loop implicitly handles spurious wake-ups. */
+  while (!job->done && !err)
+    err = svn_thread_cond__wait(peb->cond, peb->mutex);
+
+  return svn_error_trace(svn_mutex__unlock(peb->mutex, err));
+}
+
+/* Wait for the oldest pending window in PEB and write it to the output. */
+static svn_error_t *
+write_oldest_job(struct parallel_encoder_baton *peb)
+{
+  encoder_job_t *job = &peb->jobs[peb->first];
+  svn_error_t *err;
+
+  SVN_ERR(wait_for_job(peb, job));
+
+  peb->first = (peb->first + 1) % peb->job_count;
+  peb->pending--;
+
+  err = job->result;
+  job->result = SVN_NO_ERROR;
+  SVN_ERR(err);
+
+  return svn_error_trace(write_encoded_window(peb->eb, job->header,
+                                              job->instructions,
+                                              job->newdata));
+}
+
+/* Pool cleanup function for parallel_encoder_baton DATA.  Wait for all
+   workers to finish and release the job pools. */
+static apr_status_t
+parallel_encoder_cleanup(void *data)
+{
+  struct parallel_encoder_baton *peb = data;
+  int i;
+
+  for (i = 0; i < peb->job_count; ++i)
+    {
+      encoder_job_t *job = &peb->jobs[i];
+
+      /* We can't do anything about errors at this point. */
+      svn_error_clear(wait_for_job(peb, job));
+      svn_error_clear(job->result);
+      svn_pool_destroy(job->pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Implements svn_txdelta_window_handler_t for the parallel encoder. */
+static svn_error_t *
+parallel_window_handler(svn_txdelta_window_t *window,
+                        void *baton)
+{
+  struct parallel_encoder_baton *peb = baton;
+  encoder_job_t *job;
+  apr_status_t status;
+
+  if (window == NULL)
+    {
+      /* Write all remaining windows in order, then finalize the stream. */
+      while (peb->pending)
+        SVN_ERR(write_oldest_job(peb));
+
+      return svn_error_trace(window_handler(NULL, peb->eb));
+    }
+
+  /* The svndiff header must precede the first window. */
+  if (!peb->eb->header_done)
+    {
+      apr_size_t len = SVNDIFF_HEADER_SIZE;
+      SVN_ERR(svn_stream_write(peb->eb->output,
+                               get_svndiff_header(peb->eb->version), &len));
+      peb->eb->header_done = TRUE;
+    }
+
+  /* Make room for the next job. */
+  if (peb->pending == peb->job_count)
+    SVN_ERR(write_oldest_job(peb));
+
+  /* WINDOW is only valid during this call. */
+  job = &peb->jobs[(peb->first + peb->pending) % peb->job_count];
+  svn_pool_clear(job->pool);
+  job->window = svn_txdelta_window_dup(window, job->pool);
+  job->result = SVN_NO_ERROR;
+  job->done = FALSE;
+  peb->pending++;
+
+  status = apr_thread_pool_push(peb->thread_pool, encode_task, job, 0, peb);
+  if (status)
+    {
+      /* Encode it ourselves then. */
+      job->result = encode_window(&job->instructions, &job->header,
+                                  &job->newdata, job->window,
+                                  peb->eb->version,
+                                  peb->eb->compression_level, job->pool);
+      job->done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int max_threads,
+                                 apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  struct parallel_encoder_baton *peb;
+  int i;
+#endif
+
+  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
+                          compression_level, pool);
+
+#if APR_HAS_THREADS
+
+  /* Without compression, there is nothing worth parallelizing. */
+  if (max_threads <= 1 || svndiff_version == 0)
+    return SVN_NO_ERROR;
+
+  peb = apr_pcalloc(pool, sizeof(*peb));
+  peb->eb = *handler_baton;
+  SVN_ERR(svn_parallel__get_thread_pool(&peb->thread_pool, pool));
+  SVN_ERR(svn_mutex__init(&peb->mutex, TRUE, pool));
+  SVN_ERR(svn_thread_cond__create(&peb->cond, pool));
+
+  /* Allow for a second set of windows being queued while the first ones
+     are being compressed. */
+  peb->job_count = 2 * MIN(max_threads, MAX_ENCODER_THREADS);
+  peb->jobs = apr_pcalloc(pool, peb->job_count * sizeof(*peb->jobs));
+  for (i = 0; i < peb->job_count; ++i)
+    {
+      /* Each job must have its own thread-safe root pool, so the workers
+         and this thread can allocate memory at the same time. */
+      peb->jobs[i].pool = svn_pool_create(NULL);
+      peb->jobs[i].done = TRUE;
+      peb->jobs[i].peb = peb;
+    }
+
+  /* Registered after creating the mutex and the condition variable, so
+     this runs before their cleanups. */
+  apr_pool_cleanup_register(pool, peb, parallel_encoder_cleanup,
+                            apr_pool_cleanup_null);
+
+  *handler = parallel_window_handler;
+  *handler_baton = peb;
+
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 void
 svn_txdelta_to_svndiff2(svn_txdelta_window_handler_t *handler,
                         void **handler_baton,
@@ -544,14 +851,14 @@ count_and_verify_instructions(int *ninst,
 
 /* Given the five integer fields of a window header and a pointer to
    the remainder of the window contents, fill in a delta window
-   structure *WINDOW.  New allocations will be performed in POOL;
-   the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   structure *WINDOW.  Reject windows larger than MAX_WINDOW_SIZE.
+   New allocations will be performed in POOL; the new_data field of
+   *WINDOW will refer directly to memory pointed to by DATA. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
               apr_size_t newlen, const unsigned char *data, apr_pool_t *pool,
-              unsigned int version)
+              unsigned int version, apr_size_t max_window_size)
 {
   const unsigned char *insend;
   int ninst;
@@ -565,15 +872,31 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__decompress_zstd(insend, newlen, ndout,
+                                   max_window_size));
+      SVN_ERR(svn__decompress_zstd(data, insend - data, instout,
+                                   MAX_INSTRUCTION_SECTION_LEN(max_window_size)));
+
+      newlen = ndout->len;
+      data = (unsigned char *)instout->data;
+      insend = (unsigned char *)instout->data + instout->len;
+
+      new_data = svn_stringbuf__morph_into_string(ndout);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+                                  max_window_size));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  MAX_INSTRUCTION_SECTION_LEN(max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -587,9 +910,9 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
-                                   SVN_DELTA_WINDOW_SIZE));
+                                   max_window_size));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   MAX_INSTRUCTION_SECTION_LEN(max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -653,6 +976,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -714,7 +1039,7 @@ write_handler(void *baton,
               sview_len > SVN_DELTA_WINDOW_SIZE ||
               /* for svndiff1, newlen includes the original length */
               newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              inslen > MAX_INSTRUCTION_SECTION_LEN(SVN_DELTA_WINDOW_SIZE))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -758,7 +1083,8 @@ write_handler(void *baton,
       /* Decode the window and send it off. */
       SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
                             db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
+                            db->subpool, db->version,
+                            SVN_DELTA_WINDOW_SIZE));
       SVN_ERR(db->consumer_func(&window, db->consumer_baton));
 
       p += db->inslen + db->newlen;
@@ -894,12 +1220,13 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   and for windows larger than MAX_WINDOW_SIZE. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, apr_size_t max_window_size)
 {
   unsigned char c;
 
@@ -921,11 +1248,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_window_size ||
+      *sview_len > max_window_size ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(max_window_size))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -939,27 +1266,69 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
-                                svn_stream_t *stream,
-                                int svndiff_version,
-                                apr_pool_t *pool)
+/* Implement svn_txdelta_read_svndiff_window but accept windows of up to
+   MAX_WINDOW_SIZE. */
+static svn_error_t *
+read_svndiff_window(svn_txdelta_window_t **window,
+                    svn_stream_t *stream,
+                    int svndiff_version,
+                    apr_size_t max_window_size,
+                    apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, len, header_len;
-  unsigned char *buf;
+  const char *data;
+  svn_error_t *err;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             max_window_size));
   len = inslen + newlen;
-  buf = apr_palloc(pool, len);
-  SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
+
+  /* In-memory and memory-mapped sources can be decoded in place.
+     decode_window() copies everything that the window keeps. */
+  err = svn_stream__view(stream, &data, &len);
+  if (err && err->apr_err == SVN_ERR_STREAM_NOT_SUPPORTED)
+    {
+      char *buf = apr_palloc(pool, len);
+
+      svn_error_clear(err);
+      SVN_ERR(svn_stream_read_full(stream, buf, &len));
+      data = buf;
+    }
+  else
+    {
+      SVN_ERR(err);
+    }
+
   if (len < inslen + newlen)
     return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
                             _("Unexpected end of svndiff input"));
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
-                       newlen, buf, pool, svndiff_version);
+                       newlen, (const unsigned char *)data, pool,
+                       svndiff_version, max_window_size);
+}
+
+svn_error_t *
+svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
+                                svn_stream_t *stream,
+                                int svndiff_version,
+                                apr_pool_t *pool)
+{
+  return svn_error_trace(read_svndiff_window(window, stream, svndiff_version,
+                                             SVN_DELTA_WINDOW_SIZE, pool));
+}
+
+svn_error_t *
+svn_txdelta__read_large_svndiff_window(svn_txdelta_window_t **window,
+                                       svn_stream_t *stream,
+                                       int svndiff_version,
+                                       apr_pool_t *pool)
+{
+  return svn_error_trace(read_svndiff_window(window, stream, svndiff_version,
+                                             SVN_DELTA__MAX_WINDOW_SIZE,
+                                             pool));
 }
 
 
@@ -974,7 +1343,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             SVN_DELTA_WINDOW_SIZE));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -989,12 +1359,320 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             SVN_DELTA__MAX_WINDOW_SIZE));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
 }
 
+/* Routines for re-encoding svndiff windows. */
+
+/* Replace *SECTION, the instruction or new data section of a window in
+   svndiff VERSION, by its uncompressed contents.  Reject contents larger
+   than LIMIT.  Allocate the result in POOL. */
+static svn_error_t *
+decompress_section(svn_stringbuf_t **section,
+                   int version,
+                   apr_size_t limit,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *out;
+
+  if (version == 0)
+    return SVN_NO_ERROR;
+
+  out = svn_stringbuf_create_empty(pool);
+  if (version == 3)
+    SVN_ERR(svn__decompress_zstd((*section)->data, (*section)->len, out,
+                                 limit));
+  else if (version == 2)
+    SVN_ERR(svn__decompress_lz4((*section)->data, (*section)->len, out,
+                                limit));
+  else
+    SVN_ERR(svn__decompress_zlib((*section)->data, (*section)->len, out,
+                                 limit));
+
+  *section = out;
+  return SVN_NO_ERROR;
+}
+
+/* Replace *SECTION, the uncompressed instruction or new data section of
+   a window, by its encoding for svndiff VERSION using COMPRESSION_LEVEL.
+   Allocate the result in POOL. */
+static svn_error_t *
+compress_section(svn_stringbuf_t **section,
+                 int version,
+                 int compression_level,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *out;
+
+  if (version == 0)
+    return SVN_NO_ERROR;
+
+  out = svn_stringbuf_create_empty(pool);
+  if (version == 3)
+    SVN_ERR(svn__compress_zstd((*section)->data, (*section)->len, out,
+                               zstd_level(compression_level)));
+  else if (version == 2)
+    SVN_ERR(svn__compress_lz4((*section)->data, (*section)->len, out));
+  else
+    SVN_ERR(svn__compress_zlib((*section)->data, (*section)->len, out,
+                               compression_level));
+
+  *section = out;
+  return SVN_NO_ERROR;
+}
+
+/* Return the number of bytes svn__encode_uint() uses for VAL. */
+static apr_size_t
+encoded_uint_len(apr_uint64_t val)
+{
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN];
+  return svn__encode_uint(buf, val) - buf;
+}
+
+/* Append VAL to HEADER using exactly LEN bytes, LEN being at least the
+   minimal encoded length of VAL.  The decoders accept leading 0x80 bytes
+   since they do not contribute to the value. */
+static void
+append_padded_int(svn_stringbuf_t *header, apr_uint64_t val, apr_size_t len)
+{
+  for (; len > encoded_uint_len(val); --len)
+    svn_stringbuf_appendbyte(header, (char)0x80);
+
+  append_encoded_int(header, (svn_filesize_t)val);
+}
+
+/* Zstandard decoders skip over "skippable frames" (RFC 8878, section
+   3.1.2), which consist of a 4 byte magic number, a 4 byte little-endian
+   length and that many bytes of user data. */
+#define ZSTD_SKIPPABLE_FRAME_MAGIC 0x184D2A50
+#define ZSTD_SKIPPABLE_FRAME_HEADER_LEN 8
+
+/* Append a skippable Zstandard frame of exactly LEN bytes to SECTION.
+   LEN must be at least ZSTD_SKIPPABLE_FRAME_HEADER_LEN. */
+static void
+append_skippable_frame(svn_stringbuf_t *section, apr_size_t len)
+{
+  apr_uint32_t magic = ZSTD_SKIPPABLE_FRAME_MAGIC;
+  apr_uint32_t frame_len = (apr_uint32_t)(len
+                                          - ZSTD_SKIPPABLE_FRAME_HEADER_LEN);
+  int i;
+
+  for (i = 0; i < 4; ++i, magic >>= 8)
+    svn_stringbuf_appendbyte(section, (char)(magic & 0xff));
+  for (i = 0; i < 4; ++i, frame_len >>= 8)
+    svn_stringbuf_appendbyte(section, (char)(frame_len & 0xff));
+
+  svn_stringbuf_appendfill(section, 0, len - ZSTD_SKIPPABLE_FRAME_HEADER_LEN);
+}
+
+/* Return TRUE if the svndiff3 SECTION holding PLAIN_LEN bytes of data
+   would still be decoded as compressed data when we appended EXTRA bytes
+   to it.  Sections stored uncompressed cannot carry any padding. */
+static svn_boolean_t
+can_pad_section(const svn_stringbuf_t *section,
+                apr_size_t plain_len,
+                apr_size_t extra)
+{
+  apr_size_t prefix_len = encoded_uint_len(plain_len);
+
+  return section->len - prefix_len != plain_len
+      && section->len + extra - prefix_len != plain_len;
+}
+
+/* Append the svndiff3 window with the header FIELDS (source view offset,
+   source view length, target view length and the lengths of the
+   INSTRUCTIONS and NEW_DATA sections) to OUTPUT such that it takes exactly
+   WINDOW_LEN bytes.  INSTRUCTIONS_LEN and NEW_DATA_LEN give the
+   uncompressed lengths of the sections.  The padding goes into a skippable
+   frame within one of the compressed sections and into non-minimal
+   encodings of the header fields.
+
+   Return FALSE and leave OUTPUT untouched, if the window cannot be padded
+   to WINDOW_LEN. */
+static svn_boolean_t
+append_padded_window(svn_stringbuf_t *output,
+                     apr_uint64_t fields[5],
+                     const svn_stringbuf_t *instructions,
+                     apr_size_t instructions_len,
+                     const svn_stringbuf_t *new_data,
+                     apr_size_t new_data_len,
+                     apr_size_t window_len)
+{
+  apr_size_t content_len = instructions->len + new_data->len;
+  apr_size_t header_len = 0;
+  apr_size_t lens[5];
+  apr_size_t padding, frame_len, extra;
+  int frame_field, i;
+
+  for (i = 0; i < 5; ++i)
+    header_len += encoded_uint_len(fields[i]);
+  if (header_len + content_len > window_len)
+    return FALSE;
+
+  padding = window_len - header_len - content_len;
+
+  /* Prefer the new data section as it is usually the larger one. */
+  if (can_pad_section(new_data, new_data_len, 0))
+    frame_field = 4;
+  else if (can_pad_section(instructions, instructions_len, 0))
+    frame_field = 3;
+  else
+    frame_field = -1;
+
+  /* Moving bytes into a frame may lengthen the encoded section length.
+     Try the largest frames first and fall back to not using any. */
+  for (frame_len = padding; ; --frame_len)
+    {
+      apr_size_t capacity = 0;
+
+      if (frame_len < ZSTD_SKIPPABLE_FRAME_HEADER_LEN
+          || padding - frame_len > 5 * SVN__MAX_ENCODED_UINT_LEN
+          || frame_field < 0)
+        frame_len = 0;
+
+      header_len = 0;
+      for (i = 0; i < 5; ++i)
+        {
+          lens[i] = encoded_uint_len(fields[i]
+                                     + (i == frame_field ? frame_len : 0));
+          header_len += lens[i];
+          capacity += SVN__MAX_ENCODED_UINT_LEN - lens[i];
+        }
+
+      if (   header_len + content_len + frame_len <= window_len
+          && window_len - header_len - content_len - frame_len <= capacity
+          && (   frame_len == 0
+              || (   can_pad_section(frame_field == 4 ? new_data
+                                                      : instructions,
+                                     frame_field == 4 ? new_data_len
+                                                      : instructions_len,
+                                     frame_len)
+                  && fields[3] + (frame_field == 3 ? frame_len : 0)
+                       <= MAX_INSTRUCTION_SECTION_LEN(
+                            SVN_DELTA__MAX_WINDOW_SIZE)
+                  && fields[4] + (frame_field == 4 ? frame_len : 0)
+                       <= SVN_DELTA__MAX_WINDOW_SIZE
+                          + SVN__MAX_ENCODED_UINT_LEN)))
+        break;
+
+      if (frame_len == 0)
+        return FALSE;
+    }
+
+  /* Distribute the remainder over the header fields. */
+  extra = window_len - header_len - content_len - frame_len;
+  for (i = 0; i < 5; ++i)
+    {
+      apr_size_t added = MIN(extra, SVN__MAX_ENCODED_UINT_LEN - lens[i]);
+      lens[i] += added;
+      extra -= added;
+    }
+
+  for (i = 0; i < 5; ++i)
+    append_padded_int(output,
+                      fields[i] + (i == frame_field ? frame_len : 0),
+                      lens[i]);
+
+  svn_stringbuf_appendbytes(output, instructions->data, instructions->len);
+  if (frame_len && frame_field == 3)
+    append_skippable_frame(output, frame_len);
+
+  svn_stringbuf_appendbytes(output, new_data->data, new_data->len);
+  if (frame_len && frame_field == 4)
+    append_skippable_frame(output, frame_len);
+
+  return TRUE;
+}
+
+svn_error_t *
+svn_txdelta__transcode_svndiff_window(svn_stringbuf_t *output,
+                                      svn_boolean_t *fits,
+                                      apr_size_t *window_len,
+                                      svn_stream_t *stream,
+                                      int source_version,
+                                      int target_version,
+                                      int compression_level,
+                                      svn_boolean_t keep_length,
+                                      apr_pool_t *scratch_pool)
+{
+  svn_filesize_t sview_offset;
+  apr_size_t sview_len, tview_len, inslen, newlen, header_len, len;
+  svn_stringbuf_t *instructions, *new_data;
+  apr_size_t instructions_len, new_data_len;
+  apr_uint64_t fields[5];
+
+  SVN_ERR_ASSERT(!keep_length || target_version == 3);
+
+  /* Read the raw window. */
+  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+                             &inslen, &newlen, &header_len,
+                             SVN_DELTA__MAX_WINDOW_SIZE));
+  *window_len = header_len + inslen + newlen;
+
+  instructions = svn_stringbuf_create_ensure(inslen, scratch_pool);
+  new_data = svn_stringbuf_create_ensure(newlen, scratch_pool);
+
+  len = inslen;
+  SVN_ERR(svn_stream_read_full(stream, instructions->data, &len));
+  instructions->len = len;
+  instructions->data[len] = '\0';
+
+  len = newlen;
+  SVN_ERR(svn_stream_read_full(stream, new_data->data, &len));
+  new_data->len = len;
+  new_data->data[len] = '\0';
+
+  if (instructions->len < inslen || new_data->len < newlen)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of svndiff input"));
+
+  /* Re-compress both sections.  The instructions stay as they are. */
+  SVN_ERR(decompress_section(&instructions, source_version,
+                             MAX_INSTRUCTION_SECTION_LEN(
+                               SVN_DELTA__MAX_WINDOW_SIZE),
+                             scratch_pool));
+  SVN_ERR(decompress_section(&new_data, source_version,
+                             SVN_DELTA__MAX_WINDOW_SIZE, scratch_pool));
+
+  instructions_len = instructions->len;
+  new_data_len = new_data->len;
+
+  SVN_ERR(compress_section(&instructions, target_version, compression_level,
+                           scratch_pool));
+  SVN_ERR(compress_section(&new_data, target_version, compression_level,
+                           scratch_pool));
+
+  fields[0] = (apr_uint64_t)sview_offset;
+  fields[1] = sview_len;
+  fields[2] = tview_len;
+  fields[3] = instructions->len;
+  fields[4] = new_data->len;
+
+  if (keep_length)
+    {
+      *fits = append_padded_window(output, fields,
+                                   instructions, instructions_len,
+                                   new_data, new_data_len, *window_len);
+    }
+  else
+    {
+      int i;
+      for (i = 0; i < 5; ++i)
+        append_encoded_int(output, (svn_filesize_t)fields[i]);
+
+      svn_stringbuf_appendbytes(output, instructions->data,
+                                instructions->len);
+      svn_stringbuf_appendbytes(output, new_data->data, new_data->len);
+      *fits = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 typedef struct svndiff_stream_baton_t
 {
   apr_pool_t *scratch_pool;
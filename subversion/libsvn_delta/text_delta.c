@@ -35,6 +35,9 @@
 
 #include "delta.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_io_private.h"
+
 
 /* Text delta stream descriptor. */
 
@@ -56,6 +59,7 @@ struct txdelta_baton {
   svn_boolean_t more;           /* TRUE if there are more data in the pool. */
   svn_filesize_t pos;           /* Offset of next read in source file. */
   char *buf;                    /* Buffer for input data. */
+  apr_size_t window_size;       /* Max. source / target data per window. */
 
   svn_checksum_ctx_t *context;  /* If not NULL, the context for computing
                                    the checksum. */
@@ -76,6 +80,7 @@ struct tpush_baton {
 
   /* Private data */
   char *buf;
+  apr_size_t window_size;
   svn_filesize_t source_offset;
   apr_size_t source_len;
   svn_boolean_t source_done;
@@ -102,6 +107,12 @@ struct apply_baton {
   char *tbuf;                   /* Target buffer */
   apr_size_t tbuf_size;         /* Allocated target buffer space */
 
+  /* If SOURCE_VIEWS is svn_tristate_true, the source view lives in the
+   * source stream's own memory at SVIEW and SBUF is not used.  Until we
+   * first need source data, we don't know whether SOURCE supports that. */
+  svn_tristate_t source_views;
+  const char *sview;
+
   svn_checksum_ctx_t *md5_context; /* Leads to result_digest below. */
   unsigned char *result_digest; /* MD5 digest of resultant fulltext;
                                    must point to at least APR_MD5_DIGESTSIZE
@@ -359,14 +370,14 @@ txdelta_next_window(svn_txdelta_window_t **window,
                     apr_pool_t *pool)
 {
   struct txdelta_baton *b = baton;
-  apr_size_t source_len = SVN_DELTA_WINDOW_SIZE;
-  apr_size_t target_len = SVN_DELTA_WINDOW_SIZE;
+  apr_size_t source_len = b->window_size;
+  apr_size_t target_len = b->window_size;
 
   /* Read the source stream. */
   if (b->more_source)
     {
       SVN_ERR(svn_stream_read_full(b->source, b->buf, &source_len));
-      b->more_source = (source_len == SVN_DELTA_WINDOW_SIZE);
+      b->more_source = (source_len == b->window_size);
     }
   else
     source_len = 0;
@@ -436,6 +447,7 @@ svn_txdelta_run(svn_stream_t *source,
   tb.more = TRUE;
   tb.pos = 0;
   tb.buf = apr_palloc(scratch_pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  tb.window_size = SVN_DELTA_WINDOW_SIZE;
   tb.result_pool = result_pool;
 
   if (checksum != NULL)
@@ -467,19 +479,24 @@ svn_txdelta_run(svn_stream_t *source,
 
 
 void
-svn_txdelta2(svn_txdelta_stream_t **stream,
-             svn_stream_t *source,
-             svn_stream_t *target,
-             svn_boolean_t calculate_checksum,
-             apr_pool_t *pool)
+svn_txdelta__with_window_size(svn_txdelta_stream_t **stream,
+                              svn_stream_t *source,
+                              svn_stream_t *target,
+                              svn_boolean_t calculate_checksum,
+                              apr_size_t window_size,
+                              apr_pool_t *pool)
 {
   struct txdelta_baton *b = apr_pcalloc(pool, sizeof(*b));
 
+  SVN_ERR_ASSERT_NO_RETURN(window_size > 0
+                           && window_size <= SVN_DELTA__MAX_WINDOW_SIZE);
+
   b->source = source;
   b->target = target;
   b->more_source = TRUE;
   b->more = TRUE;
-  b->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  b->buf = apr_palloc(pool, 2 * window_size);
+  b->window_size = window_size;
   b->context = calculate_checksum
              ? svn_checksum_ctx_create(svn_checksum_md5, pool)
              : NULL;
@@ -489,6 +506,17 @@ svn_txdelta2(svn_txdelta_stream_t **stream,
                                       txdelta_md5_digest, pool);
 }
 
+void
+svn_txdelta2(svn_txdelta_stream_t **stream,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             svn_boolean_t calculate_checksum,
+             apr_pool_t *pool)
+{
+  svn_txdelta__with_window_size(stream, source, target, calculate_checksum,
+                                SVN_DELTA_WINDOW_SIZE, pool);
+}
+
 void
 svn_txdelta(svn_txdelta_stream_t **stream,
             svn_stream_t *source,
@@ -520,14 +548,14 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       /* Make sure we're all full up on source data, if possible. */
       if (tb->source_len == 0 && !tb->source_done)
         {
-          tb->source_len = SVN_DELTA_WINDOW_SIZE;
+          tb->source_len = tb->window_size;
           SVN_ERR(svn_stream_read_full(tb->source, tb->buf, &tb->source_len));
-          if (tb->source_len < SVN_DELTA_WINDOW_SIZE)
+          if (tb->source_len < tb->window_size)
             tb->source_done = TRUE;
         }
 
-      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
-      chunk_len = SVN_DELTA_WINDOW_SIZE - tb->target_len;
+      /* Copy in the target data, up to the window size. */
+      chunk_len = tb->window_size - tb->target_len;
       if (chunk_len > data_len)
         chunk_len = data_len;
       memcpy(tb->buf + tb->source_len + tb->target_len, data, chunk_len);
@@ -536,7 +564,7 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       tb->target_len += chunk_len;
 
       /* If we're full of target data, compute and fire off a window. */
-      if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
+      if (tb->target_len == tb->window_size)
         {
           window = compute_window(tb->buf, tb->source_len, tb->target_len,
                                   tb->source_offset, pool);
@@ -575,20 +603,26 @@ tpush_close_handler(void *baton)
 
 
 svn_stream_t *
-svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
-                        void *handler_baton, svn_stream_t *source,
-                        apr_pool_t *pool)
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool)
 {
   struct tpush_baton *tb;
   svn_stream_t *stream;
 
+  SVN_ERR_ASSERT_NO_RETURN(window_size > 0
+                           && window_size <= SVN_DELTA__MAX_WINDOW_SIZE);
+
   /* Initialize baton. */
   tb = apr_palloc(pool, sizeof(*tb));
   tb->source = source;
   tb->wh = handler;
   tb->whb = handler_baton;
   tb->pool = pool;
-  tb->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  tb->buf = apr_palloc(pool, 2 * window_size);
+  tb->window_size = window_size;
   tb->source_offset = 0;
   tb->source_len = 0;
   tb->source_done = FALSE;
@@ -601,6 +635,15 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   return stream;
 }
 
+svn_stream_t *
+svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
+                        void *handler_baton, svn_stream_t *source,
+                        apr_pool_t *pool)
+{
+  return svn_txdelta__target_push(handler, handler_baton, source,
+                                  SVN_DELTA_WINDOW_SIZE, pool);
+}
+
 
 
 /* Functions for applying deltas.  */
@@ -714,6 +757,50 @@ svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
   *tlen = tpos;
 }
 
+/* Make AB->SVIEW point to WINDOW's source view within the memory of
+ * AB->SOURCE, without copying any data.  Return SVN_ERR_STREAM_NOT_SUPPORTED
+ * if AB->SOURCE does not support svn_stream__view().  */
+static svn_error_t *
+view_source(struct apply_baton *ab,
+            const svn_txdelta_window_t *window)
+{
+  const char *data;
+  apr_size_t len;
+
+  /* Drop the part of the previous view that precedes the new one. */
+  if (window->sview_offset != ab->sbuf_offset)
+    {
+      if (  (apr_size_t)ab->sbuf_offset + ab->sbuf_len
+          > (apr_size_t)window->sview_offset)
+        {
+          apr_size_t start =
+            (apr_size_t)(window->sview_offset - ab->sbuf_offset);
+          ab->sview += start;
+          ab->sbuf_len -= start;
+        }
+      else
+        ab->sbuf_len = 0;
+      ab->sbuf_offset = window->sview_offset;
+    }
+
+  /* Extend the view.  Since views are contiguous, the part that we kept
+   * directly precedes the new data. */
+  if (ab->sbuf_len < window->sview_len)
+    {
+      len = window->sview_len - ab->sbuf_len;
+      SVN_ERR(svn_stream__view(ab->source, &data, &len));
+      if (len != window->sview_len - ab->sbuf_len)
+        return svn_error_create(SVN_ERR_INCOMPLETE_DATA, NULL,
+                                "Delta source ended unexpectedly");
+
+      ab->sview = data - ab->sbuf_len;
+      ab->sbuf_len = window->sview_len;
+      ab->source_views = svn_tristate_true;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Apply WINDOW to the streams given by APPL.  */
 static svn_error_t *
 apply_window(svn_txdelta_window_t *window, void *baton)
@@ -751,9 +838,26 @@ apply_window(svn_txdelta_window_t *window, void *baton)
   /* Make sure there's enough room in the target buffer.  */
   SVN_ERR(size_buffer(&ab->tbuf, &ab->tbuf_size, window->tview_len, ab->pool));
 
-  /* Prepare the source buffer for reading from the input stream.  */
-  if (window->sview_offset != ab->sbuf_offset
-      || window->sview_len > ab->sbuf_size)
+  /* Prefer applying the instructions directly to the source stream's
+   * memory, e.g. a memory-mapped file, over copying it into SBUF. */
+  if (ab->source_views != svn_tristate_false)
+    {
+      svn_error_t *err = view_source(ab, window);
+      if (   err && err->apr_err == SVN_ERR_STREAM_NOT_SUPPORTED
+          && ab->source_views == svn_tristate_unknown)
+        {
+          svn_error_clear(err);
+          ab->source_views = svn_tristate_false;
+        }
+      else
+        SVN_ERR(err);
+    }
+
+  /* Prepare the source buffer for reading from the input stream.
+   * With source views, SBUF_LEN already covers the whole view. */
+  if (ab->source_views != svn_tristate_true
+      && (window->sview_offset != ab->sbuf_offset
+          || window->sview_len > ab->sbuf_size))
     {
       char *old_sbuf = ab->sbuf;
 
@@ -790,7 +894,11 @@ apply_window(svn_txdelta_window_t *window, void *baton)
   /* Apply the window instructions to the source view to generate
      the target view.  */
   len = window->tview_len;
-  svn_txdelta_apply_instructions(window, ab->sbuf, ab->tbuf, &len);
+  svn_txdelta_apply_instructions(window,
+                                 ab->source_views == svn_tristate_true
+                                   ? ab->sview
+                                   : ab->sbuf,
+                                 ab->tbuf, &len);
   SVN_ERR_ASSERT(len == window->tview_len);
 
   /* Write out the output. */
@@ -825,6 +933,8 @@ svn_txdelta_apply(svn_stream_t *source,
   ab->sbuf_len = 0;
   ab->tbuf = NULL;
   ab->tbuf_size = 0;
+  ab->source_views = svn_tristate_unknown;
+  ab->sview = NULL;
   ab->result_digest = result_digest;
 
   if (result_digest)
@@ -31,6 +31,10 @@
 #include "svn_delta.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+#if SVN__SSE2_AVAILABLE
+#include <emmintrin.h>
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -48,7 +52,8 @@
    MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about 20x
    the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
-   against the FLAGS array.
+   against the FLAGS array.  Larger windows, up to SVN_DELTA__MAX_WINDOW_SIZE,
+   merely make this pre-check less selective.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
@@ -82,6 +87,41 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 static APR_INLINE apr_uint32_t
 init_adler32(const char *data)
 {
+#if SVN__SSE2_AVAILABLE
+
+  /* The byte at offset I contributes (MATCH_BLOCKSIZE - I) times to S2.
+   * Weigh 8 bytes at a time with these factors and use SAD against 0 to
+   * sum up the bytes for S1. */
+  const __m128i zero = _mm_setzero_si128();
+  __m128i weights = _mm_set_epi16(57, 58, 59, 60, 61, 62, 63, 64);
+  const __m128i step = _mm_set1_epi16(8);
+  __m128i sum1 = zero;
+  __m128i sum2 = zero;
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += sizeof(__m128i))
+    {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+      __m128i low = _mm_unpacklo_epi8(bytes, zero);
+      __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+      sum1 = _mm_add_epi32(sum1, _mm_sad_epu8(bytes, zero));
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(low, weights));
+      weights = _mm_sub_epi16(weights, step);
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(high, weights));
+      weights = _mm_sub_epi16(weights, step);
+    }
+
+  /* Horizontal additions. */
+  sum1 = _mm_add_epi32(sum1, _mm_srli_si128(sum1, 8));
+  sum2 = _mm_add_epi32(sum2, _mm_srli_si128(sum2, 8));
+  sum2 = _mm_add_epi32(sum2, _mm_srli_si128(sum2, 4));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(sum2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(sum1);
+
+#else
+
   const unsigned char *input = (const unsigned char *)data;
   const unsigned char *last = input + MATCH_BLOCKSIZE;
 
@@ -101,6 +141,8 @@ init_adler32(const char *data)
     }
 
   return s2 * 0x10000 + s1;
+
+#endif
 }
 
 /* Information for a block of the delta source.  The length of the
@@ -204,6 +246,125 @@ find_block(const struct blocks *blocks,
   return NO_POSITION;
 }
 
+/* Return TRUE if the FLAGS in BLOCKS indicate that there may be a block
+   with the checksum ADLERSUM. */
+static APR_INLINE svn_boolean_t
+may_match(const struct blocks *blocks, apr_uint32_t adlersum)
+{
+  return (blocks->flags[hash_flags(adlersum)] & (1 << (adlersum & 7))) != 0;
+}
+
+#if SVN__SSE2_AVAILABLE
+
+/* Number of consecutive rolling checksums that skip_unmatched() computes
+   in one go. */
+#define ROLLING_LANES 8
+
+/* Given the checksum ROLLING of the block at DATA, write the checksums of
+   the ROLLING_LANES blocks starting at DATA+1, DATA+2, ... to SUMS.
+
+   The lower 16 bits of the pseudo-adler32, S1, are the plain sum over the
+   block, and the upper 16 bits, S2, are the sum over the S1 values of all
+   prefixes of the block.  Neither will carry into the other, so we can
+   roll 8 16 bit lanes in parallel using prefix sums:
+
+      S1(k) = S1 + sum(IN - OUT)[0..k)
+      S2(k) = S2 + k * S1 + sum(S1(1) .. S1(k)) - MATCH_BLOCKSIZE
+                                                  * sum(OUT)[0..k)
+
+   This gives exactly the same values as calling adler32_replace() for
+   each position. */
+static APR_INLINE void
+adler32_roll_lanes(apr_uint32_t sums[ROLLING_LANES],
+                   apr_uint32_t rolling,
+                   const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i out = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)data),
+                                  zero);
+  __m128i in = _mm_unpacklo_epi8(
+                 _mm_loadl_epi64((const __m128i *)(data + MATCH_BLOCKSIZE)),
+                 zero);
+  __m128i s1 = _mm_set1_epi16((short)(rolling & 0xffff));
+  __m128i s2 = _mm_set1_epi16((short)(rolling >> 16));
+  __m128i diff = _mm_sub_epi16(in, out);
+  __m128i sum_s1;
+
+  /* Inclusive prefix sums over the 8 lanes. */
+#define PREFIX_SUM(v) \
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 2)); \
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 4)); \
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 8))
+
+  PREFIX_SUM(diff);
+  PREFIX_SUM(out);
+  sum_s1 = diff;
+  PREFIX_SUM(sum_s1);
+
+#undef PREFIX_SUM
+
+  s2 = _mm_add_epi16(s2, _mm_mullo_epi16(s1, _mm_set_epi16(8, 7, 6, 5,
+                                                           4, 3, 2, 1)));
+  s2 = _mm_add_epi16(s2, sum_s1);
+  s2 = _mm_sub_epi16(s2, _mm_slli_epi16(out, 6));
+  s1 = _mm_add_epi16(s1, diff);
+
+  /* Interleave to S2 * 0x10000 + S1. */
+  _mm_storeu_si128((__m128i *)sums, _mm_unpacklo_epi16(s1, s2));
+  _mm_storeu_si128((__m128i *)(sums + 4), _mm_unpackhi_epi16(s1, s2));
+}
+
+#endif
+
+/* Starting with the block at LO in B that has the checksum *ROLLING,
+   advance to the first block whose checksum may have a match in BLOCKS
+   but don't go beyond UPPER.  Update *ROLLING and return the new
+   position. */
+static APR_INLINE apr_size_t
+skip_unmatched(const struct blocks *blocks,
+               apr_uint32_t *rolling,
+               const char *b,
+               apr_size_t lo,
+               apr_size_t upper)
+{
+  apr_uint32_t sum = *rolling;
+
+#if SVN__SSE2_AVAILABLE
+
+  /* Process the bulk of the data with the vectorized checksum.  The flag
+     lookups are still individual but no longer wait for one another. */
+  while (lo + ROLLING_LANES <= upper && !may_match(blocks, sum))
+    {
+      apr_uint32_t sums[ROLLING_LANES];
+      int i;
+
+      adler32_roll_lanes(sums, sum, b + lo);
+      for (i = 0; i < ROLLING_LANES; ++i)
+        if (may_match(blocks, sums[i]))
+          break;
+
+      if (i < ROLLING_LANES)
+        {
+          *rolling = sums[i];
+          return lo + i + 1;
+        }
+
+      sum = sums[ROLLING_LANES - 1];
+      lo += ROLLING_LANES;
+    }
+
+#endif
+
+  while (!may_match(blocks, sum) && lo < upper)
+    {
+      sum = adler32_replace(sum, b[lo], b[lo+MATCH_BLOCKSIZE]);
+      lo++;
+    }
+
+  *rolling = sum;
+  return lo;
+}
+
 /* Initialize the matches table from DATA of size DATALEN.  This goes
    through every block of MATCH_BLOCKSIZE bytes in the source and
    checksums it, inserting the result into the BLOCKS table.  */
@@ -414,12 +575,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
-        {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
-        }
+      lo = skip_unmatched(&blocks, &rolling, b, lo, upper);
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
          Closely check whether we've got a match for the current location.
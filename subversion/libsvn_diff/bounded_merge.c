@@ -0,0 +1,507 @@
+/*
+ * bounded_merge.c :  three-way merge of files in segments of limited size
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+
+#include <apr.h>
+#include <apr_pools.h>
+#include <apr_hash.h>
+#include <apr_file_io.h>
+
+#include "svn_diff.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "private/svn_eol_private.h"
+#include "private/svn_string_private.h"
+
+#include "diff.h"
+
+
+/*
+ * A merge of whole files needs memory for all three texts, their tokens,
+ * position lists and the LCS.  For large files, that is many times their
+ * size.  To stay within a memory budget, we read the files through windows
+ * of limited size instead and split them into segments that can be merged
+ * on their own:
+ *
+ * - Lines that are identical in all three windows at their start get
+ *   copied to the output directly.  This is the same identical-prefix
+ *   optimization that svn_diff_file_diff3_2() does, except that it applies
+ *   to every segment and not just to the start of the files.
+ *
+ * - Otherwise, we pick an anchor line that occurs exactly once in each of
+ *   the three windows and cut each file just before it.  The text before
+ *   the anchor gets merged in memory and written to the output.  The anchor
+ *   itself then becomes part of the identical prefix of the next segment.
+ *
+ * - If there is no such line, we merge everything up to the last complete
+ *   line of each window.
+ */
+
+/* The diff code needs several times the size of the data in memory.
+ * Each of the three files gets this fraction of the memory budget. */
+#define BUDGET_SHARE_PER_FILE 12
+
+/* Never read less than this per file and window. */
+#define MIN_WINDOW_SIZE 0x1000
+
+/* One of the three files being merged. */
+typedef struct merge_source_t
+{
+  /* The file, positioned just behind the data in WINDOW. */
+  apr_file_t *file;
+
+  /* The data read but not processed yet. */
+  svn_stringbuf_t *window;
+
+  /* Whether WINDOW contains all remaining data of FILE. */
+  svn_boolean_t eof;
+} merge_source_t;
+
+/* Number of occurrences and offset of the first occurrence of a line in
+ * each of the three windows. */
+typedef struct anchor_t
+{
+  int count[3];
+  apr_size_t offset[3];
+} anchor_t;
+
+/* The state of svn_diff_file_merge3() in bounded mode. */
+typedef struct merge_baton_t
+{
+  /* Original, modified and latest file, in that order. */
+  merge_source_t sources[3];
+
+  /* Maximum number of bytes to read into each window. */
+  apr_size_t window_size;
+
+  /* Line ending for the conflict markers or NULL if the modified file did
+   * not have any line ending so far. */
+  const char *marker_eol;
+
+  /* Merge results so far. */
+  svn_boolean_t contains_diffs;
+  svn_boolean_t contains_conflicts;
+
+  /* Parameters passed to svn_diff_file_merge3(). */
+  svn_stream_t *output_stream;
+  const svn_diff_file_options_t *options;
+  const char *conflict_original;
+  const char *conflict_modified;
+  const char *conflict_latest;
+  const char *conflict_separator;
+  svn_diff_conflict_display_style_t conflict_style;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} merge_baton_t;
+
+/* Read data from SOURCE until its window contains WINDOW_SIZE bytes or
+ * the end of the file has been reached.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+fill_window(merge_source_t *source,
+            apr_size_t window_size,
+            apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *window = source->window;
+  apr_size_t bytes_read;
+
+  if (source->eof || window->len >= window_size)
+    return SVN_NO_ERROR;
+
+  svn_stringbuf_ensure(window, window_size);
+  SVN_ERR(svn_io_file_read_full2(source->file, window->data + window->len,
+                                 window_size - window->len, &bytes_read,
+                                 &source->eof, scratch_pool));
+  window->len += bytes_read;
+  window->data[window->len] = '\0';
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if a line ends just before offset POS in the window of
+ * SOURCE.  A trailing CR at the end of the window only counts if there
+ * can't be a LF following it. */
+static svn_boolean_t
+is_line_end(const merge_source_t *source,
+            apr_size_t pos)
+{
+  const svn_stringbuf_t *window = source->window;
+
+  if (pos == 0)
+    return FALSE;
+
+  if (window->data[pos - 1] == '\n')
+    return TRUE;
+  if (window->data[pos - 1] != '\r')
+    return FALSE;
+
+  return pos < window->len ? window->data[pos] != '\n' : source->eof;
+}
+
+/* Return the number of bytes of complete lines in the window of SOURCE.
+ * At the end of the file, that includes any final line without EOL. */
+static apr_size_t
+complete_length(const merge_source_t *source)
+{
+  apr_size_t pos = source->window->len;
+
+  if (source->eof)
+    return pos;
+
+  while (pos > 0 && !is_line_end(source, pos))
+    --pos;
+
+  return pos;
+}
+
+/* Return the number of bytes of complete lines that are identical at the
+ * start of all windows in B. */
+static apr_size_t
+common_prefix_length(const merge_baton_t *b)
+{
+  const svn_stringbuf_t *windows[3];
+  apr_size_t length;
+  int i;
+
+  for (i = 0; i < 3; ++i)
+    windows[i] = b->sources[i].window;
+
+  length = svn_cstring__match_length(windows[0]->data, windows[1]->data,
+                                     MIN(windows[0]->len, windows[1]->len));
+  length = svn_cstring__match_length(windows[0]->data, windows[2]->data,
+                                     MIN(length, windows[2]->len));
+
+  /* Identical remainders of all files. */
+  if (   b->sources[0].eof && b->sources[1].eof && b->sources[2].eof
+      && length == windows[0]->len
+      && length == windows[1]->len
+      && length == windows[2]->len)
+    return length;
+
+  while (   length > 0
+         && !(   is_line_end(&b->sources[0], length)
+              && is_line_end(&b->sources[1], length)
+              && is_line_end(&b->sources[2], length)))
+    --length;
+
+  return length;
+}
+
+/* Find the line that occurs exactly once within the first LENGTHS[I] bytes
+ * of each window I in B and that is as far away from the start of the
+ * windows as possible.  Return FALSE if there is no such line.  Otherwise,
+ * set OFFSETS[I] to the offset of that line in window I.  Use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_boolean_t
+find_anchor(apr_size_t offsets[3],
+            const merge_baton_t *b,
+            const apr_size_t lengths[3],
+            apr_pool_t *scratch_pool)
+{
+  apr_hash_t *lines = apr_hash_make(scratch_pool);
+  apr_hash_index_t *hi;
+  svn_boolean_t found = FALSE;
+  apr_size_t best_distance = 0;
+  int i;
+
+  for (i = 0; i < 3; ++i)
+    {
+      char *data = b->sources[i].window->data;
+      apr_size_t pos = 0;
+
+      while (pos < lengths[i])
+        {
+          char *eol = svn_eol__find_eol_start(data + pos, lengths[i] - pos);
+          apr_size_t end = eol ? eol - data + 1 : lengths[i];
+          anchor_t *anchor;
+
+          if (eol && *eol == '\r' && end < lengths[i] && data[end] == '\n')
+            ++end;
+
+          anchor = apr_hash_get(lines, data + pos, end - pos);
+          if (anchor)
+            {
+              if (anchor->count[i]++ == 0)
+                anchor->offset[i] = pos;
+            }
+          else if (i == 0)
+            {
+              /* Only lines from the original can be common to all. */
+              anchor = apr_pcalloc(scratch_pool, sizeof(*anchor));
+              anchor->count[0] = 1;
+              anchor->offset[0] = pos;
+              apr_hash_set(lines, data + pos, end - pos, anchor);
+            }
+
+          pos = end;
+        }
+    }
+
+  for (hi = apr_hash_first(scratch_pool, lines); hi; hi = apr_hash_next(hi))
+    {
+      const anchor_t *anchor = apr_hash_this_val(hi);
+      apr_size_t distance;
+
+      if (   anchor->count[0] != 1
+          || anchor->count[1] != 1
+          || anchor->count[2] != 1)
+        continue;
+
+      /* Cutting before a common first line would not get us anywhere. */
+      if (anchor->offset[0] + anchor->offset[1] + anchor->offset[2] == 0)
+        continue;
+
+      distance = MIN(anchor->offset[0],
+                     MIN(anchor->offset[1], anchor->offset[2]));
+      if (!found || distance > best_distance)
+        {
+          found = TRUE;
+          best_distance = distance;
+          for (i = 0; i < 3; ++i)
+            offsets[i] = anchor->offset[i];
+        }
+    }
+
+  return found;
+}
+
+/* Merge the first LENGTHS[I] bytes of each window I in B, write the result
+ * to the output stream and remove the data from the windows.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+merge_segment(merge_baton_t *b,
+              const apr_size_t lengths[3],
+              apr_pool_t *scratch_pool)
+{
+  svn_string_t texts[3];
+  svn_diff_t *diff;
+  int i;
+
+  for (i = 0; i < 3; ++i)
+    {
+      texts[i].data = b->sources[i].window->data;
+      texts[i].len = lengths[i];
+    }
+
+  SVN_ERR(svn_diff_mem_string_diff3(&diff, &texts[0], &texts[1], &texts[2],
+                                    b->options, scratch_pool));
+  SVN_ERR(svn_diff__mem_string_output_merge3(b->output_stream, diff,
+                                             &texts[0], &texts[1], &texts[2],
+                                             b->conflict_original,
+                                             b->conflict_modified,
+                                             b->conflict_latest,
+                                             b->conflict_separator,
+                                             b->marker_eol
+                                               ? b->marker_eol
+                                               : APR_EOL_STR,
+                                             b->conflict_style,
+                                             b->cancel_func, b->cancel_baton,
+                                             scratch_pool));
+
+  b->contains_diffs |= svn_diff_contains_diffs(diff);
+  b->contains_conflicts |= svn_diff_contains_conflicts(diff);
+
+  for (i = 0; i < 3; ++i)
+    svn_stringbuf_remove(b->sources[i].window, 0, lengths[i]);
+
+  return SVN_NO_ERROR;
+}
+
+/* Merge the files in B segment by segment.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+merge_bounded(merge_baton_t *b,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      apr_size_t lengths[3];
+      apr_size_t offsets[3];
+      apr_size_t prefix_length;
+      svn_boolean_t all_eof = TRUE;
+      svn_boolean_t need_more_data = FALSE;
+      int i;
+
+      svn_pool_clear(iterpool);
+      if (b->cancel_func)
+        SVN_ERR(b->cancel_func(b->cancel_baton));
+
+      for (i = 0; i < 3; ++i)
+        {
+          SVN_ERR(fill_window(&b->sources[i], b->window_size, iterpool));
+          all_eof &= b->sources[i].eof;
+        }
+
+      /* Use the first line ending in the modified file for the conflict
+       * markers, just like svn_diff_file_output_merge3() does. */
+      if (!b->marker_eol)
+        b->marker_eol = svn_eol__detect_eol(b->sources[1].window->data,
+                                            b->sources[1].window->len,
+                                            NULL);
+
+      prefix_length = common_prefix_length(b);
+      if (prefix_length)
+        {
+          SVN_ERR(svn_stream_write(b->output_stream,
+                                   b->sources[0].window->data,
+                                   &prefix_length));
+          for (i = 0; i < 3; ++i)
+            svn_stringbuf_remove(b->sources[i].window, 0, prefix_length);
+
+          continue;
+        }
+
+      if (all_eof)
+        {
+          if (   b->sources[0].window->len
+              || b->sources[1].window->len
+              || b->sources[2].window->len)
+            {
+              for (i = 0; i < 3; ++i)
+                lengths[i] = b->sources[i].window->len;
+
+              SVN_ERR(merge_segment(b, lengths, iterpool));
+            }
+
+          break;
+        }
+
+      /* A single line must fit into the window. */
+      for (i = 0; i < 3; ++i)
+        {
+          lengths[i] = complete_length(&b->sources[i]);
+          if (lengths[i] == 0 && !b->sources[i].eof)
+            need_more_data = TRUE;
+        }
+
+      if (need_more_data)
+        {
+          b->window_size *= 2;
+          continue;
+        }
+
+      /* Cut before the anchor line or, if there is none, at the window
+       * ends. */
+      if (find_anchor(offsets, b, lengths, iterpool))
+        SVN_ERR(merge_segment(b, offsets, iterpool));
+      else
+        SVN_ERR(merge_segment(b, lengths, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_diff_file_merge3(svn_boolean_t *contains_diffs,
+                     svn_boolean_t *contains_conflicts,
+                     svn_stream_t *output_stream,
+                     const char *original_path,
+                     const char *modified_path,
+                     const char *latest_path,
+                     const svn_diff_file_options_t *options,
+                     const char *conflict_original,
+                     const char *conflict_modified,
+                     const char *conflict_latest,
+                     const char *conflict_separator,
+                     svn_diff_conflict_display_style_t conflict_style,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  merge_baton_t b;
+  const char *paths[3];
+  int i;
+
+  /* The hunk headers of conflicts-only output refer to line numbers in
+   * the whole files. */
+  if (   options->memory_budget == 0
+      || conflict_style == svn_diff_conflict_display_only_conflicts)
+    {
+      svn_diff_t *diff;
+
+      SVN_ERR(svn_diff_file_diff3_2(&diff, original_path, modified_path,
+                                    latest_path, options, scratch_pool));
+      SVN_ERR(svn_diff_file_output_merge3(output_stream, diff,
+                                          original_path, modified_path,
+                                          latest_path,
+                                          conflict_original,
+                                          conflict_modified,
+                                          conflict_latest,
+                                          conflict_separator,
+                                          conflict_style,
+                                          cancel_func, cancel_baton,
+                                          scratch_pool));
+
+      if (contains_diffs)
+        *contains_diffs = svn_diff_contains_diffs(diff);
+      if (contains_conflicts)
+        *contains_conflicts = svn_diff_contains_conflicts(diff);
+
+      return SVN_NO_ERROR;
+    }
+
+  memset(&b, 0, sizeof(b));
+  paths[0] = original_path;
+  paths[1] = modified_path;
+  paths[2] = latest_path;
+
+  b.window_size = MAX(options->memory_budget / BUDGET_SHARE_PER_FILE,
+                      MIN_WINDOW_SIZE);
+  for (i = 0; i < 3; ++i)
+    {
+      SVN_ERR(svn_io_file_open(&b.sources[i].file, paths[i], APR_READ,
+                               APR_OS_DEFAULT, scratch_pool));
+      b.sources[i].window = svn_stringbuf_create_ensure(b.window_size,
+                                                        scratch_pool);
+    }
+
+  b.output_stream = output_stream;
+  b.options = options;
+  b.conflict_original = conflict_original;
+  b.conflict_modified = conflict_modified;
+  b.conflict_latest = conflict_latest;
+  b.conflict_separator = conflict_separator;
+  b.conflict_style = conflict_style;
+  b.cancel_func = cancel_func;
+  b.cancel_baton = cancel_baton;
+
+  SVN_ERR(merge_bounded(&b, scratch_pool));
+
+  for (i = 0; i < 3; ++i)
+    SVN_ERR(svn_io_file_close(b.sources[i].file, scratch_pool));
+
+  if (contains_diffs)
+    *contains_diffs = b.contains_diffs;
+  if (contains_conflicts)
+    *contains_conflicts = b.contains_conflicts;
+
+  return SVN_NO_ERROR;
+}
@@ -101,6 +101,8 @@ typedef enum svn_diff__normalize_state_t
  * equal and be excluded from the comparison process. Similarly, SUFFIX_LINES
  * at the end of both sequences will be skipped.
  *
+ * ALGORITHM selects how the LCS gets calculated.
+ *
  * The resulting lcs structure will be the return value of this function.
  * Allocations will be made from POOL.
  */
@@ -112,8 +114,24 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
               svn_diff__token_index_t num_tokens, /* length of count arrays */
               apr_off_t prefix_lines,
               apr_off_t suffix_lines,
+              svn_diff_algorithm_t algorithm,
               apr_pool_t *pool);
 
+/*
+ * Match the non-empty datasources POSITION_LIST1 and POSITION_LIST2
+ * (pointers to the tails of the rings) using the histogram diff algorithm.
+ * NUM_TOKENS is the highest possible token index + 1.
+ *
+ * Return the common runs as a chain of lcs structures in reverse order,
+ * i.e. starting with the last one, and without an EOF element.  Return
+ * NULL if there are none.  Allocations will be made from POOL.
+ */
+svn_diff__lcs_t *
+svn_diff__lcs_histogram(svn_diff__position_t *position_list1,
+                        svn_diff__position_t *position_list2,
+                        svn_diff__token_index_t num_tokens,
+                        apr_pool_t *pool);
+
 
 /*
  * Returns number of tokens in a tree
@@ -163,8 +181,53 @@ svn_diff__resolve_conflict(svn_diff_t *hunk,
                            svn_diff__position_t **position_list1,
                            svn_diff__position_t **position_list2,
                            svn_diff__token_index_t num_tokens,
+                           svn_diff_algorithm_t algorithm,
                            apr_pool_t *pool);
 
+/* Like svn_diff_diff_2(), svn_diff_diff3_2() and svn_diff_diff4_2(),
+ * respectively, but calculate the LCS using ALGORITHM. */
+svn_error_t *
+svn_diff__diff_2(svn_diff_t **diff,
+                 void *diff_baton,
+                 const svn_diff_fns2_t *vtable,
+                 svn_diff_algorithm_t algorithm,
+                 apr_pool_t *pool);
+
+svn_error_t *
+svn_diff__diff3_2(svn_diff_t **diff,
+                  void *diff_baton,
+                  const svn_diff_fns2_t *vtable,
+                  svn_diff_algorithm_t algorithm,
+                  apr_pool_t *pool);
+
+svn_error_t *
+svn_diff__diff4_2(svn_diff_t **diff,
+                  void *diff_baton,
+                  const svn_diff_fns2_t *vtable,
+                  svn_diff_algorithm_t algorithm,
+                  apr_pool_t *pool);
+
+
+/* Like svn_diff_mem_string_output_merge3() but terminate the conflict
+ * markers with MARKER_EOL.  If that is NULL, use the line ending of the
+ * first line of MODIFIED or the platform default as the public function
+ * does. */
+svn_error_t *
+svn_diff__mem_string_output_merge3(svn_stream_t *output_stream,
+                                   svn_diff_t *diff,
+                                   const svn_string_t *original,
+                                   const svn_string_t *modified,
+                                   const svn_string_t *latest,
+                                   const char *conflict_original,
+                                   const char *conflict_modified,
+                                   const char *conflict_latest,
+                                   const char *conflict_separator,
+                                   const char *marker_eol,
+                                   svn_diff_conflict_display_style_t style,
+                                   svn_cancel_func_t cancel_func,
+                                   void *cancel_baton,
+                                   apr_pool_t *scratch_pool);
+
 
 /* Normalize the characters pointed to by the buffer BUF (of length *LENGTHP)
  * according to the options *OPTS, starting in the state *STATEP.
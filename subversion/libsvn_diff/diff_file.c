@@ -51,6 +51,11 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_adler32.h"
 #include "private/svn_diff_private.h"
+#include "private/svn_string_private.h"
+
+#if SVN__SSE2_AVAILABLE
+#include <emmintrin.h>
+#endif
 
 /* A token, i.e. a line read from a file. */
 typedef struct svn_diff__file_token_t
@@ -372,6 +377,66 @@ static svn_boolean_t contains_eol(apr_uintptr_t chunk)
 }
 #endif
 
+#if SVN__SSE2_AVAILABLE
+
+/* Return the number of bits set in the 16 bit MASK.  In our use-case,
+ * only few bits will be set. */
+static APR_INLINE apr_off_t
+count_bits(int mask)
+{
+  apr_off_t count = 0;
+  for (; mask; mask &= mask - 1)
+    ++count;
+
+  return count;
+}
+
+/* Return the number of EOL sequences ending in the 16 bytes of CHUNK,
+ * scanning forward.  '\r\n' counts as a single EOL.  *HAD_CR tells whether
+ * the byte before CHUNK has been a '\r'; it will be updated to refer to
+ * the last byte in CHUNK. */
+static APR_INLINE apr_off_t
+count_eols_forward(__m128i chunk,
+                   svn_boolean_t *had_cr)
+{
+  int cr = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+  int lf = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+
+  /* A '\n' directly following a '\r' has already been counted. */
+  int lf_after_cr = lf & ((cr << 1) | (*had_cr ? 1 : 0));
+
+  *had_cr = (cr & 0x8000) != 0;
+  return count_bits(cr) + count_bits(lf & ~lf_after_cr);
+}
+
+/* Like count_eols_forward() but for scanning backward.  *HAD_NL tells
+ * whether the byte behind CHUNK has been a '\n' and will be updated to
+ * refer to the first byte in CHUNK. */
+static APR_INLINE apr_off_t
+count_eols_backward(__m128i chunk,
+                    svn_boolean_t *had_nl)
+{
+  int cr = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+  int lf = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+
+  /* A '\r' directly followed by a '\n' has already been counted. */
+  int cr_before_lf = cr & ((lf >> 1) | (*had_nl ? 0x8000 : 0));
+
+  *had_nl = (lf & 1) != 0;
+  return count_bits(lf) + count_bits(cr & ~cr_before_lf);
+}
+
+/* Return TRUE if the 16 bytes at DATA equal CHUNK. */
+static APR_INLINE svn_boolean_t
+chunk_matches(__m128i chunk,
+              const char *data)
+{
+  __m128i other = _mm_loadu_si128((const __m128i *)data);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, other)) == 0xffff;
+}
+
+#endif /* SVN__SSE2_AVAILABLE */
+
 /* Find the prefix which is identical between all elements of the FILE array.
  * Return the number of prefix lines in PREFIX_LINES.  REACHED_ONE_EOF will be
  * set to TRUE if one of the FILEs reached its end while scanning prefix,
@@ -420,6 +485,36 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
       INCREMENT_POINTERS(file, file_len, pool);
 
 #if SVN_UNALIGNED_ACCESS_IS_OK
+#if SVN__SSE2_AVAILABLE
+
+      /* Compare 16 bytes at a time.  Unlike the word loop below, we don't
+       * need to stop at EOLs because we can count them on the way.
+       */
+      max_delta = file[0].endp - file[0].curp - sizeof(__m128i);
+      for (i = 1; i < file_len; i++)
+        {
+          delta = file[i].endp - file[i].curp - sizeof(__m128i);
+          if (delta < max_delta)
+            max_delta = delta;
+        }
+
+      for (delta = 0; delta < max_delta; delta += sizeof(__m128i))
+        {
+          __m128i chunk = _mm_loadu_si128((const __m128i *)(file[0].curp
+                                                            + delta));
+          for (i = 1, is_match = TRUE; is_match && i < file_len; i++)
+            is_match = chunk_matches(chunk, file[i].curp + delta);
+
+          if (! is_match)
+            break;
+
+          lines += count_eols_forward(chunk, &had_cr);
+        }
+
+      for (i = 0; i < file_len; i++)
+        file[i].curp += delta;
+
+#endif /* SVN__SSE2_AVAILABLE */
 
       /* Try to advance as far as possible with machine-word granularity.
        * Determine how far we may advance with chunky ops without reaching
@@ -646,6 +741,38 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
       if (file_for_suffix[0].chunk == suffix_min_chunk0)
         min_curp[0] += suffix_min_offset0;
 
+#if SVN__SSE2_AVAILABLE
+      /* Compare 16 bytes at a time, counting the EOLs on the way. */
+      for (i = 0, can_read_word = TRUE; can_read_word && i < file_len; i++)
+        can_read_word = ((file_for_suffix[i].curp + 1 - sizeof(__m128i))
+                         > min_curp[i]);
+
+      while (can_read_word)
+        {
+          __m128i chunk
+            = _mm_loadu_si128((const __m128i *)(file_for_suffix[0].curp + 1
+                                                - sizeof(__m128i)));
+
+          for (i = 1, is_match = TRUE; is_match && i < file_len; i++)
+            is_match = chunk_matches(chunk, file_for_suffix[i].curp + 1
+                                              - sizeof(__m128i));
+
+          if (! is_match)
+            break;
+
+          lines += count_eols_backward(chunk, &had_nl);
+
+          for (i = 0; i < file_len; i++)
+            {
+              file_for_suffix[i].curp -= sizeof(__m128i);
+              can_read_word = can_read_word
+                              && (  (file_for_suffix[i].curp + 1
+                                       - sizeof(__m128i))
+                                  > min_curp[i]);
+            }
+        }
+#endif /* SVN__SSE2_AVAILABLE */
+
       /* Scan quickly by reading with machine-word granularity. */
       for (i = 0, can_read_word = TRUE; can_read_word && i < file_len; i++)
         can_read_word = ((file_for_suffix[i].curp + 1 - sizeof(apr_uintptr_t))
@@ -1179,8 +1306,10 @@ static const svn_diff_fns2_t svn_diff__file_vtable =
   token_discard_all
 };
 
-/* Id for the --ignore-eol-style option, which doesn't have a short name. */
+/* Ids for the options that don't have a short name. */
 #define SVN_DIFF__OPT_IGNORE_EOL_STYLE 256
+#define SVN_DIFF__OPT_DIFF_ALGORITHM 257
+#define SVN_DIFF__OPT_MEMORY_BUDGET 258
 
 /* Options supported by svn_diff_file_options_parse(). */
 static const apr_getopt_option_t diff_options[] =
@@ -1189,6 +1318,8 @@ static const apr_getopt_option_t diff_options[] =
   { "ignore-all-space", 'w', 0, NULL },
   { "ignore-eol-style", SVN_DIFF__OPT_IGNORE_EOL_STYLE, 0, NULL },
   { "show-c-function", 'p', 0, NULL },
+  { "diff-algorithm", SVN_DIFF__OPT_DIFF_ALGORITHM, 1, NULL },
+  { "memory-budget", SVN_DIFF__OPT_MEMORY_BUDGET, 1, NULL },
   /* ### For compatibility; we don't support the argument to -u, because
    * ### we don't have optional argument support. */
   { "unified", 'u', 0, NULL },
@@ -1298,6 +1429,26 @@ svn_diff_file_options_parse(svn_diff_file_options_t *options,
         case 'U':
           SVN_ERR(svn_cstring_atoi(&options->context_size, opt_arg));
           break;
+        case SVN_DIFF__OPT_DIFF_ALGORITHM:
+          if (strcmp(opt_arg, "auto") == 0)
+            options->algorithm = svn_diff_algorithm_auto;
+          else if (strcmp(opt_arg, "myers") == 0)
+            options->algorithm = svn_diff_algorithm_myers;
+          else if (strcmp(opt_arg, "histogram") == 0)
+            options->algorithm = svn_diff_algorithm_histogram;
+          else
+            return svn_error_createf(SVN_ERR_INVALID_DIFF_OPTION, NULL,
+                                     _("Unknown diff algorithm '%s'"),
+                                     opt_arg);
+          break;
+        case SVN_DIFF__OPT_MEMORY_BUDGET:
+          {
+            apr_uint64_t megabytes;
+            SVN_ERR(svn_cstring_strtoui64(&megabytes, opt_arg, 0,
+                                          APR_SIZE_MAX / (1024 * 1024), 10));
+            options->memory_budget = (apr_size_t)megabytes * 1024 * 1024;
+          }
+          break;
         default:
           break;
         }
@@ -1326,7 +1477,8 @@ svn_diff_file_diff_2(svn_diff_t **diff,
   baton.files[1].path = modified;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff_2(diff, &baton, &svn_diff__file_vtable,
+                           options->algorithm, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -1348,7 +1500,8 @@ svn_diff_file_diff3_2(svn_diff_t **diff,
   baton.files[2].path = latest;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff3_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff3_2(diff, &baton, &svn_diff__file_vtable,
+                            options->algorithm, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -1372,7 +1525,8 @@ svn_diff_file_diff4_2(svn_diff_t **diff,
   baton.files[3].path = ancestor;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff4_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff4_2(diff, &baton, &svn_diff__file_vtable,
+                            options->algorithm, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -293,7 +293,8 @@ svn_diff_mem_string_diff(svn_diff_t **diff,
 
   baton.normalization_options = options;
 
-  return svn_diff_diff_2(diff, &baton, &svn_diff__mem_vtable, pool);
+  return svn_diff__diff_2(diff, &baton, &svn_diff__mem_vtable,
+                          options->algorithm, pool);
 }
 
 svn_error_t *
@@ -313,7 +314,8 @@ svn_diff_mem_string_diff3(svn_diff_t **diff,
 
   baton.normalization_options = options;
 
-  return svn_diff_diff3_2(diff, &baton, &svn_diff__mem_vtable, pool);
+  return svn_diff__diff3_2(diff, &baton, &svn_diff__mem_vtable,
+                           options->algorithm, pool);
 }
 
 
@@ -336,7 +338,8 @@ svn_diff_mem_string_diff4(svn_diff_t **diff,
 
   baton.normalization_options = options;
 
-  return svn_diff_diff4_2(diff, &baton, &svn_diff__mem_vtable, pool);
+  return svn_diff__diff4_2(diff, &baton, &svn_diff__mem_vtable,
+                           options->algorithm, pool);
 }
 
 
@@ -1048,22 +1051,23 @@ detect_eol(svn_string_t *token)
 }
 
 svn_error_t *
-svn_diff_mem_string_output_merge3(svn_stream_t *output_stream,
-                                  svn_diff_t *diff,
-                                  const svn_string_t *original,
-                                  const svn_string_t *modified,
-                                  const svn_string_t *latest,
-                                  const char *conflict_original,
-                                  const char *conflict_modified,
-                                  const char *conflict_latest,
-                                  const char *conflict_separator,
-                                  svn_diff_conflict_display_style_t style,
-                                  svn_cancel_func_t cancel_func,
-                                  void *cancel_baton,
-                                  apr_pool_t *scratch_pool)
+svn_diff__mem_string_output_merge3(svn_stream_t *output_stream,
+                                   svn_diff_t *diff,
+                                   const svn_string_t *original,
+                                   const svn_string_t *modified,
+                                   const svn_string_t *latest,
+                                   const char *conflict_original,
+                                   const char *conflict_modified,
+                                   const char *conflict_latest,
+                                   const char *conflict_separator,
+                                   const char *marker_eol,
+                                   svn_diff_conflict_display_style_t style,
+                                   svn_cancel_func_t cancel_func,
+                                   void *cancel_baton,
+                                   apr_pool_t *scratch_pool)
 {
   merge_output_baton_t btn;
-  const char *eol;
+  const char *eol = marker_eol;
   svn_boolean_t conflicts_only =
     (style == svn_diff_conflict_display_only_conflicts);
   const svn_diff_output_fns_t *vtable = conflicts_only
@@ -1087,7 +1091,9 @@ svn_diff_mem_string_output_merge3(svn_stream_t *output_stream,
 
   btn.conflict_style = style;
 
-  if (btn.sources[1].tokens->nelts > 0)
+  if (eol)
+    ; /* use the caller's choice */
+  else if (btn.sources[1].tokens->nelts > 0)
     {
       eol = detect_eol(APR_ARRAY_IDX(btn.sources[1].tokens, 0, svn_string_t *));
       if (!eol)
@@ -1127,3 +1133,25 @@ svn_diff_mem_string_output_merge3(svn_stream_t *output_stream,
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_diff_mem_string_output_merge3(svn_stream_t *output_stream,
+                                  svn_diff_t *diff,
+                                  const svn_string_t *original,
+                                  const svn_string_t *modified,
+                                  const svn_string_t *latest,
+                                  const char *conflict_original,
+                                  const char *conflict_modified,
+                                  const char *conflict_latest,
+                                  const char *conflict_separator,
+                                  svn_diff_conflict_display_style_t style,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_diff__mem_string_output_merge3(
+                           output_stream, diff, original, modified, latest,
+                           conflict_original, conflict_modified,
+                           conflict_latest, conflict_separator, NULL,
+                           style, cancel_func, cancel_baton, scratch_pool));
+}
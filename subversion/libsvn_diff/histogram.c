@@ -0,0 +1,376 @@
+/*
+ * histogram.c :  routines for creating an lcs with the histogram algorithm
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <stdlib.h>
+
+#include <apr.h>
+#include <apr_pools.h>
+#include <apr_general.h>
+#include <apr_tables.h>
+
+#include "svn_pools.h"
+
+#include "diff.h"
+
+
+/*
+ * The histogram diff algorithm is an extension of Bram Cohen's "patience
+ * diff".  Instead of searching for a minimal edit script, it matches the
+ * two sequences at "anchors" - runs of common tokens that are rare in the
+ * first sequence - and then recursively processes the sections before and
+ * after each anchor.
+ *
+ * For a given pair of sections, we first strip their common prefix and
+ * suffix.  Then, we count how often each token occurs in the first section
+ * (the histogram) and scan the second section for tokens that also occur
+ * in the first one.  Every such token gets extended into the longest common
+ * run around it.  The run containing the rarest token wins, with longer
+ * runs breaking ties.
+ *
+ * Since frequent tokens like empty lines or lone braces are not chosen as
+ * anchors while rarer ones exist, this tends to produce more readable
+ * diffs than the O(NP) algorithm for moved or rewritten blocks of code.
+ * The run time is roughly linear in the size of the input for typical
+ * data, independent of the number of differences.  However, the result is
+ * not guaranteed to be minimal.
+ */
+
+/* Limits the number of occurrences of a single token that we try to
+ * extend into a common run while scanning a section.  This keeps us from
+ * going quadratic on input with many repetitive lines.
+ */
+#define MAX_CHAIN_LENGTH 64
+
+/* A pair of sections [A_START, A_END) and [B_START, B_END) in the two
+ * sequences that still needs to be matched.
+ */
+typedef struct range_t
+{
+  apr_off_t a_start;
+  apr_off_t a_end;
+  apr_off_t b_start;
+  apr_off_t b_end;
+} range_t;
+
+/* A run of LENGTH common tokens starting at A and B, respectively.
+ */
+typedef struct match_t
+{
+  apr_off_t a;
+  apr_off_t b;
+  apr_off_t length;
+} match_t;
+
+/* The state of the histogram algorithm. */
+typedef struct histogram_t
+{
+  /* The token indexes of each sequence. */
+  svn_diff__token_index_t *tokens[2];
+
+  /* The number of occurrences of each token in the current section of
+   * the first sequence and the first of these occurrences (or -1).
+   * Indexed by token index. */
+  svn_diff__token_index_t *counts;
+  apr_off_t *head;
+
+  /* Offset of the next occurrence of the same token in the current
+   * section of the first sequence (or -1).  Indexed by offset. */
+  apr_off_t *next_occurrence;
+
+  /* All common runs found so far, in no particular order.
+   * Array of match_t. */
+  apr_array_header_t *matches;
+
+  /* Sections still to process.  Array of range_t. */
+  apr_array_header_t *todo;
+} histogram_t;
+
+/* Append a match of LENGTH tokens starting at A and B to H. */
+static void
+add_match(histogram_t *h,
+          apr_off_t a,
+          apr_off_t b,
+          apr_off_t length)
+{
+  match_t *match = apr_array_push(h->matches);
+  match->a = a;
+  match->b = b;
+  match->length = length;
+}
+
+/* Schedule the sections [A_START, A_END) and [B_START, B_END) in H for
+ * matching, unless one of them is empty. */
+static void
+push_range(histogram_t *h,
+           apr_off_t a_start,
+           apr_off_t a_end,
+           apr_off_t b_start,
+           apr_off_t b_end)
+{
+  range_t *range;
+
+  if (a_start >= a_end || b_start >= b_end)
+    return;
+
+  range = apr_array_push(h->todo);
+  range->a_start = a_start;
+  range->a_end = a_end;
+  range->b_start = b_start;
+  range->b_end = b_end;
+}
+
+/* Match the sections given by RANGE in H.  Record the common runs that
+ * can be determined directly and schedule the remaining sub-sections.
+ */
+static void
+process_range(histogram_t *h,
+              range_t range)
+{
+  svn_diff__token_index_t *tokens_a = h->tokens[0];
+  svn_diff__token_index_t *tokens_b = h->tokens[1];
+  apr_off_t a_start = range.a_start;
+  apr_off_t a_end = range.a_end;
+  apr_off_t b_start = range.b_start;
+  apr_off_t b_end = range.b_end;
+  apr_off_t best_a = 0, best_b = 0, best_length = 0;
+  svn_diff__token_index_t best_count = 0;
+  apr_off_t a, b;
+
+  /* Common prefix and suffix match trivially. */
+  for (a = a_start, b = b_start;
+       a < a_end && b < b_end && tokens_a[a] == tokens_b[b];
+       ++a, ++b)
+    ;
+  if (a > a_start)
+    add_match(h, a_start, b_start, a - a_start);
+  a_start = a;
+  b_start = b;
+
+  for (a = a_end, b = b_end;
+       a > a_start && b > b_start && tokens_a[a - 1] == tokens_b[b - 1];
+       --a, --b)
+    ;
+  if (a < a_end)
+    add_match(h, a, b, a_end - a);
+  a_end = a;
+  b_end = b;
+
+  if (a_start >= a_end || b_start >= b_end)
+    return;
+
+  /* Build the histogram of the first section.  Going backwards makes
+   * the occurrence chains ascending. */
+  for (a = a_end; a > a_start; --a)
+    {
+      svn_diff__token_index_t token = tokens_a[a - 1];
+
+      h->counts[token]++;
+      h->next_occurrence[a - 1] = h->head[token];
+      h->head[token] = a - 1;
+    }
+
+  /* Find the best anchor. */
+  for (b = b_start; b < b_end; )
+    {
+      svn_diff__token_index_t token = tokens_b[b];
+      apr_off_t next_b = b + 1;
+      apr_off_t candidate;
+      int chain_length;
+
+      if (h->counts[token] == 0
+          || (best_length && h->counts[token] > best_count))
+        {
+          b = next_b;
+          continue;
+        }
+
+      for (candidate = h->head[token], chain_length = 0;
+           candidate >= 0 && chain_length < MAX_CHAIN_LENGTH;
+           candidate = h->next_occurrence[candidate], ++chain_length)
+        {
+          svn_diff__token_index_t count = h->counts[token];
+          apr_off_t as = candidate, bs = b;
+          apr_off_t ae = candidate + 1, be = b + 1;
+
+          while (as > a_start && bs > b_start
+                 && tokens_a[as - 1] == tokens_b[bs - 1])
+            {
+              --as;
+              --bs;
+              if (h->counts[tokens_a[as]] < count)
+                count = h->counts[tokens_a[as]];
+            }
+
+          while (ae < a_end && be < b_end && tokens_a[ae] == tokens_b[be])
+            {
+              if (h->counts[tokens_a[ae]] < count)
+                count = h->counts[tokens_a[ae]];
+              ++ae;
+              ++be;
+            }
+
+          /* Continue the scan behind the longest run. */
+          if (next_b < be)
+            next_b = be;
+
+          if (   best_length == 0
+              || count < best_count
+              || (count == best_count && ae - as > best_length))
+            {
+              best_a = as;
+              best_b = bs;
+              best_length = ae - as;
+              best_count = count;
+            }
+        }
+
+      b = next_b;
+    }
+
+  /* Reset the histogram for the next section. */
+  for (a = a_start; a < a_end; ++a)
+    {
+      h->counts[tokens_a[a]] = 0;
+      h->head[tokens_a[a]] = -1;
+    }
+
+  /* Without any common token, the sections differ completely. */
+  if (best_length == 0)
+    return;
+
+  add_match(h, best_a, best_b, best_length);
+  push_range(h, a_start, best_a, b_start, best_b);
+  push_range(h, best_a + best_length, a_end, best_b + best_length, b_end);
+}
+
+/* Convert the position ring with tail POSITION_LIST into arrays of
+ * *LENGTH tokens and positions, allocated in POOL. */
+static void
+ring_to_arrays(svn_diff__token_index_t **tokens,
+               svn_diff__position_t ***positions,
+               apr_off_t *length,
+               svn_diff__position_t *position_list,
+               apr_pool_t *pool)
+{
+  svn_diff__position_t *position = position_list->next;
+  apr_off_t i;
+
+  *length = position_list->offset - position->offset + 1;
+  *tokens = apr_palloc(pool, sizeof(**tokens) * (apr_size_t)*length);
+  *positions = apr_palloc(pool, sizeof(**positions) * (apr_size_t)*length);
+
+  for (i = 0; i < *length; ++i, position = position->next)
+    {
+      (*tokens)[i] = position->token_index;
+      (*positions)[i] = position;
+    }
+}
+
+/* Sort match_t by the offset in the first sequence.  Implements the
+ * qsort() comparison callback. */
+static int
+compare_matches(const void *lhs,
+                const void *rhs)
+{
+  const match_t *lhs_match = lhs;
+  const match_t *rhs_match = rhs;
+
+  if (lhs_match->a < rhs_match->a)
+    return -1;
+
+  return lhs_match->a > rhs_match->a ? 1 : 0;
+}
+
+svn_diff__lcs_t *
+svn_diff__lcs_histogram(svn_diff__position_t *position_list1,
+                        svn_diff__position_t *position_list2,
+                        svn_diff__token_index_t num_tokens,
+                        apr_pool_t *pool)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  svn_diff__position_t **positions[2];
+  apr_off_t length[2];
+  histogram_t h;
+  svn_diff__lcs_t *lcs = NULL;
+  match_t *matches;
+  svn_diff__token_index_t token_index;
+  int i;
+
+  ring_to_arrays(&h.tokens[0], &positions[0], &length[0], position_list1,
+                 scratch_pool);
+  ring_to_arrays(&h.tokens[1], &positions[1], &length[1], position_list2,
+                 scratch_pool);
+
+  h.counts = apr_pcalloc(scratch_pool,
+                         sizeof(*h.counts) * (apr_size_t)num_tokens);
+  h.head = apr_palloc(scratch_pool, sizeof(*h.head) * (apr_size_t)num_tokens);
+  for (token_index = 0; token_index < num_tokens; ++token_index)
+    h.head[token_index] = -1;
+  h.next_occurrence = apr_palloc(scratch_pool,
+                                 sizeof(*h.next_occurrence)
+                                 * (apr_size_t)length[0]);
+
+  h.matches = apr_array_make(scratch_pool, 16, sizeof(match_t));
+  h.todo = apr_array_make(scratch_pool, 16, sizeof(range_t));
+
+  push_range(&h, 0, length[0], 0, length[1]);
+  while (h.todo->nelts)
+    {
+      range_t range = *(range_t *)apr_array_pop(h.todo);
+      process_range(&h, range);
+    }
+
+  /* The runs don't cross, so ordering them by the first sequence orders
+   * them by the second sequence as well. */
+  matches = (match_t *)h.matches->elts;
+  qsort(matches, h.matches->nelts, sizeof(*matches), compare_matches);
+
+  /* Build the lcs chain backwards, merging adjacent runs on the way. */
+  for (i = 0; i < h.matches->nelts; ++i)
+    {
+      svn_diff__lcs_t *new_lcs;
+
+      if (lcs
+          && lcs->position[0]->offset + lcs->length
+             == positions[0][matches[i].a]->offset
+          && lcs->position[1]->offset + lcs->length
+             == positions[1][matches[i].b]->offset)
+        {
+          lcs->length += matches[i].length;
+          continue;
+        }
+
+      new_lcs = apr_palloc(pool, sizeof(*new_lcs));
+      new_lcs->position[0] = positions[0][matches[i].a];
+      new_lcs->position[1] = positions[1][matches[i].b];
+      new_lcs->length = matches[i].length;
+      new_lcs->refcount = 1;
+      new_lcs->next = lcs;
+      lcs = new_lcs;
+    }
+
+  svn_pool_destroy(scratch_pool);
+
+  return lcs;
+}
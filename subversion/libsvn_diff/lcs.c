@@ -68,7 +68,19 @@
  * A recent improvement of the algorithm is to ignore tokens that are unique
  * to one file or the other, as those are known from the start to be
  * impossible to match.
+ *
+ * The run time of this algorithm grows with the product of the file lengths
+ * and the number of differences between them.  Unless the caller asked for
+ * it explicitly, we give up after MAX_AUTO_SNAKES snakes and fall back to
+ * the histogram algorithm (see histogram.c), which is much faster on large
+ * and very different inputs but does not guarantee a minimal diff.
+ */
+
+/* The number of calls to svn_diff__snake() after which svn_diff__lcs()
+ * switches to the histogram algorithm for svn_diff_algorithm_auto.
+ * This corresponds to roughly 4000 changed lines.
  */
+#define MAX_AUTO_SNAKES ((apr_off_t)1 << 24)
 
 typedef struct svn_diff__snake_t svn_diff__snake_t;
 
@@ -228,15 +240,25 @@ prepend_lcs(svn_diff__lcs_t *lcs, apr_off_t lines,
 }
 
 
-svn_diff__lcs_t *
-svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
-              svn_diff__position_t *position_list2, /* pointer to tail (ring) */
-              svn_diff__token_index_t *token_counts_list1, /* array of counts */
-              svn_diff__token_index_t *token_counts_list2, /* array of counts */
-              svn_diff__token_index_t num_tokens,
-              apr_off_t prefix_lines,
-              apr_off_t suffix_lines,
-              apr_pool_t *pool)
+/* Calculate the LCS between the non-empty datasources POSITION_LIST1 and
+ * POSITION_LIST2 using the O(NP) algorithm described above and set
+ * *MATCHES to the chain of common runs, starting with the last one.
+ * TOKEN_COUNTS_LIST1, TOKEN_COUNTS_LIST2 and NUM_TOKENS are as for
+ * svn_diff__lcs().
+ *
+ * If MAX_SNAKES is not 0 and the calculation takes more than that many
+ * snakes, abort it and return FALSE.  Otherwise, return TRUE.
+ * Allocations will be made from POOL.
+ */
+static svn_boolean_t
+lcs_onp(svn_diff__lcs_t **matches,
+        svn_diff__position_t *position_list1,
+        svn_diff__position_t *position_list2,
+        svn_diff__token_index_t *token_counts_list1,
+        svn_diff__token_index_t *token_counts_list2,
+        svn_diff__token_index_t num_tokens,
+        apr_off_t max_snakes,
+        apr_pool_t *pool)
 {
   apr_off_t length[2];
   svn_diff__token_index_t *token_counts[2];
@@ -246,39 +268,12 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
   apr_off_t d;
   apr_off_t k;
   apr_off_t p = 0;
-  svn_diff__lcs_t *lcs, *lcs_freelist = NULL;
+  apr_off_t snakes = 0;
+  svn_diff__lcs_t *lcs_freelist = NULL;
+  svn_boolean_t completed = TRUE;
 
   svn_diff__position_t sentinel_position[2];
 
-  /* Since EOF is always a sync point we tack on an EOF link
-   * with sentinel positions
-   */
-  lcs = apr_palloc(pool, sizeof(*lcs));
-  lcs->position[0] = apr_pcalloc(pool, sizeof(*lcs->position[0]));
-  lcs->position[0]->offset = position_list1
-                             ? position_list1->offset + suffix_lines + 1
-                             : prefix_lines + suffix_lines + 1;
-  lcs->position[1] = apr_pcalloc(pool, sizeof(*lcs->position[1]));
-  lcs->position[1]->offset = position_list2
-                             ? position_list2->offset + suffix_lines + 1
-                             : prefix_lines + suffix_lines + 1;
-  lcs->length = 0;
-  lcs->refcount = 1;
-  lcs->next = NULL;
-
-  if (position_list1 == NULL || position_list2 == NULL)
-    {
-      if (suffix_lines)
-        lcs = prepend_lcs(lcs, suffix_lines,
-                          lcs->position[0]->offset - suffix_lines,
-                          lcs->position[1]->offset - suffix_lines,
-                          pool);
-      if (prefix_lines)
-        lcs = prepend_lcs(lcs, prefix_lines, 1, 1, pool);
-
-      return lcs;
-    }
-
   unique_count[1] = unique_count[0] = 0;
   for (token_index = 0; token_index < num_tokens; token_index++)
     {
@@ -340,6 +335,14 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
   p = 0;
   do
     {
+      /* Each round takes one snake per diagonal between -p and d + p. */
+      snakes += 2 * p + (d < 0 ? -d : d) + 1;
+      if (max_snakes && snakes > max_snakes)
+        {
+          completed = FALSE;
+          break;
+        }
+
       /* For k < 0, insertions are free */
       for (k = (d < 0 ? d : 0) - p; k < 0; k++)
         {
@@ -355,19 +358,76 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
     }
   while (fp[0].position[1] != &sentinel_position[1]);
 
+  *matches = fp[0].lcs;
+
+  position_list1->next = sentinel_position[0].next;
+  position_list2->next = sentinel_position[1].next;
+
+  return completed;
+}
+
+
+svn_diff__lcs_t *
+svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
+              svn_diff__position_t *position_list2, /* pointer to tail (ring) */
+              svn_diff__token_index_t *token_counts_list1, /* array of counts */
+              svn_diff__token_index_t *token_counts_list2, /* array of counts */
+              svn_diff__token_index_t num_tokens,
+              apr_off_t prefix_lines,
+              apr_off_t suffix_lines,
+              svn_diff_algorithm_t algorithm,
+              apr_pool_t *pool)
+{
+  svn_diff__lcs_t *lcs;
+  svn_diff__lcs_t *matches;
+
+  /* Since EOF is always a sync point we tack on an EOF link
+   * with sentinel positions
+   */
+  lcs = apr_palloc(pool, sizeof(*lcs));
+  lcs->position[0] = apr_pcalloc(pool, sizeof(*lcs->position[0]));
+  lcs->position[0]->offset = position_list1
+                             ? position_list1->offset + suffix_lines + 1
+                             : prefix_lines + suffix_lines + 1;
+  lcs->position[1] = apr_pcalloc(pool, sizeof(*lcs->position[1]));
+  lcs->position[1]->offset = position_list2
+                             ? position_list2->offset + suffix_lines + 1
+                             : prefix_lines + suffix_lines + 1;
+  lcs->length = 0;
+  lcs->refcount = 1;
+  lcs->next = NULL;
+
+  if (position_list1 == NULL || position_list2 == NULL)
+    {
+      if (suffix_lines)
+        lcs = prepend_lcs(lcs, suffix_lines,
+                          lcs->position[0]->offset - suffix_lines,
+                          lcs->position[1]->offset - suffix_lines,
+                          pool);
+      if (prefix_lines)
+        lcs = prepend_lcs(lcs, prefix_lines, 1, 1, pool);
+
+      return lcs;
+    }
+
+  if (   algorithm == svn_diff_algorithm_histogram
+      || !lcs_onp(&matches, position_list1, position_list2,
+                  token_counts_list1, token_counts_list2, num_tokens,
+                  algorithm == svn_diff_algorithm_auto ? MAX_AUTO_SNAKES : 0,
+                  pool))
+    matches = svn_diff__lcs_histogram(position_list1, position_list2,
+                                      num_tokens, pool);
+
   if (suffix_lines)
-    lcs->next = prepend_lcs(fp[0].lcs, suffix_lines,
+    lcs->next = prepend_lcs(matches, suffix_lines,
                             lcs->position[0]->offset - suffix_lines,
                             lcs->position[1]->offset - suffix_lines,
                             pool);
   else
-    lcs->next = fp[0].lcs;
+    lcs->next = matches;
 
   lcs = svn_diff__lcs_reverse(lcs);
 
-  position_list1->next = sentinel_position[0].next;
-  position_list2->next = sentinel_position[1].next;
-
   if (prefix_lines)
     return prepend_lcs(lcs, prefix_lines, 1, 1, pool);
   else
@@ -39,10 +39,15 @@
 
 #include "private/svn_diff_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_string_private.h"
 #include "diff.h"
 
 #include "svn_private_config.h"
 
+#if SVN__SSE2_AVAILABLE
+#include <emmintrin.h>
+#endif
+
 
 svn_boolean_t
 svn_diff_contains_conflicts(svn_diff_t *diff)
@@ -143,6 +148,60 @@ svn_diff_output2(svn_diff_t *diff,
 }
 
 
+
+/* Return the number of bytes at the start of the LEN bytes at BUF that
+ * svn_diff__normalize_buffer() will simply include with OPTS, i.e. up to
+ * the first EOL character or, if whitespace gets ignored, whitespace. */
+static apr_size_t
+plain_length(const char *buf,
+             apr_size_t len,
+             const svn_diff_file_options_t *opts)
+{
+  svn_boolean_t check_space
+    = opts->ignore_space != svn_diff_file_ignore_space_none;
+  apr_size_t pos = 0;
+
+#if SVN__SSE2_AVAILABLE
+
+  /* Check 16 bytes at a time.  The first chunk containing a special
+   * character will be narrowed down by the loop below. */
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i ctrl_range = _mm_set1_epi8('\r' - '\t');
+
+  for (; len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(buf + pos));
+      __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                     _mm_cmpeq_epi8(chunk, lf));
+      if (check_space)
+        {
+          /* svn_ctype_isspace() is TRUE for ' ' and '\t' through '\r'. */
+          __m128i ctrl_offset = _mm_sub_epi8(chunk, tab);
+          __m128i is_ctrl_space
+            = _mm_cmpeq_epi8(_mm_subs_epu8(ctrl_offset, ctrl_range),
+                             _mm_setzero_si128());
+
+          special = _mm_or_si128(special, _mm_cmpeq_epi8(chunk, space));
+          special = _mm_or_si128(special, is_ctrl_space);
+        }
+
+      if (_mm_movemask_epi8(special))
+        break;
+    }
+
+#endif
+
+  for (; pos < len; ++pos)
+    if (   buf[pos] == '\r' || buf[pos] == '\n'
+        || (check_space && svn_ctype_isspace(buf[pos])))
+      break;
+
+  return pos;
+}
+
 void
 svn_diff__normalize_buffer(char **tgt,
                            apr_off_t *lengthp,
@@ -308,8 +367,14 @@ svn_diff__normalize_buffer(char **tgt,
           else
             {
               /* Non-whitespace character, or whitespace character in
-                 svn_diff_file_ignore_space_none mode. */
+                 svn_diff_file_ignore_space_none mode.  The same applies
+                 to the characters following it up to the next special
+                 one, so include them in one go. */
+              apr_size_t run = plain_length(curp + 1, endp - curp - 1, opts);
+
               INCLUDE;
+              include_len += run;
+              curp += run;
               state = svn_diff__normalize_state_normal;
             }
         }
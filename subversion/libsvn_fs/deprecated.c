@@ -123,6 +123,19 @@ svn_fs_open(svn_fs_t **fs_p,
   return svn_fs_open2(fs_p, path, fs_config, pool, pool);
 }
 
+svn_error_t *
+svn_fs_pack(const char *db_path,
+            svn_fs_pack_notify_t notify_func,
+            void *notify_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *pool)
+{
+  return svn_error_trace(svn_fs_pack2(db_path, NULL, notify_func,
+                                      notify_baton, cancel_func,
+                                      cancel_baton, pool));
+}
+
 svn_error_t *
 svn_fs_node_history(svn_fs_history_t **history_p, svn_fs_root_t *root,
                     const char *path, apr_pool_t *pool)
@@ -710,18 +710,19 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 }
 
 svn_error_t *
-svn_fs_pack(const char *path,
-            svn_fs_pack_notify_t notify_func,
-            void *notify_baton,
-            svn_cancel_func_t cancel_func,
-            void *cancel_baton,
-            apr_pool_t *pool)
+svn_fs_pack2(const char *path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
 {
   fs_library_vtable_t *vtable;
   svn_fs_t *fs;
 
   SVN_ERR(fs_library_vtable(&vtable, path, pool));
-  fs = fs_new(NULL, pool);
+  fs = fs_new(fs_config, pool);
 
   SVN_ERR(vtable->pack_fs(fs, path, notify_func, notify_baton,
                           cancel_func, cancel_baton, common_pool_lock,
@@ -38,6 +38,7 @@
 #include "index.h"
 #include "low_level.h"
 #include "pack.h"
+#include "readahead.h"
 #include "util.h"
 #include "temp_serializer.h"
 
@@ -193,21 +194,6 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
-static svn_error_t *
-aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
-             apr_off_t *buffer_start,
-             apr_off_t offset,
-             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
-}
-
 /* Open the revision file for revision REV in filesystem FS and store
    the newly opened file in FILE.  Seek to location OFFSET before
    returning.  Perform temporary allocations in POOL. */
@@ -227,7 +213,7 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
   *file = rev_file;
 
@@ -249,7 +235,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(*file, NULL, offset));
 
   return SVN_NO_ERROR;
 }
@@ -547,7 +533,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -630,9 +616,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -746,29 +731,25 @@ typedef struct rep_state_t
   int chunk_index;  /* number of the window to read */
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
                 rep_state_t *rs,
                 apr_pool_t *pool)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                    rs->sfile->rfile));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
                 apr_off_t offset,
                 apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
+                                                  buffer_start, offset));
 }
 
 /* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet. */
@@ -809,8 +790,7 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
     {
       char buf[4];
       SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf)));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -946,6 +926,16 @@ create_rep_state_body(rep_state_t **rep_state,
       /* populate the cache if appropriate */
       if (! svn_fs_fs__id_txn_used(&rep->txn_id))
         {
+          /* The current block is being read anyway.  Let the background
+           * threads fetch the remainder of the rep while we are busy
+           * following the delta chain. */
+          apr_off_t next_block = rs->start - (rs->start % ffd->block_size)
+                               + ffd->block_size;
+          if (next_block < rs->start + rep->size)
+            SVN_ERR(svn_fs_fs__readahead(fs, rs->sfile->rfile, next_block,
+                                         rs->start + rep->size - next_block,
+                                         scratch_pool));
+
           if (use_block_read(fs))
             SVN_ERR(block_read(NULL, fs, rep->revision, rep->item_index,
                                rs->sfile->rfile, result_pool, scratch_pool));
@@ -1165,6 +1155,29 @@ svn_fs_fs__rep_chain_length(int *chain_length,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rep_window_size(apr_size_t *window_size,
+                           representation_t *rep,
+                           svn_fs_t *fs,
+                           apr_pool_t *scratch_pool)
+{
+  rep_state_t *rep_state;
+  svn_fs_fs__rep_header_t *header;
+
+  SVN_ERR(create_rep_state(&rep_state, &header, NULL, rep, fs,
+                           scratch_pool, scratch_pool));
+  *window_size = header->window_size;
+
+  /* Don't keep file handles open for longer than necessary. */
+  if (rep_state->sfile->rfile)
+    {
+      SVN_ERR(svn_fs_fs__close_revision_file(rep_state->sfile->rfile));
+      rep_state->sfile->rfile = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 struct rep_read_baton
 {
   /* The FS from which we're reading. */
@@ -1268,8 +1281,8 @@ parse_raw_window(void **out,
   stream = svn_stream_from_string(&raw_window, result_pool);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, window->ver,
-                                          result_pool));
+  SVN_ERR(svn_txdelta__read_large_svndiff_window(&result->window, stream,
+                                                 window->ver, result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1601,11 +1614,15 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   iterpool = svn_pool_create(scratch_pool);
   while (rs->chunk_index < this_chunk)
     {
+      apr_size_t window_len;
+
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                               rs->sfile->rfile->stream,
+                                               iterpool));
+      start_offset += window_len;
+      SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
       rs->chunk_index++;
-      SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
       rs->current = start_offset - rs->start;
       if (rs->current >= rs->size)
         return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
@@ -1616,8 +1633,9 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   svn_pool_destroy(iterpool);
 
   /* Actually read the next window. */
-  SVN_ERR(svn_txdelta_read_svndiff_window(nwin, rs->sfile->rfile->stream,
-                                          rs->ver, result_pool));
+  SVN_ERR(svn_txdelta__read_large_svndiff_window(nwin,
+                                                 rs->sfile->rfile->stream,
+                                                 rs->ver, result_pool));
   SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
   rs->current = end_offset - rs->start;
   if (rs->current > rs->size)
@@ -1651,8 +1669,7 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1672,6 +1689,40 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Delta chains whose windows have no more than this many ops in total
+   get composed into a single window before expanding it.  Beyond that,
+   the composition tends to get more expensive than expanding every
+   window on its own. */
+#define MAX_COMPOSED_OPS 256
+
+/* Return TRUE if the delta WINDOWS read for RB's current chunk shall be
+   composed into a single window instead of being expanded one by one.
+   WINDOWS[I] belongs to the I-th rep state in RB->RS_LIST. */
+static svn_boolean_t
+compose_window_chain_p(struct rep_read_baton *rb,
+                       const apr_array_header_t *windows)
+{
+  int total_ops = 0;
+  int i;
+
+  for (i = 0; i < windows->nelts; ++i)
+    {
+      const svn_txdelta_window_t *window
+        = APR_ARRAY_IDX(windows, i, const svn_txdelta_window_t *);
+      rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+
+      /* Composition skips the intermediate fulltexts.  Don't do that if
+         get_combined_window() would put them into the cache. */
+      if (   i > 0 && rs->combined_cache && rb->chunk_index == 0
+          && rs->current == rs->size && SVN_IS_VALID_REVNUM(rs->revision))
+        return FALSE;
+
+      total_ops += window->num_ops;
+    }
+
+  return total_ops <= MAX_COMPOSED_OPS;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1687,7 +1738,7 @@ get_combined_window(svn_stringbuf_t **result,
   apr_pool_t *iterpool;
 
   /* Read all windows that we need to combine. This is fine because
-     the size of each window is relatively small (100kB) and skip-
+     the size of each window is relatively small (100kB to 1MB) and skip-
      delta limits the number of deltas in a chain to well under 100.
      Stop early if one of them does not depend on its predecessors. */
   window_pool = svn_pool_create(rb->pool);
@@ -1711,6 +1762,21 @@ get_combined_window(svn_stringbuf_t **result,
         }
     }
 
+  /* Replace the whole chain with a single window, if that is cheaper.
+     The loop below will then only expand that one. */
+  if (i > 1 && compose_window_chain_p(rb, windows))
+    {
+      svn_txdelta_window_t *composite
+        = svn_txdelta__compose_window_chain(windows, window_pool, iterpool);
+
+      /* The intermediate reps are done with the current chunk. */
+      for (--i; i > 0; --i)
+        APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *)->chunk_index++;
+
+      APR_ARRAY_IDX(windows, 0, svn_txdelta_window_t *) = composite;
+      i = 1;
+    }
+
   /* Combine in the windows from the other delta reps. */
   pool = svn_pool_create(rb->pool);
   for (--i; i >= 0; --i)
@@ -1840,8 +1906,7 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           offset = rs->start + rs->current;
           SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len));
         }
 
       rs->current += copy_len;
@@ -2296,7 +2361,7 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rs->sfile->rfile, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
@@ -2486,7 +2551,8 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
 
   /* Try a shortcut: if the target is stored as a delta against the source,
      then just use that delta.  However, prefer using the fulltext cache
-     whenever that is available. */
+     whenever that is available.  Deltas with non-standard window sizes
+     must not be passed on as older clients could not read them. */
   if (target->data_rep && (source || ! ffd->fulltext_cache))
     {
       /* Read target's base rep if any. */
@@ -2499,6 +2565,7 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
              Note that we want an actual delta here.  E.g. a self-delta would
              not be good enough. */
           if (rep_header->type == svn_fs_fs__rep_delta
+              && rep_header->window_size == 0
               && rep_header->base_revision == source->data_rep->revision
               && rep_header->base_item_index == source->data_rep->item_index)
             {
@@ -2511,7 +2578,8 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
           /* We want a self-delta. There is a fair chance that TARGET got
              added in this revision and is already stored in the requested
              format. */
-          if (rep_header->type == svn_fs_fs__rep_self_delta)
+          if (rep_header->type == svn_fs_fs__rep_self_delta
+              && rep_header->window_size == 0)
             {
               *stream_p = get_storaged_delta_stream(rep_state, target, pool);
               return SVN_NO_ERROR;
@@ -3142,9 +3210,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
-                               NULL, changes_offset + context->next_offset,
-                               scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(context->revision_file, NULL,
+                                           changes_offset
+                                             + context->next_offset));
 
           SVN_ERR(svn_fs_fs__read_changes(changes,
                                           context->revision_file->stream,
@@ -3153,9 +3221,8 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
@@ -3338,8 +3405,8 @@ cache_windows(svn_fs_t *fs,
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf,
+                                           window_len));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3415,12 +3482,12 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data,
+                                       (apr_size_t)rs.size));
+      plaintext->len = (apr_size_t)rs.size;
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3498,7 +3565,9 @@ block_read_contents(svn_fs_t *fs,
 
 /* For the given REV_FILE in FS, in *STREAM return a stream covering the
  * item specified by ENTRY.  Also, verify the item's content by low-level
- * checksum.  Allocate the result in POOL.
+ * checksum.  Allocate the result in POOL.  If REV_FILE is memory-mapped,
+ * the stream reads directly from the mapping and must not be used after
+ * REV_FILE got closed.
  */
 static svn_error_t *
 read_item(svn_stream_t **stream,
@@ -3510,17 +3579,31 @@ read_item(svn_stream_t **stream,
   apr_uint32_t digest;
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
+  const char *data;
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  /* Refer to the item in the memory-mapped file or read it into a string
+   * buffer. */
+  SVN_ERR(svn_fs_fs__rev_file_view(&data, rev_file, (apr_size_t)entry->size));
+  if (data)
+    {
+      svn_string_t *text = apr_palloc(pool, sizeof(*text));
+      text->data = data;
+      text->len = (apr_size_t)entry->size;
+      *stream = svn_stream_from_string(text, pool);
+    }
+  else
+    {
+      svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
+      text->len = entry->size;
+      text->data[text->len] = 0;
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, text->data, text->len));
 
-  /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
-  digest = svn__fnv1a_32x4(text->data, text->len);
+      *stream = svn_stream_from_stringbuf(text, pool);
+      data = text->data;
+    }
+
+  /* Calculate the checksum. */
+  digest = svn__fnv1a_32x4(data, (apr_size_t)entry->size);
 
   /* Checksums will match most of the time. */
   if (entry->fnv1_checksum == digest)
@@ -3610,16 +3693,18 @@ block_read_changes(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* If not already cached or if MUST_READ is set, read the node revision
- * addressed by ENTRY in FS and retúrn it in *NODEREV_P.  Cache the
- * result if caching is enabled.  Read the data from REV_FILE.  Allocate
- * *NODEREV_P in RESUSLT_POOL and allocate temporaries in SCRATCH_POOL.
+/* If not already cached, as indicated by IS_CACHED, or if MUST_READ is
+ * set, read the node revision addressed by ENTRY in FS and retúrn it in
+ * *NODEREV_P.  Cache the result if caching is enabled.  Read the data from
+ * REV_FILE.  Allocate *NODEREV_P in RESUSLT_POOL and allocate temporaries
+ * in SCRATCH_POOL.
  */
 static svn_error_t *
 block_read_noderev(node_revision_t **noderev_p,
                    svn_fs_t *fs,
                    svn_fs_fs__revision_file_t *rev_file,
                    svn_fs_fs__p2l_entry_t *entry,
+                   svn_boolean_t is_cached,
                    svn_boolean_t must_read,
                    apr_pool_t *result_pool,
                    apr_pool_t *scratch_pool)
@@ -3631,19 +3716,9 @@ block_read_noderev(node_revision_t **noderev_p,
   key.revision = entry->item.revision;
   key.second = entry->item.number;
 
-  if (!must_read && !ffd->node_revision_cache)
+  if (!must_read && (!ffd->node_revision_cache || is_cached))
     return SVN_NO_ERROR;
 
-  /* already in cache? */
-  if (!must_read && ffd->node_revision_cache)
-    {
-      svn_boolean_t is_cached;
-      SVN_ERR(svn_cache__has_key(&is_cached, ffd->node_revision_cache,
-                                 &key, scratch_pool));
-      if (is_cached)
-        return SVN_NO_ERROR;
-    }
-
   SVN_ERR(read_item(&stream, fs, rev_file, entry, scratch_pool));
 
   /* read node rev from revision file */
@@ -3658,6 +3733,115 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+/* For all node revisions listed in the block ENTRIES of FS, check whether
+ * they are already in the node revision cache.  Return the result in
+ * *CACHED, indexed like ENTRIES, allocated in RESULT_POOL.  Entries that
+ * are not node revisions will be reported as not cached.
+ *
+ * Checking all of them in a single call allows remote caches to pipeline
+ * the lookups instead of doing a round-trip per item.
+ */
+static svn_error_t *
+noderevs_cached(svn_boolean_t **cached,
+                svn_fs_t *fs,
+                apr_array_header_t *entries,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const void **keys = apr_pcalloc(scratch_pool,
+                                  entries->nelts * sizeof(*keys));
+  int i;
+
+  *cached = apr_pcalloc(result_pool, entries->nelts * sizeof(**cached));
+  if (!ffd->node_revision_cache)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+      if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
+        {
+          pair_cache_key_t *key = apr_pcalloc(scratch_pool, sizeof(*key));
+          key->revision = entry->item.revision;
+          key->second = entry->item.number;
+          keys[i] = key;
+        }
+    }
+
+  /* Lookups for NULL keys are no-ops. */
+  return svn_error_trace(svn_cache__get_multi(NULL, *cached,
+                                              ffd->node_revision_cache,
+                                              keys, entries->nelts,
+                                              scratch_pool));
+}
+
+/* If REP of FS is stored in the same rev / pack file as REVISION, which
+ * is open in REVISION_FILE, and does not overlap with the section from
+ * START to END that has already been read, request it to be read ahead.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+readahead_rep(svn_fs_t *fs,
+              representation_t *rep,
+              svn_revnum_t revision,
+              svn_fs_fs__revision_file_t *revision_file,
+              apr_off_t start,
+              apr_off_t end,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t offset;
+
+  if (   !rep
+      || svn_fs_fs__id_txn_used(&rep->txn_id)
+      || !SVN_IS_VALID_REVNUM(rep->revision))
+    return SVN_NO_ERROR;
+
+  /* Don't open other files just for the sake of a hint. */
+  if (rep->revision != revision)
+    {
+      if (   !revision_file->is_packed
+          || !svn_fs_fs__is_packed_rev(fs, rep->revision)
+          || (   rep->revision / ffd->max_files_per_dir
+              != revision / ffd->max_files_per_dir))
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_fs__item_offset(&offset, fs, revision_file, rep->revision,
+                                 NULL, rep->item_index, scratch_pool));
+  if (offset >= end || offset + (apr_off_t)rep->size <= start)
+    SVN_ERR(svn_fs_fs__readahead(fs, revision_file, offset, rep->size,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Request the data and property reps of NODEREV to be read ahead.  For
+ * the meaning of all other parameters, see readahead_rep.
+ */
+static svn_error_t *
+readahead_noderev_reps(svn_fs_t *fs,
+                       node_revision_t *noderev,
+                       svn_revnum_t revision,
+                       svn_fs_fs__revision_file_t *revision_file,
+                       apr_off_t start,
+                       apr_off_t end,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  if (!ffd->use_readahead)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(readahead_rep(fs, noderev->data_rep, revision, revision_file,
+                        start, end, scratch_pool));
+  SVN_ERR(readahead_rep(fs, noderev->prop_rep, revision, revision_file,
+                        start, end, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3678,11 +3862,14 @@ block_read(void **result,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_off_t offset, wanted_offset = 0;
-  apr_off_t block_start = 0;
+  apr_off_t block_start = 0, first_block_start;
   apr_array_header_t *entries;
+  svn_boolean_t *cached;
   int run_count = 0;
   int i;
   apr_pool_t *iterpool;
+  apr_time_t start_time;
+  svn_boolean_t is_noderev = FALSE;
 
   /* Block read is an optional feature. If the caller does not want anything
    * specific we may not have to read anything. */
@@ -3690,6 +3877,7 @@ block_read(void **result,
     return SVN_NO_ERROR;
 
   iterpool = svn_pool_create(scratch_pool);
+  start_time = apr_time_now();
 
   /* don't try this on transaction protorev files */
   SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(revision));
@@ -3700,6 +3888,7 @@ block_read(void **result,
                                  revision, NULL, item_index, iterpool));
 
   offset = wanted_offset;
+  first_block_start = offset - (offset % ffd->block_size);
 
   /* Heuristics:
    *
@@ -3718,8 +3907,11 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
-                           iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, &block_start, offset));
+
+      /* batch the cache lookups for the node revisions in this block */
+      SVN_ERR(noderevs_cached(&cached, fs, entries, scratch_pool,
+                              iterpool));
 
       /* read all items from the block */
       for (i = 0; i < entries->nelts; ++i)
@@ -3751,8 +3943,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
@@ -3770,8 +3962,8 @@ block_read(void **result,
                     if (ffd->node_revision_cache || is_result)
                       SVN_ERR(block_read_noderev((node_revision_t **)&item,
                                                  fs, revision_file,
-                                                 entry, is_result, pool,
-                                                 iterpool));
+                                                 entry, cached[i], is_result,
+                                                 pool, iterpool));
                     break;
 
                   case SVN_FS_FS__ITEM_TYPE_CHANGES:
@@ -3784,7 +3976,10 @@ block_read(void **result,
                 }
 
               if (is_result)
-                *result = item;
+                {
+                  *result = item;
+                  is_noderev = entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV;
+                }
 
               /* if we crossed a block boundary, read the remainder of
                * the last block as well */
@@ -3800,6 +3995,17 @@ block_read(void **result,
 
   /* if the caller requested a result, we must have provided one by now */
   assert(!result || *result);
+  svn_fs_fs__readahead_count_block_read(fs, apr_time_now() - start_time,
+                                        iterpool);
+
+  /* The reps of a node are likely to be read next.  If they live in the
+   * same rev / pack file, fetch them in the background. */
+  if (is_noderev)
+    SVN_ERR(readahead_noderev_reps(fs, *result, revision, revision_file,
+                                   first_block_start,
+                                   block_start + ffd->block_size,
+                                   iterpool));
+
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -81,6 +81,16 @@ svn_fs_fs__rep_chain_length(int *chain_length,
                             svn_fs_t *fs,
                             apr_pool_t *scratch_pool);
 
+/* Set *WINDOW_SIZE to the delta window size that REP in FS has been
+   written with, or to 0 if that is the standard SVN_DELTA_WINDOW_SIZE.
+   Deltas against REP must use the same window size.
+   Do any allocations in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__rep_window_size(apr_size_t *window_size,
+                           representation_t *rep,
+                           svn_fs_t *fs,
+                           apr_pool_t *scratch_pool);
+
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
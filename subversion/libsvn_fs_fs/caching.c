@@ -334,7 +334,7 @@ create_cache(svn_cache__t **cache_p,
     {
       SVN_ERR(svn_cache__create_inprocess(
                 cache_p, serializer, deserializer, klen, pages,
-                items_per_page, FALSE, prefix, result_pool));
+                items_per_page, 0, FALSE, prefix, result_pool));
     }
   else
     {
@@ -351,8 +351,15 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* Instance ID and format number make sure that cache contents restored
+   * from a snapshot (see svn_cache__membuffer_load) will not be used for
+   * a repository that has been replaced by a hotcopy, a dump / load cycle
+   * or an upgraded version of itself. */
   const char *prefix = apr_pstrcat(pool,
                                    "fsfs:", fs->uuid,
+                                   "--", ffd->instance_id,
+                                   ":", apr_itoa(pool, ffd->format),
                                    "/", normalize_key_part(fs->path, pool),
                                    ":",
                                    SVN_VA_NULL);
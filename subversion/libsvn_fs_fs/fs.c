@@ -29,6 +29,7 @@
 #include <apr_file_io.h>
 
 #include "svn_fs.h"
+#include "svn_hash.h"
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
@@ -39,6 +40,7 @@
 #include "hotcopy.h"
 #include "id.h"
 #include "pack.h"
+#include "readahead.h"
 #include "recovery.h"
 #include "rep-cache.h"
 #include "revprops.h"
@@ -124,6 +126,10 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* The rep-cache filter is shared by all svn_fs_t instances, too. */
+      SVN_ERR(svn_fs_fs__create_rep_cache_filter(&ffsd->rep_cache_filter,
+                                                 common_pool));
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
@@ -312,6 +318,30 @@ fs_ioctl(svn_fs_t *fs, svn_fs_ioctl_code_t ctlcode,
           *output_p = output;
           return SVN_NO_ERROR;
         }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_RECOMPRESS.code)
+        {
+          svn_fs_fs__ioctl_recompress_input_t *input = input_void;
+          svn_fs_fs__ioctl_recompress_output_t *output
+            = apr_pcalloc(result_pool, sizeof(*output));
+
+          SVN_ERR(svn_fs_fs__recompress(&output->stats, fs,
+                                        input->progress_func,
+                                        input->progress_baton,
+                                        cancel_func, cancel_baton,
+                                        result_pool, scratch_pool));
+          *output_p = output;
+          return SVN_NO_ERROR;
+        }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_GET_READAHEAD_STATS.code)
+        {
+          svn_fs_fs__ioctl_get_readahead_stats_output_t *output
+            = apr_pcalloc(result_pool, sizeof(*output));
+
+          SVN_ERR(svn_fs_fs__get_readahead_stats(&output->stats,
+                                                 result_pool, scratch_pool));
+          *output_p = output;
+          return SVN_NO_ERROR;
+        }
     }
 
   return svn_error_create(SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE, NULL, NULL);
@@ -428,6 +458,31 @@ fs_open(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_clone(svn_fs_t **clone,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_t *new_fs = apr_pcalloc(result_pool, sizeof(*new_fs));
+
+  new_fs->pool = result_pool;
+  new_fs->warning = fs->warning;
+  new_fs->warning_baton = fs->warning_baton;
+  new_fs->config = fs->config;
+
+  SVN_ERR(initialize_fs_struct(new_fs));
+  SVN_ERR(svn_fs_fs__open(new_fs, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(new_fs, scratch_pool));
+
+  /* The shared data has been initialized for FS already. */
+  ((fs_fs_data_t *)new_fs->fsap_data)->shared = ffd->shared;
+
+  *clone = new_fs;
+  return SVN_NO_ERROR;
+}
+
 
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
@@ -509,6 +564,22 @@ fs_upgrade(svn_fs_t *fs,
                             cancel_func, cancel_baton, pool);
 }
 
+/* Set *JOBS to the number of threads given by the config OPTION of FS.
+ * Default to 1. */
+static svn_error_t *
+get_jobs_config(int *jobs,
+                svn_fs_t *fs,
+                const char *option)
+{
+  const char *value = fs->config ? svn_hash_gets(fs->config, option) : NULL;
+
+  *jobs = 1;
+  if (value)
+    SVN_ERR(svn_cstring_atoi(jobs, value));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 fs_verify(svn_fs_t *fs, const char *path,
           svn_revnum_t start,
@@ -521,8 +592,12 @@ fs_verify(svn_fs_t *fs, const char *path,
           apr_pool_t *pool,
           apr_pool_t *common_pool)
 {
+  int max_threads;
+
+  SVN_ERR(get_jobs_config(&max_threads, fs, SVN_FS_CONFIG_VERIFY_JOBS));
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__verify(fs, start, end, notify_func, notify_baton,
+  return svn_fs_fs__verify(fs, start, end, max_threads,
+                           notify_func, notify_baton,
                            cancel_func, cancel_baton, pool);
 }
 
@@ -537,8 +612,11 @@ fs_pack(svn_fs_t *fs,
         apr_pool_t *pool,
         apr_pool_t *common_pool)
 {
+  int max_threads;
+
+  SVN_ERR(get_jobs_config(&max_threads, fs, SVN_FS_CONFIG_PACK_JOBS));
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__pack(fs, 0, notify_func, notify_baton,
+  return svn_fs_fs__pack(fs, 0, max_threads, notify_func, notify_baton,
                          cancel_func, cancel_baton, pool);
 }
 
@@ -102,6 +102,7 @@ extern "C" {
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_ENABLE_REP_CACHE_FILTER "enable-rep-cache-filter"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
@@ -119,6 +120,7 @@ extern "C" {
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_COMPRESSION_THREADS "compression-threads"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -127,7 +129,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -188,6 +190,13 @@ extern "C" {
 /* The minimum format number that supports svndiff version 2. */
 #define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The minimum format number that supports non-standard delta window sizes
+   in representation headers. */
+#define SVN_FS_FS__MIN_DELTA_WINDOW_SIZE_FORMAT 9
+
 /* The minimum format number that supports the special notation ("-")
    for optional values that are not present in the representation strings,
    such as SHA1 or the uniquifier.  For example:
@@ -239,6 +248,9 @@ typedef struct fs_fs_shared_txn_data_t
   apr_pool_t *pool;
 } fs_fs_shared_txn_data_t;
 
+/* Bloom filter in front of the rep-cache database.  See rep-cache.c. */
+typedef struct rep_cache_filter_t rep_cache_filter_t;
+
 /* Private FSFS-specific data shared between all svn_fs_t objects that
    relate to a particular filesystem, as identified by filesystem UUID.
    Objects of this type are allocated in the common pool. */
@@ -275,6 +287,10 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Bloom filter in front of the rep-cache database.  It comes with its
+     own lock, which must always be taken after any of the above. */
+  rep_cache_filter_t *rep_cache_filter;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -315,7 +331,8 @@ typedef enum compression_type_t
 {
   compression_type_none,
   compression_type_zlib,
-  compression_type_lz4
+  compression_type_lz4,
+  compression_type_zstd
 } compression_type_t;
 
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
@@ -347,6 +364,18 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* If set, let background threads prefetch the blocks that we are likely
+   * to read next.  Requires USE_BLOCK_READ. */
+  svn_boolean_t use_readahead;
+
+  /* Maximum number of bytes of pack file data mapped into memory by this
+   * process.  0 disables memory mapping. */
+  apr_int64_t mmap_budget;
+
+  /* If set, consult an in-memory Bloom filter before querying the
+   * rep-cache database for representations. */
+  svn_boolean_t use_rep_cache_filter;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -496,9 +525,14 @@ typedef struct fs_fs_data_t
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
-  /* Compression level (currently, only used with compression_type_zlib). */
+  /* Compression level (used with compression_type_zlib and
+     compression_type_zstd). */
   int delta_compression_level;
 
+  /* Maximum number of threads compressing the svndiff windows of a single
+   * file representation concurrently.  1 disables that. */
+  int delta_compression_threads;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -692,7 +692,8 @@ parse_compression_option(compression_type_t *compression_type_p,
   int level;
   svn_boolean_t is_valid = TRUE;
 
-  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 */
+  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9
+                   | zstd | zstd-1 ... zstd-19 */
   if (strcmp(value, "none") == 0)
     {
       type = compression_type_none;
@@ -722,6 +723,25 @@ parse_compression_option(compression_type_t *compression_type_p,
       else
         is_valid = FALSE;
     }
+  else if (strncmp(value, "zstd", 4) == 0)
+    {
+      const char *p = value + 4;
+
+      type = compression_type_zstd;
+      if (*p == 0)
+        {
+          level = SVN__ZSTD_DEFAULT_LEVEL;
+        }
+      else if (*p == '-')
+        {
+          p++;
+          SVN_ERR(svn_cstring_atoi(&level, p));
+          if (level < 1 || level > SVN__ZSTD_MAX_LEVEL)
+            is_valid = FALSE;
+        }
+      else
+        is_valid = FALSE;
+    }
   else
     {
       is_valid = FALSE;
@@ -760,6 +780,15 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  /* Initialize ffd->use_rep_cache_filter.  The FS config may override it. */
+  if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    SVN_ERR(svn_config_get_bool(config, &ffd->use_rep_cache_filter,
+                                CONFIG_SECTION_REP_SHARING,
+                                CONFIG_OPTION_ENABLE_REP_CACHE_FILTER,
+                                FALSE));
+  else
+    ffd->use_rep_cache_filter = FALSE;
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
@@ -890,6 +919,17 @@ read_config(fs_fs_data_t *ffd,
                                       _("Compression type 'lz4' requires "
                                         "filesystem format 8 or higher"));
             }
+          if (ffd->delta_compression_type == compression_type_zstd)
+            {
+              if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' requires "
+                                          "filesystem format 9 or higher"));
+              if (!svn__zstd_available())
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' is not "
+                                          "supported by this build"));
+            }
         }
       else if (compression_level_val)
         {
@@ -925,6 +965,15 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  {
+    apr_int64_t compression_threads;
+    SVN_ERR(svn_config_get_int64(config, &compression_threads,
+                                 CONFIG_SECTION_DELTIFICATION,
+                                 CONFIG_OPTION_COMPRESSION_THREADS, 1));
+    ffd->delta_compression_threads = (int)MIN(MAX(1, compression_threads),
+                                              64);
+  }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -993,6 +1042,16 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### The following parameter enables a filter in front of the rep-sharing"   NL
+"### database that lets commits skip most database lookups for new"          NL
+"### contents.  The filter is kept in memory and in the 'rep-cache.filter'"  NL
+"### file.  Building it for the first time requires reading the whole"       NL
+"### database, which may take a while for large repositories.  Servers"      NL
+"### should enable it only if commits are slowed down by the database."      NL
+"### The filter is disabled by default.  Versions prior to 1.14 will"        NL
+"### ignore this option."                                                    NL
+"# " CONFIG_OPTION_ENABLE_REP_CACHE_FILTER " = false"                        NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -1066,11 +1125,17 @@ write_config(svn_fs_t *fs,
 "### significantly speed up commits as well as reading the data."            NL
 "### lz4 compression algorithm is supported, starting from format 8"         NL
 "### repositories, available in Subversion 1.10 and higher."                 NL
+"### zstd (Zstandard) compresses about as well as zlib or better while"      NL
+"### being considerably faster, in particular when reading.  It requires"    NL
+"### format 9 repositories, available in Subversion 1.14 and higher, and a"  NL
+"### Subversion build with Zstandard support."                                NL
 "### The syntax of this option is:"                                          NL
 "###   " CONFIG_OPTION_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"###                 | zstd | zstd-1 ... zstd-19"                            NL
 "### Versions prior to Subversion 1.10 will ignore this option."             NL
 "### The default value is 'lz4' if supported by the repository format and"   NL
-"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
+"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5' and"      NL
+"### 'zstd' to 'zstd-3'."                                                    NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
@@ -1079,6 +1144,15 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### Compressing large files can be CPU bound.  This setting allows up to"   NL
+"### that many threads to compress consecutive parts of a file at the same"  NL
+"### time.  The result is identical to single-threaded compression.  Values" NL
+"### greater than 1 are only useful for repositories that receive large"     NL
+"### files and on servers with idle CPU cores.  Platforms without thread"    NL
+"### support and versions prior to Subversion 1.14 will ignore this option." NL
+"### The default is 1."                                                      NL
+"# " CONFIG_OPTION_COMPRESSION_THREADS " = 1"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1170,9 +1244,25 @@ read_global_config(svn_fs_t *fs)
   ffd->use_block_read = svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_FSFS_BLOCK_READ,
                                            FALSE);
+  ffd->use_readahead = ffd->use_block_read
+                    && svn_hash__get_bool(fs->config,
+                                          SVN_FS_CONFIG_FSFS_READAHEAD,
+                                          TRUE);
   ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
+  ffd->use_rep_cache_filter
+    = svn_hash__get_bool(fs->config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER,
+                         ffd->use_rep_cache_filter);
+
+  ffd->mmap_budget = 0;
+  if (fs->config)
+    {
+      const char *budget = svn_hash_gets(fs->config,
+                                         SVN_FS_CONFIG_FSFS_MMAP_BUDGET);
+      if (budget)
+        SVN_ERR(svn_cstring_atoi64(&ffd->mmap_budget, budget));
+    }
 
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
@@ -1951,6 +2041,12 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12:
+          case 13: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2322,8 +2418,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 14;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -24,6 +24,7 @@
 #define SVN_LIBSVN_FS__FS_FS_H
 
 #include "fs.h"
+#include "rev_file.h"
 
 /* Read the 'format' file of fsfs filesystem FS and store its info in FS.
  * Use SCRATCH_POOL for temporary allocations. */
@@ -39,6 +40,16 @@ svn_error_t *svn_fs_fs__open(svn_fs_t *fs,
                              const char *path,
                              apr_pool_t *pool);
 
+/* Open another filesystem object for the already opened FSFS filesystem
+   FS and return it in *CLONE.  The new object will share FS's config and
+   caches but may be used concurrently with FS from a different thread.
+   Allocate *CLONE in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__open_clone(svn_fs_t **clone,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool);
+
 /* Initialize parts of the FS data that are being shared across multiple
    filesystem objects.  Use COMMON_POOL for process-wide and POOL for
    temporary allocations.  Use COMMON_POOL_LOCK to ensure that the
@@ -338,6 +349,10 @@ svn_fs_fs__dump_index(svn_fs_t *fs,
  * containing REVISION and use the svn_fs_fs__p2l_entry_t * array ENTRIES
  * as the new index contents.  Allocate temporaries from SCRATCH_POOL.
  *
+ * The file is not modified in place but replaced by an updated copy.
+ * Readers that still have the old file open continue to see the old
+ * contents.
+ *
  * Note that this becomes a no-op if ENTRIES is empty.  You may use a zero-
  * sized empty entry instead.
  */
@@ -347,6 +362,49 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool);
 
+/* Append index data for the svn_fs_fs__p2l_entry_t * array ENTRIES to
+ * COPY, created by svn_fs_fs__rev_file_copy() at COPY_PATH, close it and
+ * atomically replace the rev / pack file in FS that it was copied from.
+ * ENTRIES must be sorted by offset and cover all of COPY's contents.  The
+ * FNV-1 checksums are calculated from COPY's contents, not taken from
+ * ENTRIES.  Allocate temporaries from SCRATCH_POOL.
+ */
+svn_error_t *
+svn_fs_fs__replace_rev_file(svn_fs_t *fs,
+                            svn_fs_fs__revision_file_t *copy,
+                            const char *copy_path,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool);
+
+/* Re-encode all delta representations in FS that use an svndiff version
+ * older than 3 as svndiff version 3, i.e. with Zstandard compression.
+ * This only changes the compression of the instructions and new data
+ * within each delta window; no fulltext gets reconstructed.
+ *
+ * Reps keep their exact offsets and lengths, so all references to them
+ * stay valid.  Reps that would not fit are left as they are.  Modified
+ * rev / pack files are written to a copy with a new index, which then
+ * atomically replaces the original.  Return the number of reps processed
+ * in *STATS, allocated in RESULT_POOL.
+ *
+ * FS must be a format 9 repository with logical addressing.  This takes
+ * the write lock as well as the pack and txn-current locks, so commits
+ * and packing will wait for it to finish.  Readers are not blocked; they
+ * see either the old or the new version of each file.  Report progress
+ * per rev / pack file through PROGRESS_FUNC with PROGRESS_BATON, if
+ * PROGRESS_FUNC is not NULL.  If not NULL, call CANCEL_FUNC with
+ * CANCEL_BATON from time to time.  Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__recompress(svn_fs_fs__recompress_stats_t **stats,
+                      svn_fs_t *fs,
+                      svn_fs_progress_notify_func_t progress_func,
+                      void *progress_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool);
+
 /* Set *REV_SIZE to the total size of objects belonging to revision REVISION
  * in FS. The size includes revision properties and excludes indexes.
  */
@@ -26,9 +26,12 @@
 
 #include "fs_fs.h"
 #include "index.h"
+#include "rev_file.h"
 #include "util.h"
 #include "transaction.h"
 
+#include "../libsvn_fs/fs-loader.h"
+
 /* From the ENTRIES array of svn_fs_fs__p2l_entry_t*, sorted by offset,
  * return the first offset behind the last item. */
 static apr_off_t
@@ -93,6 +96,44 @@ compare_p2l_entry_revision(const void *lhs,
   return lhs_entry->offset == rhs_entry->offset ? 0 : 1;
 }
 
+svn_error_t *
+svn_fs_fs__replace_rev_file(svn_fs_t *fs,
+                            svn_fs_fs__revision_file_t *copy,
+                            const char *copy_path,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *l2p_proto_index;
+  const char *p2l_proto_index;
+  const char *final_path;
+
+  /* Create proto index files for the new index data
+   * (will be cleaned up automatically with SCRATCH_POOL). */
+  SVN_ERR(svn_fs_fs__p2l_index_from_p2l_entries(&p2l_proto_index, fs,
+                                                copy, entries,
+                                                scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&l2p_proto_index, fs,
+                                                entries, scratch_pool,
+                                                scratch_pool));
+
+  /* Combine rev data with new index data. */
+  SVN_ERR(svn_fs_fs__add_index_data(fs, copy->file, l2p_proto_index,
+                                    p2l_proto_index, copy->start_revision,
+                                    scratch_pool));
+  SVN_ERR(svn_fs_fs__close_revision_file(copy));
+
+  /* Readers that still have the old file open keep reading the old
+   * contents.  Everybody else sees the new file. */
+  final_path = svn_fs_fs__path_rev_absolute(fs, copy->start_revision,
+                                            scratch_pool);
+  SVN_ERR(svn_fs_fs__move_into_place(copy_path, final_path, final_path,
+                                     ffd->flush_to_disk, scratch_pool));
+  SVN_ERR(svn_io_set_file_read_only(final_path, FALSE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__load_index(svn_fs_t *fs,
                       svn_revnum_t revision,
@@ -112,29 +153,29 @@ svn_fs_fs__load_index(svn_fs_t *fs,
   /* Treat an empty array as a no-op instead error. */
   if (entries->nelts != 0)
     {
-      const char *l2p_proto_index;
-      const char *p2l_proto_index;
       svn_fs_fs__revision_file_t *rev_file;
+      svn_fs_fs__revision_file_t *copy;
+      const char *copy_path;
       svn_error_t *err;
       apr_off_t max_covered = get_max_covered(entries);
+      apr_off_t data_end;
 
       /* Ensure that the index data is complete. */
       SVN_ERR(check_all_covered(entries, scratch_pool));
 
-      /* Open rev / pack file & trim indexes + footer off it. */
-      SVN_ERR(svn_fs_fs__open_pack_or_rev_file_writable(&rev_file, fs,
-                                                        revision, subpool,
-                                                        subpool));
+      /* Open rev / pack file to copy its contents without the indexes
+       * and footer. */
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                               subpool, subpool));
 
-      /* Remove the existing index info. */
+      /* Determine the end of the existing rev data. */
       err = svn_fs_fs__auto_read_footer(rev_file);
       if (err)
         {
           /* Even the index footer cannot be read, even less be trusted.
            * Take the range of valid data from the new index data. */
           svn_error_clear(err);
-          SVN_ERR(svn_io_file_trunc(rev_file->file, max_covered,
-                                    subpool));
+          data_end = max_covered;
         }
       else
         {
@@ -149,23 +190,16 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                        apr_psprintf(scratch_pool, "%" APR_UINT64_T_HEX_FMT,
                                     (apr_uint64_t) rev_file->l2p_offset));
 
-          SVN_ERR(svn_io_file_trunc(rev_file->file, rev_file->l2p_offset,
-                                    subpool));
+          data_end = rev_file->l2p_offset;
         }
 
-      /* Create proto index files for the new index data
-       * (will be cleaned up automatically with iterpool). */
-      SVN_ERR(svn_fs_fs__p2l_index_from_p2l_entries(&p2l_proto_index, fs,
-                                                    rev_file, entries,
-                                                    subpool, subpool));
-      SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&l2p_proto_index, fs,
-                                                    entries, subpool,
-                                                    subpool));
-
-      /* Combine rev data with new index data. */
-      SVN_ERR(svn_fs_fs__add_index_data(fs, rev_file->file, l2p_proto_index,
-                                        p2l_proto_index,
-                                        rev_file->start_revision, subpool));
+      /* Never modify the file in place.  Concurrent readers may have it
+       * open or mapped. */
+      SVN_ERR(svn_fs_fs__rev_file_copy(&copy, &copy_path, fs, rev_file,
+                                       data_end, subpool, subpool));
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+      SVN_ERR(svn_fs_fs__replace_rev_file(fs, copy, copy_path, entries,
+                                          subpool));
     }
 
   svn_pool_destroy(subpool);
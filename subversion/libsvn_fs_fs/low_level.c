@@ -24,6 +24,7 @@
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
@@ -62,6 +63,9 @@
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
 
+/* Prefix of the optional window size token in DELTA rep headers. */
+#define REP_WINDOW_SIZE    'W'
+
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
 #define FSFS_MAX_PATH_LEN 4096
@@ -1273,14 +1277,35 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
-  (*header)->type = svn_fs_fs__rep_delta;
-
-  /* We have hopefully a DELTA vs. a non-empty base revision. */
   last_str = buffer->data;
   str = svn_cstring_tokenize(" ", &last_str);
   if (! str || (strcmp(str, REP_DELTA) != 0))
     goto error;
 
+  /* Format 9+ may give a non-standard window size as the last token. */
+  str = strrchr(last_str, ' ');
+  str = str ? str + 1 : last_str;
+  if (*str == REP_WINDOW_SIZE)
+    {
+      SVN_ERR(svn_cstring_atoi64(&val, str + 1));
+      if (val <= 0 || val > SVN_DELTA__MAX_WINDOW_SIZE)
+        goto error;
+
+      (*header)->window_size = (apr_size_t)val;
+      *str = '\0';
+      if (str > last_str)
+        str[-1] = '\0';
+    }
+
+  if (*last_str == '\0')
+    {
+      /* This is a delta against the empty stream. */
+      (*header)->type = svn_fs_fs__rep_self_delta;
+      return SVN_NO_ERROR;
+    }
+
+  /* We have hopefully a DELTA vs. a non-empty base revision. */
+  (*header)->type = svn_fs_fs__rep_delta;
   SVN_ERR(parse_revnum(&(*header)->base_revision, (const char **)&last_str));
 
   str = svn_cstring_tokenize(" ", &last_str);
@@ -1316,14 +1341,24 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
         break;
 
       case svn_fs_fs__rep_self_delta:
-        text = REP_DELTA "\n";
+        if (header->window_size)
+          text = apr_psprintf(scratch_pool, REP_DELTA " %c%" APR_SIZE_T_FMT
+                                            "\n",
+                              REP_WINDOW_SIZE, header->window_size);
+        else
+          text = REP_DELTA "\n";
         break;
 
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
-                                          " %" SVN_FILESIZE_T_FMT "\n",
+                                          " %" SVN_FILESIZE_T_FMT,
                             header->base_revision, header->base_item_index,
                             header->base_length);
+        if (header->window_size)
+          text = apr_psprintf(scratch_pool, "%s %c%" APR_SIZE_T_FMT "\n",
+                              text, REP_WINDOW_SIZE, header->window_size);
+        else
+          text = apr_pstrcat(scratch_pool, text, "\n", SVN_VA_NULL);
     }
 
   return svn_error_trace(svn_stream_puts(stream, text));
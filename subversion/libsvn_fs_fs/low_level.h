@@ -212,6 +212,12 @@ typedef struct svn_fs_fs__rep_header_t
    * size of that base rep.  Should be 0 if there is no base rep. */
   svn_filesize_t base_length;
 
+  /* for DELTA representations, the maximum amount of source and target data
+   * per delta window.  0 for the standard SVN_DELTA_WINDOW_SIZE, which is
+   * the only size supported before format 9.  All reps along a delta chain
+   * share the same window size. */
+  apr_size_t window_size;
+
   /* length of the textual representation of the header in the rep or pack
    * file, including EOL.  Only valid after reading it from disk.
    * Should be 0 otherwise. */
@@ -30,6 +30,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_parallel.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -1865,6 +1866,7 @@ struct pack_baton
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
   size_t max_mem;
+  int max_threads;
 
   /* Additional entries valid when entering pack_shard(). */
   const char *revs_dir;
@@ -1957,6 +1959,49 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Set *REV_PACK_FILE_DIR and *REV_SHARD_PATH to the directories of the
+ * packed and the non-packed revision SHARD, respectively, within REVS_DIR.
+ * Allocate the results in POOL.
+ */
+static void
+get_rev_shard_paths(const char **rev_pack_file_dir,
+                    const char **rev_shard_path,
+                    const char *revs_dir,
+                    apr_int64_t shard,
+                    apr_pool_t *pool)
+{
+  *rev_pack_file_dir = svn_dirent_join(revs_dir,
+                  apr_psprintf(pool,
+                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                               shard),
+                  pool);
+  *rev_shard_path = svn_dirent_join(revs_dir,
+                                    apr_psprintf(pool, "%" APR_INT64_T_FMT,
+                                                 shard),
+                                    pool);
+}
+
+/* Switch the shard described by BATON over to its packed revision data,
+ * which has already been written, and pack its revprops.
+ */
+static svn_error_t *
+publish_shard(struct pack_baton *baton,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +2020,8 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  get_rev_shard_paths(&rev_pack_file_dir, &baton->rev_shard_path,
+                      baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,14 +2029,7 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  SVN_ERR(publish_shard(baton, pool));
 
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
@@ -2009,6 +2039,86 @@ pack_shard(struct pack_baton *baton,
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by pack_shard_job() and pack_shard_done().  Job number
+ * I packs shard FIRST_SHARD + I.
+ */
+typedef struct pack_jobs_baton_t
+{
+  /* Valid as for pack_shard() except for SHARD and REV_SHARD_PATH, which
+     are only being set by pack_shard_done(). */
+  struct pack_baton *pb;
+
+  /* The first shard to pack. */
+  apr_int64_t first_shard;
+} pack_jobs_baton_t;
+
+/* Implements svn_parallel__job_func_t.
+ * Write the revision pack file for job number INDEX in BATON, using a
+ * separate svn_fs_t instance.  This does not touch the repository state
+ * as seen by readers. */
+static svn_error_t *
+pack_shard_job(void *baton,
+               int index,
+               apr_pool_t *pool)
+{
+  pack_jobs_baton_t *jobs_baton = baton;
+  struct pack_baton *pb = jobs_baton->pb;
+  apr_int64_t shard = jobs_baton->first_shard + index;
+  const char *rev_pack_file_dir, *rev_shard_path;
+  fs_fs_data_t *ffd;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_fs__open_clone(&fs, pb->fs, pool, pool));
+  ffd = fs->fsap_data;
+
+  get_rev_shard_paths(&rev_pack_file_dir, &rev_shard_path, pb->revs_dir,
+                      shard, pool);
+
+  return svn_error_trace(pack_rev_shard(fs, rev_pack_file_dir,
+                                        rev_shard_path, shard,
+                                        ffd->max_files_per_dir,
+                                        pb->max_mem, ffd->flush_to_disk,
+                                        pb->cancel_func, pb->cancel_baton,
+                                        pool));
+}
+
+/* Implements svn_parallel__job_done_t.
+ * Unless JOB_ERR is set, switch the shard of job number INDEX in BATON
+ * over to the packed data and send the notifications for it. */
+static svn_error_t *
+pack_shard_done(void *baton,
+                int index,
+                svn_error_t *job_err,
+                apr_pool_t *pool)
+{
+  pack_jobs_baton_t *jobs_baton = baton;
+  struct pack_baton *pb = jobs_baton->pb;
+  const char *rev_pack_file_dir;
+
+  SVN_ERR(job_err);
+
+  pb->shard = jobs_baton->first_shard + index;
+  get_rev_shard_paths(&rev_pack_file_dir, &pb->rev_shard_path,
+                      pb->revs_dir, pb->shard, pool);
+
+  /* The pack file has been written already.  Still, report the usual
+     sequence of events. */
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_start, pool));
+
+  SVN_ERR(publish_shard(pb, pool));
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_end, pool));
+
+  if (pb->cancel_func)
+    SVN_ERR(pb->cancel_func(pb->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2057,7 +2167,7 @@ pack_body(void *baton,
 {
   struct pack_baton *pb = baton;
   fs_fs_data_t *ffd = pb->fs->fsap_data;
-  apr_int64_t completed_shards;
+  apr_int64_t completed_shards, first_shard;
   apr_pool_t *iterpool;
   svn_boolean_t fully_packed;
 
@@ -2080,8 +2190,26 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  /* Write several pack files at once but switch over to them in order. */
+  first_shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+  if (pb->max_threads > 1 && completed_shards - first_shard > 1)
+    {
+      pack_jobs_baton_t jobs_baton;
+      jobs_baton.pb = pb;
+      jobs_baton.first_shard = first_shard;
+
+      if (pb->cancel_func)
+        SVN_ERR(pb->cancel_func(pb->cancel_baton));
+
+      return svn_error_trace(svn_parallel__run_jobs(
+                               (int)(completed_shards - first_shard),
+                               pb->max_threads,
+                               pack_shard_job, pack_shard_done,
+                               &jobs_baton, pool));
+    }
+
   iterpool = svn_pool_create(pool);
-  for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+  for (pb->shard = first_shard;
        pb->shard < completed_shards;
        pb->shard++)
     {
@@ -2100,6 +2228,7 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int max_threads,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -2146,6 +2275,7 @@ svn_fs_fs__pack(svn_fs_t *fs,
   pb.cancel_func = cancel_func;
   pb.cancel_baton = cancel_baton;
   pb.max_mem = max_mem ? max_mem : DEFAULT_MAX_MEM;
+  pb.max_threads = max_threads;
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     {
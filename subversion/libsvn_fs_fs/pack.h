@@ -32,13 +32,20 @@
    MAX_MEM limits the size of in-memory data structures needed for reordering
    items in format 7 repositories.  0 means use the built-in default.
 
-   If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
-   Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
+   Up to MAX_THREADS shards will be packed concurrently, each of them using
+   up to MAX_MEM.  The packed shards will be switched over to strictly in
+   order, though, such that the min-unpacked-rev never skips a shard.
+
+   If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress;
+   this happens from the current thread only.  Use optional CANCEL_FUNC /
+   CANCEL_BATON for cancellation support; CANCEL_FUNC may be called from
+   any of the worker threads.
 
    Existing filesystem references need not change.  */
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int max_threads,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
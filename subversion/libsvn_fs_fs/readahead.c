@@ -0,0 +1,428 @@
+/* readahead.c --- asynchronous prefetching of rev / pack file data
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_file_io.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_parallel.h"
+
+#include "readahead.h"
+#include "util.h"
+
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Maximum number of tasks that we keep in the shared thread pool. */
+#define MAX_READAHEAD_THREADS 4
+
+/* Maximum number of requests that may be pending at any time.  Further
+ * requests will be dropped. */
+#define MAX_PENDING_REQUESTS 64
+
+/* Upper limit to the size of a single request.  Larger ones will be
+ * truncated; the reader will catch up with them eventually. */
+#define MAX_REQUEST_SIZE (4 * 1024 * 1024)
+
+/* Number of bytes to read at once when processing a request. */
+#define READ_CHUNK_SIZE 0x10000
+
+/* A prefetch request slot. */
+typedef struct request_t
+{
+  /* Private root pool, cleared whenever the slot gets reused. */
+  apr_pool_t *pool;
+
+  /* Set while a request is pending for this slot.  Protected by
+   * READAHEAD_MUTEX. */
+  svn_boolean_t in_use;
+
+  /* Set once a task picked up the request.  Protected by
+   * READAHEAD_MUTEX. */
+  svn_boolean_t started;
+
+  /* File to read from and the section to read. */
+  const char *path;
+  apr_off_t offset;
+  apr_off_t size;
+} request_t;
+
+/* Serializes access to the request slots and the statistics. */
+static svn_mutex__t *readahead_mutex = NULL;
+
+/* Fixed set of request slots. */
+static request_t readahead_requests[MAX_PENDING_REQUESTS];
+
+/* Accumulated statistics. */
+static svn_fs_fs__readahead_stats_t readahead_stats = { 0 };
+
+/* Number of readahead_task() instances pushed to the shared thread pool
+   that have not finished, yet.  Protected by READAHEAD_MUTEX. */
+static int readahead_tasks = 0;
+
+/* Keep track on whether we already initialized the static data. */
+static svn_atomic_t readahead_initialized = FALSE;
+
+/* Implements svn_atomic__init_once's init_func.  Create the mutex and
+   the request slots. */
+static svn_error_t *
+init_readahead(void *baton,
+               apr_pool_t *scratch_pool)
+{
+  /* All of this must live as long as the process. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  int i;
+
+  SVN_ERR(svn_mutex__init(&readahead_mutex, TRUE, pool));
+
+  /* Each slot must have its own thread-safe root pool, so the worker
+     threads can allocate memory at the same time. */
+  for (i = 0; i < MAX_PENDING_REQUESTS; ++i)
+    readahead_requests[i].pool = svn_pool_create(NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Release REQUEST after it read BYTES_READ bytes within DURATION and
+   update the statistics accordingly.  To be called with READAHEAD_MUTEX
+   held. */
+static svn_error_t *
+complete_request(request_t *request,
+                 apr_off_t bytes_read,
+                 apr_interval_time_t duration)
+{
+  request->in_use = FALSE;
+  request->started = FALSE;
+
+  readahead_stats.completed++;
+  readahead_stats.bytes_read += bytes_read;
+  readahead_stats.prefetch_usecs += duration;
+
+  return SVN_NO_ERROR;
+}
+
+/* Release REQUEST without having processed it and count it as dropped.
+   To be called with READAHEAD_MUTEX held. */
+static svn_error_t *
+drop_request(request_t *request)
+{
+  request->in_use = FALSE;
+
+  readahead_stats.requests--;
+  readahead_stats.dropped++;
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Drop all requests that no task has picked up.  To be called with
+   READAHEAD_MUTEX held. */
+static svn_error_t *
+drop_pending_requests(void)
+{
+  int i;
+  for (i = 0; i < MAX_PENDING_REQUESTS; ++i)
+    if (readahead_requests[i].in_use && !readahead_requests[i].started)
+      SVN_ERR(drop_request(&readahead_requests[i]));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REQUEST to some request that no task has picked up, yet, and mark
+   it as started.  If there is none, set it to NULL and retire the calling
+   task.  To be called with READAHEAD_MUTEX held. */
+static svn_error_t *
+next_request(request_t **request)
+{
+  int i;
+  for (i = 0; i < MAX_PENDING_REQUESTS; ++i)
+    if (readahead_requests[i].in_use && !readahead_requests[i].started)
+      {
+        readahead_requests[i].started = TRUE;
+        *request = &readahead_requests[i];
+        return SVN_NO_ERROR;
+      }
+
+  --readahead_tasks;
+  *request = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Read the file section given by REQUEST into the OS file cache and
+   return the number of bytes read. */
+static apr_off_t
+read_request(request_t *request)
+{
+  apr_off_t bytes_read = 0;
+  apr_pool_t *pool = svn_pool_create(request->pool);
+  apr_file_t *file;
+
+  /* This is only a hint.  So, ignore any errors and just stop. */
+  if (apr_file_open(&file, request->path, APR_READ, APR_OS_DEFAULT,
+                    pool) == APR_SUCCESS)
+    {
+      char *buffer = apr_palloc(pool, READ_CHUNK_SIZE);
+      apr_off_t offset = request->offset;
+
+      if (apr_file_seek(file, APR_SET, &offset) == APR_SUCCESS)
+        while (bytes_read < request->size)
+          {
+            apr_size_t len = (apr_size_t)MIN(READ_CHUNK_SIZE,
+                                             request->size - bytes_read);
+            if (apr_file_read(file, buffer, &len) != APR_SUCCESS)
+              break;
+
+            bytes_read += len;
+          }
+
+      apr_file_close(file);
+    }
+
+  /* The slot may be reused as soon as we mark it as unused. */
+  svn_pool_destroy(pool);
+
+  return bytes_read;
+}
+
+/* Thread-pool task: Process pending requests until there are none left.
+   This limits the number of threads that we take from the shared pool
+   to MAX_READAHEAD_THREADS. */
+static void * APR_THREAD_FUNC
+readahead_task(apr_thread_t *tid,
+               void *data)
+{
+  request_t *request = NULL;
+  svn_error_t *err;
+
+  /* There is no way to tell the caller about synchronization problems,
+     so they will simply terminate the task. */
+  err = svn_mutex__lock(readahead_mutex);
+  if (!err)
+    err = svn_mutex__unlock(readahead_mutex, next_request(&request));
+
+  while (!err && request)
+    {
+      apr_time_t start = apr_time_now();
+      apr_off_t bytes_read = read_request(request);
+
+      err = svn_mutex__lock(readahead_mutex);
+      if (!err)
+        {
+          err = complete_request(request, bytes_read,
+                                 apr_time_now() - start);
+          if (!err)
+            err = next_request(&request);
+          err = svn_mutex__unlock(readahead_mutex, err);
+        }
+    }
+
+  svn_error_clear(err);
+  return NULL;
+}
+
+#endif
+
+/* Set *REQUEST to a free request slot for the SIZE bytes at OFFSET in
+   file PATH.  Set it to NULL if there is none, if the same data is
+   being fetched already or if HAVE_THREADS is FALSE.  If the caller
+   shall push another readahead_task() to the thread pool, set
+   *START_TASK and count that task as running.  To be called with
+   READAHEAD_MUTEX held. */
+static svn_error_t *
+allocate_request(request_t **request,
+                 svn_boolean_t *start_task,
+                 const char *path,
+                 apr_off_t offset,
+                 apr_off_t size,
+                 svn_boolean_t have_threads)
+{
+  request_t *free_slot = NULL;
+  int i;
+
+  *request = NULL;
+  *start_task = FALSE;
+
+#if APR_HAS_THREADS
+  for (i = 0; have_threads && i < MAX_PENDING_REQUESTS; ++i)
+    {
+      request_t *slot = &readahead_requests[i];
+      if (!slot->in_use)
+        {
+          if (!free_slot)
+            free_slot = slot;
+        }
+      else if (   slot->offset <= offset
+               && slot->offset + slot->size >= offset + size
+               && strcmp(slot->path, path) == 0)
+        {
+          /* Duplicate. */
+          free_slot = NULL;
+          break;
+        }
+    }
+#endif
+
+  if (!free_slot)
+    {
+      readahead_stats.dropped++;
+      return SVN_NO_ERROR;
+    }
+
+  svn_pool_clear(free_slot->pool);
+  free_slot->in_use = TRUE;
+  free_slot->path = apr_pstrdup(free_slot->pool, path);
+  free_slot->offset = offset;
+  free_slot->size = size;
+  readahead_stats.requests++;
+
+  if (readahead_tasks < MAX_READAHEAD_THREADS)
+    {
+      ++readahead_tasks;
+      *start_task = TRUE;
+    }
+
+  *request = free_slot;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__readahead(svn_fs_t *fs,
+                     svn_fs_fs__revision_file_t *rev_file,
+                     apr_off_t offset,
+                     apr_off_t size,
+                     apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  request_t *request;
+  svn_boolean_t start_task;
+  svn_boolean_t have_threads = FALSE;
+  const char *path;
+  apr_off_t end;
+#if APR_HAS_THREADS
+  apr_thread_pool_t *thread_pool = NULL;
+#endif
+
+  if (   !ffd->use_readahead
+      || size <= 0
+      || !SVN_IS_VALID_REVNUM(rev_file->start_revision))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&readahead_initialized, init_readahead,
+                                NULL, scratch_pool));
+
+#if APR_HAS_THREADS
+  /* Without a thread pool, we simply drop all requests. */
+  svn_error_clear(svn_parallel__get_thread_pool(&thread_pool, scratch_pool));
+  have_threads = thread_pool != NULL;
+#endif
+
+  /* Read whole blocks. */
+  end = offset + MIN(size, MAX_REQUEST_SIZE);
+  offset -= offset % ffd->block_size;
+  end = APR_ALIGN(end, ffd->block_size);
+
+  path = rev_file->is_packed
+       ? svn_fs_fs__path_rev_packed(fs, rev_file->start_revision,
+                                    PATH_PACKED, scratch_pool)
+       : svn_fs_fs__path_rev(fs, rev_file->start_revision, scratch_pool);
+
+  SVN_MUTEX__WITH_LOCK(readahead_mutex,
+                       allocate_request(&request, &start_task, path, offset,
+                                        end - offset, have_threads));
+
+#if APR_HAS_THREADS
+  /* Otherwise, one of the running tasks will pick up the request. */
+  if (start_task
+      && apr_thread_pool_push(thread_pool, readahead_task, NULL, 0, NULL))
+    {
+      SVN_ERR(svn_mutex__lock(readahead_mutex));
+
+      /* The shared pool is busy.  Unless some other task is still around
+         to process them, retract all pending requests. */
+      if (--readahead_tasks == 0)
+        SVN_ERR(svn_mutex__unlock(readahead_mutex,
+                                  drop_pending_requests()));
+      else
+        SVN_ERR(svn_mutex__unlock(readahead_mutex, SVN_NO_ERROR));
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Add a block read of DURATION to the statistics.  To be called with
+   READAHEAD_MUTEX held. */
+static svn_error_t *
+count_block_read(apr_interval_time_t duration)
+{
+  readahead_stats.block_reads++;
+  readahead_stats.block_read_usecs += duration;
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_fs_fs__readahead_count_block_read(svn_fs_t *fs,
+                                      apr_interval_time_t duration,
+                                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  /* Don't bother with the mutex if nobody asked for readahead. */
+  if (!ffd->use_readahead)
+    return;
+
+  /* Statistics are not important enough to report errors. */
+  err = svn_atomic__init_once(&readahead_initialized, init_readahead,
+                              NULL, scratch_pool);
+  if (!err)
+    err = svn_mutex__lock(readahead_mutex);
+  if (!err)
+    err = svn_mutex__unlock(readahead_mutex, count_block_read(duration));
+
+  svn_error_clear(err);
+}
+
+svn_error_t *
+svn_fs_fs__get_readahead_stats(svn_fs_fs__readahead_stats_t **stats,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__readahead_stats_t *result
+    = apr_pcalloc(result_pool, sizeof(*result));
+
+  SVN_ERR(svn_atomic__init_once(&readahead_initialized, init_readahead,
+                                NULL, scratch_pool));
+
+  SVN_ERR(svn_mutex__lock(readahead_mutex));
+  *result = readahead_stats;
+  SVN_ERR(svn_mutex__unlock(readahead_mutex, SVN_NO_ERROR));
+
+  *stats = result;
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,71 @@
+/* readahead.h --- asynchronous prefetching of rev / pack file data
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS__READAHEAD_H
+#define SVN_LIBSVN_FS__READAHEAD_H
+
+#include "private/svn_fs_fs_private.h"
+
+#include "fs.h"
+#include "rev_file.h"
+
+/* Readahead lets a few tasks on the process-wide thread pool (see
+ * svn_parallel__get_thread_pool()) read rev / pack file sections that we
+ * expect to need soon.  They use their own file handles and discard the
+ * data, i.e. they only make sure that the following synchronous reads
+ * will be served from the OS file cache instead of stalling on the disk.
+ *
+ * All requests are mere hints.  They will silently be dropped if too many
+ * are pending already, if the same data has been requested already or if
+ * there is no thread support.
+ */
+
+/* If readahead has been enabled for FS, ask the background threads to
+ * read the SIZE bytes starting at OFFSET in REV_FILE.  REV_FILE must be a
+ * rev or pack file, not a proto-rev file.  The range will be extended to
+ * full blocks.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__readahead(svn_fs_t *fs,
+                     svn_fs_fs__revision_file_t *rev_file,
+                     apr_off_t offset,
+                     apr_off_t size,
+                     apr_pool_t *scratch_pool);
+
+/* Add a synchronous block read in FS that took DURATION to the readahead
+ * statistics.  This is a no-op unless readahead has been enabled for FS.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+void
+svn_fs_fs__readahead_count_block_read(svn_fs_t *fs,
+                                      apr_interval_time_t duration,
+                                      apr_pool_t *scratch_pool);
+
+/* Return the readahead statistics of this process in *STATS, allocated
+ * in RESULT_POOL.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__get_readahead_stats(svn_fs_fs__readahead_stats_t **stats,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
+#endif
@@ -0,0 +1,306 @@
+/* recompress.c --- re-encode stored deltas in place
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+
+#include "private/svn_delta_private.h"
+#include "private/svn_subr_private.h"
+
+#include "fs_fs.h"
+#include "index.h"
+#include "low_level.h"
+#include "rev_file.h"
+#include "util.h"
+
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* The svndiff version that representations get re-encoded to. */
+#define TARGET_SVNDIFF_VERSION 3
+
+/* Every representation ends with this line. */
+#define REP_TRAILER "ENDREP\n"
+#define REP_TRAILER_LEN (sizeof(REP_TRAILER) - 1)
+
+/* Implements svn_fs_fs__dump_index_func_t.  Append a copy of ENTRY to
+ * the apr_array_header_t * of svn_fs_fs__p2l_entry_t * in BATON.
+ */
+static svn_error_t *
+collect_entry(const svn_fs_fs__p2l_entry_t *entry,
+              void *baton,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries = baton;
+  APR_ARRAY_PUSH(entries, svn_fs_fs__p2l_entry_t *)
+    = apr_pmemdup(entries->pool, entry, sizeof(*entry));
+
+  return SVN_NO_ERROR;
+}
+
+/* Re-encode the representation described by ENTRY in REV_FILE as
+ * svndiff TARGET_SVNDIFF_VERSION using COMPRESSION_LEVEL.  Return the new
+ * svndiff data in *OUTPUT, allocated in RESULT_POOL, and the offset in
+ * REV_FILE at which it replaces the old data in *OUTPUT_OFFSET.  Set
+ * *OUTPUT to NULL, if the rep is not a delta in some older svndiff
+ * version or if it would not fit into its current length.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+recompress_rep(svn_stringbuf_t **output,
+               apr_off_t *output_offset,
+               svn_fs_fs__revision_file_t *rev_file,
+               const svn_fs_fs__p2l_entry_t *entry,
+               int compression_level,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream = rev_file->stream;
+  svn_fs_fs__rep_header_t *header;
+  svn_stringbuf_t *result;
+  char svndiff_header[4];
+  apr_size_t len = sizeof(svndiff_header);
+  apr_off_t data_len, consumed;
+  int version;
+  apr_pool_t *iterpool;
+
+  *output = NULL;
+
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, entry->offset));
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, stream, scratch_pool,
+                                     scratch_pool));
+  if (header->type == svn_fs_fs__rep_plain)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_stream_read_full(stream, svndiff_header, &len));
+  if (   len != sizeof(svndiff_header)
+      || memcmp(svndiff_header, "SVN", 3) != 0)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Malformed svndiff data in representation "
+                               "at offset %s"),
+                             apr_off_t_toa(scratch_pool, entry->offset));
+
+  /* Already up to date or some unknown future format? */
+  version = svndiff_header[3];
+  if (version < 0 || version >= TARGET_SVNDIFF_VERSION)
+    return SVN_NO_ERROR;
+
+  /* The svndiff data is everything between header and trailer. */
+  data_len = entry->size - header->header_size - REP_TRAILER_LEN;
+  result = svn_stringbuf_create_ensure((apr_size_t)data_len, result_pool);
+  svn_stringbuf_appendbytes(result, "SVN", 3);
+  svn_stringbuf_appendbyte(result, TARGET_SVNDIFF_VERSION);
+
+  /* Each window must keep its size.  Otherwise, the rep size stored in
+   * the noderevs and in the rep-cache as well as the base lengths in the
+   * headers of all deltas against this rep would become invalid. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (consumed = sizeof(svndiff_header); consumed < data_len; )
+    {
+      svn_boolean_t fits;
+      apr_size_t window_len;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_txdelta__transcode_svndiff_window(result, &fits,
+                                                    &window_len, stream,
+                                                    version,
+                                                    TARGET_SVNDIFF_VERSION,
+                                                    compression_level,
+                                                    TRUE, iterpool));
+      if (!fits)
+        {
+          svn_pool_destroy(iterpool);
+          return SVN_NO_ERROR;
+        }
+
+      consumed += window_len;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (consumed != data_len)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Svndiff data of representation at offset "
+                               "%s exceeds the item length"),
+                             apr_off_t_toa(scratch_pool, entry->offset));
+
+  *output = result;
+  *output_offset = entry->offset + header->header_size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for recompress_body(). */
+typedef struct recompress_baton_t
+{
+  svn_fs_t *fs;
+  svn_fs_fs__recompress_stats_t *stats;
+  svn_fs_progress_notify_func_t progress_func;
+  void *progress_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} recompress_baton_t;
+
+/* Re-encode all delta reps in the rev / pack file of BATON->FS that
+ * contains REVISION.  If any rep changed, replace the file with an updated
+ * copy with a new index.  The caller must hold the write lock.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+recompress_rev_file(recompress_baton_t *baton,
+                    svn_revnum_t revision,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool, 16, sizeof(svn_fs_fs__p2l_entry_t *));
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__revision_file_t *copy = NULL;
+  const char *copy_path = NULL;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_fs_fs__dump_index(baton->fs, revision, collect_entry, entries,
+                                baton->cancel_func, baton->cancel_baton,
+                                scratch_pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, baton->fs, revision,
+                                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, const svn_fs_fs__p2l_entry_t *);
+      svn_stringbuf_t *output;
+      apr_off_t offset;
+
+      if (   entry->type != SVN_FS_FS__ITEM_TYPE_FILE_REP
+          && entry->type != SVN_FS_FS__ITEM_TYPE_DIR_REP
+          && entry->type != SVN_FS_FS__ITEM_TYPE_FILE_PROPS
+          && entry->type != SVN_FS_FS__ITEM_TYPE_DIR_PROPS)
+        continue;
+
+      svn_pool_clear(iterpool);
+      if (baton->cancel_func)
+        SVN_ERR(baton->cancel_func(baton->cancel_baton));
+
+      SVN_ERR(recompress_rep(&output, &offset, rev_file, entry,
+                             ffd->delta_compression_level, iterpool,
+                             iterpool));
+      if (output)
+        {
+          /* Never modify the original file.  Concurrent readers may have
+           * it open or mapped. */
+          if (!copy)
+            SVN_ERR(svn_fs_fs__rev_file_copy(&copy, &copy_path, baton->fs,
+                                             rev_file, rev_file->l2p_offset,
+                                             scratch_pool, iterpool));
+
+          SVN_ERR(svn_io_file_seek(copy->file, APR_SET, &offset, iterpool));
+          SVN_ERR(svn_io_file_write_full(copy->file, output->data,
+                                         output->len, NULL, iterpool));
+          ++baton->stats->reps_recompressed;
+        }
+      else
+        {
+          ++baton->stats->reps_kept;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* The item checksums in the P2L index have changed. */
+  if (copy)
+    SVN_ERR(svn_fs_fs__replace_rev_file(baton->fs, copy, copy_path, entries,
+                                        scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements the body of svn_fs_fs__recompress() while holding all
+ * locks, including the write lock.  BATON is a recompress_baton_t *. */
+static svn_error_t *
+recompress_body(void *baton,
+                apr_pool_t *pool)
+{
+  recompress_baton_t *rb = baton;
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  svn_revnum_t youngest, revision;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, rb->fs, pool));
+  for (revision = 0; revision <= youngest; )
+    {
+      svn_boolean_t packed = svn_fs_fs__is_packed_rev(rb->fs, revision);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(recompress_rev_file(rb, revision, iterpool));
+      if (rb->progress_func)
+        rb->progress_func(revision, rb->progress_baton, iterpool);
+
+      revision = packed
+               ? svn_fs_fs__packed_base_rev(rb->fs, revision)
+                 + ffd->max_files_per_dir
+               : revision + 1;
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__recompress(svn_fs_fs__recompress_stats_t **stats,
+                      svn_fs_t *fs,
+                      svn_fs_progress_notify_func_t progress_func,
+                      void *progress_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  recompress_baton_t baton;
+
+  if (   ! svn_fs_fs__use_log_addressing(fs)
+      || ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    return svn_error_createf(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL,
+                             _("Recompressing deltas requires FSFS format "
+                               "%d or newer with logical addressing"),
+                             SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+
+  if (! svn__zstd_available())
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Zstandard compression is not available"));
+
+  baton.fs = fs;
+  baton.stats = apr_pcalloc(result_pool, sizeof(*baton.stats));
+  baton.progress_func = progress_func;
+  baton.progress_baton = progress_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  SVN_ERR(svn_fs_fs__with_all_locks(fs, recompress_body, &baton,
+                                    scratch_pool));
+
+  *stats = baton.stats;
+  return SVN_NO_ERROR;
+}
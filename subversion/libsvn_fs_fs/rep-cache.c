@@ -21,6 +21,8 @@
  */
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
 
 #include "svn_private_config.h"
 
@@ -32,6 +34,7 @@
 
 #include "svn_path.h"
 
+#include "private/svn_mutex.h"
 #include "private/svn_sqlite.h"
 
 #include "rep-cache-db.h"
@@ -48,7 +51,1115 @@ path_rep_cache_db(const char *fs_path,
   return svn_dirent_join(fs_path, REP_CACHE_DB_NAME, result_pool);
 }
 
-
+static APR_INLINE const char *
+path_rep_cache_filter(const char *fs_path,
+                      apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, REP_CACHE_FILTER_NAME, result_pool);
+}
+
+static APR_INLINE const char *
+path_rep_cache_filter_lock(const char *fs_path,
+                           apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, REP_CACHE_FILTER_LOCK_NAME, result_pool);
+}
+
+
+/** The rep-cache filter. **/
+
+/* Most SHA1 lookups during a commit are for new contents, i.e. they will
+ * not find anything in the rep-cache database.  The filter is a Bloom
+ * filter over all SHA1 keys in that database, allowing us to skip the
+ * database query for most of these misses.
+ *
+ * The filter may report false positives but it must never report a false
+ * negative for any rep-cache entry of a revision up to and including
+ * SYNCED_REV.  The filter is only being used while SYNCED_REV covers the
+ * youngest revision that the respective svn_fs_t knows of.  SYNCED_REV
+ * only advances over revisions whose keys have actually been added:  by
+ * our own commits, from the filter file or from the database.  Keys that
+ * get added while a new bit array is being loaded or built are never
+ * dropped.  Building the filter from the database is expensive and thus
+ * rate-limited.
+ *
+ * The filter file starts with a base, i.e. a copy of the bit array that
+ * covers all revisions up to and including its BASE_REV.  It is followed
+ * by a log of records, each listing the keys added by a single commit.
+ * Commits only append their record.  The base gets rewritten only after
+ * a rebuild or once the log has become too long.  Readers remember how
+ * much of the file they have already seen and only read the new records.
+ *
+ * Commits add their rows to the database only after bumping 'current'.
+ * From before bumping it until their log record has been written, they
+ * hold a shared lock on the filter lock file.  Rebuilding the filter from
+ * the database and rewriting the base of the filter file require the
+ * exclusive lock.  Thus, a database snapshot taken under that lock has all
+ * rows of all revisions up to the youngest one, and no log record can get
+ * appended between catching up with the filter file and replacing it.  We
+ * never wait for the exclusive lock but simply try again later.  File locks
+ * don't work between threads of the same process, so we count our own
+ * commits in progress.  Processes that don't use the filter don't take the
+ * lock; other processes may then miss some of their keys, which only means
+ * that their representations don't get shared.
+ *
+ * Removing entries from the database does not change the filter; only
+ * the false positive rate increases.  However, revisions that have been
+ * removed from the rep-cache may be committed again with new contents.
+ * Hence, we must lower SYNCED_REV in that case.
+ *
+ * Being an optimization only, the filter file is written without flushing
+ * it to disk and we ignore any errors when reading or writing it.  Bogus
+ * filter data may only cause representations to not be shared.
+ */
+
+/* Number of filter bits per expected entry and number of bit positions
+ * per key.  This gives a false positive rate of about 1%. */
+#define FILTER_BITS_PER_ENTRY 10
+#define FILTER_HASH_COUNT 7
+
+/* Number of leading SHA1 digest bytes that the bit positions are derived
+ * from.  Only these get stored in the filter file log. */
+#define FILTER_KEY_SIZE 8
+
+/* Minimum number of entries to size the filter for. */
+#define FILTER_MIN_CAPACITY 0x1000
+
+/* Upper limit to the number of bits in a filter. */
+#define FILTER_MAX_BIT_COUNT APR_UINT64_C(0x80000000)
+
+/* A stale filter must have been bypassed for at least this many lookups
+ * and at least for 1 in FILTER_REBUILD_RATIO of its entries before we
+ * rebuild it from the database. */
+#define FILTER_MIN_REBUILD_LOOKUPS 0x400
+#define FILTER_REBUILD_RATIO 64
+
+/* The base in the filter file gets rewritten once the log following it
+ * exceeds FILTER_MIN_LOG_SIZE bytes as well as 1 / FILTER_LOG_RATIO of
+ * the base size. */
+#define FILTER_MIN_LOG_SIZE 0x10000
+#define FILTER_LOG_RATIO 4
+
+/* Maximum length of a header line in the filter file. */
+#define FILTER_MAX_LINE_LEN 256
+
+/* First word in the filter file, identifying its format. */
+#define FILTER_FILE_MAGIC "rep-cache-filter-2"
+
+struct rep_cache_filter_t
+{
+  /* Serializes all access to this structure. */
+  svn_mutex__t *lock;
+
+  /* The common pool.  BITS will be allocated in a sub-pool of it. */
+  apr_pool_t *parent_pool;
+
+  /* Pool containing BITS.  NULL if BITS is NULL. */
+  apr_pool_t *pool;
+
+  /* The filter bit array.  NULL if the filter has not been built yet. */
+  unsigned char *bits;
+
+  /* Number of bits in BITS.  Always a power of two. */
+  apr_uint64_t bit_count;
+
+  /* Number of entries the filter has been sized for. */
+  apr_uint64_t capacity;
+
+  /* Number of entries added to the filter. */
+  apr_uint64_t count;
+
+  /* The filter contains all rep-cache entries for all revisions up to
+   * and including this one.  SVN_INVALID_REVNUM if BITS is NULL. */
+  svn_revnum_t synced_rev;
+
+  /* Revisions younger than SYNCED_REV + 1 whose keys have already been
+   * added.  SYNCED_REV will advance over them once the gap is closed. */
+  apr_array_header_t *ahead;
+
+  /* Youngest revision for which we tried to read the filter file. */
+  svn_revnum_t probed_rev;
+
+  /* Number of lookups that could not use the filter since the latest
+   * update from the database or the filter file. */
+  apr_uint64_t bypassed;
+
+  /* The leading FILTER_KEY_SIZE bytes of all keys added since the latest
+   * revision has been completed, i.e. the keys of the commit in progress.
+   * They get added again whenever BITS gets replaced. */
+  svn_stringbuf_t *pending;
+
+  /* Identifies the base of the filter file that we processed last.
+   * 0 if we don't know of any filter file. */
+  apr_int64_t file_generation;
+
+  /* Offset in the filter file at which the log following that base
+   * starts. */
+  apr_off_t file_log_start;
+
+  /* Offset in the filter file up to which we have processed the log. */
+  apr_off_t file_offset;
+
+  /* Size of the filter file when we last read or wrote it. */
+  apr_off_t file_end;
+
+  /* Set while some thread rebuilds the filter from the database. */
+  svn_boolean_t rebuilding;
+
+  /* Set if the base of the filter file shall be replaced by BITS as soon
+   * as there are no commits in progress. */
+  svn_boolean_t base_outdated;
+
+  /* Number of commits in this process between bumping 'current' and
+   * writing their log record. */
+  int commits;
+
+  /* Pool holding our shared lock on the filter lock file while COMMITS is
+   * not 0.  NULL if we don't hold that lock. */
+  apr_pool_t *commit_lock_pool;
+};
+
+svn_error_t *
+svn_fs_fs__create_rep_cache_filter(rep_cache_filter_t **filter,
+                                   apr_pool_t *pool)
+{
+  rep_cache_filter_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  SVN_ERR(svn_mutex__init(&result->lock, TRUE, pool));
+  result->parent_pool = pool;
+  result->synced_rev = SVN_INVALID_REVNUM;
+  result->ahead = apr_array_make(pool, 4, sizeof(svn_revnum_t));
+  result->probed_rev = SVN_INVALID_REVNUM;
+  result->pending = svn_stringbuf_create_empty(pool);
+
+  *filter = result;
+  return SVN_NO_ERROR;
+}
+
+/* Determine the *BIT_COUNT and *CAPACITY of a filter that can hold
+ * ENTRIES entries plus some room to grow. */
+static void
+filter_size(apr_uint64_t *bit_count,
+            apr_uint64_t *capacity,
+            apr_uint64_t entries)
+{
+  *capacity = MAX(2 * entries, FILTER_MIN_CAPACITY);
+  *bit_count = 8;
+
+  while (   *bit_count < *capacity * FILTER_BITS_PER_ENTRY
+         && *bit_count < FILTER_MAX_BIT_COUNT)
+    *bit_count *= 2;
+}
+
+/* Set *H1 and *H2 to two independent hash values derived from the first
+ * FILTER_KEY_SIZE bytes of the SHA1 digest KEY.  The bit positions for KEY
+ * are then H1 + i * H2. */
+static void
+filter_hashes(apr_uint32_t *h1,
+              apr_uint32_t *h2,
+              const unsigned char *key)
+{
+  /* SHA1 values are uniformly distributed, so any of their bits will do.
+   * Use an odd H2 to never get the same bit position twice. */
+  *h1 = ((apr_uint32_t)key[0] << 24) | ((apr_uint32_t)key[1] << 16)
+      | ((apr_uint32_t)key[2] << 8) | key[3];
+  *h2 = ((apr_uint32_t)key[4] << 24) | ((apr_uint32_t)key[5] << 16)
+      | ((apr_uint32_t)key[6] << 8) | key[7] | 1;
+}
+
+/* Set the bits for all COUNT keys in KEYS in the bit array BITS of
+ * BIT_COUNT bits.  Every key is FILTER_KEY_SIZE bytes long. */
+static void
+set_bits(unsigned char *bits,
+         apr_uint64_t bit_count,
+         const unsigned char *keys,
+         apr_size_t count)
+{
+  apr_uint32_t mask = (apr_uint32_t)(bit_count - 1);
+  apr_size_t k;
+
+  for (k = 0; k < count; ++k, keys += FILTER_KEY_SIZE)
+    {
+      apr_uint32_t h1, h2;
+      int i;
+
+      filter_hashes(&h1, &h2, keys);
+      for (i = 0; i < FILTER_HASH_COUNT; ++i, h1 += h2)
+        bits[(h1 & mask) / 8] |= (unsigned char)(1 << (h1 % 8));
+    }
+}
+
+/* Add the SHA1 DIGEST to FILTER.  To be called with FILTER->LOCK held. */
+static svn_error_t *
+filter_add(rep_cache_filter_t *filter,
+           const unsigned char *digest)
+{
+  svn_stringbuf_appendbytes(filter->pending, (const char *)digest,
+                            FILTER_KEY_SIZE);
+  if (filter->bits)
+    {
+      set_bits(filter->bits, filter->bit_count, digest, 1);
+      filter->count++;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the SHA1 DIGEST may have been added to FILTER and FALSE
+ * if it has definitely not been added.  FILTER must have been built. */
+static svn_boolean_t
+filter_may_contain(const rep_cache_filter_t *filter,
+                   const unsigned char *digest)
+{
+  apr_uint32_t h1, h2;
+  apr_uint32_t mask = (apr_uint32_t)(filter->bit_count - 1);
+  int i;
+
+  filter_hashes(&h1, &h2, digest);
+  for (i = 0; i < FILTER_HASH_COUNT; ++i, h1 += h2)
+    if ((filter->bits[(h1 & mask) / 8] & (1 << (h1 % 8))) == 0)
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Advance FILTER->SYNCED_REV over all revisions in FILTER->AHEAD that
+ * directly follow it and forget about those that are covered now.
+ * To be called with FILTER->LOCK held. */
+static void
+filter_catch_up(rep_cache_filter_t *filter)
+{
+  svn_boolean_t advanced;
+  int i, k;
+
+  do
+    {
+      advanced = FALSE;
+      for (i = 0; i < filter->ahead->nelts; ++i)
+        if (APR_ARRAY_IDX(filter->ahead, i, svn_revnum_t)
+              == filter->synced_rev + 1)
+          {
+            filter->synced_rev++;
+            advanced = TRUE;
+          }
+    }
+  while (advanced);
+
+  for (i = 0, k = 0; i < filter->ahead->nelts; ++i)
+    {
+      svn_revnum_t revision = APR_ARRAY_IDX(filter->ahead, i, svn_revnum_t);
+      if (revision > filter->synced_rev)
+        APR_ARRAY_IDX(filter->ahead, k++, svn_revnum_t) = revision;
+    }
+
+  filter->ahead->nelts = k;
+}
+
+/* Record that all keys of REVISION have been added to FILTER and extend
+ * its coverage accordingly.  To be called with FILTER->LOCK held. */
+static void
+filter_cover(rep_cache_filter_t *filter,
+             svn_revnum_t revision)
+{
+  if (!filter->bits || revision <= filter->synced_rev)
+    return;
+
+  APR_ARRAY_PUSH(filter->ahead, svn_revnum_t) = revision;
+  filter_catch_up(filter);
+}
+
+/* Make BITS, allocated in POOL, the new bit array of FILTER.  BITS has
+ * BIT_COUNT bits, is sized for CAPACITY entries, contains COUNT entries
+ * and covers all revisions up to and including SYNCED_REV.
+ *
+ * If the current bit array of FILTER has the same size, merge it into
+ * BITS such that no keys get lost.  Otherwise, add the keys of the commit
+ * in progress to BITS.  To be called with FILTER->LOCK held. */
+static void
+filter_install(rep_cache_filter_t *filter,
+               apr_pool_t *pool,
+               unsigned char *bits,
+               apr_uint64_t bit_count,
+               apr_uint64_t capacity,
+               apr_uint64_t count,
+               svn_revnum_t synced_rev)
+{
+  if (filter->bits && filter->bit_count == bit_count)
+    {
+      apr_size_t i;
+      for (i = 0; i < bit_count / 8; ++i)
+        bits[i] |= filter->bits[i];
+
+      synced_rev = MAX(synced_rev, filter->synced_rev);
+      count = MAX(count, filter->count);
+    }
+  else
+    {
+      apr_size_t pending = filter->pending->len / FILTER_KEY_SIZE;
+      set_bits(bits, bit_count, (const unsigned char *)filter->pending->data,
+               pending);
+
+      count += pending;
+      apr_array_clear(filter->ahead);
+    }
+
+  /* Don't hold onto the old filter any longer than necessary. */
+  if (filter->pool)
+    svn_pool_destroy(filter->pool);
+
+  filter->pool = pool;
+  filter->bits = bits;
+  filter->bit_count = bit_count;
+  filter->capacity = capacity;
+  filter->count = count;
+  filter->synced_rev = synced_rev;
+  filter->bypassed = 0;
+
+  filter_catch_up(filter);
+}
+
+/* Write a new base to the filter file of FS, consisting of the bit array
+ * BITS of BIT_COUNT bits, that is sized for CAPACITY entries, contains
+ * COUNT entries and covers all revisions up to and including SYNCED_REV.
+ * Discard any log.  Return TRUE on success and set *GENERATION to the
+ * identifier of the new base and *LOG_START to the size of the new file.
+ * Errors will be ignored.  Use SCRATCH_POOL for temporary allocations. */
+static svn_boolean_t
+write_filter_file(apr_int64_t *generation,
+                  apr_off_t *log_start,
+                  svn_fs_t *fs,
+                  const unsigned char *bits,
+                  apr_uint64_t bit_count,
+                  apr_uint64_t capacity,
+                  apr_uint64_t count,
+                  svn_revnum_t synced_rev,
+                  apr_pool_t *scratch_pool)
+{
+  const char *path = path_rep_cache_filter(fs->path, scratch_pool);
+  const char *tmp_path;
+  apr_file_t *file;
+  svn_stringbuf_t *header;
+  svn_error_t *err;
+
+  /* Readers use this to tell whether they have to re-read the base. */
+  *generation = (apr_int64_t)apr_time_now();
+
+  header = svn_stringbuf_createf(scratch_pool,
+                                 "%s %ld %" APR_UINT64_T_FMT
+                                 " %" APR_UINT64_T_FMT
+                                 " %" APR_UINT64_T_FMT
+                                 " %" APR_INT64_T_FMT "\n",
+                                 FILTER_FILE_MAGIC, synced_rev,
+                                 bit_count, capacity, count, *generation);
+
+  /* The bit array may be large.  So, don't copy it into a buffer. */
+  err = svn_io_open_unique_file3(&file, &tmp_path, fs->path,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 scratch_pool, scratch_pool);
+  if (!err)
+    err = svn_io_file_write_full(file, header->data, header->len, NULL,
+                                 scratch_pool);
+  if (!err)
+    err = svn_io_file_write_full(file, bits, (apr_size_t)(bit_count / 8),
+                                 NULL, scratch_pool);
+  if (!err)
+    err = svn_io_file_close(file, scratch_pool);
+  if (!err)
+    err = svn_io_copy_perms(svn_fs_fs__path_current(fs, scratch_pool),
+                            tmp_path, scratch_pool);
+  if (!err)
+    err = svn_io_file_rename2(tmp_path, path, FALSE, scratch_pool);
+
+  if (err)
+    {
+      svn_error_clear(err);
+      return FALSE;
+    }
+
+  *log_start = (apr_off_t)(header->len + bit_count / 8);
+  return TRUE;
+}
+
+/* Append a log record for REVISION with the keys given in FILTER->PENDING
+ * to the filter file of FS, if that exists, and update FILTER->FILE_END.
+ * Errors will be ignored.  Use SCRATCH_POOL for temporary allocations. */
+static void
+append_filter_record(rep_cache_filter_t *filter,
+                     svn_fs_t *fs,
+                     svn_revnum_t revision,
+                     apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_stringbuf_t *record;
+  svn_filesize_t file_size;
+  svn_error_t *err;
+
+  /* Concurrent commits may append their records at the same time.  Write
+   * each record in a single call, so the records don't get interleaved. */
+  record = svn_stringbuf_createf(scratch_pool, "%ld %" APR_SIZE_T_FMT "\n",
+                                 revision,
+                                 filter->pending->len / FILTER_KEY_SIZE);
+  svn_stringbuf_appendstr(record, filter->pending);
+
+  err = svn_io_file_open(&file, path_rep_cache_filter(fs->path,
+                                                      scratch_pool),
+                         APR_WRITE | APR_APPEND, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (!err)
+    {
+      err = svn_io_file_write_full(file, record->data, record->len, NULL,
+                                   scratch_pool);
+      if (!err)
+        err = svn_io_file_size_get(&file_size, file, scratch_pool);
+      if (!err)
+        filter->file_end = (apr_off_t)file_size;
+
+      err = svn_error_compose_create(err,
+                                     svn_io_file_close(file, scratch_pool));
+    }
+
+  svn_error_clear(err);
+}
+
+/* Read the log records in the open filter FILE starting at
+ * FILTER->FILE_OFFSET up to FILE_SIZE and add their keys to FILTER.
+ * Extend its coverage accordingly.  Stop at the first incomplete record
+ * and at the first record for a revision beyond YOUNGEST.  To be called
+ * with FILTER->LOCK held.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_filter_log(rep_cache_filter_t *filter,
+                apr_file_t *file,
+                svn_filesize_t file_size,
+                svn_revnum_t youngest,
+                apr_pool_t *scratch_pool)
+{
+  apr_off_t offset = filter->file_offset;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  while (filter->file_offset < file_size)
+    {
+      svn_stringbuf_t *line;
+      svn_boolean_t eof;
+      apr_array_header_t *fields;
+      apr_int64_t revision;
+      apr_uint64_t count;
+      apr_size_t len, bytes_read;
+      unsigned char *keys;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_io_file_readline(file, &line, NULL, &eof,
+                                   FILTER_MAX_LINE_LEN, iterpool, iterpool));
+      if (eof)
+        break;
+
+      fields = svn_cstring_split(line->data, " ", FALSE, iterpool);
+      if (   fields->nelts != 2
+          || svn_cstring_atoi64(&revision,
+                                APR_ARRAY_IDX(fields, 0, const char *))
+          || svn_cstring_atoui64(&count,
+                                 APR_ARRAY_IDX(fields, 1, const char *)))
+        break;
+
+      /* Leave records of revisions that we don't know of, yet, for later.
+       * Revisions beyond YOUNGEST may also have been removed from the
+       * rep-cache. */
+      if (revision > youngest)
+        break;
+
+      /* Don't allocate memory for bogus key counts. */
+      SVN_ERR(svn_io_file_get_offset(&offset, file, iterpool));
+      if (count > (apr_uint64_t)(file_size - offset) / FILTER_KEY_SIZE)
+        break;
+
+      len = (apr_size_t)count * FILTER_KEY_SIZE;
+      keys = apr_palloc(iterpool, len);
+      SVN_ERR(svn_io_file_read_full2(file, keys, len, &bytes_read, NULL,
+                                     iterpool));
+      if (bytes_read != len)
+        break;
+
+      if (filter->bits)
+        {
+          set_bits(filter->bits, filter->bit_count, keys, (apr_size_t)count);
+          if (revision > filter->synced_rev)
+            filter->count += count;
+
+          filter_cover(filter, (svn_revnum_t)revision);
+        }
+
+      filter->file_offset = offset + len;
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Bring FILTER up to date with the filter file of FS.  If the file has a
+ * new base that covers more revisions than FILTER but not more than
+ * YOUNGEST, merge it into FILTER.  Then add the keys from the log records
+ * that we have not seen yet.  To be called with FILTER->LOCK held.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_filter_file(rep_cache_filter_t *filter,
+                 svn_fs_t *fs,
+                 svn_revnum_t youngest,
+                 apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_filesize_t file_size;
+  svn_stringbuf_t *header;
+  apr_array_header_t *fields;
+  svn_boolean_t eof;
+  apr_int64_t synced_rev, generation;
+  apr_uint64_t bit_count, capacity, count;
+  apr_off_t log_start;
+  svn_error_t *err;
+
+  /* There may be no filter file at all. */
+  err = svn_io_file_open(&file, path_rep_cache_filter(fs->path,
+                                                      scratch_pool),
+                         APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      filter->file_generation = 0;
+      return SVN_NO_ERROR;
+    }
+
+  err = svn_io_file_size_get(&file_size, file, scratch_pool);
+  if (!err)
+    err = svn_io_file_readline(file, &header, NULL, &eof,
+                               FILTER_MAX_LINE_LEN, scratch_pool,
+                               scratch_pool);
+  if (err || eof)
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_io_file_close(file, scratch_pool));
+    }
+
+  fields = svn_cstring_split(header->data, " ", FALSE, scratch_pool);
+  if (   fields->nelts != 6
+      || strcmp(APR_ARRAY_IDX(fields, 0, const char *), FILTER_FILE_MAGIC)
+      || svn_cstring_atoi64(&synced_rev,
+                            APR_ARRAY_IDX(fields, 1, const char *))
+      || svn_cstring_atoui64(&bit_count,
+                             APR_ARRAY_IDX(fields, 2, const char *))
+      || svn_cstring_atoui64(&capacity,
+                             APR_ARRAY_IDX(fields, 3, const char *))
+      || svn_cstring_atoui64(&count,
+                             APR_ARRAY_IDX(fields, 4, const char *))
+      || svn_cstring_atoi64(&generation,
+                            APR_ARRAY_IDX(fields, 5, const char *)))
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  /* Use only consistent data. */
+  log_start = (apr_off_t)(header->len + 1 + bit_count / 8);
+  if (   bit_count < 8
+      || bit_count > FILTER_MAX_BIT_COUNT
+      || (bit_count & (bit_count - 1)) != 0
+      || log_start > file_size)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  /* The base is new to us.  Take it if it is actually newer than what we
+   * have.  Revisions beyond YOUNGEST may have been removed from the
+   * rep-cache. */
+  if (generation != filter->file_generation)
+    {
+      if (synced_rev > filter->synced_rev && synced_rev <= youngest)
+        {
+          apr_pool_t *pool = svn_pool_create(filter->parent_pool);
+          unsigned char *bits = apr_palloc(pool, (apr_size_t)(bit_count / 8));
+
+          err = svn_io_file_read_full2(file, bits, (apr_size_t)(bit_count / 8),
+                                       NULL, NULL, scratch_pool);
+          if (err)
+            {
+              svn_pool_destroy(pool);
+              svn_error_clear(err);
+              return svn_error_trace(svn_io_file_close(file, scratch_pool));
+            }
+
+          filter_install(filter, pool, bits, bit_count, capacity, count,
+                         (svn_revnum_t)synced_rev);
+        }
+
+      filter->file_generation = generation;
+      filter->file_log_start = log_start;
+      filter->file_offset = log_start;
+    }
+
+  filter->file_end = (apr_off_t)file_size;
+  err = read_filter_log(filter, file, file_size, youngest, scratch_pool);
+  svn_error_clear(err);
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Lock the filter lock file of FS for the lifetime of POOL, creating the
+ * file if necessary.  Take an exclusive lock if EXCLUSIVE is set and a
+ * shared one otherwise.  If NONBLOCKING is set, fail instead of waiting
+ * for other processes to release their locks. */
+static svn_error_t *
+lock_filter_file(svn_fs_t *fs,
+                 svn_boolean_t exclusive,
+                 svn_boolean_t nonblocking,
+                 apr_pool_t *pool)
+{
+  const char *path = path_rep_cache_filter_lock(fs->path, pool);
+  svn_error_t *err = svn_io_file_lock2(path, exclusive, nonblocking, pool);
+
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* Some other process may create the file at the same time. */
+      svn_error_clear(err);
+      err = svn_io_file_create_empty(path, pool);
+      if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+        {
+          svn_error_clear(err);
+          err = NULL;
+        }
+      else if (!err)
+        {
+          err = svn_io_copy_perms(svn_fs_fs__path_current(fs, pool), path,
+                                  pool);
+        }
+
+      if (!err)
+        err = svn_io_file_lock2(path, exclusive, nonblocking, pool);
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Replace the base of the filter file of FS with the bit array of FILTER,
+ * unless another process is in the middle of a commit.  Catch up with the
+ * current filter file first, so no log records get lost.  Errors will be
+ * ignored.  To be called with FILTER->LOCK held and FILTER->COMMITS being
+ * 0.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+persist_filter(rep_cache_filter_t *filter,
+               svn_fs_t *fs,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *lock_pool = svn_pool_create(scratch_pool);
+  svn_revnum_t youngest;
+  apr_int64_t generation;
+  apr_off_t log_start;
+  svn_error_t *err;
+
+  err = lock_filter_file(fs, TRUE, TRUE, lock_pool);
+  if (!err)
+    err = svn_fs_fs__youngest_rev(&youngest, fs, lock_pool);
+  if (!err)
+    {
+      filter->probed_rev = MAX(filter->probed_rev, youngest);
+      err = read_filter_file(filter, fs, youngest, lock_pool);
+    }
+
+  if (   !err
+      && filter->bits
+      && write_filter_file(&generation, &log_start, fs, filter->bits,
+                           filter->bit_count, filter->capacity,
+                           filter->count, filter->synced_rev, lock_pool))
+    {
+      filter->file_generation = generation;
+      filter->file_log_start = log_start;
+      filter->file_offset = log_start;
+      filter->file_end = log_start;
+      filter->base_outdated = FALSE;
+    }
+
+  svn_error_clear(err);
+  svn_pool_destroy(lock_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the keys of all entries returned by STMT to the bit array BITS of
+ * BIT_COUNT bits and return their number in *COUNT.  STMT has already been
+ * stepped once and HAVE_ROW is the result of that.  Reset STMT when done.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+scan_rep_cache(apr_uint64_t *count,
+               unsigned char *bits,
+               apr_uint64_t bit_count,
+               svn_sqlite__stmt_t *stmt,
+               svn_boolean_t have_row,
+               apr_pool_t *scratch_pool)
+{
+  int iterations = 0;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  *count = 0;
+
+  while (have_row)
+    {
+      svn_checksum_t *checksum;
+      svn_error_t *err;
+
+      /* Clear ITERPOOL occasionally. */
+      if (iterations++ % 1024 == 0)
+        svn_pool_clear(iterpool);
+
+      /* Skip entries that are not SHA1 checksums.  They can never match. */
+      err = svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
+                                   svn_sqlite__column_text(stmt, 0, iterpool),
+                                   iterpool);
+      if (err)
+        {
+          svn_error_clear(err);
+        }
+      else if (checksum)
+        {
+          set_bits(bits, bit_count, checksum->digest, 1);
+          ++*count;
+        }
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  SVN_ERR(svn_sqlite__reset(stmt));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Take a snapshot of the rep-cache database of FS for rebuilding FILTER.
+ * Set *STMT to a statement that has been stepped once to the first entry
+ * of the snapshot and set *HAVE_ROW accordingly.  Set *ENTRIES to the
+ * number of entries in the database and *YOUNGEST to the youngest
+ * revision whose entries are all in the snapshot.  Set *STMT to NULL if
+ * commits are in progress.  To be called with FILTER->LOCK held.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+begin_rebuild(svn_sqlite__stmt_t **stmt,
+              svn_boolean_t *have_row,
+              apr_int64_t *entries,
+              svn_revnum_t *youngest,
+              rep_cache_filter_t *filter,
+              svn_fs_t *fs,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *count_stmt;
+  apr_pool_t *lock_pool;
+  svn_error_t *err;
+
+  *stmt = NULL;
+  if (filter->commits)
+    return SVN_NO_ERROR;
+
+  /* Keep other processes from committing until the snapshot is fixed. */
+  lock_pool = svn_pool_create(scratch_pool);
+  err = lock_filter_file(fs, TRUE, TRUE, lock_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      svn_pool_destroy(lock_pool);
+      return SVN_NO_ERROR;
+    }
+
+  err = svn_fs_fs__youngest_rev(youngest, fs, scratch_pool);
+  if (!err)
+    err = svn_sqlite__get_statement(&count_stmt, ffd->rep_cache_db,
+                                    STMT_GET_REP_COUNT);
+  if (!err)
+    err = svn_sqlite__step_row(count_stmt);
+  if (!err)
+    {
+      *entries = svn_sqlite__column_int64(count_stmt, 0);
+      err = svn_sqlite__reset(count_stmt);
+    }
+
+  /* The first step starts the read transaction. */
+  if (!err)
+    err = svn_sqlite__get_statement(stmt, ffd->rep_cache_db,
+                                    STMT_GET_ALL_HASHES);
+  if (!err)
+    {
+      err = svn_sqlite__step(have_row, *stmt);
+      if (err)
+        *stmt = NULL;
+    }
+
+  svn_pool_destroy(lock_pool);
+  return svn_error_trace(err);
+}
+
+/* Rebuild FILTER from the rep-cache database of FS and persist it.  The
+ * caller must have set FILTER->REBUILDING but must not hold FILTER->LOCK.
+ * The database gets scanned without holding the lock; it is only taken
+ * to start the scan and to install the result.  If commits are in
+ * progress, leave FILTER unchanged and allow for another attempt later.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+rebuild_filter(rep_cache_filter_t *filter,
+               svn_fs_t *fs,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_revnum_t youngest;
+  apr_int64_t entries;
+  apr_uint64_t bit_count, capacity, count;
+  unsigned char *bits;
+  apr_pool_t *pool;
+  svn_error_t *err, *lock_err;
+
+  SVN_ERR(svn_mutex__lock(filter->lock));
+  err = begin_rebuild(&stmt, &have_row, &entries, &youngest, filter, fs,
+                      scratch_pool);
+  if (err || !stmt)
+    {
+      /* Allow for another attempt later. */
+      filter->rebuilding = FALSE;
+      filter->bypassed = 0;
+      return svn_error_trace(svn_mutex__unlock(filter->lock, err));
+    }
+
+  pool = svn_pool_create(filter->parent_pool);
+  SVN_ERR(svn_mutex__unlock(filter->lock, SVN_NO_ERROR));
+
+  filter_size(&bit_count, &capacity, (apr_uint64_t)entries);
+  bits = apr_pcalloc(pool, (apr_size_t)(bit_count / 8));
+  err = scan_rep_cache(&count, bits, bit_count, stmt, have_row,
+                       scratch_pool);
+
+  lock_err = svn_mutex__lock(filter->lock);
+  if (lock_err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_compose_create(err, lock_err);
+    }
+
+  /* Allow for another attempt later, if this one failed. */
+  filter->rebuilding = FALSE;
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(svn_mutex__unlock(filter->lock, err));
+    }
+
+  filter_install(filter, pool, bits, bit_count, capacity, count, youngest);
+  filter->probed_rev = MAX(filter->probed_rev, youngest);
+
+  /* Commits in progress would keep us from replacing the base. */
+  filter->base_outdated = TRUE;
+  if (filter->commits == 0)
+    err = persist_filter(filter, fs, scratch_pool);
+
+  return svn_error_trace(svn_mutex__unlock(filter->lock, err));
+}
+
+/* Set *MAY_CONTAIN to FALSE if the rep-cache of FS definitely does not
+ * contain an entry for the SHA1 DIGEST.  Otherwise, set it to TRUE.
+ * Bring FILTER up to date as necessary.  Set *REBUILD to TRUE if the
+ * caller shall rebuild FILTER from the database.  To be called with
+ * FILTER->LOCK held.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+filter_lookup(svn_boolean_t *may_contain,
+              svn_boolean_t *rebuild,
+              rep_cache_filter_t *filter,
+              svn_fs_t *fs,
+              const unsigned char *digest,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t youngest = ffd->youngest_rev_cache;
+
+  /* Other processes may have committed and updated the filter file.
+   * Our idea of the youngest revision may also be outdated. */
+  if (filter->synced_rev < youngest && filter->probed_rev < youngest)
+    {
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, scratch_pool));
+      filter->probed_rev = youngest;
+      SVN_ERR(read_filter_file(filter, fs, youngest, scratch_pool));
+    }
+
+  /* Reading the whole database is expensive.  Unless we don't have any
+   * filter, do it only once the filter became too inaccurate or once
+   * the lookups it could not serve would have become more expensive. */
+  *rebuild = !filter->rebuilding
+          && (   !filter->bits
+              || filter->count > filter->capacity
+              || (   filter->synced_rev < youngest
+                  && filter->bypassed >= MAX(FILTER_MIN_REBUILD_LOOKUPS,
+                                             filter->count
+                                               / FILTER_REBUILD_RATIO)));
+  if (*rebuild)
+    filter->rebuilding = TRUE;
+
+  if (!filter->bits || filter->synced_rev < youngest)
+    {
+      filter->bypassed++;
+      *may_contain = TRUE;
+    }
+  else
+    {
+      *may_contain = filter_may_contain(filter, digest);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Reset the coverage of FILTER such that it will not be used for
+ * revisions younger than YOUNGEST.  To be called with FILTER->LOCK held. */
+static svn_error_t *
+filter_truncate(rep_cache_filter_t *filter,
+                svn_revnum_t youngest)
+{
+  if (filter->bits && filter->synced_rev > youngest)
+    filter->synced_rev = youngest;
+  if (filter->probed_rev > youngest)
+    filter->probed_rev = youngest;
+
+  /* The filter file is about to be removed. */
+  apr_array_clear(filter->ahead);
+  filter->file_generation = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark FILTER as covering REVISION, whose keys have all been added, and
+ * record those in the filter file of FS.  To be called with FILTER->LOCK
+ * held.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+filter_add_revision(rep_cache_filter_t *filter,
+                    svn_fs_t *fs,
+                    svn_revnum_t revision,
+                    apr_pool_t *scratch_pool)
+{
+  /* Catch up with other processes' commits first.  Otherwise, we can't
+   * claim to cover REVISION. */
+  if (filter->bits && filter->synced_rev < revision - 1)
+    SVN_ERR(read_filter_file(filter, fs, revision, scratch_pool));
+
+  filter_cover(filter, revision);
+  filter->probed_rev = MAX(filter->probed_rev, revision);
+  if (filter->synced_rev == revision)
+    filter->bypassed = 0;
+
+  /* The base gets rewritten once the commit has ended. */
+  append_filter_record(filter, fs, revision, scratch_pool);
+  svn_stringbuf_setempty(filter->pending);
+
+  return SVN_NO_ERROR;
+}
+
+/* Register a commit in progress with FILTER and make sure that other
+ * processes know about it.  To be called with FILTER->LOCK held. */
+static svn_error_t *
+filter_begin_commit(rep_cache_filter_t *filter,
+                    svn_fs_t *fs)
+{
+  if (filter->commits == 0)
+    {
+      apr_pool_t *pool = svn_pool_create(filter->parent_pool);
+      svn_error_t *err = lock_filter_file(fs, FALSE, FALSE, pool);
+
+      /* Without the lock, other processes may only miss our keys. */
+      if (err)
+        {
+          svn_error_clear(err);
+          svn_pool_destroy(pool);
+        }
+      else
+        {
+          filter->commit_lock_pool = pool;
+        }
+    }
+
+  filter->commits++;
+  return SVN_NO_ERROR;
+}
+
+/* Unregister a commit in progress from FILTER.  Once there are no more
+ * commits, rewrite the base of the filter file of FS if there is none,
+ * if FILTER has been rebuilt in the meantime or if the log became too
+ * long.  To be called with FILTER->LOCK held.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+filter_end_commit(rep_cache_filter_t *filter,
+                  svn_fs_t *fs,
+                  apr_pool_t *scratch_pool)
+{
+  apr_off_t max_log_size;
+
+  if (--filter->commits > 0)
+    return SVN_NO_ERROR;
+
+  if (filter->commit_lock_pool)
+    {
+      svn_pool_destroy(filter->commit_lock_pool);
+      filter->commit_lock_pool = NULL;
+    }
+
+  /* Appending to the log is cheap.  If the log became too long, the new
+   * base must not cover fewer revisions than the log does. */
+  max_log_size = MAX(FILTER_MIN_LOG_SIZE,
+                     (apr_off_t)(filter->bit_count / 8 / FILTER_LOG_RATIO));
+  if (   filter->bits
+      && (   filter->file_generation == 0
+          || filter->base_outdated
+          || (   filter->file_end - filter->file_log_start > max_log_size
+              && filter->ahead->nelts == 0)))
+    SVN_ERR(persist_filter(filter, fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__begin_rep_cache_filter_commit(svn_fs_t *fs,
+                                         apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+
+  if (!ffd->use_rep_cache_filter)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(filter->lock, filter_begin_commit(filter, fs));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__end_rep_cache_filter_commit(svn_fs_t *fs,
+                                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+
+  if (!ffd->use_rep_cache_filter)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(filter->lock, filter_end_commit(filter, fs, pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__update_rep_cache_filter(svn_fs_t *fs,
+                                   svn_revnum_t revision,
+                                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+
+  if (!ffd->use_rep_cache_filter)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(filter->lock,
+                       filter_add_revision(filter, fs, revision, pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 /** Library-private API's. **/
 
 /* Body of svn_fs_fs__open_rep_cache().
@@ -281,6 +1392,28 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
                             _("Only SHA1 checksums can be used as keys in the "
                               "rep_cache table.\n"));
 
+  /* Skip the database query if the filter rules out any match. */
+  if (ffd->use_rep_cache_filter)
+    {
+      rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+      svn_boolean_t may_contain, rebuild;
+
+      SVN_MUTEX__WITH_LOCK(filter->lock,
+                           filter_lookup(&may_contain, &rebuild, filter, fs,
+                                         checksum->digest, pool));
+
+      /* Scanning the database may take a while.  Don't block other
+       * lookups in the meantime. */
+      if (rebuild)
+        SVN_ERR(rebuild_filter(filter, fs, pool));
+
+      if (!may_contain)
+        {
+          *rep_p = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
                             svn_checksum_to_cstring(checksum, pool)));
@@ -352,7 +1485,13 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                             (apr_int64_t) rep->expanded_size));
 
   err = svn_sqlite__insert(NULL, stmt);
-  if (err)
+  if (!err && ffd->use_rep_cache_filter)
+    {
+      rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+      SVN_MUTEX__WITH_LOCK(filter->lock,
+                           filter_add(filter, rep->sha1_digest));
+    }
+  else if (err)
     {
       representation_t *old_rep;
 
@@ -395,6 +1534,14 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
   SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
   SVN_ERR(svn_sqlite__step_done(stmt));
 
+  /* The removed revisions may get committed again with different contents.
+   * Make sure that no filter claims to cover them. */
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter->lock,
+                       filter_truncate(ffd->shared->rep_cache_filter,
+                                       youngest));
+  SVN_ERR(svn_io_remove_file2(path_rep_cache_filter(fs->path, pool), TRUE,
+                              pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -33,6 +33,8 @@ extern "C" {
 
 
 #define REP_CACHE_DB_NAME        "rep-cache.db"
+#define REP_CACHE_FILTER_NAME    "rep-cache.filter"
+#define REP_CACHE_FILTER_LOCK_NAME "rep-cache.filter-lock"
 
 /* Open and create, if needed, the rep cache database associated with FS.
    Use POOL for temporary allocations. */
@@ -90,6 +92,38 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
                              svn_revnum_t youngest,
                              apr_pool_t *pool);
 
+/* Allocate an empty rep-cache filter in *FILTER.  POOL must be the
+   process-wide common pool that the FSFS shared data is allocated in. */
+svn_error_t *
+svn_fs_fs__create_rep_cache_filter(rep_cache_filter_t **filter,
+                                   apr_pool_t *pool);
+
+/* Tell the rep-cache filter of FS that a commit is about to bump the
+   'current' file and will then add its representations to the rep-cache.
+   Until the matching svn_fs_fs__end_rep_cache_filter_commit() call, no
+   process will rebuild its filter from the database or rewrite the filter
+   file.  This is a no-op unless the filter has been enabled for FS.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__begin_rep_cache_filter_commit(svn_fs_t *fs,
+                                         apr_pool_t *pool);
+
+/* End the commit started by svn_fs_fs__begin_rep_cache_filter_commit(),
+   regardless of whether it succeeded.  This is a no-op unless the filter
+   has been enabled for FS.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__end_rep_cache_filter_commit(svn_fs_t *fs,
+                                       apr_pool_t *pool);
+
+/* Notify the rep-cache filter of FS that all representations of REVISION
+   have been added through svn_fs_fs__set_rep_reference() and record them
+   in the filter file for other processes.  This is a no-op unless the
+   filter has been enabled for FS.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__update_rep_cache_filter(svn_fs_t *fs,
+                                   svn_revnum_t revision,
+                                   apr_pool_t *pool);
+
 /* Start a transaction to take an SQLite reserved lock that prevents
    other writes, call BODY, end the transaction, and return what BODY returned.
  */
@@ -28,7 +28,14 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
+#include "private/svn_mutex.h"
 #include "svn_private_config.h"
 
 /* Initialize the *FILE structure for REVISION in filesystem FS.  Set its
@@ -46,6 +53,9 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->mapping = NULL;
+  file->mmap_offset = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +130,337 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* A read-only mapping of a whole pack file.  It is shared by all
+ * svn_fs_fs__revision_file_t instances in this process that read the
+ * same file.  Unused mappings are kept for later reuse until the budget
+ * is needed for other files. */
+struct svn_fs_fs__file_mapping_t
+{
+  /* Absolute path of the mapped file.  Key in MAPPINGS. */
+  const char *path;
+
+  /* Size, modification time and identity of the mapped file.  If a file
+   * with a different identity shows up under PATH, the original file got
+   * replaced and this mapping must not be handed out anymore. */
+  apr_finfo_t finfo;
+
+  /* The mapping itself. */
+  apr_mmap_t *mmap;
+
+  /* Number of revision files currently using this mapping. */
+  int ref_count;
+
+  /* Set once this mapping has been removed from MAPPINGS.  It will be
+   * destroyed as soon as REF_COUNT drops to 0. */
+  svn_boolean_t retired;
+
+  /* Private root pool owning this struct and the mapping. */
+  apr_pool_t *pool;
+};
+
+/* Maps the absolute path of a pack file to its current
+ * svn_fs_fs__file_mapping_t.  Protected by MAPPINGS_MUTEX. */
+static apr_hash_t *mappings = NULL;
+
+/* Total number of bytes mapped by all svn_fs_fs__file_mapping_t
+ * instances in this process, including retired ones.  Protected by
+ * MAPPINGS_MUTEX. */
+static apr_int64_t mapped_size = 0;
+
+/* Serializes access to MAPPINGS, MAPPED_SIZE and to the reference
+ * counts of all svn_fs_fs__file_mapping_t instances. */
+static svn_mutex__t *mappings_mutex = NULL;
+
+/* Keep track on whether we already initialized the static data. */
+static svn_atomic_t mappings_initialized = FALSE;
+
+/* Implements svn_atomic__init_once's init_func.  Create MAPPINGS and the
+ * mutex protecting it. */
+static svn_error_t *
+init_mappings(void *baton,
+              apr_pool_t *scratch_pool)
+{
+  /* All of this must live as long as the process. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  mappings = apr_hash_make(pool);
+  return svn_error_trace(svn_mutex__init(&mappings_mutex, TRUE, pool));
+}
+
+/* Set *FINFO to the size, modification time and, if available, the
+ * identity of the open FILE.  Return FALSE if that information is not
+ * available. */
+static svn_boolean_t
+get_file_identity(apr_finfo_t *finfo,
+                  apr_file_t *file)
+{
+  apr_int32_t required = APR_FINFO_SIZE | APR_FINFO_MTIME;
+  apr_status_t status = apr_file_info_get(finfo, required | APR_FINFO_IDENT,
+                                          file);
+
+  return (status == APR_SUCCESS || status == APR_INCOMPLETE)
+      && (finfo->valid & required) == required;
+}
+
+/* Return TRUE if LHS and RHS, both filled in by get_file_identity(),
+ * describe the same file. */
+static svn_boolean_t
+is_same_file(const apr_finfo_t *lhs,
+             const apr_finfo_t *rhs)
+{
+  if (lhs->size != rhs->size || lhs->mtime != rhs->mtime)
+    return FALSE;
+
+  if ((lhs->valid & rhs->valid & APR_FINFO_IDENT) == APR_FINFO_IDENT)
+    return lhs->inode == rhs->inode && lhs->device == rhs->device;
+
+  return TRUE;
+}
+
+/* Remove MAPPING from MAPPINGS and destroy it, once it is no longer in
+ * use.  To be called with MAPPINGS_MUTEX held. */
+static void
+retire_mapping(svn_fs_fs__file_mapping_t *mapping)
+{
+  if (!mapping->retired)
+    {
+      apr_hash_set(mappings, mapping->path, APR_HASH_KEY_STRING, NULL);
+      mapping->retired = TRUE;
+    }
+
+  if (mapping->ref_count == 0)
+    {
+      mapped_size -= mapping->mmap->size;
+      svn_pool_destroy(mapping->pool);
+    }
+}
+
+/* Retire unused mappings until SIZE more bytes fit into BUDGET.  Return
+ * FALSE if that is not possible.  To be called with MAPPINGS_MUTEX held. */
+static svn_boolean_t
+make_room(apr_int64_t size,
+          apr_int64_t budget)
+{
+  while (mapped_size + size > budget)
+    {
+      svn_fs_fs__file_mapping_t *victim = NULL;
+      apr_hash_index_t *hi;
+
+      for (hi = apr_hash_first(NULL, mappings); hi; hi = apr_hash_next(hi))
+        {
+          svn_fs_fs__file_mapping_t *mapping = apr_hash_this_val(hi);
+          if (mapping->ref_count == 0)
+            {
+              victim = mapping;
+              break;
+            }
+        }
+
+      if (!victim)
+        return FALSE;
+
+      retire_mapping(victim);
+    }
+
+  return TRUE;
+}
+
+/* Set *MAPPING to a mapping of the whole FILE found at PATH with the
+ * properties given by FINFO and take a reference to it.  Reuse an existing
+ * mapping, if possible.  Set *MAPPING to NULL if the mapping would exceed
+ * BUDGET or if mapping FILE failed.  To be called with MAPPINGS_MUTEX
+ * held. */
+static svn_error_t *
+acquire_mapping(svn_fs_fs__file_mapping_t **mapping,
+                const char *path,
+                apr_file_t *file,
+                const apr_finfo_t *finfo,
+                apr_int64_t budget)
+{
+  svn_fs_fs__file_mapping_t *result = svn_hash_gets(mappings, path);
+  apr_pool_t *pool;
+
+  *mapping = NULL;
+  if (result)
+    {
+      if (is_same_file(&result->finfo, finfo))
+        {
+          ++result->ref_count;
+          *mapping = result;
+          return SVN_NO_ERROR;
+        }
+
+      /* The file got replaced, e.g. by svn_fs_fs__load_index(). */
+      retire_mapping(result);
+    }
+
+  if (!make_room(finfo->size, budget))
+    return SVN_NO_ERROR;
+
+  /* Mappings get handed over between threads and outlive the revision
+   * file that created them.  So, they need their own root pool. */
+  pool = svn_pool_create(NULL);
+  result = apr_pcalloc(pool, sizeof(*result));
+  result->path = apr_pstrdup(pool, path);
+  result->finfo = *finfo;
+  result->ref_count = 1;
+  result->pool = pool;
+
+  /* Mapping is an optimization.  If it fails, we use the file as is.
+   * The mapping remains valid after FILE got closed. */
+  if (apr_mmap_create(&result->mmap, file, 0, (apr_size_t)finfo->size,
+                      APR_MMAP_READ, pool))
+    {
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+
+  svn_hash_sets(mappings, result->path, result);
+  mapped_size += result->mmap->size;
+
+  *mapping = result;
+  return SVN_NO_ERROR;
+}
+
+/* Drop a reference to MAPPING and destroy it if it has been retired and
+ * is no longer in use.  To be called with MAPPINGS_MUTEX held. */
+static svn_error_t *
+release_mapping(svn_fs_fs__file_mapping_t *mapping)
+{
+  if (--mapping->ref_count == 0 && mapping->retired)
+    retire_mapping(mapping);
+
+  return SVN_NO_ERROR;
+}
+
+/* APR pool cleanup callback taking a svn_fs_fs__revision_file_t baton.
+ * Release the mapping used by that file. */
+static apr_status_t
+unmap_revision_file(void *baton)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  svn_fs_fs__file_mapping_t *mapping = file->mapping;
+  apr_status_t status = APR_SUCCESS;
+  svn_error_t *err;
+
+  file->mmap = NULL;
+  file->mapping = NULL;
+
+  err = svn_mutex__lock(mappings_mutex);
+  if (!err)
+    err = svn_mutex__unlock(mappings_mutex, release_mapping(mapping));
+
+  if (err)
+    {
+      status = err->apr_err;
+      svn_error_clear(err);
+    }
+
+  return status;
+}
+
+/* Implements svn_read_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+read_handler_mapped(void *baton,
+                    char *buffer,
+                    apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = (apr_off_t)file->mmap->size - file->mmap_offset;
+
+  if (left < 0)
+    left = 0;
+  if ((apr_off_t)*len > left)
+    *len = (apr_size_t)left;
+
+  memcpy(buffer, (const char *)file->mmap->mm + file->mmap_offset, *len);
+  file->mmap_offset += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+skip_handler_mapped(void *baton,
+                    apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mmap_offset = MIN(file->mmap_offset + (apr_off_t)len,
+                          (apr_off_t)file->mmap->size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream__view_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+view_handler_mapped(void *baton,
+                    const char **data,
+                    apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = (apr_off_t)file->mmap->size - file->mmap_offset;
+
+  if (left < 0)
+    left = 0;
+  if ((apr_off_t)*len > left)
+    *len = (apr_size_t)left;
+
+  *data = (const char *)file->mmap->mm + file->mmap_offset;
+  file->mmap_offset += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* If FS has been configured to do so and the budget allows for it, read
+ * all data of the already opened FILE at PATH from a memory mapping of the
+ * whole file.  Otherwise, leave FILE untouched.  The mapping will be
+ * released when RESULT_POOL gets cleaned up. */
+static svn_error_t *
+auto_map_revision_file(svn_fs_fs__revision_file_t *file,
+                       svn_fs_t *fs,
+                       const char *path,
+                       apr_pool_t *result_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__file_mapping_t *mapping;
+  apr_finfo_t finfo;
+
+  if (ffd->mmap_budget <= 0 || !file->is_packed)
+    return SVN_NO_ERROR;
+
+  if (   !get_file_identity(&finfo, file->file)
+      || finfo.size <= 0
+      || finfo.size > APR_SIZE_MAX)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&mappings_initialized, init_mappings,
+                                NULL, result_pool));
+  SVN_MUTEX__WITH_LOCK(mappings_mutex,
+                       acquire_mapping(&mapping, path, file->file, &finfo,
+                                       ffd->mmap_budget));
+  if (!mapping)
+    return SVN_NO_ERROR;
+
+  file->mapping = mapping;
+  file->mmap = mapping->mmap;
+  file->mmap_offset = 0;
+  apr_pool_cleanup_register(result_pool, file, unmap_revision_file,
+                            apr_pool_cleanup_null);
+
+  file->stream = svn_stream_create(file, result_pool);
+  svn_stream_set_read2(file->stream, read_handler_mapped,
+                       read_handler_mapped);
+  svn_stream_set_skip(file->stream, skip_handler_mapped);
+  svn_stream__set_view(file->stream, view_handler_mapped);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +501,11 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Pack files are never modified in place, only replaced.
+           * So, we may read them from memory. */
+          if (!writable)
+            SVN_ERR(auto_map_revision_file(file, fs, path, result_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -237,22 +583,22 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      if (file->mmap)
+        filesize = (apr_off_t)file->mmap->size;
+      else
+        SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, filesize - 1));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length)));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1 - footer_length,
-                                       file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL,
+                                       filesize - 1 - footer_length));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length));
+      footer->len = footer_length;
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -293,6 +639,14 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
+  if (file->mmap)
+    {
+      apr_status_t status = apr_pool_cleanup_run(file->pool, file,
+                                                 unmap_revision_file);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap file"));
+    }
+
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
   if (file->file)
@@ -305,3 +659,158 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset)
+{
+  if (file->mmap)
+    {
+      /* There is no buffer to align. */
+      if (buffer_start)
+        *buffer_start = offset;
+
+      file->mmap_offset = offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file)
+{
+  if (file->mmap)
+    {
+      *offset = file->mmap_offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_view(const char **data,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_size_t nbytes)
+{
+  *data = NULL;
+  if (!file->mmap)
+    return SVN_NO_ERROR;
+
+  if (   file->mmap_offset < 0
+      || file->mmap_offset + (apr_off_t)nbytes
+           > (apr_off_t)file->mmap->size)
+    {
+      const char *file_name;
+      SVN_ERR(svn_io_file_name_get(&file_name, file->file, file->pool));
+      return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                               _("Unexpected end of file '%s'"),
+                               svn_dirent_local_style(file_name,
+                                                      file->pool));
+    }
+
+  *data = (const char *)file->mmap->mm + file->mmap_offset;
+  file->mmap_offset += nbytes;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes)
+{
+  if (file->mmap)
+    {
+      const char *data;
+      SVN_ERR(svn_fs_fs__rev_file_view(&data, file, nbytes));
+      memcpy(buf, data, nbytes);
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buf, nbytes,
+                                                NULL, NULL, file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_copy(svn_fs_fs__revision_file_t **copy,
+                         const char **copy_path,
+                         svn_fs_t *fs,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_off_t size,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  const char *file_name;
+  svn_fs_fs__revision_file_t *result;
+
+  SVN_ERR(svn_io_file_name_get(&file_name, file->file, scratch_pool));
+
+  result = apr_palloc(result_pool, sizeof(*result));
+  init_revision_file(result, fs, file->start_revision, result_pool);
+
+  /* The copy must be in the same folder as the original, so it can be
+   * moved into place atomically. */
+  SVN_ERR(svn_io_open_unique_file3(&result->file, copy_path,
+                                   svn_dirent_dirname(file_name,
+                                                      scratch_pool),
+                                   svn_io_file_del_on_pool_cleanup,
+                                   result_pool, scratch_pool));
+  result->stream = svn_stream_from_aprfile2(result->file, TRUE,
+                                            result_pool);
+
+  if (file->mmap)
+    {
+      SVN_ERR_ASSERT(size <= (apr_off_t)file->mmap->size);
+      SVN_ERR(svn_io_file_write_full(result->file, file->mmap->mm,
+                                     (apr_size_t)size, NULL, scratch_pool));
+    }
+  else
+    {
+      apr_size_t buffer_size = SVN__STREAM_CHUNK_SIZE;
+      char *buffer = apr_palloc(scratch_pool, buffer_size);
+      apr_off_t offset = 0;
+
+      SVN_ERR(svn_io_file_seek(file->file, APR_SET, &offset, scratch_pool));
+      while (offset < size)
+        {
+          apr_size_t to_copy = (apr_size_t)MIN(size - offset,
+                                               (apr_off_t)buffer_size);
+          SVN_ERR(svn_io_file_read_full2(file->file, buffer, to_copy,
+                                         NULL, NULL, scratch_pool));
+          SVN_ERR(svn_io_file_write_full(result->file, buffer, to_copy,
+                                         NULL, scratch_pool));
+          offset += to_copy;
+        }
+    }
+
+  *copy = result;
+  return SVN_NO_ERROR;
+}
+
+apr_int64_t
+svn_fs_fs__rev_file_mapped_size(void)
+{
+  apr_int64_t result = 0;
+  svn_error_t *err = svn_atomic__init_once(&mappings_initialized,
+                                           init_mappings, NULL, NULL);
+
+  if (!err)
+    err = svn_mutex__lock(mappings_mutex);
+  if (!err)
+    {
+      result = mapped_size;
+      err = svn_mutex__unlock(mappings_mutex, SVN_NO_ERROR);
+    }
+
+  svn_error_clear(err);
+  return result;
+}
@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -42,6 +44,11 @@ typedef struct svn_fs_fs__packed_number_stream_t
  * START_REVISION.  As the FILE is kept open, background pack operations
  * will not cause access to this file to fail.
  */
+/* A memory mapping of a pack file, shared between all
+ * svn_fs_fs__revision_file_t instances for that file in this process.
+ * Opaque, see rev_file.c. */
+typedef struct svn_fs_fs__file_mapping_t svn_fs_fs__file_mapping_t;
+
 typedef struct svn_fs_fs__revision_file_t
 {
   /* first (potentially only) revision in the rev / pack file.
@@ -57,6 +64,17 @@ typedef struct svn_fs_fs__revision_file_t
   /* stream based on FILE and not NULL exactly when FILE is not NULL */
   svn_stream_t *stream;
 
+  /* Read-only mapping of the whole FILE or NULL.  If set, STREAM and the
+   * svn_fs_fs__rev_file_* access functions read from it and FILE's own
+   * read position becomes meaningless.  Only ever set for pack files. */
+  apr_mmap_t *mmap;
+
+  /* The shared mapping that MMAP belongs to.  NULL if MMAP is NULL. */
+  svn_fs_fs__file_mapping_t *mapping;
+
+  /* Current read position within MMAP.  Unused if MMAP is NULL. */
+  apr_off_t mmap_offset;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -142,4 +160,55 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file);
 
+/* File access.  Data in FILE must be read through these functions or
+ * FILE->STREAM, so the data gets taken from the memory mapping if there
+ * is one. */
+
+/* Convenience wrapper around svn_io_file_aligned_seek. */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset);
+
+/* Convenience wrapper around svn_io_file_get_offset. */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file);
+
+/* Convenience wrapper around svn_io_file_read_full2. */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes);
+
+/* If FILE is memory-mapped, set *DATA to the next NBYTES of FILE's data,
+ * pointing directly into the mapping, and advance the read position.
+ * Otherwise, set *DATA to NULL and leave FILE untouched.  The data remains
+ * valid until FILE gets closed. */
+svn_error_t *
+svn_fs_fs__rev_file_view(const char **data,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_size_t nbytes);
+
+/* Copy the first SIZE bytes of FILE in FS into a new temporary file next
+ * to it.  Return the new file, opened for reading and writing and
+ * positioned at its end, in *COPY and its path in *COPY_PATH.  *COPY has
+ * the same start revision as FILE and will be deleted when RESULT_POOL
+ * gets cleaned up, unless it has been moved into place before.  Use
+ * SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_copy(svn_fs_fs__revision_file_t **copy,
+                         const char **copy_path,
+                         svn_fs_t *fs,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_off_t size,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
+/* Return the size of the mapped memory of all FSFS rev / pack files in
+ * this process, in bytes.  This includes mappings that are currently
+ * unused but kept for later reuse. */
+apr_int64_t
+svn_fs_fs__rev_file_mapped_size(void);
+
 #endif
@@ -462,8 +462,8 @@ parse_representation(rep_stats_t **representation,
                            + (apr_off_t)rep->item_index;
 
           SVN_ERR_ASSERT(revision_info->rev_file);
-          SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                                   &offset, scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL,
+                                           offset));
           SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
@@ -530,8 +530,7 @@ read_phsy_noderev(svn_stringbuf_t **noderev,
   SVN_ERR_ASSERT(revision_info->rev_file);
 
   offset += revision_info->offset;
-  SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                           &offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL, offset));
 
   /* Read it (terminated by an empty line) */
   do
@@ -727,10 +726,8 @@ read_phys_revision(query_t *query,
   /* Read the last 64 bytes of the revision (if long enough). */
   apr_off_t start = MAX(info->offset, info->end - sizeof(buf));
   apr_size_t len = (apr_size_t)(info->end - start);
-  SVN_ERR(svn_io_file_seek(info->rev_file->file, APR_SET, &start,
-                           scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(info->rev_file->file, buf, len, NULL, NULL,
-                                 scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(info->rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(info->rev_file, buf, len));
   trailer = svn_stringbuf_ncreate(buf, len, scratch_pool);
 
   /* Parse that trailer. */
@@ -914,10 +911,8 @@ read_item(svn_stringbuf_t **contents,
   item->len = entry->size;
   item->data[item->len] = 0;
 
-  SVN_ERR(svn_io_file_aligned_seek(rev_file->file, rev_file->block_size,
-                                   NULL, entry->offset, scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, item->data, item->len,
-                                 NULL, NULL, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, entry->offset));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, item->data, item->len));
 
   *contents = item;
 
@@ -1094,10 +1089,8 @@ read_log_rev_or_packfile(query_t *query,
               svn_fs_fs__rep_header_t *header;
               rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
 
-              SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
-                                               rev_file->block_size,
-                                               NULL, entry->offset,
-                                               iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL,
+                                               entry->offset));
               SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                                  rev_file->stream,
                                                  iterpool, iterpool));
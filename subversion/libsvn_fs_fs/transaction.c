@@ -43,6 +43,7 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -1917,6 +1918,16 @@ struct rep_write_baton
      deltified, then eventually written to rep_stream. */
   svn_stream_t *delta_stream;
 
+  /* The delta base contents and the rep they come from (NULL for the
+     empty stream).  Only needed until DELTA_STREAM has been created. */
+  svn_stream_t *source;
+  representation_t *base_rep;
+
+  /* If not NULL, the window size has not been chosen yet and all data
+     received so far is kept here.  Nothing has been written for this
+     rep, then, not even its header. */
+  svn_stringbuf_t *pending;
+
   /* Where is this representation header stored. */
   apr_off_t rep_offset;
 
@@ -1948,6 +1959,14 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+/* Files larger than this get delta windows of this size, unless their
+   delta base requires otherwise.  Smaller files use the standard size. */
+#define LARGE_FILE_WINDOW_SIZE SVN_DELTA__MAX_WINDOW_SIZE
+
+static svn_error_t *
+rep_write_start_delta(struct rep_write_baton *b,
+                      apr_size_t window_size);
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1962,6 +1981,18 @@ rep_write_contents(void *baton,
   SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Large files get large delta windows.  Until we know, keep the data. */
+  if (b->pending)
+    {
+      if (b->rep_size <= LARGE_FILE_WINDOW_SIZE)
+        {
+          svn_stringbuf_appendbytes(b->pending, data, *len);
+          return SVN_NO_ERROR;
+        }
+
+      SVN_ERR(rep_write_start_delta(b, LARGE_FILE_WINDOW_SIZE));
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2159,17 +2190,27 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
-static void
+/* Set *HANDLER and *HANDLER_BATON to a window handler that writes svndiff
+   data to OUTPUT, using the compression configured for FS.  Allow up to
+   MAX_THREADS threads to compress windows concurrently.  Allocate the
+   handler in POOL. */
+static svn_error_t *
 txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    void **handler_baton,
                    svn_stream_t *output,
                    svn_fs_t *fs,
+                   int max_threads,
                    apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->delta_compression_type == compression_type_zstd)
+    {
+      SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2184,8 +2225,67 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
       svndiff_version = 0;
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  return svn_error_trace(
+           svn_txdelta__to_svndiff_parallel(handler, handler_baton, output,
+                                            svndiff_version,
+                                            ffd->delta_compression_level,
+                                            max_threads, pool));
+}
+
+/* Write the representation header for B and prepare B->DELTA_STREAM for
+   the svndiff data, using delta windows of WINDOW_SIZE bytes or the
+   standard size if that is 0.  Then, send any pending data through it. */
+static svn_error_t *
+rep_write_start_delta(struct rep_write_baton *b,
+                      apr_size_t window_size)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+
+  /* Write out the rep header. */
+  if (b->base_rep)
+    {
+      header.base_revision = b->base_rep->revision;
+      header.base_item_index = b->base_rep->item_index;
+      header.base_length = b->base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  header.window_size = window_size;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  SVN_ERR(txdelta_to_svndiff(&wh, &whb, b->rep_stream, b->fs,
+                             ffd->delta_compression_threads,
+                             b->result_pool));
+
+  if (window_size)
+    b->delta_stream = svn_txdelta__target_push(wh, whb, b->source,
+                                               window_size, b->scratch_pool);
+  else
+    b->delta_stream = svn_txdelta_target_push(wh, whb, b->source,
+                                              b->scratch_pool);
+
+  if (b->pending)
+    {
+      svn_stringbuf_t *pending = b->pending;
+      b->pending = NULL;
+
+      SVN_ERR(svn_stream_write(b->delta_stream, pending->data,
+                               &pending->len));
+    }
+
+  return SVN_NO_ERROR;
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2198,13 +2298,11 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
   representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
+  apr_size_t window_size = 0;
 
   b = apr_pcalloc(pool, sizeof(*b));
 
@@ -2232,37 +2330,25 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   /* Get the base for this delta. */
   SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
+  SVN_ERR(svn_fs_fs__get_contents(&b->source, fs, base_rep, TRUE,
                                   b->scratch_pool));
-
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
-    }
-  else
-    {
-      header.type = svn_fs_fs__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
+  b->base_rep = base_rep;
 
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
+  /* Deltas must use the same window size as their base because the reader
+     combines the windows of a delta chain chunk by chunk.  Without a base,
+     we may pick the size once we know whether the file is large. */
+  if (base_rep)
+    SVN_ERR(svn_fs_fs__rep_window_size(&window_size, base_rep, fs,
+                                       b->scratch_pool));
+  else if (ffd->format >= SVN_FS_FS__MIN_DELTA_WINDOW_SIZE_FORMAT)
+    b->pending = svn_stringbuf_create_empty(b->scratch_pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  if (!b->pending)
+    SVN_ERR(rep_write_start_delta(b, window_size));
 
   *wb_p = b;
 
@@ -2520,6 +2606,10 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Small files keep the standard window size. */
+  if (b->pending)
+    SVN_ERR(rep_write_start_delta(b, 0));
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2947,7 +3037,8 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
+  SVN_ERR(txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, 1,
+                             scratch_pool));
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
@@ -3732,6 +3823,7 @@ struct commit_baton {
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
+  svn_boolean_t filter_commit_started;
 };
 
 /* The work-horse for svn_fs_fs__commit, called with the FS write lock.
@@ -3912,6 +4004,14 @@ commit_body(void *baton, apr_pool_t *pool)
       SVN_ERR(verify_before_commit(cb->fs, new_rev, pool));
     }
 
+  /* Other processes must not rebuild their rep-cache filter before our
+     rep-cache entries are in the database. */
+  if (cb->reps_to_cache)
+    {
+      SVN_ERR(svn_fs_fs__begin_rep_cache_filter_commit(cb->fs, pool));
+      cb->filter_commit_started = TRUE;
+    }
+
   /* Update the 'current' file. */
   SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
                               start_copy_id, pool));
@@ -3954,6 +4054,49 @@ write_reps_to_cache(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Add the representations in REPS_TO_CACHE (an array of representation_t *)
+ * of the new revision NEW_REV to the rep-cache database of FS and let
+ * the rep-cache filter know about them. */
+static svn_error_t *
+add_reps_to_cache(svn_fs_t *fs,
+                  svn_revnum_t new_rev,
+                  const apr_array_header_t *reps_to_cache,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  /* Write new entries to the rep-sharing database.
+   *
+   * We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>.
+   */
+  /* ### A commit that touches thousands of files will starve other
+         (reader/writer) commits for the duration of the below call.
+         Maybe write in batches? */
+  SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
+  err = write_reps_to_cache(fs, reps_to_cache, scratch_pool);
+  err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+
+  if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+    {
+      /* Failed rollback means that our db connection is unusable, and
+         the only thing we can do is close it.  The connection will be
+         reopened during the next operation with rep-cache.db. */
+      return svn_error_trace(
+          svn_error_compose_create(err,
+                                   svn_fs_fs__close_rep_cache(fs)));
+    }
+  else if (err)
+    return svn_error_trace(err);
+
+  /* Let the rep-cache filter know that it covers the new revision. */
+  return svn_error_trace(svn_fs_fs__update_rep_cache_filter(fs, new_rev,
+                                                            scratch_pool));
+}
+
 svn_error_t *
 svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_t *fs,
@@ -3962,6 +4105,7 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
 {
   struct commit_baton cb;
   fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
 
   cb.new_rev_p = new_rev_p;
   cb.fs = fs;
@@ -3980,43 +4124,22 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
       cb.reps_pool = NULL;
     }
 
-  SVN_ERR(svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool));
+  cb.filter_commit_started = FALSE;
 
-  /* At this point, *NEW_REV_P has been set, so errors below won't affect
-     the success of the commit.  (See svn_fs_commit_txn().)  */
+  err = svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool);
 
-  if (ffd->rep_sharing_allowed)
-    {
-      svn_error_t *err;
+  /* Unless that failed, *NEW_REV_P has been set, so errors below won't
+     affect the success of the commit.  (See svn_fs_commit_txn().)  */
 
-      SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  if (!err && ffd->rep_sharing_allowed)
+    err = add_reps_to_cache(fs, *new_rev_p, cb.reps_to_cache, pool);
 
-      /* Write new entries to the rep-sharing database.
-       *
-       * We use an sqlite transaction to speed things up;
-       * see <http://www.sqlite.org/faq.html#q19>.
-       */
-      /* ### A commit that touches thousands of files will starve other
-             (reader/writer) commits for the duration of the below call.
-             Maybe write in batches? */
-      SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
-      err = write_reps_to_cache(fs, cb.reps_to_cache, pool);
-      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
-
-      if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
-        {
-          /* Failed rollback means that our db connection is unusable, and
-             the only thing we can do is close it.  The connection will be
-             reopened during the next operation with rep-cache.db. */
-          return svn_error_trace(
-              svn_error_compose_create(err,
-                                       svn_fs_fs__close_rep_cache(fs)));
-        }
-      else if (err)
-        return svn_error_trace(err);
-    }
+  if (cb.filter_commit_started)
+    err = svn_error_compose_create(err,
+                                   svn_fs_fs__end_rep_cache_filter_commit(
+                                     fs, pool));
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(err);
 }
 
 
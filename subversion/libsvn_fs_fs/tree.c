@@ -2359,7 +2359,7 @@ svn_fs_fs__commit_txn(const char **conflict_p,
 
   if (ffd->pack_after_commit)
     {
-      SVN_ERR(svn_fs_fs__pack(fs, 0, NULL, NULL, NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__pack(fs, 0, 1, NULL, NULL, NULL, NULL, pool));
     }
 
   return SVN_NO_ERROR;
@@ -4643,7 +4643,7 @@ make_txn_root(svn_fs_root_t **root_p,
                                       svn_fs_fs__dag_serialize,
                                       svn_fs_fs__dag_deserialize,
                                       APR_HASH_KEY_STRING,
-                                      32, 20, FALSE,
+                                      32, 20, 0, FALSE,
                                       apr_pstrcat(pool, txn, ":TXN",
                                                   SVN_VA_NULL),
                                       root->pool));
@@ -23,6 +23,7 @@
 #include "svn_sorts.h"
 #include "svn_checksum.h"
 #include "svn_time.h"
+#include "private/svn_parallel.h"
 #include "private/svn_subr_private.h"
 
 #include "verify.h"
@@ -884,10 +885,219 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by the verify_*_job() and verify_*_done() functions
+ * when running verification on multiple threads.  Job number I covers
+ * the revisions that verify_chunk_range() returns for it.
+ */
+typedef struct verify_jobs_baton_t
+{
+  /* the filesystem being verified;
+     workers only use it to open their own clones */
+  svn_fs_t *fs;
+
+  /* the overall range of revisions to verify */
+  svn_revnum_t start;
+  svn_revnum_t end;
+
+  /* number of revisions per job, aligned to shards */
+  svn_revnum_t chunk_size;
+
+  /* progress notification as passed to svn_fs_fs__verify() */
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+
+  /* cancellation as passed to svn_fs_fs__verify() */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_jobs_baton_t;
+
+/* Set *CHUNK_START and *CHUNK_END to the first and last revision that
+ * job number INDEX within BATON shall verify. */
+static void
+verify_chunk_range(svn_revnum_t *chunk_start,
+                   svn_revnum_t *chunk_end,
+                   verify_jobs_baton_t *baton,
+                   int index)
+{
+  svn_revnum_t base = baton->start - baton->start % baton->chunk_size;
+
+  *chunk_start = MAX(baton->start, base + index * baton->chunk_size);
+  *chunk_end = MIN(baton->end, base + (index + 1) * baton->chunk_size - 1);
+}
+
+/* Implements svn_parallel__job_func_t.
+ * Check the metadata of job INDEX's revision range in BATON. */
+static svn_error_t *
+verify_f7_metadata_job(void *baton,
+                       int index,
+                       apr_pool_t *pool)
+{
+  verify_jobs_baton_t *jobs_baton = baton;
+  svn_revnum_t chunk_start, chunk_end;
+  svn_fs_t *fs;
+
+  verify_chunk_range(&chunk_start, &chunk_end, jobs_baton, index);
+  SVN_ERR(svn_fs_fs__open_clone(&fs, jobs_baton->fs, pool, pool));
+
+  return svn_error_trace(verify_f7_metadata_consistency(
+                           fs, chunk_start, chunk_end, NULL, NULL,
+                           jobs_baton->cancel_func, jobs_baton->cancel_baton,
+                           pool));
+}
+
+/* Implements svn_parallel__job_done_t.
+ * Report progress for the revision range of job INDEX in BATON and
+ * return JOB_ERR. */
+static svn_error_t *
+verify_f7_metadata_done(void *baton,
+                        int index,
+                        svn_error_t *job_err,
+                        apr_pool_t *pool)
+{
+  verify_jobs_baton_t *jobs_baton = baton;
+  fs_fs_data_t *ffd = jobs_baton->fs->fsap_data;
+  svn_revnum_t chunk_start, chunk_end;
+
+  SVN_ERR(job_err);
+
+  verify_chunk_range(&chunk_start, &chunk_end, jobs_baton, index);
+  if (   jobs_baton->notify_func
+      && (   ffd->max_files_per_dir == 0
+          || chunk_start % ffd->max_files_per_dir == 0))
+    jobs_baton->notify_func(chunk_start, jobs_baton->notify_baton, pool);
+
+  if (jobs_baton->cancel_func)
+    SVN_ERR(jobs_baton->cancel_func(jobs_baton->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_parallel__job_func_t.
+ * Check the rep-cache entries of job INDEX's revision range in BATON. */
+static svn_error_t *
+verify_rep_cache_job(void *baton,
+                     int index,
+                     apr_pool_t *pool)
+{
+  verify_jobs_baton_t *jobs_baton = baton;
+  verify_walker_baton_t *walker_baton;
+  svn_revnum_t chunk_start, chunk_end;
+  svn_fs_t *fs;
+
+  verify_chunk_range(&chunk_start, &chunk_end, jobs_baton, index);
+  SVN_ERR(svn_fs_fs__open_clone(&fs, jobs_baton->fs, pool, pool));
+
+  walker_baton = apr_pcalloc(pool, sizeof(*walker_baton));
+  walker_baton->pool = svn_pool_create(pool);
+  walker_baton->last_notified_revision = SVN_INVALID_REVNUM;
+
+  SVN_ERR(svn_fs_fs__walk_rep_reference(fs, chunk_start, chunk_end,
+                                        verify_walker, walker_baton,
+                                        jobs_baton->cancel_func,
+                                        jobs_baton->cancel_baton,
+                                        pool));
+
+  /* Close the rep-cache DB and any open rev / pack files. */
+  svn_pool_destroy(walker_baton->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_parallel__job_done_t.
+ * Report progress for the revision range of job INDEX in BATON and
+ * return JOB_ERR.  The initial notification already covers the first
+ * job. */
+static svn_error_t *
+verify_rep_cache_done(void *baton,
+                      int index,
+                      svn_error_t *job_err,
+                      apr_pool_t *pool)
+{
+  verify_jobs_baton_t *jobs_baton = baton;
+  svn_revnum_t chunk_start, chunk_end;
+
+  SVN_ERR(job_err);
+
+  verify_chunk_range(&chunk_start, &chunk_end, jobs_baton, index);
+  if (jobs_baton->notify_func && index > 0)
+    jobs_baton->notify_func(chunk_start, jobs_baton->notify_baton, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run verification of FS for revisions START to END on up to MAX_THREADS
+ * threads.  Each thread uses its own clone of FS and handles a shard-
+ * aligned range of revisions at a time.  The remaining parameters are
+ * the same as for svn_fs_fs__verify.
+ *
+ * The values of START and END have already been auto-selected and
+ * verified.
+ */
+static svn_error_t *
+verify_parallel(svn_fs_t *fs,
+                svn_revnum_t start,
+                svn_revnum_t end,
+                int max_threads,
+                svn_fs_progress_notify_func_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  verify_jobs_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+  int job_count;
+
+  baton->fs = fs;
+  baton->start = start;
+  baton->end = end;
+  baton->chunk_size = ffd->max_files_per_dir ? ffd->max_files_per_dir
+                                              : 1000;
+  baton->notify_func = notify_func;
+  baton->notify_baton = notify_baton;
+  baton->cancel_func = cancel_func;
+  baton->cancel_baton = cancel_baton;
+
+  job_count = (int)(end / baton->chunk_size - start / baton->chunk_size + 1);
+
+  /* log/phys index consistency.  We need to check them first to make
+     sure we can access the rev / pack files in format7. */
+  if (svn_fs_fs__use_log_addressing(fs))
+    SVN_ERR(svn_parallel__run_jobs(job_count, max_threads,
+                                   verify_f7_metadata_job,
+                                   verify_f7_metadata_done,
+                                   baton, pool));
+
+  /* rep cache consistency */
+  if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    {
+      svn_boolean_t exists;
+
+      /* Do not attempt to walk the rep-cache database if its file does
+         not exist,  since doing so would create it --- which may confuse
+         the administrator. */
+      SVN_ERR(svn_fs_fs__exists_rep_cache(&exists, fs, pool));
+      if (exists)
+        {
+          /* tell the user that we are now ready to do *something* */
+          if (notify_func)
+            notify_func(SVN_INVALID_REVNUM, notify_baton, pool);
+
+          SVN_ERR(svn_parallel__run_jobs(job_count, max_threads,
+                                         verify_rep_cache_job,
+                                         verify_rep_cache_done,
+                                         baton, pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__verify(svn_fs_t *fs,
                   svn_revnum_t start,
                   svn_revnum_t end,
+                  int max_threads,
                   svn_fs_progress_notify_func_t notify_func,
                   void *notify_baton,
                   svn_cancel_func_t cancel_func,
@@ -907,6 +1117,12 @@ svn_fs_fs__verify(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__ensure_revision_exists(start, fs, pool));
   SVN_ERR(svn_fs_fs__ensure_revision_exists(end, fs, pool));
 
+  if (max_threads > 1 && end > start)
+    return svn_error_trace(verify_parallel(fs, start, end, max_threads,
+                                           notify_func, notify_baton,
+                                           cancel_func, cancel_baton,
+                                           pool));
+
   /* log/phys index consistency.  We need to check them first to make
      sure we can access the rev / pack files in format7. */
   if (svn_fs_fs__use_log_addressing(fs))
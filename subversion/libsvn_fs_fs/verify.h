@@ -26,13 +26,16 @@
 #include "fs.h"
 
 /* Verify metadata in fsfs filesystem FS.  Limit the checks to revisions
- * START to END where possible.  Indicate progress via the optional
- * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
- * will periodically be called with CANCEL_BATON to allow for preemption.
- * Use POOL for temporary allocations. */
+ * START to END where possible.  Use up to MAX_THREADS threads to check
+ * independent shards concurrently.  Indicate progress via the optional
+ * NOTIFY_FUNC callback using NOTIFY_BATON; it will only be called from
+ * the current thread.  The optional CANCEL_FUNC will periodically be
+ * called with CANCEL_BATON, possibly from other threads, to allow for
+ * preemption.  Use POOL for temporary allocations. */
 svn_error_t *svn_fs_fs__verify(svn_fs_t *fs,
                                svn_revnum_t start,
                                svn_revnum_t end,
+                               int max_threads,
                                svn_fs_progress_notify_func_t notify_func,
                                void *notify_baton,
                                svn_cancel_func_t cancel_func,
@@ -28,6 +28,7 @@
 #include "svn_ctype.h"
 #include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -1425,6 +1426,41 @@ read_container_window(svn_stringbuf_t **nwin,
   return SVN_NO_ERROR;
 }
 
+/* Delta chains whose windows have no more than this many ops in total
+   get composed into a single window before expanding it.  Beyond that,
+   the composition tends to get more expensive than expanding every
+   window on its own. */
+#define MAX_COMPOSED_OPS 256
+
+/* Return TRUE if the delta WINDOWS read for RB's current chunk shall be
+   composed into a single window instead of being expanded one by one.
+   WINDOWS[I] belongs to the I-th rep state in RB->RS_LIST. */
+static svn_boolean_t
+compose_window_chain_p(rep_read_baton_t *rb,
+                       const apr_array_header_t *windows)
+{
+  int total_ops = 0;
+  int i;
+
+  for (i = 0; i < windows->nelts; ++i)
+    {
+      const svn_txdelta_window_t *window
+        = APR_ARRAY_IDX(windows, i, const svn_txdelta_window_t *);
+      rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+
+      /* Composition skips the intermediate fulltexts.  Don't do that if
+         get_combined_window() would put them into the cache. */
+      if (   i > 0 && rs->combined_cache && rb->chunk_index == 0
+          && rs->current == rs->size
+          && svn_fs_x__is_revision(rs->rep_id.change_set))
+        return FALSE;
+
+      total_ops += window->num_ops;
+    }
+
+  return total_ops <= MAX_COMPOSED_OPS;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1464,6 +1500,21 @@ get_combined_window(svn_stringbuf_t **result,
         }
     }
 
+  /* Replace the whole chain with a single window, if that is cheaper.
+     The loop below will then only expand that one. */
+  if (i > 1 && compose_window_chain_p(rb, windows))
+    {
+      svn_txdelta_window_t *composite
+        = svn_txdelta__compose_window_chain(windows, window_pool, iterpool);
+
+      /* The intermediate reps are done with the current chunk. */
+      for (--i; i > 0; --i)
+        APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *)->chunk_index++;
+
+      APR_ARRAY_IDX(windows, 0, svn_txdelta_window_t *) = composite;
+      i = 1;
+    }
+
   /* Combine in the windows from the other delta reps. */
   pool = svn_pool_create(rb->scratch_pool);
   for (--i; i >= 0; --i)
@@ -361,7 +361,7 @@ create_cache(svn_cache__t **cache_p,
     {
       SVN_ERR(svn_cache__create_inprocess(
                 cache_p, serializer, deserializer, klen, pages,
-                items_per_page, FALSE, prefix, result_pool));
+                items_per_page, 0, FALSE, prefix, result_pool));
     }
   else
     {
@@ -262,6 +262,7 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  apr_int64_t compression_threads;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -288,6 +289,10 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->delta_compression_level
     = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                 SVN_DELTA_COMPRESSION_LEVEL_MAX);
+  SVN_ERR(svn_config_get_int64(config, &compression_threads,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_COMPRESSION_THREADS, 1));
+  ffd->delta_compression_threads = (int)MIN(MAX(1, compression_threads), 64);
 
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
@@ -457,6 +462,14 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Compressing large files can be CPU bound.  This setting allows up to"   NL
+"### that many threads to compress consecutive parts of a file at the same"  NL
+"### time.  The result is identical to single-threaded compression.  Values" NL
+"### greater than 1 are only useful for repositories that receive large"     NL
+"### files and on servers with idle CPU cores.  Platforms without thread"    NL
+"### support will ignore this option.  The default is 1."                    NL
+"# " CONFIG_OPTION_COMPRESSION_THREADS " = 1"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
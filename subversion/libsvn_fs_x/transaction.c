@@ -45,6 +45,7 @@
 #include "batch_fsync.h"
 #include "revprops.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -2309,12 +2310,14 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
                             apr_pool_cleanup_null);
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
-                          &whb,
-                          svn_stream_disown(b->rep_stream, b->result_pool),
-                          diff_version,
-                          ffd->delta_compression_level,
-                          result_pool);
+  SVN_ERR(svn_txdelta__to_svndiff_parallel(&wh,
+                                           &whb,
+                                           svn_stream_disown(b->rep_stream,
+                                                             b->result_pool),
+                                           diff_version,
+                                           ffd->delta_compression_level,
+                                           ffd->delta_compression_threads,
+                                           result_pool));
 
   b->delta_stream = svn_txdelta_target_push(wh, whb, source,
                                             b->result_pool);
@@ -476,6 +476,19 @@ pack_notify_wrapper_func(void *baton,
                                     notify->action - 3, scratch_pool));
 }
 
+svn_error_t *
+svn_repos_fs_pack2(svn_repos_t *repos,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos_fs_pack3(repos, 1, notify_func,
+                                            notify_baton, cancel_func,
+                                            cancel_baton, pool));
+}
+
 svn_error_t *
 svn_repos_fs_pack(svn_repos_t *repos,
                   svn_fs_pack_notify_t notify_func,
@@ -489,7 +502,7 @@ svn_repos_fs_pack(svn_repos_t *repos,
   pnwb.notify_func = notify_func;
   pnwb.notify_baton = notify_baton;
 
-  return svn_repos_fs_pack2(repos, pack_notify_wrapper_func, &pnwb,
+  return svn_repos_fs_pack3(repos, 1, pack_notify_wrapper_func, &pnwb,
                             cancel_func, cancel_baton, pool);
 }
 
@@ -855,6 +868,35 @@ svn_repos_dump_fs2(svn_repos_t *repos,
                                             pool));
 }
 
+svn_error_t *
+svn_repos_verify_fs3(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos_verify_fs4(repos,
+                                              start_rev,
+                                              end_rev,
+                                              check_normalization,
+                                              metadata_only,
+                                              1,
+                                              notify_func,
+                                              notify_baton,
+                                              verify_callback,
+                                              verify_baton,
+                                              cancel_func,
+                                              cancel_baton,
+                                              pool));
+}
+
 svn_error_t *
 svn_repos_verify_fs2(svn_repos_t *repos,
                      svn_revnum_t start_rev,
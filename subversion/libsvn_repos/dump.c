@@ -45,6 +45,8 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_mutex.h"
+#include "private/svn_parallel.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -2459,12 +2461,311 @@ report_error(svn_revnum_t revision,
     }
 }
 
+/* Number of revisions that a single job of verify_revisions_job() will
+   check.  Small enough to keep the buffered notifications in check. */
+#define REVS_PER_VERIFY_JOB 16
+
+/* Result of verifying a single revision on a worker thread. */
+typedef struct verify_rev_result_t
+{
+  /* Notifications sent while verifying the revision, in order.
+     Elements are svn_repos_notify_t *.  NULL if not verified at all. */
+  apr_array_header_t *notifications;
+
+  /* Verification error or SVN_NO_ERROR. */
+  svn_error_t *err;
+} verify_rev_result_t;
+
+/* An svn_fs_t instance used by verify_revisions_job().  Instances get
+   reused across jobs, so there is at most one per concurrent job. */
+typedef struct verify_fs_t
+{
+  svn_fs_t *fs;
+
+  /* Root pool owning FS and this struct.  Jobs on different threads
+     use it in turn, never concurrently. */
+  apr_pool_t *pool;
+
+  /* Next entry in the list of idle instances. */
+  struct verify_fs_t *next;
+} verify_fs_t;
+
+/* Baton type used by verify_revisions_job() and verify_revisions_done().
+   Job number I verifies up to REVS_PER_VERIFY_JOB revisions, starting
+   at START_REV + I * REVS_PER_VERIFY_JOB. */
+typedef struct verify_revisions_baton_t
+{
+  /* How to open the filesystem to verify.  Concurrent jobs use
+     separate svn_fs_t instances. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Instances not currently used by any job.  Protected by MUTEX. */
+  verify_fs_t *idle_fs;
+  svn_mutex__t *mutex;
+
+  /* Parameters as passed to svn_repos_verify_fs4(). */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t check_normalization;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Array of per-revision results for each job, indexed by job number.
+     Each job fills in its own entry only. */
+  verify_rev_result_t **results;
+} verify_revisions_baton_t;
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+   apr_array_header_t BATON, allocated in the array's pool. */
+static void
+buffer_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(notifications->pool, notify,
+                                         sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(notifications->pool, notify->warning_str);
+  copy->path = apr_pstrdup(notifications->pool, notify->path);
+
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Set *FIRST and *LAST to the range of revisions verified by job number
+   INDEX in BATON. */
+static void
+verify_job_range(svn_revnum_t *first,
+                 svn_revnum_t *last,
+                 verify_revisions_baton_t *baton,
+                 int index)
+{
+  *first = baton->start_rev + (svn_revnum_t)index * REVS_PER_VERIFY_JOB;
+  *last = MIN(baton->end_rev, *first + REVS_PER_VERIFY_JOB - 1);
+}
+
+/* Take the first entry from the list of idle instances in BATON and
+   return it in *RESULT.  Open a new instance if there is none. */
+static svn_error_t *
+acquire_verify_fs(verify_fs_t **result,
+                  verify_revisions_baton_t *baton)
+{
+  verify_fs_t *entry;
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  SVN_ERR(svn_mutex__lock(baton->mutex));
+  entry = baton->idle_fs;
+  if (entry)
+    baton->idle_fs = entry->next;
+  SVN_ERR(svn_mutex__unlock(baton->mutex, SVN_NO_ERROR));
+
+  if (entry)
+    {
+      *result = entry;
+      return SVN_NO_ERROR;
+    }
+
+  /* Instances move between threads, so they need their own root pool. */
+  pool = svn_pool_create(NULL);
+  entry = apr_pcalloc(pool, sizeof(*entry));
+  entry->pool = pool;
+
+  err = svn_fs_open2(&entry->fs, baton->fs_path, baton->fs_config,
+                     pool, pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  *result = entry;
+  return SVN_NO_ERROR;
+}
+
+/* Return ENTRY to the list of idle instances in BATON. */
+static svn_error_t *
+release_verify_fs(verify_revisions_baton_t *baton,
+                  verify_fs_t *entry)
+{
+  SVN_ERR(svn_mutex__lock(baton->mutex));
+  entry->next = baton->idle_fs;
+  baton->idle_fs = entry;
+  SVN_ERR(svn_mutex__unlock(baton->mutex, SVN_NO_ERROR));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_parallel__job_func_t.  Verify the revisions of job
+   number INDEX in the verify_revisions_baton_t BATON, recording errors
+   and notifications instead of reporting them. */
+static svn_error_t *
+verify_revisions_job(void *baton,
+                     int index,
+                     apr_pool_t *pool)
+{
+  verify_revisions_baton_t *vb = baton;
+  verify_rev_result_t *results;
+  svn_revnum_t first, last, rev;
+  apr_pool_t *iterpool;
+  verify_fs_t *entry;
+
+  verify_job_range(&first, &last, vb, index);
+  results = apr_pcalloc(pool, (last - first + 1) * sizeof(*results));
+  vb->results[index] = results;
+
+  SVN_ERR(acquire_verify_fs(&entry, vb));
+
+  iterpool = svn_pool_create(pool);
+  for (rev = first; rev <= last; rev++)
+    {
+      verify_rev_result_t *result = &results[rev - first];
+
+      svn_pool_clear(iterpool);
+
+      result->notifications = apr_array_make(pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+      result->err = verify_one_revision(entry->fs, rev,
+                                        vb->notify_func
+                                          ? buffer_notification
+                                          : NULL,
+                                        result->notifications,
+                                        vb->start_rev,
+                                        vb->check_normalization,
+                                        vb->cancel_func, vb->cancel_baton,
+                                        iterpool);
+
+      /* Don't bother with the remaining revisions. */
+      if (result->err && result->err->apr_err == SVN_ERR_CANCELLED)
+        break;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(release_verify_fs(vb, entry));
+}
+
+/* Implements svn_parallel__job_done_t.  Report the results of job number
+   INDEX in the verify_revisions_baton_t BATON in the same way as a
+   serial verification run would. */
+static svn_error_t *
+verify_revisions_done(void *baton,
+                      int index,
+                      svn_error_t *job_err,
+                      apr_pool_t *pool)
+{
+  verify_revisions_baton_t *vb = baton;
+  verify_rev_result_t *results = vb->results[index];
+  svn_revnum_t first, last, rev;
+  svn_error_t *err = job_err;
+
+  verify_job_range(&first, &last, vb, index);
+  for (rev = first; rev <= last; rev++)
+    {
+      verify_rev_result_t *result = &results[rev - first];
+      int i;
+
+      /* Discard everything after a fatal error. */
+      if (err)
+        {
+          svn_error_clear(result->err);
+          continue;
+        }
+
+      if (vb->notify_func && result->notifications)
+        for (i = 0; i < result->notifications->nelts; i++)
+          vb->notify_func(vb->notify_baton,
+                          APR_ARRAY_IDX(result->notifications, i,
+                                        svn_repos_notify_t *),
+                          pool);
+
+      if (result->err && result->err->apr_err == SVN_ERR_CANCELLED)
+        {
+          err = result->err;
+        }
+      else if (result->err)
+        {
+          err = report_error(rev, result->err, vb->verify_callback,
+                             vb->verify_baton, pool);
+        }
+      else if (vb->notify_func)
+        {
+          /* Tell the caller that we're done with this revision. */
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_verify_rev_end, pool);
+          notify->revision = rev;
+          vb->notify_func(vb->notify_baton, notify, pool);
+        }
+    }
+
+  if (!err && vb->cancel_func)
+    err = vb->cancel_func(vb->cancel_baton);
+
+  return svn_error_trace(err);
+}
+
+/* Verify revisions START_REV to END_REV of FS on up to JOBS threads.
+   The remaining parameters are the same as for svn_repos_verify_fs4(). */
+static svn_error_t *
+verify_revisions_parallel(svn_fs_t *fs,
+                          svn_revnum_t start_rev,
+                          svn_revnum_t end_rev,
+                          svn_boolean_t check_normalization,
+                          int jobs,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_repos_verify_callback_t verify_callback,
+                          void *verify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  verify_revisions_baton_t *baton = apr_pcalloc(scratch_pool,
+                                                sizeof(*baton));
+  int job_count = (int)((end_rev - start_rev) / REVS_PER_VERIFY_JOB + 1);
+  svn_error_t *err;
+
+  baton->fs_path = svn_fs_path(fs, scratch_pool);
+  baton->fs_config = svn_fs_config(fs, scratch_pool);
+  baton->start_rev = start_rev;
+  baton->end_rev = end_rev;
+  baton->check_normalization = check_normalization;
+  baton->notify_func = notify_func;
+  baton->notify_baton = notify_baton;
+  baton->verify_callback = verify_callback;
+  baton->verify_baton = verify_baton;
+  baton->cancel_func = cancel_func;
+  baton->cancel_baton = cancel_baton;
+  baton->results = apr_pcalloc(scratch_pool,
+                               job_count * sizeof(*baton->results));
+  SVN_ERR(svn_mutex__init(&baton->mutex, TRUE, scratch_pool));
+
+  err = svn_parallel__run_jobs(job_count, jobs, verify_revisions_job,
+                               verify_revisions_done, baton, scratch_pool);
+
+  /* All jobs have finished, so every instance is idle again. */
+  while (baton->idle_fs)
+    {
+      verify_fs_t *entry = baton->idle_fs;
+      baton->idle_fs = entry->next;
+      svn_pool_destroy(entry->pool);
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2480,6 +2781,7 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   svn_repos_notify_t *notify;
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
+  apr_hash_t *fs_config;
   svn_error_t *err;
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
@@ -2521,8 +2823,18 @@ svn_repos_verify_fs3(svn_repos_t *repos,
         = svn_repos_notify_create(svn_repos_notify_verify_rev_structure, pool);
     }
 
+  /* Let the backend use the same number of threads. */
+  fs_config = svn_fs_config(fs, pool);
+  if (jobs > 1)
+    {
+      if (!fs_config)
+        fs_config = apr_hash_make(pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_VERIFY_JOBS,
+                    apr_itoa(pool, jobs));
+    }
+
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+  err = svn_fs_verify(svn_fs_path(fs, pool), fs_config,
                       start_rev, end_rev,
                       verify_notify, verify_notify_baton,
                       cancel_func, cancel_baton, pool);
@@ -2537,7 +2849,14 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
-  if (!metadata_only)
+  if (!metadata_only && jobs > 1 && end_rev > start_rev)
+    SVN_ERR(verify_revisions_parallel(fs, start_rev, end_rev,
+                                      check_normalization, jobs,
+                                      notify_func, notify_baton,
+                                      verify_callback, verify_baton,
+                                      cancel_func, cancel_baton,
+                                      iterpool));
+  else if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
         svn_pool_clear(iterpool);
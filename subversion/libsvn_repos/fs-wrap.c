@@ -1033,7 +1033,8 @@ pack_notify_func(void *baton,
 }
 
 svn_error_t *
-svn_repos_fs_pack2(svn_repos_t *repos,
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1041,14 +1042,21 @@ svn_repos_fs_pack2(svn_repos_t *repos,
                    apr_pool_t *pool)
 {
   struct pack_notify_baton pnb;
+  apr_hash_t *fs_config = NULL;
 
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  if (jobs > 1)
+    {
+      fs_config = apr_hash_make(pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_PACK_JOBS, apr_itoa(pool, jobs));
+    }
+
+  return svn_fs_pack2(repos->db_path, fs_config,
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
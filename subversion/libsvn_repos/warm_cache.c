@@ -0,0 +1,294 @@
+/* warm_cache.c : preloading the filesystem caches
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "svn_private_config.h"
+
+#include "repos.h"
+
+
+
+/* Larger files are not worth reading: their fulltexts will not fit into
+ * the cache and their deltas would push out more valuable data. */
+#define MAX_FILE_SIZE (1024 * 1024)
+
+/* Send a svn_repos_notify_warm_cache_path notification for PATH@REVISION
+ * to NOTIFY_FUNC with NOTIFY_BATON, if set.  Use SCRATCH_POOL for
+ * temporaries. */
+static void
+notify_path(const char *path,
+            svn_revnum_t revision,
+            svn_repos_notify_func_t notify_func,
+            void *notify_baton,
+            apr_pool_t *scratch_pool)
+{
+  svn_repos_notify_t *notify;
+
+  if (!notify_func)
+    return;
+
+  notify = svn_repos_notify_create(svn_repos_notify_warm_cache_path,
+                                   scratch_pool);
+  notify->path = path;
+  notify->revision = revision;
+  notify_func(notify_baton, notify, scratch_pool);
+}
+
+/* Read the node of KIND at PATH under ROOT such that the FS will cache
+ * its node revision, properties and contents.  For directories, continue
+ * with the entries as indicated by DEPTH.  Use SCRATCH_POOL for
+ * temporaries. */
+static svn_error_t *
+warm_node(svn_fs_root_t *root,
+          const char *path,
+          svn_node_kind_t kind,
+          svn_depth_t depth,
+          svn_cancel_func_t cancel_func,
+          void *cancel_baton,
+          apr_pool_t *scratch_pool)
+{
+  apr_hash_t *props;
+  apr_hash_t *entries;
+  apr_array_header_t *sorted;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (cancel_func)
+    SVN_ERR(cancel_func(cancel_baton));
+
+  SVN_ERR(svn_fs_node_proplist(&props, root, path, scratch_pool));
+
+  if (kind == svn_node_file)
+    {
+      svn_filesize_t length;
+      svn_stream_t *contents;
+
+      SVN_ERR(svn_fs_file_length(&length, root, path, scratch_pool));
+      if (length > MAX_FILE_SIZE)
+        return SVN_NO_ERROR;
+
+      /* Reading the whole file is what makes the FS cache its fulltext. */
+      SVN_ERR(svn_fs_file_contents(&contents, root, path, scratch_pool));
+      return svn_error_trace(svn_stream_copy3(contents,
+                                              svn_stream_empty(scratch_pool),
+                                              cancel_func, cancel_baton,
+                                              scratch_pool));
+    }
+
+  if (kind != svn_node_dir || depth <= svn_depth_empty)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_dir_entries(&entries, root, path, scratch_pool));
+
+  /* Process the entries in the order that minimizes disk seeks. */
+  SVN_ERR(svn_fs_dir_optimal_order(&sorted, root, entries, scratch_pool,
+                                   scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent = APR_ARRAY_IDX(sorted, i, svn_fs_dirent_t *);
+
+      svn_pool_clear(iterpool);
+      if (dirent->kind == svn_node_dir && depth < svn_depth_immediates)
+        continue;
+
+      SVN_ERR(warm_node(root, svn_fspath__join(path, dirent->name, iterpool),
+                        dirent->kind,
+                        depth == svn_depth_infinity ? depth : svn_depth_empty,
+                        cancel_func, cancel_baton, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Warm the caches for all nodes in REVISION of FS that got added or
+ * modified at or below PATH.  Report them to NOTIFY_FUNC with
+ * NOTIFY_BATON.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+warm_changes(svn_fs_t *fs,
+             const char *path,
+             svn_revnum_t revision,
+             svn_repos_notify_func_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_hash_t *revprops;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, scratch_pool));
+  SVN_ERR(svn_fs_revision_proplist2(&revprops, fs, revision, FALSE,
+                                    scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      const char *changed_path = change->path.data;
+
+      svn_pool_clear(iterpool);
+      if (   change->change_kind != svn_fs_path_change_delete
+          && svn_fspath__skip_ancestor(path, changed_path))
+        {
+          svn_node_kind_t kind = change->node_kind;
+          if (kind == svn_node_unknown)
+            SVN_ERR(svn_fs_check_path(&kind, root, changed_path, iterpool));
+
+          SVN_ERR(warm_node(root, changed_path, kind, svn_depth_empty,
+                            cancel_func, cancel_baton, iterpool));
+          notify_path(changed_path, revision, notify_func, notify_baton,
+                      iterpool);
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos_warm_cache(svn_repos_t *repos,
+                     const apr_array_header_t *targets,
+                     svn_depth_t depth,
+                     int recent_revisions,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, scratch_pool));
+
+  for (i = 0; i < targets->nelts; ++i)
+    {
+      const svn_repos_warm_cache_target_t *target
+        = APR_ARRAY_IDX(targets, i, const svn_repos_warm_cache_target_t *);
+      svn_revnum_t revision = SVN_IS_VALID_REVNUM(target->revision)
+                            ? target->revision
+                            : youngest;
+      const char *path;
+      svn_fs_root_t *root;
+      svn_node_kind_t kind;
+      svn_revnum_t rev;
+
+      svn_pool_clear(iterpool);
+      path = svn_fspath__canonicalize(target->path, iterpool);
+
+      if (revision > youngest)
+        return svn_error_createf(SVN_ERR_FS_NO_SUCH_REVISION, NULL,
+                                 _("No such revision %ld"), revision);
+
+      /* Recent changes first, so they have the lower priority in case
+       * the caches are too small to hold everything. */
+      for (rev = MAX(1, revision - recent_revisions + 1);
+           recent_revisions > 0 && rev <= revision;
+           ++rev)
+        SVN_ERR(warm_changes(fs, path, rev, notify_func, notify_baton,
+                             cancel_func, cancel_baton, iterpool));
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, revision, iterpool));
+      SVN_ERR(svn_fs_check_path(&kind, root, path, iterpool));
+      if (kind == svn_node_none)
+        continue;
+
+      SVN_ERR(warm_node(root, path, kind, depth, cancel_func, cancel_baton,
+                        iterpool));
+      notify_path(path, revision, notify_func, notify_baton, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__parse_warm_cache_targets(apr_array_header_t **targets,
+                                    const char *text,
+                                    apr_pool_t *result_pool)
+{
+  apr_array_header_t *lines = svn_cstring_split(text, "\n\r", TRUE,
+                                                result_pool);
+  int i;
+
+  *targets = apr_array_make(result_pool, lines->nelts,
+                            sizeof(svn_repos_warm_cache_target_t *));
+
+  for (i = 0; i < lines->nelts; ++i)
+    {
+      const char *line = APR_ARRAY_IDX(lines, i, const char *);
+      svn_repos_warm_cache_target_t *target;
+      const char *at;
+
+      if (*line == '#')
+        continue;
+
+      target = apr_pcalloc(result_pool, sizeof(*target));
+      target->path = line;
+      target->revision = SVN_INVALID_REVNUM;
+
+      /* An optional peg revision follows the last '@'. */
+      at = strrchr(line, '@');
+      if (at)
+        {
+          const char *rev_str = at + 1;
+          target->path = apr_pstrmemdup(result_pool, line, at - line);
+
+          if (strcmp(rev_str, "HEAD") != 0)
+            {
+              apr_int64_t rev;
+              SVN_ERR(svn_cstring_atoi64(&rev, rev_str));
+              if (rev < 0)
+                return svn_error_createf(SVN_ERR_REVNUM_PARSE_FAILURE, NULL,
+                                         _("Invalid revision in '%s'"),
+                                         line);
+
+              target->revision = (svn_revnum_t)rev;
+            }
+        }
+
+      APR_ARRAY_PUSH(*targets, svn_repos_warm_cache_target_t *) = target;
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -24,34 +24,40 @@
 #include <assert.h>
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
 #include "cache.h"
 #include "private/svn_mutex.h"
 
-/* The (internal) cache object. */
-typedef struct inprocess_cache_t {
-  /* A user-defined identifier for this cache instance. */
-  const char *id;
+/* Maximum number of independently locked shards per cache instance.
+ * Only thread-safe caches get sharded; the others have no lock that
+ * could be contended. */
+#define MAX_SHARDS 16
 
-  /* HASH maps a key (of size KLEN) to a struct cache_entry. */
-  apr_hash_t *hash;
-  apr_ssize_t klen;
+/* Forward declaration. */
+typedef struct inprocess_cache_t inprocess_cache_t;
 
-  /* Used to copy values into the cache. */
-  svn_cache__serialize_func_t serialize_func;
+/* A shard of a cache: it holds all entries whose keys hash to it and
+ * has its own lock, LRU list and memory budget. */
+typedef struct inprocess_shard_t {
+  /* The cache that this shard belongs to. */
+  inprocess_cache_t *cache;
 
-  /* Used to copy values out of the cache. */
-  svn_cache__deserialize_func_t deserialize_func;
+  /* The pool that HASH, all pages and their page pools are allocated in.
+   * For thread-safe caches, this is a private root pool, such that no two
+   * shards ever allocate from the same pool. */
+  apr_pool_t *pool;
 
-  /* Maximum number of pages that this cache instance may allocate */
+  /* HASH maps a key (of size CACHE->KLEN) to a struct cache_entry. */
+  apr_hash_t *hash;
+
+  /* Maximum number of pages that this shard may allocate */
   apr_uint64_t total_pages;
   /* The number of pages we're allowed to allocate before having to
    * try to reuse one. */
   apr_uint64_t unallocated_pages;
-  /* Number of cache entries stored on each page.  Must be at least 1. */
-  apr_uint64_t items_per_page;
 
   /* A dummy cache_page serving as the head of a circular doubly
    * linked list of cache_pages.  SENTINEL->NEXT is the most recently
@@ -67,11 +73,9 @@ typedef struct inprocess_cache_t {
    * currently on PARTIAL_PAGE. */
   apr_uint64_t partial_page_number_filled;
 
-  /* The pool that the svn_cache__t itself, HASH, and all pages are
-   * allocated in; subpools of this pool are used for the cache_entry
-   * structs, as well as the dup'd values and hash keys.
-   */
-  apr_pool_t *cache_pool;
+  /* Empty pages that have been evicted to stay within MAX_SIZE.  They
+   * will be reused before allocating new ones.  Linked via NEXT. */
+  struct cache_page *free_pages;
 
   /* Sum of the SIZE members of all cache_entry elements that are
    * accessible from HASH. This is used to make statistics available
@@ -79,30 +83,72 @@ typedef struct inprocess_cache_t {
    */
   apr_size_t data_size;
 
-  /* A lock for intra-process synchronization to the cache, or NULL if
+  /* Sum of the CHARGED_SIZE members of all pages of this shard. */
+  apr_size_t charged_size;
+
+  /* Upper limit for CHARGED_SIZE.  0 means "only limited by pages". */
+  apr_size_t max_size;
+
+  /* A lock for intra-process synchronization to the shard, or NULL if
    * the cache's creator doesn't feel the cache needs to be
    * thread-safe. */
   svn_mutex__t *mutex;
-} inprocess_cache_t;
+
+  /* Number of times we acquired MUTEX and how many of those attempts
+   * had to wait for another thread.  Only modified while holding it. */
+  apr_uint64_t lock_acquisitions;
+  apr_uint64_t lock_contentions;
+} inprocess_shard_t;
+
+/* The (internal) cache object. */
+struct inprocess_cache_t {
+  /* A user-defined identifier for this cache instance. */
+  const char *id;
+
+  /* The size of the keys in all shards. */
+  apr_ssize_t klen;
+
+  /* Used to copy values into the cache. */
+  svn_cache__serialize_func_t serialize_func;
+
+  /* Used to copy values out of the cache. */
+  svn_cache__deserialize_func_t deserialize_func;
+
+  /* Number of cache entries stored on each page.  Must be at least 1. */
+  apr_uint64_t items_per_page;
+
+  /* The key space gets distributed evenly over SHARD_COUNT SHARDS. */
+  int shard_count;
+  inprocess_shard_t *shards;
+
+  /* The pool that the svn_cache__t itself and the shards are allocated
+   * in.  The shards' pools get destroyed together with it.
+   */
+  apr_pool_t *cache_pool;
+};
 
 /* A cache page; all items on the page are allocated from the same
  * pool. */
 struct cache_page {
-  /* Pointers for the LRU list anchored at the cache's SENTINEL.
+  /* Pointers for the LRU list anchored at the shard's SENTINEL.
    * (NULL for the PARTIAL_PAGE.) */
   struct cache_page *prev;
   struct cache_page *next;
 
   /* The pool in which cache_entry structs, hash keys, and dup'd
    * values are allocated.  The CACHE_PAGE structs are allocated
-   * in CACHE_POOL and have the same lifetime as the cache itself.
-   * (The cache will never allocate more than TOTAL_PAGES page
-   * structs (inclusive of the sentinel) from CACHE_POOL.)
+   * in the shard's POOL and have the same lifetime as the cache itself.
+   * (A shard will never allocate more than TOTAL_PAGES page
+   * structs from its POOL.)
    */
   apr_pool_t *page_pool;
 
+  /* Number of bytes charged for the entries that have been allocated
+   * in PAGE_POOL, including values that have since been replaced. */
+  apr_size_t charged_size;
+
   /* A singly linked list of the entries on this page; used to remove
-   * them from the cache's HASH before reusing the page. */
+   * them from the shard's HASH before reusing the page. */
   struct cache_entry *first_entry;
 };
 
@@ -124,6 +170,75 @@ struct cache_entry {
   struct cache_entry *next_entry;
 };
 
+/* Return the number of bytes that an entry with KEY and a serialized
+ * value of SIZE bytes counts against the MAX_SIZE of a shard in CACHE. */
+static apr_size_t
+entry_charge(inprocess_cache_t *cache,
+             const void *key,
+             apr_size_t size)
+{
+  apr_size_t key_size = cache->klen == APR_HASH_KEY_STRING
+                      ? strlen(key) + 1
+                      : (apr_size_t)cache->klen;
+
+  return sizeof(struct cache_entry) + key_size + size;
+}
+
+/* Return the shard of CACHE that is responsible for KEY. */
+static inprocess_shard_t *
+get_shard(inprocess_cache_t *cache,
+          const void *key)
+{
+  apr_ssize_t klen = cache->klen;
+
+  if (cache->shard_count == 1)
+    return cache->shards;
+
+  return &cache->shards[apr_hashfunc_default(key, &klen)
+                        % cache->shard_count];
+}
+
+/* Acquire the mutex of SHARD and update its lock statistics.  Unlike
+ * svn_mutex__lock(), try a non-blocking lock first so we can tell
+ * whether another thread held it. */
+static svn_error_t *
+lock_shard(inprocess_shard_t *shard)
+{
+  svn_boolean_t contended = FALSE;
+
+  if (shard->mutex == NULL)
+    return SVN_NO_ERROR;
+
+#if APR_HAS_THREADS
+  {
+    apr_status_t status
+      = apr_thread_mutex_trylock(svn_mutex__get(shard->mutex));
+    if (APR_STATUS_IS_EBUSY(status))
+      contended = TRUE;
+    else if (status)
+      return svn_error_wrap_apr(status, _("Can't lock mutex"));
+  }
+
+  if (contended)
+    SVN_ERR(svn_mutex__lock(shard->mutex));
+#endif
+
+  shard->lock_acquisitions++;
+  if (contended)
+    shard->lock_contentions++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Execute EXPR while holding the lock of SHARD.  The equivalent of
+ * SVN_MUTEX__WITH_LOCK that counts lock contention. */
+#define WITH_SHARD_LOCK(shard, expr)                       \
+do {                                                       \
+  inprocess_shard_t *shard__ = (shard);                    \
+  SVN_ERR(lock_shard(shard__));                            \
+  SVN_ERR(svn_mutex__unlock(shard__->mutex, (expr)));      \
+} while (0)
+
 
 /* Removes PAGE from the doubly-linked list it is in (leaving its PREV
  * and NEXT fields undefined). */
@@ -134,12 +249,12 @@ remove_page_from_list(struct cache_page *page)
   page->next->prev = page->prev;
 }
 
-/* Inserts PAGE after CACHE's sentinel. */
+/* Inserts PAGE after SHARD's sentinel. */
 static void
-insert_page(inprocess_cache_t *cache,
+insert_page(inprocess_shard_t *shard,
             struct cache_page *page)
 {
-  struct cache_page *pred = cache->sentinel;
+  struct cache_page *pred = shard->sentinel;
 
   page->prev = pred;
   page->next = pred->next;
@@ -150,18 +265,18 @@ insert_page(inprocess_cache_t *cache,
 /* If PAGE is in the circularly linked list (eg, its NEXT isn't NULL),
  * move it to the front of the list. */
 static svn_error_t *
-move_page_to_front(inprocess_cache_t *cache,
+move_page_to_front(inprocess_shard_t *shard,
                    struct cache_page *page)
 {
-  /* This function is called whilst CACHE is locked. */
+  /* This function is called whilst SHARD is locked. */
 
-  SVN_ERR_ASSERT(page != cache->sentinel);
+  SVN_ERR_ASSERT(page != shard->sentinel);
 
   if (! page->next)
     return SVN_NO_ERROR;
 
   remove_page_from_list(page);
-  insert_page(cache, page);
+  insert_page(shard, page);
 
   return SVN_NO_ERROR;
 }
@@ -182,15 +297,16 @@ duplicate_key(inprocess_cache_t *cache,
 static svn_error_t *
 inprocess_cache_get_internal(char **buffer,
                              apr_size_t *size,
-                             inprocess_cache_t *cache,
+                             inprocess_shard_t *shard,
                              const void *key,
                              apr_pool_t *result_pool)
 {
-  struct cache_entry *entry = apr_hash_get(cache->hash, key, cache->klen);
+  struct cache_entry *entry = apr_hash_get(shard->hash, key,
+                                           shard->cache->klen);
 
   if (entry)
     {
-      SVN_ERR(move_page_to_front(cache, entry->page));
+      SVN_ERR(move_page_to_front(shard, entry->page));
 
       /* duplicate the buffer entry */
       *buffer = apr_palloc(result_pool, entry->size);
@@ -222,12 +338,12 @@ inprocess_cache_get(void **value_p,
       char* buffer;
       apr_size_t size;
 
-      SVN_MUTEX__WITH_LOCK(cache->mutex,
-                           inprocess_cache_get_internal(&buffer,
-                                                        &size,
-                                                        cache,
-                                                        key,
-                                                        result_pool));
+      WITH_SHARD_LOCK(get_shard(cache, key),
+                      inprocess_cache_get_internal(&buffer,
+                                                   &size,
+                                                   shard__,
+                                                   key,
+                                                   result_pool));
       /* deserialize the buffer content. Usually, this will directly
          modify the buffer content directly. */
       *found = (buffer != NULL);
@@ -247,11 +363,11 @@ inprocess_cache_get(void **value_p,
 
 static svn_error_t *
 inprocess_cache_has_key_internal(svn_boolean_t *found,
-                                 inprocess_cache_t *cache,
+                                 inprocess_shard_t *shard,
                                  const void *key,
                                  apr_pool_t *scratch_pool)
 {
-  *found = apr_hash_get(cache->hash, key, cache->klen) != NULL;
+  *found = apr_hash_get(shard->hash, key, shard->cache->klen) != NULL;
 
   return SVN_NO_ERROR;
 }
@@ -265,58 +381,145 @@ inprocess_cache_has_key(svn_boolean_t *found,
   inprocess_cache_t *cache = cache_void;
 
   if (key)
-    SVN_MUTEX__WITH_LOCK(cache->mutex,
-                         inprocess_cache_has_key_internal(found,
-                                                          cache,
-                                                          key,
-                                                          scratch_pool));
+    WITH_SHARD_LOCK(get_shard(cache, key),
+                    inprocess_cache_has_key_internal(found,
+                                                     shard__,
+                                                     key,
+                                                     scratch_pool));
   else
     *found = FALSE;
 
   return SVN_NO_ERROR;
 }
 
-/* Removes PAGE from the LRU list, removes all of its entries from
- * CACHE's hash, clears its pool, and sets its entry pointer to NULL.
- * Finally, puts it in the "partial page" slot in the cache and sets
- * partial_page_number_filled to 0.  Must be called on a page actually
- * in the list. */
+/* Remove ENTRY from SHARD's hash and update the size statistics.
+ * The entry itself remains on its page until that gets erased. */
 static void
-erase_page(inprocess_cache_t *cache,
+detach_entry(inprocess_shard_t *shard,
+             struct cache_entry *entry)
+{
+  inprocess_cache_t *cache = shard->cache;
+
+  shard->data_size -= entry->size;
+  apr_hash_set(shard->hash, entry->key, cache->klen, NULL);
+}
+
+/* Remove all entries of PAGE from SHARD's hash and clear its pool.
+ * PAGE must not be in the LRU list anymore. */
+static void
+clear_page(inprocess_shard_t *shard,
            struct cache_page *page)
 {
   struct cache_entry *e;
 
-  remove_page_from_list(page);
-
   for (e = page->first_entry;
        e;
        e = e->next_entry)
     {
-      cache->data_size -= e->size;
-      apr_hash_set(cache->hash, e->key, cache->klen, NULL);
+      /* Entries may have been detached and replaced already. */
+      if (apr_hash_get(shard->hash, e->key, shard->cache->klen) == e)
+        detach_entry(shard, e);
     }
 
   svn_pool_clear(page->page_pool);
+  shard->charged_size -= page->charged_size;
+  page->charged_size = 0;
 
   page->first_entry = NULL;
   page->prev = NULL;
   page->next = NULL;
+}
 
-  cache->partial_page = page;
-  cache->partial_page_number_filled = 0;
+/* Removes PAGE from the LRU list, removes all of its entries from
+ * SHARD's hash, clears its pool, and sets its entry pointer to NULL.
+ * Finally, puts it in the "partial page" slot in the shard and sets
+ * partial_page_number_filled to 0.  Must be called on a page actually
+ * in the list. */
+static void
+erase_page(inprocess_shard_t *shard,
+           struct cache_page *page)
+{
+  remove_page_from_list(page);
+  clear_page(shard, page);
+
+  shard->partial_page = page;
+  shard->partial_page_number_filled = 0;
 }
 
+/* Account for CHARGE bytes having been allocated in PAGE of SHARD. */
+static void
+charge_page(inprocess_shard_t *shard,
+            struct cache_page *page,
+            apr_size_t charge)
+{
+  page->charged_size += charge;
+  shard->charged_size += charge;
+}
+
+/* Evict the least recently used pages from SHARD until another CHARGE
+ * bytes will fit into its MAX_SIZE budget.  If the full pages are not
+ * enough, evict the partial page as well.  The pages go to the free list.
+ * Any entry of SHARD may get evicted. */
+static void
+make_room(inprocess_shard_t *shard,
+          apr_size_t charge)
+{
+  if (shard->max_size == 0)
+    return;
+
+  while (   shard->charged_size + charge > shard->max_size
+         && shard->sentinel->prev != shard->sentinel)
+    {
+      struct cache_page *oldest_page = shard->sentinel->prev;
+
+      remove_page_from_list(oldest_page);
+      clear_page(shard, oldest_page);
+
+      oldest_page->next = shard->free_pages;
+      shard->free_pages = oldest_page;
+    }
+
+  if (   shard->charged_size + charge > shard->max_size
+      && shard->partial_page)
+    {
+      clear_page(shard, shard->partial_page);
+
+      shard->partial_page->next = shard->free_pages;
+      shard->free_pages = shard->partial_page;
+      shard->partial_page = NULL;
+      shard->partial_page_number_filled = 0;
+    }
+}
 
 static svn_error_t *
-inprocess_cache_set_internal(inprocess_cache_t *cache,
+inprocess_cache_set_internal(inprocess_shard_t *shard,
                              const void *key,
                              void *value,
                              apr_pool_t *scratch_pool)
 {
+  inprocess_cache_t *cache = shard->cache;
   struct cache_entry *existing_entry;
+  void *data = NULL;
+  apr_size_t size = 0;
+  apr_size_t charge;
+
+  /* Serialize first, so we know how much space the entry will need.
+   * The result gets copied into the respective page pool later. */
+  if (value)
+    SVN_ERR(cache->serialize_func(&data, &size, value, scratch_pool));
+  charge = entry_charge(cache, key, size);
+
+  existing_entry = apr_hash_get(shard->hash, key, cache->klen);
+
+  /* Larger than the whole shard?  Don't cache it but also don't keep
+   * any outdated value around. */
+  if (shard->max_size && charge > shard->max_size)
+    {
+      if (existing_entry)
+        detach_entry(shard, existing_entry);
 
-  existing_entry = apr_hash_get(cache->hash, key, cache->klen);
+      return SVN_NO_ERROR;
+    }
 
   /* Is it already here, but we can do the one-item-per-page
    * optimization? */
@@ -331,9 +534,18 @@ inprocess_cache_set_internal(inprocess_cache_t *cache,
        * *never* has a partial page (except for in the temporary state
        * that we're about to fake). */
       SVN_ERR_ASSERT(page->next != NULL);
-      SVN_ERR_ASSERT(cache->partial_page == NULL);
+      SVN_ERR_ASSERT(shard->partial_page == NULL);
 
-      erase_page(cache, page);
+      erase_page(shard, page);
+      existing_entry = NULL;
+    }
+
+  /* With a byte budget, we must be able to evict any page to make room
+   * for the new value.  So, store it as a new entry and let the old one
+   * go with its page. */
+  if (existing_entry && shard->max_size)
+    {
+      detach_entry(shard, existing_entry);
       existing_entry = NULL;
     }
 
@@ -342,75 +554,71 @@ inprocess_cache_set_internal(inprocess_cache_t *cache,
     {
       struct cache_page *page = existing_entry->page;
 
-      SVN_ERR(move_page_to_front(cache, page));
-      cache->data_size -= existing_entry->size;
-      if (value)
-        {
-          SVN_ERR(cache->serialize_func(&existing_entry->value,
-                                        &existing_entry->size,
-                                        value,
-                                        page->page_pool));
-          cache->data_size += existing_entry->size;
-          if (existing_entry->size == 0)
-            existing_entry->value = NULL;
-        }
-      else
-        {
-          existing_entry->value = NULL;
-          existing_entry->size = 0;
-        }
+      SVN_ERR(move_page_to_front(shard, page));
+      detach_entry(shard, existing_entry);
+
+      existing_entry->value = size ? apr_pmemdup(page->page_pool, data, size)
+                                   : NULL;
+      existing_entry->size = size;
+
+      apr_hash_set(shard->hash, existing_entry->key, cache->klen,
+                   existing_entry);
+      shard->data_size += size;
+      charge_page(shard, page, size);
 
       return SVN_NO_ERROR;
     }
 
+  make_room(shard, charge);
+
+  /* Do we not have a partial page to put it on, but there is an evicted
+   * page that we can reuse? */
+  if (shard->partial_page == NULL && shard->free_pages)
+    {
+      shard->partial_page = shard->free_pages;
+      shard->free_pages = shard->free_pages->next;
+      shard->partial_page->next = NULL;
+      shard->partial_page_number_filled = 0;
+    }
+
   /* Do we not have a partial page to put it on, but we are allowed to
    * allocate more? */
-  if (cache->partial_page == NULL && cache->unallocated_pages > 0)
+  if (shard->partial_page == NULL && shard->unallocated_pages > 0)
     {
-      cache->partial_page = apr_pcalloc(cache->cache_pool,
-                                        sizeof(*(cache->partial_page)));
-      cache->partial_page->page_pool = svn_pool_create(cache->cache_pool);
-      cache->partial_page_number_filled = 0;
-      (cache->unallocated_pages)--;
+      shard->partial_page = apr_pcalloc(shard->pool,
+                                        sizeof(*(shard->partial_page)));
+      shard->partial_page->page_pool = svn_pool_create(shard->pool);
+      shard->partial_page_number_filled = 0;
+      (shard->unallocated_pages)--;
     }
 
   /* Do we really not have a partial page to put it on, even after the
    * one-item-per-page optimization and checking the unallocated page
    * count? */
-  if (cache->partial_page == NULL)
+  if (shard->partial_page == NULL)
     {
-      struct cache_page *oldest_page = cache->sentinel->prev;
+      struct cache_page *oldest_page = shard->sentinel->prev;
 
-      SVN_ERR_ASSERT(oldest_page != cache->sentinel);
+      SVN_ERR_ASSERT(oldest_page != shard->sentinel);
 
-      /* Erase the page and put it in cache->partial_page. */
-      erase_page(cache, oldest_page);
+      /* Erase the page and put it in shard->partial_page. */
+      erase_page(shard, oldest_page);
     }
 
-  SVN_ERR_ASSERT(cache->partial_page != NULL);
+  SVN_ERR_ASSERT(shard->partial_page != NULL);
 
   {
-    struct cache_page *page = cache->partial_page;
+    struct cache_page *page = shard->partial_page;
     struct cache_entry *new_entry = apr_pcalloc(page->page_pool,
                                                 sizeof(*new_entry));
 
     /* Copy the key and value into the page's pool.  */
     new_entry->key = duplicate_key(cache, key, page->page_pool);
-    if (value)
-      {
-        SVN_ERR(cache->serialize_func(&new_entry->value,
-                                      &new_entry->size,
-                                      value,
-                                      page->page_pool));
-        cache->data_size += new_entry->size;
-        if (new_entry->size == 0)
-          new_entry->value = NULL;
-      }
-    else
-      {
-        new_entry->value = NULL;
-        new_entry->size = 0;
-      }
+    new_entry->value = size ? apr_pmemdup(page->page_pool, data, size)
+                            : NULL;
+    new_entry->size = size;
+    shard->data_size += size;
+    charge_page(shard, page, charge);
 
     /* Add the entry to the page's list. */
     new_entry->page = page;
@@ -419,16 +627,16 @@ inprocess_cache_set_internal(inprocess_cache_t *cache,
 
     /* Add the entry to the hash, using the *entry's* copy of the
      * key. */
-    apr_hash_set(cache->hash, new_entry->key, cache->klen, new_entry);
+    apr_hash_set(shard->hash, new_entry->key, cache->klen, new_entry);
 
     /* We've added something else to the partial page. */
-    (cache->partial_page_number_filled)++;
+    (shard->partial_page_number_filled)++;
 
     /* Is it full? */
-    if (cache->partial_page_number_filled >= cache->items_per_page)
+    if (shard->partial_page_number_filled >= cache->items_per_page)
       {
-        insert_page(cache, page);
-        cache->partial_page = NULL;
+        insert_page(shard, page);
+        shard->partial_page = NULL;
       }
   }
 
@@ -444,11 +652,11 @@ inprocess_cache_set(void *cache_void,
   inprocess_cache_t *cache = cache_void;
 
   if (key)
-    SVN_MUTEX__WITH_LOCK(cache->mutex,
-                         inprocess_cache_set_internal(cache,
-                                                      key,
-                                                      value,
-                                                      scratch_pool));
+    WITH_SHARD_LOCK(get_shard(cache, key),
+                    inprocess_cache_set_internal(shard__,
+                                                 key,
+                                                 value,
+                                                 scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -483,12 +691,18 @@ inprocess_cache_iter(svn_boolean_t *completed,
 {
   inprocess_cache_t *cache = cache_void;
   struct cache_iter_baton b;
+  int i;
+
   b.user_cb = user_cb;
   b.user_baton = user_baton;
 
-  SVN_MUTEX__WITH_LOCK(cache->mutex,
-                       svn_iter_apr_hash(completed, cache->hash,
-                                         iter_cb, &b, scratch_pool));
+  /* Shards are iterated one after the other, i.e. we never hold more
+   * than one lock at a time. */
+  *completed = TRUE;
+  for (i = 0; i < cache->shard_count && *completed; ++i)
+    WITH_SHARD_LOCK(&cache->shards[i],
+                    svn_iter_apr_hash(completed, shard__->hash,
+                                      iter_cb, &b, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -496,20 +710,21 @@ inprocess_cache_iter(svn_boolean_t *completed,
 static svn_error_t *
 inprocess_cache_get_partial_internal(void **value_p,
                                      svn_boolean_t *found,
-                                     inprocess_cache_t *cache,
+                                     inprocess_shard_t *shard,
                                      const void *key,
                                      svn_cache__partial_getter_func_t func,
                                      void *baton,
                                      apr_pool_t *result_pool)
 {
-  struct cache_entry *entry = apr_hash_get(cache->hash, key, cache->klen);
+  struct cache_entry *entry = apr_hash_get(shard->hash, key,
+                                           shard->cache->klen);
   if (! entry)
     {
       *found = FALSE;
       return SVN_NO_ERROR;
     }
 
-  SVN_ERR(move_page_to_front(cache, entry->page));
+  SVN_ERR(move_page_to_front(shard, entry->page));
 
   *found = TRUE;
   return func(value_p, entry->value, entry->size, baton, result_pool);
@@ -527,14 +742,14 @@ inprocess_cache_get_partial(void **value_p,
   inprocess_cache_t *cache = cache_void;
 
   if (key)
-    SVN_MUTEX__WITH_LOCK(cache->mutex,
-                         inprocess_cache_get_partial_internal(value_p,
-                                                              found,
-                                                              cache,
-                                                              key,
-                                                              func,
-                                                              baton,
-                                                              result_pool));
+    WITH_SHARD_LOCK(get_shard(cache, key),
+                    inprocess_cache_get_partial_internal(value_p,
+                                                         found,
+                                                         shard__,
+                                                         key,
+                                                         func,
+                                                         baton,
+                                                         result_pool));
   else
     *found = FALSE;
 
@@ -542,23 +757,34 @@ inprocess_cache_get_partial(void **value_p,
 }
 
 static svn_error_t *
-inprocess_cache_set_partial_internal(inprocess_cache_t *cache,
+inprocess_cache_set_partial_internal(inprocess_shard_t *shard,
                                      const void *key,
                                      svn_cache__partial_setter_func_t func,
                                      void *baton,
                                      apr_pool_t *scratch_pool)
 {
-  struct cache_entry *entry = apr_hash_get(cache->hash, key, cache->klen);
+  inprocess_cache_t *cache = shard->cache;
+  struct cache_entry *entry = apr_hash_get(shard->hash, key, cache->klen);
   if (entry)
     {
-      SVN_ERR(move_page_to_front(cache, entry->page));
+      void *old_value = entry->value;
 
-      cache->data_size -= entry->size;
+      SVN_ERR(move_page_to_front(shard, entry->page));
+
+      shard->data_size -= entry->size;
       SVN_ERR(func(&entry->value,
                    &entry->size,
                    baton,
                    entry->page->page_pool));
-      cache->data_size += entry->size;
+      shard->data_size += entry->size;
+
+      /* A modified value that got re-allocated adds to the page while
+       * the old one gets leaked until the page is cleared.  That may push
+       * us over budget. */
+      if (entry->value != old_value)
+        charge_page(shard, entry->page, entry->size);
+
+      make_room(shard, 0);
     }
 
   return SVN_NO_ERROR;
@@ -574,12 +800,12 @@ inprocess_cache_set_partial(void *cache_void,
   inprocess_cache_t *cache = cache_void;
 
   if (key)
-    SVN_MUTEX__WITH_LOCK(cache->mutex,
-                         inprocess_cache_set_partial_internal(cache,
-                                                              key,
-                                                              func,
-                                                              baton,
-                                                              scratch_pool));
+    WITH_SHARD_LOCK(get_shard(cache, key),
+                    inprocess_cache_set_partial_internal(shard__,
+                                                         key,
+                                                         func,
+                                                         baton,
+                                                         scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -593,24 +819,37 @@ inprocess_cache_is_cachable(void *cache_void, apr_size_t size)
    * will be used for checks _inside_ the cache code.
    */
   inprocess_cache_t *cache = cache_void;
-  return size < SVN_ALLOCATOR_RECOMMENDED_MAX_FREE / cache->items_per_page;
+  apr_size_t max_size = cache->shards[0].max_size;
+
+  return size < SVN_ALLOCATOR_RECOMMENDED_MAX_FREE / cache->items_per_page
+      && (max_size == 0 || size < max_size);
 }
 
+/* Add the statistics of SHARD to INFO.  Reset the lock counters
+ * if RESET is set. */
 static svn_error_t *
-inprocess_cache_get_info_internal(inprocess_cache_t *cache,
+inprocess_cache_get_info_internal(inprocess_shard_t *shard,
                                   svn_cache__info_t *info,
-                                  apr_pool_t *result_pool)
+                                  svn_boolean_t reset)
 {
-  info->id = apr_pstrdup(result_pool, cache->id);
+  inprocess_cache_t *cache = shard->cache;
+  apr_uint64_t used_entries = apr_hash_count(shard->hash);
 
-  info->used_entries = apr_hash_count(cache->hash);
-  info->total_entries = cache->items_per_page * cache->total_pages;
+  info->used_entries += used_entries;
+  info->total_entries += cache->items_per_page * shard->total_pages;
 
-  info->used_size = cache->data_size;
-  info->data_size = cache->data_size;
-  info->total_size = cache->data_size
-                   + cache->items_per_page * sizeof(struct cache_page)
-                   + info->used_entries * sizeof(struct cache_entry);
+  info->used_size += shard->data_size;
+  info->data_size += shard->charged_size;
+  info->total_size += shard->charged_size
+                    + shard->total_pages * sizeof(struct cache_page);
+
+  info->lock_acquisitions += shard->lock_acquisitions;
+  info->lock_contentions += shard->lock_contentions;
+  if (reset)
+    {
+      shard->lock_acquisitions = 0;
+      shard->lock_contentions = 0;
+    }
 
   return SVN_NO_ERROR;
 }
@@ -623,15 +862,27 @@ inprocess_cache_get_info(void *cache_void,
                          apr_pool_t *result_pool)
 {
   inprocess_cache_t *cache = cache_void;
+  int i;
 
-  SVN_MUTEX__WITH_LOCK(cache->mutex,
-                       inprocess_cache_get_info_internal(cache,
-                                                         info,
-                                                         result_pool));
+  info->id = apr_pstrdup(result_pool, cache->id);
+
+  for (i = 0; i < cache->shard_count; ++i)
+    SVN_MUTEX__WITH_LOCK(cache->shards[i].mutex,
+                         inprocess_cache_get_info_internal(&cache->shards[i],
+                                                           info, reset));
 
   return SVN_NO_ERROR;
 }
 
+/* Pool cleanup function destroying the private root pool BATON of a
+ * cache shard. */
+static apr_status_t
+destroy_shard_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+  return APR_SUCCESS;
+}
+
 static svn_cache__vtable_t inprocess_cache_vtable = {
   inprocess_cache_get,
   inprocess_cache_has_key,
@@ -640,7 +891,8 @@ static svn_cache__vtable_t inprocess_cache_vtable = {
   inprocess_cache_is_cachable,
   inprocess_cache_get_partial,
   inprocess_cache_set_partial,
-  inprocess_cache_get_info
+  inprocess_cache_get_info,
+  NULL /* get_multi */
 };
 
 svn_error_t *
@@ -650,36 +902,74 @@ svn_cache__create_inprocess(svn_cache__t **cache_p,
                             apr_ssize_t klen,
                             apr_int64_t pages,
                             apr_int64_t items_per_page,
+                            apr_size_t max_size,
                             svn_boolean_t thread_safe,
                             const char *id,
                             apr_pool_t *pool)
 {
   svn_cache__t *wrapper = apr_pcalloc(pool, sizeof(*wrapper));
   inprocess_cache_t *cache = apr_pcalloc(pool, sizeof(*cache));
+  int i;
 
   cache->id = apr_pstrdup(pool, id);
 
   SVN_ERR_ASSERT(klen == APR_HASH_KEY_STRING || klen >= 1);
 
-  cache->hash = apr_hash_make(pool);
   cache->klen = klen;
 
   cache->serialize_func = serialize;
   cache->deserialize_func = deserialize;
 
   SVN_ERR_ASSERT(pages >= 1);
-  cache->total_pages = pages;
-  cache->unallocated_pages = pages;
   SVN_ERR_ASSERT(items_per_page >= 1);
   cache->items_per_page = items_per_page;
 
-  cache->sentinel = apr_pcalloc(pool, sizeof(*(cache->sentinel)));
-  cache->sentinel->prev = cache->sentinel;
-  cache->sentinel->next = cache->sentinel;
-  /* The sentinel doesn't need a pool.  (We're happy to crash if we
-   * accidentally try to treat it like a real page.) */
+  /* Only thread-safe caches benefit from sharding.  Each shard needs at
+   * least one page. */
+  cache->shard_count = thread_safe
+                     ? (int)MIN(pages, MAX_SHARDS)
+                     : 1;
+  cache->shards = apr_pcalloc(pool,
+                              cache->shard_count * sizeof(*cache->shards));
+
+  for (i = 0; i < cache->shard_count; ++i)
+    {
+      inprocess_shard_t *shard = &cache->shards[i];
+
+      shard->cache = cache;
+
+      /* Shards of thread-safe caches get modified concurrently, so they
+       * must not share a pool (and its allocator). */
+      if (thread_safe)
+        {
+          shard->pool
+            = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+          apr_pool_cleanup_register(pool, shard->pool, destroy_shard_pool,
+                                    apr_pool_cleanup_null);
+        }
+      else
+        {
+          shard->pool = pool;
+        }
 
-  SVN_ERR(svn_mutex__init(&cache->mutex, thread_safe, pool));
+      shard->hash = apr_hash_make(shard->pool);
+
+      /* Distribute the pages evenly. */
+      shard->total_pages = pages / cache->shard_count
+                         + (i < pages % cache->shard_count ? 1 : 0);
+      shard->unallocated_pages = shard->total_pages;
+      shard->max_size = max_size
+                      ? MAX(max_size / cache->shard_count, 1)
+                      : 0;
+
+      shard->sentinel = apr_pcalloc(pool, sizeof(*(shard->sentinel)));
+      shard->sentinel->prev = shard->sentinel;
+      shard->sentinel->next = shard->sentinel;
+      /* The sentinel doesn't need a pool.  (We're happy to crash if we
+       * accidentally try to treat it like a real page.) */
+
+      SVN_ERR(svn_mutex__init(&shard->mutex, thread_safe, pool));
+    }
 
   cache->cache_pool = pool;
 
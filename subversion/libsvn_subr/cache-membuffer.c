@@ -24,9 +24,14 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_global_mutex.h>
+#include <apr_shm.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_version.h"
 #include "svn_private_config.h"
 #include "svn_hash.h"
 #include "svn_string.h"
@@ -34,12 +39,19 @@
 
 #include "private/svn_atomic.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_io_private.h"
 #include "private/svn_mutex.h"
+#include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 
 #include "cache.h"
 #include "fnv1a.h"
+#include "pools.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>   /* For getpid() */
+#endif
 
 /*
  * This svn_cache__t implementation actually consists of two parts:
@@ -63,8 +75,14 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.
+ *
+ * Sharing between processes is supported for caches that get created in
+ * a parent process before it forks its workers, e.g. a pre-fork httpd.
+ * All segment data, including the segment headers, is then allocated in
+ * a single shared memory block that all children inherit at the same
+ * address.  Access is serialized with system-wide locks.  Only the prefix
+ * pool is process-local and therefore disabled for shared caches.
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -129,6 +147,12 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Where supported, readers don't take the segment lock at all but validate
+ * their result against a per-segment sequence counter that every writer
+ * updates (seqlock).  Only upon conflicts, they fall back to the read lock.
+ * Hit statistics are sampled in that mode to keep readers from writing to
+ * shared memory on every access.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +170,48 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* On many-core servers, even an uncontended r/w lock becomes a bottleneck
+ * because every reader must write to the lock's cache line.  Therefore,
+ * readers will first try to access the segment without taking the lock
+ * and validate their result against a per-segment sequence counter that
+ * writers bump before and after every modification (seqlock).  Only if
+ * that fails, they fall back to the read lock.
+ *
+ * This requires proper acquire / release semantics which APR's atomics
+ * do not provide for plain reads.  Use the compiler intrinsics if they
+ * are available and disable the optimistic read path otherwise.  Also,
+ * the debug code needs the entry tags to be consistent with the data,
+ * so don't use the lock-free code in that case.
+ */
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && (defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#  define USE_OPTIMISTIC_READS 1
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Lock-free readers don't update the shared hit counters for every
+ * access.  Instead, only every HIT_SAMPLE_RATE-th access of a thread
+ * will be counted with a weight of HIT_SAMPLE_RATE.  This keeps the
+ * statistics unbiased while removing most writes to shared cache lines.
+ *
+ * Must be a power of 2.
+ */
+#define HIT_SAMPLE_RATE 4
+
+/* Lock-free partial getters must not run the deserializer on cache memory
+ * that may get modified concurrently.  Items up to this size get copied
+ * to the stack first.  Larger items are always read under the read lock.
+ */
+#define OPTIMISTIC_COPY_LIMIT 4096
+
+/* Maximum number of lock-free attempts to read an item before we fall
+ * back to taking the read lock.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 2
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -172,6 +238,12 @@
  */
 #define MAX_SEGMENT_COUNT 0x10000
 
+/* Every segment of a cache that is shared between processes needs its own
+ * system-wide lock object.  Those are a scarce resource on most systems,
+ * so limit the number of segments more tightly in that case.
+ */
+#define MAX_SHARED_SEGMENT_COUNT 0x100
+
 /* As of today, APR won't allocate chunks of 4GB or more. So, limit the
  * segment size to slightly below that.
  */
@@ -186,6 +258,38 @@
  */
 #define GROUP_INIT_GRANULARITY 32
 
+/* Every segment keeps a count-min sketch of recent access frequencies,
+ * i.e. an array of small saturating counters, SKETCH_DEPTH of which are
+ * being updated per access.  The estimated frequency of a key is the
+ * minimum of its counters.
+ *
+ * The sketch has about as many counters as there are entries in the
+ * segment but never more than MAX_SKETCH_WIDTH.  All counters get halved
+ * after SKETCH_SAMPLE_FACTOR accesses per counter, so the estimates
+ * reflect recent usage only.
+ *
+ * Readers update the sketch without holding the segment lock.  Therefore,
+ * the 4 bit counters are packed into 32 bit words that are only modified
+ * through atomic compare-and-swap.  Like the hit counters, lock-free
+ * readers only record every SKETCH_READ_SAMPLE_RATE-th access of a thread
+ * to keep them from contending for the same cache lines.
+ */
+#define SKETCH_DEPTH 4
+#define SKETCH_MAX_COUNT 15
+#define SKETCH_SAMPLE_FACTOR 10
+#define SKETCH_COUNTERS_PER_WORD 8
+#define SKETCH_READ_SAMPLE_RATE 4
+#define MIN_SKETCH_WIDTH 0x40
+#define MAX_SKETCH_WIDTH 0x1000000
+
+/* Maximum number of distinct key prefixes that get their own access
+ * statistics, see prefix_stats_table_t.  Any further prefixes as well
+ * as all short-lived caches share a common statistics record.
+ *
+ * Must be a power of 2.
+ */
+#define MAX_PREFIX_STATS 0x400
+
 /* Invalid index reference value. Equivalent to APR_UINT32_T(-1)
  */
 #define NO_INDEX APR_UINT32_MAX
@@ -197,6 +301,24 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Entry priorities are being stored as 16 bit values.  Higher priorities
+ * than this will be clamped.
+ */
+#define MAX_ENTRY_PRIORITY 0xffff
+
+/* Items larger than this will never be compressed.  This is the input
+ * size limit of LZ4 (LZ4_MAX_INPUT_SIZE).
+ */
+#define MAX_COMPRESSIBLE_SIZE 0x7E000000
+
+/* Flags that may be set in entry_t.flags.
+ *
+ * ENTRY_COMPRESSED: The item data has been compressed with
+ * svn__compress_lz4() and must be decompressed before being passed to
+ * any deserializer.  See svn_cache__membuffer_set_compression().
+ */
+#define ENTRY_COMPRESSED 0x0001
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -391,6 +513,144 @@ prefix_pool_get(apr_uint32_t *prefix_idx,
   return SVN_NO_ERROR;
 }
 
+/* Access statistics for all cache entries whose keys start with PREFIX.
+ * The same record gets updated by all front-ends and segments, i.e. from
+ * many threads without a common lock.  Therefore, the counters are only
+ * modified atomically.  Being 32 bit values, they may wrap around.
+ */
+typedef struct prefix_stats_t
+{
+  /* The key prefix.  NULL for unused slots and for the "other" slot.
+   * Once set, this will never change. */
+  const char *volatile prefix;
+
+  /* Number of get and hit calls through any cache front-end using PREFIX. */
+  svn_atomic_t gets;
+  svn_atomic_t hits;
+
+  /* Number of set calls through any cache front-end using PREFIX. */
+  svn_atomic_t sets;
+
+  /* Number of entries using PREFIX that got evicted to make room for
+   * other entries. */
+  svn_atomic_t evictions;
+} prefix_stats_t;
+
+/* Open hash table of prefix_stats_t, using linear probing.  Slots will
+ * only ever be added, never removed.  Therefore, lookups don't require
+ * any locking.  The table is never filled beyond 3/4 of its capacity, so
+ * every probe sequence ends at an unused slot.  Operations on this data
+ * structure are defined by prefix_stats_* functions.
+ */
+typedef struct prefix_stats_table_t
+{
+  /* MAX_PREFIX_STATS slots. */
+  prefix_stats_t *slots;
+
+  /* Number of slots in use. */
+  apr_uint32_t used;
+
+  /* Statistics for all entries whose prefix does not have its own slot. */
+  prefix_stats_t other;
+
+  /* Pool to allocate prefix copies from. */
+  apr_pool_t *pool;
+
+  /* Serializes the insertion of new slots. */
+  svn_mutex__t *mutex;
+} prefix_stats_table_t;
+
+/* Set *TABLE to a new, empty prefix statistics table.  If MUTEX_REQUIRED
+ * is set and multi-threading is supported, serialize insertions.
+ * Allocate the object from *RESULT_POOL. */
+static svn_error_t *
+prefix_stats_create(prefix_stats_table_t **table,
+                    svn_boolean_t mutex_required,
+                    apr_pool_t *result_pool)
+{
+  prefix_stats_table_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  result->slots = apr_pcalloc(result_pool,
+                              MAX_PREFIX_STATS * sizeof(*result->slots));
+  result->pool = result_pool;
+  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, result_pool));
+
+  *table = result;
+  return SVN_NO_ERROR;
+}
+
+/* Return the slot in TABLE that matches PREFIX or, if there is none,
+ * the first unused slot in its probe sequence.  Never returns NULL.
+ * May be called without holding TABLE->MUTEX.
+ */
+static prefix_stats_t *
+prefix_stats_probe(prefix_stats_table_t *table,
+                   const char *prefix)
+{
+  apr_ssize_t len = APR_HASH_KEY_STRING;
+  apr_uint32_t i = apr_hashfunc_default(prefix, &len);
+
+  while (TRUE)
+    {
+      prefix_stats_t *slot = &table->slots[i & (MAX_PREFIX_STATS - 1)];
+      const char *slot_prefix = slot->prefix;
+      if (slot_prefix == NULL || strcmp(slot_prefix, prefix) == 0)
+        return slot;
+
+      ++i;
+    }
+}
+
+/* Return the statistics for PREFIX in TABLE.  Fall back to TABLE->OTHER
+ * if PREFIX has not been added to TABLE.  May be called without holding
+ * TABLE->MUTEX.
+ */
+static prefix_stats_t *
+prefix_stats_find(prefix_stats_table_t *table,
+                  const char *prefix)
+{
+  prefix_stats_t *slot = prefix_stats_probe(table, prefix);
+  return slot->prefix ? slot : &table->other;
+}
+
+/* Set *STATS to the statistics for PREFIX in TABLE.  Add a slot for PREFIX
+ * if necessary.  If TABLE is full, fall back to TABLE->OTHER.
+ * To be called by prefix_stats_get() only. */
+static svn_error_t *
+prefix_stats_get_internal(prefix_stats_t **stats,
+                          prefix_stats_table_t *table,
+                          const char *prefix)
+{
+  prefix_stats_t *slot = prefix_stats_probe(table, prefix);
+  if (slot->prefix == NULL)
+    {
+      if (table->used >= MAX_PREFIX_STATS / 4 * 3)
+        {
+          *stats = &table->other;
+          return SVN_NO_ERROR;
+        }
+
+      /* Publish the prefix only after the copy is complete. */
+      apr_atomic_casptr((volatile void **)&slot->prefix,
+                        apr_pstrdup(table->pool, prefix), NULL);
+      ++table->used;
+    }
+
+  *stats = slot;
+  return SVN_NO_ERROR;
+}
+
+/* Thread-safe wrapper around prefix_stats_get_internal. */
+static svn_error_t *
+prefix_stats_get(prefix_stats_t **stats,
+                 prefix_stats_table_t *table,
+                 const char *prefix)
+{
+  SVN_MUTEX__WITH_LOCK(table->mutex,
+                       prefix_stats_get_internal(stats, table, prefix));
+
+  return SVN_NO_ERROR;
+}
+
 /* Debugging / corruption detection support.
  * If you define this macro, the getter functions will performed expensive
  * checks on the item data, requested keys and entry types. If there is
@@ -586,9 +846,13 @@ typedef struct entry_t
   apr_uint32_t previous;
 
   /* Priority of this entry.  This entry will not be replaced by lower-
-   * priority items.
+   * priority items.  Clamped to MAX_ENTRY_PRIORITY.
    */
-  apr_uint32_t priority;
+  apr_uint16_t priority;
+
+  /* Combination of ENTRY_* flags.  Only valid for used entries.
+   */
+  apr_uint16_t flags;
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
   /* Remember type, content and key hashes.
    */
@@ -707,6 +971,11 @@ struct svn_membuffer_t
    * use the one stored in this pool. */
   prefix_pool_t *prefix_pool;
 
+  /* Per-prefix access statistics, shared among all segments.  This is
+   * process-local data even if the segments are shared between processes.
+   */
+  prefix_stats_table_t *prefix_stats;
+
   /* The dictionary, GROUP_SIZE * (group_count + spare_group_count)
    * entries long.  Never NULL.
    */
@@ -796,6 +1065,42 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of items that the admission filter kept out of L2.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_rejects;
+
+  /* Frequency sketch, see SKETCH_DEPTH.  SKETCH_MASK + 1 counters,
+   * SKETCH_COUNTERS_PER_WORD per element.  Only to be modified atomically.
+   */
+  apr_uint32_t *sketch;
+  apr_uint32_t sketch_mask;
+
+  /* Number of counter updates since the last aging of the sketch.
+   * Only to be modified atomically.
+   */
+  apr_uint32_t sketch_additions;
+
+  /* Serialized items of at least this size get compressed before being
+   * stored.  0 disables compression.
+   * See svn_cache__membuffer_set_compression().
+   */
+  apr_size_t compression_threshold;
+
+  /* Number of items that have been stored in compressed form, their
+   * total size before and after compression and the number of times
+   * compressed items had to be expanded again.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_compressions;
+  apr_uint64_t total_uncompressed_size;
+  apr_uint64_t total_compressed_size;
+  apr_uint64_t total_decompressions;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -805,12 +1110,37 @@ struct svn_membuffer_t
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   /* Same for read-write lock. */
   apr_thread_rwlock_t *lock;
+#endif
+
+  /* If the segment is shared between processes, this points to the
+   * process-local handle of the system-wide lock for this segment.
+   * LOCK will be NULL in that case.  NULL for process-local segments.
+   *
+   * Since the segment header itself resides in shared memory, the handle
+   * is kept in process-local memory such that every child process can
+   * re-initialize its own copy after the fork.
+   */
+  apr_global_mutex_t **shared_lock;
 
   /* If set, write access will wait until they get exclusive access.
    * Otherwise, they will become no-ops if the segment is currently
-   * read-locked.  Only used when LOCK is an r/w lock.
+   * locked.  Only used when LOCK is an r/w lock or SHARED_LOCK is set.
    */
   svn_boolean_t allow_blocking_writes;
+
+#if USE_OPTIMISTIC_READS
+  /* Sequence counter for lock-free readers.  It is odd while a writer is
+   * modifying the segment and even otherwise.  Every modification of the
+   * segment changes the value.  Only accessed through the SEQUENCE_*
+   * macros and only updated while holding the write lock.
+   */
+  apr_uint32_t sequence;
+
+  /* Number of lock-free read attempts that collided with a writer and
+   * had to be repeated or fall back to the read lock.  Statistics only,
+   * updated atomically because it is shared between readers.
+   */
+  apr_uint32_t read_conflicts;
 #endif
 
   /* A write lock counter, must be either 0 or 1.
@@ -828,6 +1158,15 @@ struct svn_membuffer_t
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(*cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1190,30 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status;
+      if (cache->allow_blocking_writes)
+        {
+          status = apr_global_mutex_lock(*cache->shared_lock);
+        }
+      else
+        {
+          status = apr_global_mutex_trylock(*cache->shared_lock);
+          if (SVN_LOCK_IS_BUSY(status))
+            {
+              *success = FALSE;
+              status = APR_SUCCESS;
+            }
+        }
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,6 +1251,16 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(*cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -908,6 +1281,18 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(*cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1312,48 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Atomically read the sequence counter of segment CACHE such that no
+ * subsequent memory read may be reordered before it.
+ */
+#define SEQUENCE_READ_BEGIN(cache) \
+  __atomic_load_n(&(cache)->sequence, __ATOMIC_ACQUIRE)
+
+/* Atomically read the sequence counter of segment CACHE such that no
+ * preceding memory read may be reordered after it.
+ */
+#define SEQUENCE_READ_END(cache) \
+  (__atomic_thread_fence(__ATOMIC_ACQUIRE), \
+   __atomic_load_n(&(cache)->sequence, __ATOMIC_RELAXED))
+
+#endif
+
+/* Tell lock-free readers that CACHE is about to be modified.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_modification(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  __atomic_store_n(&cache->sequence, cache->sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/* Tell lock-free readers that the modification of CACHE has been
+ * completed.  The caller must still hold the write lock.  Return ERR.
+ */
+static APR_INLINE svn_error_t *
+end_modification(svn_membuffer_t *cache, svn_error_t *err)
+{
+#if USE_OPTIMISTIC_READS
+  __atomic_store_n(&cache->sequence, cache->sequence + 1, __ATOMIC_RELEASE);
+#endif
+
+  return err;
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -945,6 +1372,9 @@ do {                                        \
  * Once we discovered such an entry, we unconditionally do a blocking
  * wait for the write lock.  In case no old content could be found, a
  * failing lock attempt is simply a no-op and we exit the macro.
+ *
+ * Lock-free readers get notified of the modification through the
+ * segment's sequence counter.
  */
 #define WITH_WRITE_LOCK(cache, expr)                            \
 do {                                                            \
@@ -959,7 +1389,9 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_modification(cache);                                    \
+  SVN_ERR(unlock_cache(cache,                                   \
+                       end_modification(cache, (expr))));       \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1118,6 +1550,32 @@ get_cache_level(svn_membuffer_t *cache, entry_t *entry)
                                         : &cache->l2;
 }
 
+/* Return the key prefix of the used ENTRY in CACHE.  Return an empty
+ * string if the prefix cannot be determined.
+ */
+static const char *
+get_entry_prefix(svn_membuffer_t *cache, entry_t *entry)
+{
+  const char *key;
+  if (entry->key.prefix_idx != NO_INDEX)
+    return cache->prefix_pool->values[entry->key.prefix_idx];
+
+  /* Full keys start with the NUL-terminated prefix. */
+  key = (const char *)cache->data + entry->offset;
+  return memchr(key, 0, entry->key.key_len) ? key : "";
+}
+
+/* Count the eviction of the used ENTRY in CACHE in the statistics of
+ * its key prefix.
+ */
+static void
+count_eviction(svn_membuffer_t *cache, entry_t *entry)
+{
+  svn_atomic_inc(&prefix_stats_find(cache->prefix_stats,
+                                    get_entry_prefix(cache,
+                                                     entry))->evictions);
+}
+
 /* Insert ENTRY to the chain of items that belong to LEVEL in CACHE.  IDX
  * is ENTRY's item index and is only given for efficiency.  The insertion
  * takes place just before LEVEL->NEXT.  *CACHE will not be modified.
@@ -1538,6 +1996,7 @@ find_entry(svn_membuffer_t *cache,
             if (entry != &to_shrink->entries[i])
               let_entry_age(cache, &to_shrink->entries[i]);
 
+          count_eviction(cache, entry);
           drop_entry(cache, entry);
         }
 
@@ -1617,6 +2076,202 @@ promote_entry(svn_membuffer_t *cache, entry_t *entry)
   chain_entry(cache, &cache->l2, entry, idx);
 }
 
+/* Return the index of the counter in row ROW of CACHE's frequency sketch
+ * that corresponds to KEY.
+ */
+static APR_INLINE apr_uint32_t
+sketch_index(svn_membuffer_t *cache,
+             const entry_key_t *key,
+             apr_uint32_t row)
+{
+  /* Derive independent hashes from the fingerprint (double hashing).
+   * The multiplication spreads the key bits across the upper half. */
+  apr_uint64_t hash = key->fingerprint[0]
+                    + row * (key->fingerprint[1] | 1);
+  hash *= APR_UINT64_C(0x9e3779b97f4a7c15);
+
+  return (apr_uint32_t)(hash >> 32) & cache->sketch_mask;
+}
+
+/* Return the value of counter INDEX in CACHE's frequency sketch.
+ */
+static APR_INLINE apr_uint32_t
+get_sketch_counter(svn_membuffer_t *cache,
+                   apr_uint32_t index)
+{
+  apr_uint32_t word = apr_atomic_read32(
+                        &cache->sketch[index / SKETCH_COUNTERS_PER_WORD]);
+  return (word >> (index % SKETCH_COUNTERS_PER_WORD * 4)) & 0xf;
+}
+
+/* Increment counter INDEX in CACHE's frequency sketch, unless it is no
+ * longer at COUNT, i.e. some other thread has already incremented it.
+ */
+static void
+increment_sketch_counter(svn_membuffer_t *cache,
+                         apr_uint32_t index,
+                         apr_uint32_t count)
+{
+  volatile apr_uint32_t *word
+    = &cache->sketch[index / SKETCH_COUNTERS_PER_WORD];
+  apr_uint32_t shift = index % SKETCH_COUNTERS_PER_WORD * 4;
+  apr_uint32_t old_word = apr_atomic_read32(word);
+
+  while (((old_word >> shift) & 0xf) == count)
+    {
+      apr_uint32_t found = apr_atomic_cas32(word,
+                                            old_word + (1u << shift),
+                                            old_word);
+      if (found == old_word)
+        break;
+
+      old_word = found;
+    }
+}
+
+/* Halve all counters in CACHE's frequency sketch.
+ */
+static void
+age_sketch(svn_membuffer_t *cache)
+{
+  apr_uint32_t i;
+  apr_uint32_t count = (cache->sketch_mask + 1) / SKETCH_COUNTERS_PER_WORD;
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_uint32_t old_word = apr_atomic_read32(&cache->sketch[i]);
+      while (TRUE)
+        {
+          /* Shift all nibbles right by one and drop the bits that moved
+           * into the neighboring counter. */
+          apr_uint32_t found
+            = apr_atomic_cas32(&cache->sketch[i],
+                               (old_word >> 1) & 0x77777777, old_word);
+          if (found == old_word)
+            break;
+
+          old_word = found;
+        }
+    }
+}
+
+/* Return the estimated number of recent accesses to KEY in CACHE.
+ */
+static apr_uint32_t
+estimate_frequency(svn_membuffer_t *cache,
+                   const entry_key_t *key)
+{
+  apr_uint32_t row;
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    result = MIN(result,
+                 get_sketch_counter(cache, sketch_index(cache, key, row)));
+
+  return result;
+}
+
+/* Count an access to KEY in the frequency sketch of CACHE.  This may be
+ * called concurrently from multiple threads and without holding the
+ * segment lock.
+ */
+static void
+record_access(svn_membuffer_t *cache,
+              const entry_key_t *key)
+{
+  apr_uint32_t row;
+  apr_uint32_t indexes[SKETCH_DEPTH];
+  apr_uint32_t counts[SKETCH_DEPTH];
+  apr_uint32_t count = SKETCH_MAX_COUNT;
+
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    {
+      indexes[row] = sketch_index(cache, key, row);
+      counts[row] = get_sketch_counter(cache, indexes[row]);
+      count = MIN(count, counts[row]);
+    }
+
+  /* Conservative update: Only increment the counters that determine the
+   * estimate.  This greatly reduces over-estimation due to collisions. */
+  if (count < SKETCH_MAX_COUNT)
+    for (row = 0; row < SKETCH_DEPTH; ++row)
+      if (counts[row] == count)
+        increment_sketch_counter(cache, indexes[row], count);
+
+  /* Let old accesses fade away.  Only the thread that reaches the limit
+   * does the aging.  Updates that race with it may get lost or be counted
+   * towards the next period, which does not matter for an estimate. */
+  if (apr_atomic_inc32(&cache->sketch_additions) + 1
+      == (cache->sketch_mask + 1) * SKETCH_SAMPLE_FACTOR)
+    {
+      age_sketch(cache);
+      apr_atomic_set32(&cache->sketch_additions, 0);
+    }
+}
+
+#if USE_OPTIMISTIC_READS
+
+/* Number of read accesses of the current thread to any membuffer cache.
+ * Used to select the reads that update the frequency sketch.
+ */
+static __thread apr_uint32_t sketch_sample_counter = 0;
+
+#endif
+
+/* Like record_access() but for cache reads of KEY in CACHE.  Readers
+ * don't hold a lock that would keep them apart, so only record a sample
+ * of the reads if lock-free reads are enabled.
+ */
+static void
+record_read_access(svn_membuffer_t *cache,
+                   const entry_key_t *key)
+{
+#if USE_OPTIMISTIC_READS
+  if ((++sketch_sample_counter & (SKETCH_READ_SAMPLE_RATE - 1)) != 0)
+    return;
+#endif
+
+  record_access(cache, key);
+}
+
+/* This is the admission filter for L2 of CACHE.  Return TRUE, if an item
+ * with KEY, SIZE and PRIORITY may be inserted into L2.
+ *
+ * As long as there is room in L2, everything gets admitted.  Otherwise,
+ * the item must have been accessed at least as often recently as the
+ * next entry to be evicted from L2.  That keeps one-shot items of bulk
+ * operations from displacing the working set.  L1 acts as the window for
+ * new items and admits them unconditionally, i.e. new items always get
+ * the chance to prove their worth.
+ */
+static svn_boolean_t
+admit_to_l2(svn_membuffer_t *cache,
+            const entry_key_t *key,
+            apr_size_t size,
+            apr_uint32_t priority)
+{
+  apr_uint32_t victim = cache->l2.next;
+  apr_uint64_t end = victim == NO_INDEX
+                   ? cache->l2.start_offset + cache->l2.size
+                   : get_entry(cache, victim)->offset;
+
+  if (   priority >= SVN_CACHE__MEMBUFFER_HIGH_PRIORITY
+      || end - cache->l2.current_data >= size)
+    return TRUE;
+
+  /* We will wrap around to the start of the L2 buffer. */
+  if (victim == NO_INDEX)
+    victim = cache->l2.first;
+
+  if (   victim == NO_INDEX
+      || estimate_frequency(cache, key)
+           >= estimate_frequency(cache, &get_entry(cache, victim)->key))
+    return TRUE;
+
+  cache->total_rejects++;
+  return FALSE;
+}
+
 /* This function implements the cache insertion / eviction strategy for L2.
  *
  * If necessary, enlarge the insertion window of CACHE->L2 until it is at
@@ -1755,6 +2410,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
               if (entry->priority > SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
                 drop_hits += entry->hit_count * (apr_uint64_t)entry->priority;
 
+              count_eviction(cache, entry);
               drop_entry(cache, entry);
             }
         }
@@ -1815,15 +2471,22 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
           /* Remove the entry from the end of insertion window and promote
            * it to L2, if it is important enough.
            */
-          svn_boolean_t keep = ensure_data_insertable_l2(cache, entry);
+          svn_boolean_t keep
+            =    admit_to_l2(cache, &entry->key, entry->size, entry->priority)
+              && ensure_data_insertable_l2(cache, entry);
 
           /* We might have touched the group that contains ENTRY. Recheck. */
           if (entry_index == cache->l1.next)
             {
               if (keep)
-                promote_entry(cache, entry);
+                {
+                  promote_entry(cache, entry);
+                }
               else
-                drop_entry(cache, entry);
+                {
+                  count_eviction(cache, entry);
+                  drop_entry(cache, entry);
+                }
             }
         }
     }
@@ -1832,17 +2495,86 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Return a SIZE bytes block of uninitialized memory.  If *SHM_CURSOR is
+ * not NULL, take the block from the shared memory it points to and advance
+ * the cursor.  Otherwise, allocate the block in POOL.
+ */
+static void *
+allocate_block(char **shm_cursor,
+               apr_size_t size,
+               apr_pool_t *pool)
+{
+  void *result;
+  if (*shm_cursor == NULL)
+    return apr_palloc(pool, size);
+
+  result = *shm_cursor;
+  *shm_cursor += ALIGN_VALUE(size);
+
+  return result;
+}
+
+/* Process-independent resources of a shared membuffer cache.
+ */
+typedef struct shared_resources_t
+{
+  /* Unmanaged pool that holds the shared memory and the system-wide locks.
+   * Being unmanaged, it will not be destroyed implicitly when a forked
+   * child terminates APR. */
+  apr_pool_t *pool;
+
+#if APR_HAS_FORK
+  /* The process that created the cache.  Only this one may release it. */
+  pid_t owner;
+#endif
+} shared_resources_t;
+
+/* Cleanup function for shared memory caches.  DATA is the
+ * shared_resources_t of the cache.
+ *
+ * Forked children inherit the pool that this cleanup is registered with
+ * and run it when they destroy that pool, e.g. on their way out.  They
+ * must not release the shared memory nor the locks, though, because the
+ * parent and the other children still use them.  So, do nothing unless
+ * we are the process that created the cache.
+ */
+static apr_status_t
+release_shared_resources(void *data)
+{
+  shared_resources_t *resources = data;
+
+#if APR_HAS_FORK
+  if (resources->owner != getpid())
+    return APR_SUCCESS;
+#endif
+
+  svn_pool_destroy(resources->pool);
+  return APR_SUCCESS;
+}
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, allocate
+ * all segments in a single shared memory block that is backed by SHM_FILE
+ * or, if that is NULL, by anonymous shared memory and serialize access
+ * with system-wide locks.  THREAD_SAFE is implied in that case.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       const char *shm_file,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  prefix_stats_table_t *prefix_stats;
+  apr_global_mutex_t **shared_locks = NULL;
+  apr_pool_t *shared_pool = NULL;
+  char *shm_cursor = NULL;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1851,24 +2583,40 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint32_t group_init_size;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
+  apr_uint32_t sketch_width;
+  apr_size_t max_segment_count = shared ? MAX_SHARED_SEGMENT_COUNT
+                                        : MAX_SEGMENT_COUNT;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   *
+   * The prefix pool is process-local data and its indexes would diverge
+   * between processes.  Disable it for shared caches such that they will
+   * always store the full keys.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  if (shared)
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, 0, TRUE, pool));
+    }
+  else
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100,
+                                 thread_safe, pool));
+      total_size -= total_size / 100;
+    }
+
+  SVN_ERR(prefix_stats_create(&prefix_stats, thread_safe || shared, pool));
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
 #if APR_SIZEOF_VOIDP > 4
-  if (total_size > MAX_SEGMENT_SIZE * MAX_SEGMENT_COUNT)
-    total_size = MAX_SEGMENT_SIZE * MAX_SEGMENT_COUNT;
+  if (total_size > MAX_SEGMENT_SIZE * max_segment_count)
+    total_size = MAX_SEGMENT_SIZE * max_segment_count;
 #endif
 
   /* Limit the segment count
    */
-  if (segment_count > MAX_SEGMENT_COUNT)
-    segment_count = MAX_SEGMENT_COUNT;
+  if (segment_count > max_segment_count)
+    segment_count = max_segment_count;
   if (segment_count * MIN_SEGMENT_SIZE > total_size)
     segment_count = total_size / MIN_SEGMENT_SIZE;
 
@@ -1900,6 +2648,8 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
         ++segment_count_shift;
 
       segment_count = (apr_size_t)1 << segment_count_shift;
+      if (segment_count > max_segment_count)
+        segment_count = max_segment_count;
     }
 
   /* If we have an extremely large cache (>512 GB), the default segment
@@ -1907,12 +2657,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
    * increase segmentation until we are under the threshold.
    */
   while (   total_size / segment_count > MAX_SEGMENT_SIZE
-         && segment_count < MAX_SEGMENT_COUNT)
+         && segment_count < max_segment_count)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,12 +2710,69 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* One frequency counter per entry (power of two). */
+  sketch_width = MIN_SKETCH_WIDTH;
+  while (   sketch_width < MAX_SKETCH_WIDTH
+         && sketch_width < (apr_uint64_t)group_count * GROUP_SIZE)
+    sketch_width *= 2;
+
+  /* For shared caches, get one block of shared memory large enough for
+   * all segment headers and data.  The system-wide locks, however, must
+   * be process-local objects because every child will have to attach to
+   * them individually after the fork.
+   */
+  if (shared)
+    {
+      shared_resources_t *resources = apr_pcalloc(pool, sizeof(*resources));
+      apr_shm_t *shm;
+      apr_status_t status;
+      apr_size_t shm_size
+        = ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count
+          * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+             + ALIGN_VALUE(group_init_size)
+             + ALIGN_VALUE(sketch_width / 2)
+             + (apr_size_t)ALIGN_VALUE(data_size));
+
+      /* Tie the lifetime of the shared resources to POOL in this process
+       * only.  The shared memory and the locks register their own cleanups
+       * with RESOURCES->POOL. */
+      resources->pool = svn_pool__create_unmanaged(FALSE);
+#if APR_HAS_FORK
+      resources->owner = getpid();
+#endif
+      apr_pool_cleanup_register(pool, resources, release_shared_resources,
+                                apr_pool_cleanup_null);
+
+      status = apr_shm_create(&shm, shm_size, shm_file, resources->pool);
+      if (status && shm_file && APR_STATUS_IS_EEXIST(status))
+        {
+          /* Left over from a previous server instance.  Replace it. */
+          apr_shm_remove(shm_file, resources->pool);
+          status = apr_shm_create(&shm, shm_size, shm_file, resources->pool);
+        }
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      shm_cursor = apr_shm_baseaddr_get(shm);
+      shared_locks = apr_pcalloc(resources->pool,
+                                 segment_count * sizeof(*shared_locks));
+      shared_pool = resources->pool;
+    }
+
+  /* allocate cache as an array of segments / cache objects */
+  c = allocate_block(&shm_cursor, segment_count * sizeof(*c), pool);
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
        */
       c[seg].segment_count = (apr_uint32_t)segment_count;
       c[seg].prefix_pool = prefix_pool;
+      c[seg].prefix_stats = prefix_stats;
 
       c[seg].group_count = main_group_count;
       c[seg].spare_group_count = spare_group_count;
@@ -1978,12 +2782,22 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = allocate_block(&shm_cursor,
+                                        group_count * sizeof(entry_group_t),
+                                        pool);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = allocate_block(&shm_cursor, group_init_size,
+                                                pool);
+      memset(c[seg].group_initialized, 0, group_init_size);
+
+      /* Nothing has been accessed so far. */
+      c[seg].sketch = allocate_block(&shm_cursor, sketch_width / 2, pool);
+      memset(c[seg].sketch, 0, sketch_width / 2);
+      c[seg].sketch_mask = sketch_width - 1;
+      c[seg].sketch_additions = 0;
+      c[seg].compression_threshold = 0;
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2818,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = allocate_block(&shm_cursor,
+                                   (apr_size_t)ALIGN_VALUE(data_size),
+                                   pool);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2012,6 +2828,11 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].total_rejects = 0;
+      c[seg].total_compressions = 0;
+      c[seg].total_uncompressed_size = 0;
+      c[seg].total_compressed_size = 0;
+      c[seg].total_decompressions = 0;
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
@@ -2023,6 +2844,23 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
           return svn_error_wrap_apr(APR_ENOMEM, "OOM");
         }
 
+      /* A system-wide lock for inter-process synchronization.  It also
+       * serializes access between threads of the same process, so we
+       * don't need a separate intra-process lock.
+       */
+      c[seg].shared_lock = NULL;
+      if (shared)
+        {
+          apr_status_t status =
+              apr_global_mutex_create(&shared_locks[seg], NULL,
+                                      APR_LOCK_DEFAULT, shared_pool);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+
+          c[seg].shared_lock = &shared_locks[seg];
+          thread_safe = FALSE;
+        }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
@@ -2039,13 +2877,17 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
           if (status)
             return svn_error_wrap_apr(status, _("Can't create cache mutex"));
         }
+#endif
 
       /* Select the behavior of write operations.
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
-#endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+#if USE_OPTIMISTIC_READS
+      c[seg].sequence = 0;
+      c[seg].read_conflicts = 0;
+#endif
     }
 
   /* done here
@@ -2054,6 +2896,68 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, NULL, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         const char *shm_file,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE,
+                                                allow_blocking_writes,
+                                                TRUE, shm_file, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool)
+{
+  apr_uint32_t seg;
+
+  if (cache == NULL || cache->shared_lock == NULL)
+    return SVN_NO_ERROR;
+
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      apr_status_t status
+        = apr_global_mutex_child_init(cache[seg].shared_lock, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't re-open cache mutex in child"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_cache__membuffer_set_compression(svn_membuffer_t *cache,
+                                     apr_size_t threshold)
+{
+  apr_uint32_t seg;
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    cache[seg].compression_threshold = threshold;
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
@@ -2078,6 +2982,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_modification(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
@@ -2085,6 +2990,10 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
 
       memset(cache[seg].group_initialized, 0, group_init_size);
 
+      /* Forget access history. */
+      memset(cache[seg].sketch, 0, (cache[seg].sketch_mask + 1) / 2);
+      cache[seg].sketch_additions = 0;
+
       /* Unlink L1 contents. */
       cache[seg].l1.first = NO_INDEX;
       cache[seg].l1.last = NO_INDEX;
@@ -2102,7 +3011,8 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache(&cache[seg],
+                           end_modification(&cache[seg], SVN_NO_ERROR)));
     }
 
   /* done here */
@@ -2143,12 +3053,13 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Given the SIZE and PRIORITY of a new item, return the cache level
+/* Given the KEY, SIZE and PRIORITY of a new item, return the cache level
    (L1 or L2) in fragment CACHE that this item shall be inserted into.
    If we can't find nor make enough room for the item, return NULL.
  */
 static cache_level_t *
 select_level(svn_membuffer_t *cache,
+             const entry_key_t *key,
              apr_size_t size,
              apr_uint32_t priority)
 {
@@ -2161,11 +3072,12 @@ select_level(svn_membuffer_t *cache,
     }
   else if (   cache->l2.size >= size
            && MAX_ITEM_SIZE >= size
-           && priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
+           && priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY
+           && admit_to_l2(cache, key, size, priority))
     {
       /* Large but important items go into L2. */
       entry_t dummy_entry = { { { 0 } } };
-      dummy_entry.priority = priority;
+      dummy_entry.priority = (apr_uint16_t)MIN(priority, MAX_ENTRY_PRIORITY);
       dummy_entry.size = size;
 
       return ensure_data_insertable_l2(cache, &dummy_entry)
@@ -2179,7 +3091,8 @@ select_level(svn_membuffer_t *cache,
 
 /* Try to insert the serialized item given in BUFFER with ITEM_SIZE
  * into the group GROUP_INDEX of CACHE and uniquely identify it by
- * hash value TO_FIND.
+ * hash value TO_FIND.  FLAGS is a combination of ENTRY_* flags that
+ * describe the contents of BUFFER.
  *
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated with TO_FIND,
@@ -2196,6 +3109,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
                              char *buffer,
                              apr_size_t item_size,
                              apr_uint32_t priority,
+                             apr_uint16_t flags,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *scratch_pool)
 {
@@ -2209,6 +3123,9 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
    * membuffer in single-threaded mode. */
   assert(0 == svn_atomic_inc(&cache->write_lock_count));
 
+  /* Writing an item counts as an access, too. */
+  record_access(cache, &to_find->entry_key);
+
   /* Quick check make sure arithmetics will work further down the road. */
   size = item_size + to_find->entry_key.key_len;
   if (size < item_size)
@@ -2229,7 +3146,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        */
       cache->data_used += (apr_uint64_t)size - entry->size;
       entry->size = size;
-      entry->priority = priority;
+      entry->priority = (apr_uint16_t)MIN(priority, MAX_ENTRY_PRIORITY);
+      entry->flags = flags;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
 
@@ -2257,7 +3175,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
 
   /* if necessary, enlarge the insertion window.
    */
-  level = buffer ? select_level(cache, size, priority) : NULL;
+  level = buffer ? select_level(cache, &to_find->entry_key, size, priority)
+                 : NULL;
   if (level)
     {
       /* Remove old data for this key, if that exists.
@@ -2267,7 +3186,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
       entry = find_entry(cache, group_index, to_find, TRUE);
       entry->size = size;
       entry->offset = level->current_data;
-      entry->priority = priority;
+      entry->priority = (apr_uint16_t)MIN(priority, MAX_ENTRY_PRIORITY);
+      entry->flags = flags;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
 
@@ -2310,6 +3230,79 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* If compression has been enabled for CACHE and the serialized item in
+ * *BUFFER of *SIZE bytes is large enough, try to compress it.  If that
+ * saves space, replace *BUFFER and *SIZE with the compressed data and
+ * add ENTRY_COMPRESSED to *FLAGS.  Allocate the result in RESULT_POOL.
+ *
+ * This is being called before the segment gets locked, so the other
+ * threads will not have to wait for the compression to finish.
+ */
+static svn_error_t *
+maybe_compress(svn_membuffer_t *cache,
+               void **buffer,
+               apr_size_t *size,
+               apr_uint16_t *flags,
+               apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *compressed;
+
+  if (   cache->compression_threshold == 0
+      || *size < cache->compression_threshold
+      || *size > MAX_COMPRESSIBLE_SIZE)
+    return SVN_NO_ERROR;
+
+  compressed = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn__compress_lz4(*buffer, *size, compressed));
+
+  /* svn__compress_lz4 falls back to storing the data as-is, including
+   * some header, if it could not be compressed.  Keep the original in
+   * that case as it is cheaper to read. */
+  if (compressed->len < *size)
+    {
+      /* These are for stats only, see svn_membuffer_t. */
+      cache->total_compressions++;
+      cache->total_uncompressed_size += *size;
+      cache->total_compressed_size += compressed->len;
+
+      *buffer = compressed->data;
+      *size = compressed->len;
+      *flags |= ENTRY_COMPRESSED;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* If FLAGS indicate that the SIZE bytes of item data in *BUFFER have been
+ * compressed, replace *BUFFER and *SIZE with the expanded data allocated
+ * in RESULT_POOL.  Otherwise, leave them as they are.  CACHE is the
+ * segment that the item has been read from.
+ */
+static svn_error_t *
+maybe_decompress(svn_membuffer_t *cache,
+                 const void **buffer,
+                 apr_size_t *size,
+                 apr_uint16_t flags,
+                 apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *expanded;
+
+  if ((flags & ENTRY_COMPRESSED) == 0)
+    return SVN_NO_ERROR;
+
+  expanded = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn__decompress_lz4(*buffer, *size, expanded,
+                              MAX_COMPRESSIBLE_SIZE));
+
+  /* This is for stats only, see svn_membuffer_t. */
+  cache->total_decompressions++;
+
+  *buffer = expanded->data;
+  *size = expanded->len;
+
+  return SVN_NO_ERROR;
+}
+
 /* Try to insert the ITEM and use the KEY to uniquely identify it.
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated to the KEY,
@@ -2331,6 +3324,7 @@ membuffer_cache_set(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   void *buffer = NULL;
   apr_size_t size = 0;
+  apr_uint16_t flags = 0;
 
   /* find the entry group that will hold the key.
    */
@@ -2339,7 +3333,10 @@ membuffer_cache_set(svn_membuffer_t *cache,
   /* Serialize data data.
    */
   if (item)
-    SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
+    {
+      SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
+      SVN_ERR(maybe_compress(cache, &buffer, &size, &flags, scratch_pool));
+    }
 
   /* The actual cache data access needs to sync'ed
    */
@@ -2350,11 +3347,452 @@ membuffer_cache_set(svn_membuffer_t *cache,
                                                buffer,
                                                size,
                                                priority,
+                                               flags,
                                                DEBUG_CACHE_MEMBUFFER_TAG
                                                scratch_pool));
   return SVN_NO_ERROR;
 }
 
+/* Snapshot files start with this header.  Since they contain the items in
+ * their serialized form, which depends on the platform and on the data
+ * structure layout of the respective Subversion release, only snapshots
+ * written by the same build configuration may be loaded.
+ */
+typedef struct snapshot_header_t
+{
+  /* Always SNAPSHOT_MAGIC. */
+  char magic[8];
+
+  /* Always SNAPSHOT_FORMAT. */
+  apr_uint32_t format;
+
+  /* Always SNAPSHOT_ENDIAN_PROBE, in native byte order. */
+  apr_uint32_t endian_probe;
+
+  /* sizeof(void *) of the writer. */
+  apr_uint32_t pointer_size;
+
+  /* Non-zero if the writer used SVN_DEBUG_CACHE_MEMBUFFER. */
+  apr_uint32_t debug_tags;
+
+  /* SVN_VER_NUMBER of the writer, 0-padded. */
+  char version[32];
+} snapshot_header_t;
+
+#define SNAPSHOT_MAGIC "SVNMBUF"
+#define SNAPSHOT_FORMAT 2
+#define SNAPSHOT_ENDIAN_PROBE 0x01020304
+
+/* Snapshot writers and readers synchronize through a lock file whose
+ * name is the snapshot path plus this suffix. */
+#define SNAPSHOT_LOCK_SUFFIX ".lock"
+
+/* Every cache entry in a snapshot file is being described by this record.
+ * It is followed by PREFIX_LEN bytes of the shared key prefix (without
+ * terminating NUL), KEY_LEN bytes of the full key and ITEM_SIZE bytes of
+ * serialized item data.  In debug builds, the entry's tag follows.
+ */
+typedef struct snapshot_record_t
+{
+  /* Copy of entry_key_t.fingerprint. */
+  apr_uint64_t fingerprint[2];
+
+  /* Length of the shared key prefix.  0 for entries that store the full
+   * key, i.e. if KEY_LEN > 0. */
+  apr_uint32_t prefix_len;
+
+  /* Copy of entry_key_t.key_len. */
+  apr_uint32_t key_len;
+
+  /* Size of the serialized item without the key. */
+  apr_uint32_t item_size;
+
+  /* Copies of the respective entry_t elements. */
+  apr_uint32_t priority;
+  apr_uint32_t hit_count;
+  apr_uint32_t flags;
+} snapshot_record_t;
+
+/* Upper limit for snapshot_record_t.prefix_len.  Anything longer indicates
+ * a corrupted snapshot file. */
+#define MAX_SNAPSHOT_PREFIX_LEN 0x10000
+
+/* Write all entries of LEVEL in segment CACHE to STREAM.  Use SCRATCH_POOL
+ * for temporary allocations.
+ *
+ * Note: This function requires the caller to serialize access.
+ * Don't call it directly, call save_segment instead.
+ */
+static svn_error_t *
+save_level(svn_membuffer_t *cache,
+           cache_level_t *level,
+           svn_stream_t *stream,
+           apr_pool_t *scratch_pool)
+{
+  apr_uint32_t idx;
+  for (idx = level->first; idx != NO_INDEX; idx = get_entry(cache, idx)->next)
+    {
+      entry_t *entry = get_entry(cache, idx);
+      const char *prefix = "";
+      const char *data = (const char *)cache->data + entry->offset;
+      snapshot_record_t record;
+      apr_size_t len;
+
+      /* Entries in the shared prefix only store a short key. */
+      if (entry->key.prefix_idx != NO_INDEX)
+        prefix = cache->prefix_pool->values[entry->key.prefix_idx];
+
+      memset(&record, 0, sizeof(record));
+      record.fingerprint[0] = entry->key.fingerprint[0];
+      record.fingerprint[1] = entry->key.fingerprint[1];
+      record.prefix_len = (apr_uint32_t)strlen(prefix);
+      record.key_len = (apr_uint32_t)entry->key.key_len;
+      record.item_size = (apr_uint32_t)(entry->size - entry->key.key_len);
+      record.priority = entry->priority;
+      record.hit_count = entry->hit_count;
+      record.flags = entry->flags;
+
+      len = sizeof(record);
+      SVN_ERR(svn_stream_write(stream, (const char *)&record, &len));
+      len = record.prefix_len;
+      SVN_ERR(svn_stream_write(stream, prefix, &len));
+      len = entry->size;
+      SVN_ERR(svn_stream_write(stream, data, &len));
+
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+      len = sizeof(entry->tag);
+      SVN_ERR(svn_stream_write(stream, (const char *)&entry->tag, &len));
+#endif
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all entries in segment CACHE to STREAM.  Use SCRATCH_POOL for
+ * temporary allocations.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+save_segment(svn_membuffer_t *cache,
+             svn_stream_t *stream,
+             apr_pool_t *scratch_pool)
+{
+  /* Write L2 first because its contents have already proven useful and
+   * should get preferred treatment when loading into a smaller cache. */
+  SVN_ERR(save_level(cache, &cache->l2, stream, scratch_pool));
+  SVN_ERR(save_level(cache, &cache->l1, stream, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write HEADER followed by the contents of all segments of CACHE to
+ * STREAM.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+save_segments(svn_membuffer_t *cache,
+              svn_stream_t *stream,
+              const snapshot_header_t *header,
+              apr_pool_t *scratch_pool)
+{
+  apr_size_t len = sizeof(*header);
+  apr_uint32_t seg;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_stream_write(stream, (const char *)header, &len));
+
+  /* Segments are being locked one at a time, so the snapshot is not an
+   * atomic picture of the whole cache.  That is fine because there are
+   * no dependencies between cache entries. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_pool_clear(iterpool);
+      WITH_READ_LOCK(&cache[seg],
+                     save_segment(&cache[seg], stream, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Take the system-wide lock for the snapshot file at PATH, creating the
+ * lock file if necessary.  Block until it has been acquired.  The lock
+ * will be released when POOL gets cleaned up.
+ *
+ * Processes may save and load snapshots at the same time, e.g. when
+ * several server children exit while a new one starts.  The lock keeps
+ * them from replacing a file that another one is still reading, which
+ * is not possible on all platforms, and from interleaving their renames.
+ */
+static svn_error_t *
+lock_snapshot(const char *path,
+              apr_pool_t *pool)
+{
+  const char *lock_path = apr_pstrcat(pool, path, SNAPSHOT_LOCK_SUFFIX,
+                                      SVN_VA_NULL);
+  return svn_error_trace(svn_io__file_lock_autocreate(lock_path, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream;
+  const char *tmp_path;
+  snapshot_header_t header;
+  svn_error_t *err;
+  apr_pool_t *lock_pool = svn_pool_create(scratch_pool);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.format = SNAPSHOT_FORMAT;
+  header.endian_probe = SNAPSHOT_ENDIAN_PROBE;
+  header.pointer_size = sizeof(void *);
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+  header.debug_tags = 1;
+#endif
+  apr_cpystrn(header.version, SVN_VER_NUMBER, sizeof(header.version));
+
+  SVN_ERR(lock_snapshot(path, lock_pool));
+
+  /* Write to a temporary file first and move it into place when complete
+   * such that readers will never see partial snapshots. */
+  SVN_ERR(svn_stream_open_unique(&stream, &tmp_path,
+                                 svn_dirent_dirname(path, scratch_pool),
+                                 svn_io_file_del_none,
+                                 scratch_pool, scratch_pool));
+  err = save_segments(cache, stream, &header, scratch_pool);
+  err = svn_error_compose_create(err, svn_stream_close(stream));
+  if (!err)
+    err = svn_io_file_rename2(tmp_path, path, FALSE, scratch_pool);
+
+  /* Don't leave incomplete snapshots behind. */
+  if (err)
+    return svn_error_compose_create(err,
+                                    svn_io_remove_file2(tmp_path, TRUE,
+                                                        scratch_pool));
+
+  svn_pool_destroy(lock_pool);
+  return SVN_NO_ERROR;
+}
+
+/* Insert ITEM_SIZE bytes of serialized item data in BUFFER under KEY into
+ * group GROUP_INDEX of CACHE and give it the PRIORITY, FLAGS and HIT_COUNT
+ * given.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+load_entry_internal(svn_membuffer_t *cache,
+                    const full_key_t *key,
+                    apr_uint32_t group_index,
+                    char *buffer,
+                    apr_size_t item_size,
+                    apr_uint32_t priority,
+                    apr_uint16_t flags,
+                    apr_uint32_t hit_count,
+                    DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                    apr_pool_t *scratch_pool)
+{
+  entry_t *entry;
+
+  SVN_ERR(membuffer_cache_set_internal(cache, key, group_index, buffer,
+                                       item_size, priority, flags,
+                                       DEBUG_CACHE_MEMBUFFER_TAG
+                                       scratch_pool));
+
+  /* Restore the hit count as well, if the item made it into the cache. */
+  entry = find_entry(cache, group_index, key, FALSE);
+  if (entry)
+    entry->hit_count = hit_count;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_stream_t *stream;
+  svn_filesize_t remaining;
+  snapshot_header_t header;
+  snapshot_header_t expected;
+  svn_membuf_t prefix;
+  svn_membuf_t buffer;
+  full_key_t key_buf;
+  full_key_t *key = &key_buf;
+  apr_size_t len = sizeof(header);
+  svn_error_t *err;
+  apr_pool_t *lock_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool;
+
+  /* Don't read the file while another process replaces it. */
+  SVN_ERR(lock_snapshot(path, lock_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  err = svn_io_file_open(&file, path, APR_READ | APR_BUFFERED,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* No snapshot has been written, yet. */
+      svn_error_clear(err);
+      svn_pool_destroy(lock_pool);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* The lock keeps the file size stable.  We use it to validate the
+   * record sizes before allocating any buffers for them. */
+  SVN_ERR(svn_io_file_size_get(&remaining, file, scratch_pool));
+  stream = svn_stream_from_aprfile2(file, FALSE, scratch_pool);
+
+  /* Reject snapshots that have not been written by this very build
+   * configuration. */
+  memset(&expected, 0, sizeof(expected));
+  memcpy(expected.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  expected.format = SNAPSHOT_FORMAT;
+  expected.endian_probe = SNAPSHOT_ENDIAN_PROBE;
+  expected.pointer_size = sizeof(void *);
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+  expected.debug_tags = 1;
+#endif
+  apr_cpystrn(expected.version, SVN_VER_NUMBER, sizeof(expected.version));
+
+  SVN_ERR(svn_stream_read_full(stream, (char *)&header, &len));
+  if (len != sizeof(header) || memcmp(&header, &expected, sizeof(header)))
+    return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+                             _("Cache snapshot '%s' has been written by an "
+                               "incompatible version of Subversion"),
+                             svn_dirent_local_style(path, scratch_pool));
+  remaining -= len;
+
+  svn_membuf__create(&prefix, 256, scratch_pool);
+  svn_membuf__create(&buffer, 0x10000, scratch_pool);
+  svn_membuf__create(&key->full_key, 0, scratch_pool);
+
+  while (TRUE)
+    {
+      snapshot_record_t record;
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index;
+      apr_size_t size;
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+      entry_tag_t tag_buf;
+      entry_tag_t *tag = &tag_buf;
+#endif
+
+      svn_pool_clear(iterpool);
+
+      len = sizeof(record);
+      SVN_ERR(svn_stream_read_full(stream, (char *)&record, &len));
+      if (len == 0)
+        break;
+      remaining -= len;
+
+      size = (apr_size_t)record.key_len + record.item_size;
+      if (   len != sizeof(record)
+          || record.prefix_len > MAX_SNAPSHOT_PREFIX_LEN
+          || (record.prefix_len && record.key_len)
+          || (record.flags & ~ENTRY_COMPRESSED)
+          || size < record.item_size)
+        return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                                 _("Cache snapshot '%s' is corrupt"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+
+      /* Don't let a damaged file make us allocate arbitrary amounts of
+       * memory.  The cache would not accept larger entries anyway. */
+      if ((svn_filesize_t)record.prefix_len + size > remaining)
+        return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                                 _("Cache snapshot '%s' is truncated"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+      if (size > cache->max_entry_size)
+        return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                                 _("Cache snapshot '%s' contains entries "
+                                   "too large for this cache"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+      remaining -= record.prefix_len + size;
+
+      /* Read prefix, key and item data. */
+      svn_membuf__ensure(&prefix, record.prefix_len + 1);
+      len = record.prefix_len;
+      SVN_ERR(svn_stream_read_full(stream, prefix.data, &len));
+      ((char *)prefix.data)[len] = '\0';
+
+      svn_membuf__ensure(&buffer, MAX(size, 1));
+      if (len == record.prefix_len)
+        {
+          len = size;
+          SVN_ERR(svn_stream_read_full(stream, buffer.data, &len));
+        }
+
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+      if (len == size)
+        {
+          len = sizeof(*tag);
+          SVN_ERR(svn_stream_read_full(stream, (char *)tag, &len));
+          remaining -= len;
+          if (len == sizeof(*tag))
+            len = size;
+        }
+#endif
+
+      if (len != size)
+        return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                                 _("Cache snapshot '%s' is truncated"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+
+      /* Reconstruct the key.  Shared key prefixes get mapped to their
+       * index within this process' prefix pool.  The fingerprint does
+       * not depend on that index.  If the prefix cannot be added to the
+       * pool, the entry could not be found anyway, so skip it. */
+      key->entry_key.fingerprint[0] = record.fingerprint[0];
+      key->entry_key.fingerprint[1] = record.fingerprint[1];
+      key->entry_key.key_len = record.key_len;
+      key->entry_key.prefix_idx = NO_INDEX;
+
+      if (record.prefix_len)
+        {
+          SVN_ERR(prefix_pool_get(&key->entry_key.prefix_idx,
+                                  cache->prefix_pool, prefix.data));
+          if (key->entry_key.prefix_idx == NO_INDEX)
+            continue;
+        }
+      else
+        {
+          svn_membuf__ensure(&key->full_key, MAX(record.key_len, 1));
+          memcpy(key->full_key.data, buffer.data, record.key_len);
+        }
+
+      group_index = get_group_index(&segment, &key->entry_key);
+
+      WITH_WRITE_LOCK(segment,
+                      load_entry_internal(segment,
+                                          key,
+                                          group_index,
+                                          (char *)buffer.data
+                                            + record.key_len,
+                                          record.item_size,
+                                          record.priority,
+                                          (apr_uint16_t)record.flags,
+                                          record.hit_count,
+                                          DEBUG_CACHE_MEMBUFFER_TAG
+                                          iterpool));
+    }
+
+  SVN_ERR(svn_stream_close(stream));
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(lock_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Count a hit in ENTRY within CACHE.
  */
 static void
@@ -2370,11 +3808,286 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   cache->total_hits++;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Read the 32 bit VALUE exactly once, i.e. prevent the compiler from
+ * re-loading it from memory that might have been modified by a writer.
+ */
+#define READ_ONCE_UINT32(value) (*(volatile apr_uint32_t *)&(value))
+
+/* Number of lock-free cache accesses of the current thread.  Used to
+ * select the accesses that update the shared statistics.
+ */
+static __thread apr_uint32_t access_sample_counter = 0;
+
+/* Lock-free replacement for the TOTAL_READS update and the
+ * increment_hit_counters() call.  If this access to CACHE got selected
+ * for sampling, count it with a weight of HIT_SAMPLE_RATE.  ENTRY_INDEX
+ * identifies the entry that has been found and is NO_INDEX for misses.
+ */
+static void
+sample_access(svn_membuffer_t *cache, apr_uint32_t entry_index)
+{
+  if ((++access_sample_counter & (HIT_SAMPLE_RATE - 1)) != 0)
+    return;
+
+  /* These are for stats only, see svn_membuffer_t. */
+  cache->total_reads += HIT_SAMPLE_RATE;
+  if (entry_index != NO_INDEX)
+    {
+      cache->total_hits += HIT_SAMPLE_RATE;
+
+      /* A writer may have replaced the entry in the meantime.  At worst,
+       * this will give some other entry a slightly better chance to stay
+       * in the cache. */
+      apr_atomic_add32(&get_entry(cache, entry_index)->hit_count,
+                       HIT_SAMPLE_RATE);
+    }
+}
+
+/* Count a lock-free read of CACHE that collided with a writer.  This is
+ * rare enough for an atomic update to be cheap.
+ */
+static void
+count_read_conflict(svn_membuffer_t *cache)
+{
+  apr_atomic_inc32(&cache->read_conflicts);
+}
+
+/* Lock-free variant of find_entry() with FIND_EMPTY being FALSE.
+ *
+ * Look for the entry identified by TO_FIND in group GROUP_INDEX of CACHE,
+ * copy it to *RESULT and return its index.  Return NO_INDEX if no such
+ * entry could be found.
+ *
+ * Because writers may modify the directory at any time, every value read
+ * from it gets sanity-checked before being used for further memory access.
+ * The caller must validate the result against the sequence counter.
+ */
+static apr_uint32_t
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find,
+                      entry_t *result)
+{
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  apr_uint32_t chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return NO_INDEX;
+
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      entry_group_t *group = &cache->directory[group_index];
+      apr_uint32_t used = MIN(READ_ONCE_UINT32(group->header.used),
+                              GROUP_SIZE);
+      apr_uint32_t i;
+
+      for (i = 0; i < used; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            *result = group->entries[i];
+
+            /* Never access memory outside the data buffer. */
+            if (   !entry_keys_match(&result->key, &to_find->entry_key)
+                || result->size > MAX_ITEM_SIZE
+                || result->key.key_len > result->size
+                || result->offset > data_size
+                || ALIGN_VALUE(result->size) > data_size - result->offset)
+              return NO_INDEX;
+
+            /* Compare the full key, if required.  See find_entry(). */
+            if (   result->key.key_len
+                && memcmp(to_find->full_key.data,
+                          cache->data + result->offset,
+                          result->key.key_len) != 0)
+              return NO_INDEX;
+
+            return group_index * GROUP_SIZE + i;
+          }
+
+      /* Continue with the next group in the chain.  This also catches
+       * the NO_INDEX at the end of the chain. */
+      group_index = READ_ONCE_UINT32(group->header.next);
+      if (group_index >= group_limit)
+        return NO_INDEX;
+    }
+
+  return NO_INDEX;
+}
+
+/* Lock-free variant of membuffer_cache_get_internal().
+ *
+ * Try to look up the item identified by TO_FIND in group GROUP_INDEX of
+ * CACHE without taking the segment lock.  If that succeeds, set *BUFFER,
+ * *ITEM_SIZE and *FLAGS just like membuffer_cache_get_internal() and
+ * return TRUE.  Return FALSE if the lookup interfered with some writer, i.e.
+ * the caller must repeat it with the read lock held.  Allocations will
+ * be done in RESULT_POOL.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_uint16_t *flags,
+                               apr_pool_t *result_pool)
+{
+  int attempt;
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      entry_t entry;
+      apr_uint32_t entry_index;
+      apr_size_t size;
+
+      /* Don't wait for active writers. */
+      apr_uint32_t sequence = SEQUENCE_READ_BEGIN(cache);
+      if (sequence & 1)
+        {
+          count_read_conflict(cache);
+          return FALSE;
+        }
+
+      entry_index = find_entry_optimistic(cache, group_index, to_find,
+                                          &entry);
+
+      /* Don't allocate memory for stale or invalid data. */
+      if (SEQUENCE_READ_END(cache) != sequence)
+        {
+          count_read_conflict(cache);
+          continue;
+        }
+
+      if (entry_index == NO_INDEX)
+        {
+          sample_access(cache, NO_INDEX);
+          *buffer = NULL;
+          *item_size = 0;
+
+          return TRUE;
+        }
+
+      size = ALIGN_VALUE(entry.size) - entry.key.key_len;
+      *buffer = apr_palloc(result_pool, size);
+      memcpy(*buffer, cache->data + entry.offset + entry.key.key_len, size);
+
+      /* Did some writer modify the data while we were copying it? */
+      if (SEQUENCE_READ_END(cache) != sequence)
+        {
+          count_read_conflict(cache);
+          continue;
+        }
+
+      sample_access(cache, entry_index);
+      *item_size = entry.size - entry.key.key_len;
+      *flags = entry.flags;
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Lock-free variant of membuffer_cache_get_partial_internal().
+ *
+ * Try to look up the item identified by TO_FIND in group GROUP_INDEX of
+ * CACHE without taking the segment lock.  If that succeeds, set *DONE,
+ * copy the serialized item to a local buffer and then call DESERIALIZER
+ * with BATON just like membuffer_cache_get_partial_internal().  *ITEM
+ * and *FOUND are being set accordingly.
+ *
+ * Set *DONE to FALSE if the lookup interfered with some writer or if the
+ * item is too large to be copied or compressed.  In that case, the caller must repeat
+ * the lookup with the read lock held.  Allocations will be done in
+ * RESULT_POOL.
+ */
+static svn_error_t *
+membuffer_cache_get_partial_optimistic(svn_boolean_t *done,
+                                       svn_membuffer_t *cache,
+                                       apr_uint32_t group_index,
+                                       const full_key_t *to_find,
+                                       void **item,
+                                       svn_boolean_t *found,
+                                       svn_cache__partial_getter_func_t deserializer,
+                                       void *baton,
+                                       apr_pool_t *result_pool)
+{
+  /* Sufficiently aligned copy of the serialized item. */
+  apr_uint64_t copy[OPTIMISTIC_COPY_LIMIT / sizeof(apr_uint64_t)];
+  int attempt;
+
+  *done = FALSE;
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      entry_t entry;
+      apr_uint32_t entry_index;
+      apr_size_t item_size;
+
+      /* Don't wait for active writers. */
+      apr_uint32_t sequence = SEQUENCE_READ_BEGIN(cache);
+      if (sequence & 1)
+        {
+          count_read_conflict(cache);
+          return SVN_NO_ERROR;
+        }
+
+      entry_index = find_entry_optimistic(cache, group_index, to_find,
+                                          &entry);
+      if (entry_index == NO_INDEX)
+        {
+          if (SEQUENCE_READ_END(cache) != sequence)
+            {
+              count_read_conflict(cache);
+              continue;
+            }
+
+          sample_access(cache, NO_INDEX);
+          *item = NULL;
+          *found = FALSE;
+          *done = TRUE;
+
+          return SVN_NO_ERROR;
+        }
+
+      /* Large items are better read in-place under the read lock.
+       * Compressed items need to be expanded into a separate buffer
+       * anyway, so leave them to the locked code path as well. */
+      item_size = entry.size - entry.key.key_len;
+      if (item_size > sizeof(copy) || (entry.flags & ENTRY_COMPRESSED))
+        return SVN_NO_ERROR;
+
+      memcpy(copy, cache->data + entry.offset + entry.key.key_len,
+             item_size);
+
+      /* Did some writer modify the data while we were copying it? */
+      if (SEQUENCE_READ_END(cache) != sequence)
+        {
+          count_read_conflict(cache);
+          continue;
+        }
+
+      sample_access(cache, entry_index);
+      *found = TRUE;
+      *done = TRUE;
+
+      return svn_error_trace(deserializer(item, copy, item_size, baton,
+                                          result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
- * data in *BUFFER and return its size in *ITEM_SIZE. Allocations will
- * be done in POOL.
+ * data in *BUFFER and return its size in *ITEM_SIZE and the entry's
+ * ENTRY_* flags in *FLAGS. Allocations will be done in POOL.
  *
  * Note: This function requires the caller to serialization access.
  * Don't call it directly, call membuffer_cache_get instead.
@@ -2385,6 +4098,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
                              const full_key_t *to_find,
                              char **buffer,
                              apr_size_t *item_size,
+                             apr_uint16_t *flags,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *result_pool)
 {
@@ -2429,6 +4143,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
    */
   increment_hit_counters(cache, entry);
   *item_size = entry->size - entry->key.key_len;
+  *flags = entry->flags;
 
   return SVN_NO_ERROR;
 }
@@ -2448,19 +4163,37 @@ membuffer_cache_get(svn_membuffer_t *cache,
 {
   apr_uint32_t group_index;
   char *buffer;
+  const void *data;
   apr_size_t size;
+  apr_uint16_t flags = 0;
+  svn_boolean_t done = FALSE;
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+
+  /* Feed the admission filter.  Misses count as well because they will
+   * usually be followed by a write. */
+  record_read_access(cache, &key->entry_key);
+
+#if USE_OPTIMISTIC_READS
+  /* Try without locking the segment first. */
+  if (cache->lock || cache->shared_lock)
+    done = membuffer_cache_get_optimistic(cache, group_index, key,
+                                          &buffer, &size, &flags,
+                                          result_pool);
+#endif
+
+  if (!done)
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                &flags,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2470,7 +4203,11 @@ membuffer_cache_get(svn_membuffer_t *cache,
       return SVN_NO_ERROR;
     }
 
-  return deserializer(item, buffer, size, result_pool);
+  /* Expand compressed items outside the lock. */
+  data = buffer;
+  SVN_ERR(maybe_decompress(cache, &data, &size, flags, result_pool));
+
+  return deserializer(item, (void *)data, size, result_pool);
 }
 
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
@@ -2579,6 +4316,9 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      SVN_ERR(maybe_decompress(cache, &item_data, &item_size, entry->flags,
+                               result_pool));
+
       return deserializer(item, item_data, item_size, baton, result_pool);
     }
 }
@@ -2600,12 +4340,25 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                             apr_pool_t *result_pool)
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  svn_boolean_t done = FALSE;
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_partial_internal
-                     (cache, group_index, key, item, found,
-                      deserializer, baton, DEBUG_CACHE_MEMBUFFER_TAG
-                      result_pool));
+  record_read_access(cache, &key->entry_key);
+
+#if USE_OPTIMISTIC_READS
+  /* Try without locking the segment first. */
+  if (cache->lock || cache->shared_lock)
+    SVN_ERR(membuffer_cache_get_partial_optimistic(&done, cache, group_index,
+                                                   key, item, found,
+                                                   deserializer, baton,
+                                                   result_pool));
+#endif
+
+  if (!done)
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_partial_internal
+                       (cache, group_index, key, item, found,
+                        deserializer, baton, DEBUG_CACHE_MEMBUFFER_TAG
+                        result_pool));
 
   return SVN_NO_ERROR;
 }
@@ -2664,6 +4417,24 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      /* Compressed items cannot be modified in-situ.  Expanding them
+       * leaves ITEM_DATA != ORIG_DATA, i.e. the modified item will be
+       * written back in uncompressed form below.
+       */
+      if (entry->flags & ENTRY_COMPRESSED)
+        {
+          const void *data = item_data;
+          err = maybe_decompress(cache, &data, &item_size, entry->flags,
+                                 scratch_pool);
+          if (err)
+            {
+              drop_entry(cache, entry);
+              return err;
+            }
+
+          item_data = (void *)data;
+        }
+
       /* modify it, preferably in-situ.
        */
       err = func(&item_data, &item_size, baton, scratch_pool);
@@ -2698,6 +4469,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
                   entry = find_entry(cache, group_index, to_find, TRUE);
                   entry->size = item_size + key_len;
                   entry->offset = cache->l1.current_data;
+                  entry->flags = 0;
 
                   if (key_len)
                     memcpy(cache->data + entry->offset,
@@ -2799,6 +4571,10 @@ typedef struct svn_membuffer_cache_t
   /* priority class for all items written through this interface */
   apr_uint32_t priority;
 
+  /* access statistics for this instance's prefix.  May be shared with
+   * other prefixes. */
+  prefix_stats_t *stats;
+
   /* Temporary buffer containing the hash key for the current access
    */
   full_key_t combined_key;
@@ -2955,6 +4731,11 @@ svn_membuffer_cache_get(void **value_p,
   /* return result */
   *found = *value_p != NULL;
 
+  /* These are for stats only, see prefix_stats_t. */
+  svn_atomic_inc(&cache->stats->gets);
+  if (*found)
+    svn_atomic_inc(&cache->stats->hits);
+
   return SVN_NO_ERROR;
 }
 
@@ -3011,6 +4792,9 @@ svn_membuffer_cache_set(void *cache_void,
    */
   combine_key(cache, key, cache->key_len);
 
+  /* This is for stats only, see prefix_stats_t. */
+  svn_atomic_inc(&cache->stats->sets);
+
   /* (probably) add the item to the cache. But there is no real guarantee
    * that the item will actually be cached afterwards.
    */
@@ -3069,6 +4853,11 @@ svn_membuffer_cache_get_partial(void **value_p,
                                       DEBUG_CACHE_MEMBUFFER_TAG
                                       result_pool));
 
+  /* These are for stats only, see prefix_stats_t. */
+  svn_atomic_inc(&cache->stats->gets);
+  if (*found)
+    svn_atomic_inc(&cache->stats->hits);
+
   return SVN_NO_ERROR;
 }
 
@@ -3131,6 +4920,14 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
 
   info->used_entries += segment->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
+  info->rejects += segment->total_rejects;
+  info->compressions += segment->total_compressions;
+  info->uncompressed_size += segment->total_uncompressed_size;
+  info->compressed_size += segment->total_compressed_size;
+  info->decompressions += segment->total_decompressions;
+#if USE_OPTIMISTIC_READS
+  info->read_retries += apr_atomic_read32(&segment->read_conflicts);
+#endif
 
   if (include_histogram)
     for (i = 0; i < segment->group_count; ++i)
@@ -3186,7 +4983,8 @@ static svn_cache__vtable_t membuffer_cache_vtable = {
   svn_membuffer_cache_is_cachable,
   svn_membuffer_cache_get_partial,
   svn_membuffer_cache_set_partial,
-  svn_membuffer_cache_get_info
+  svn_membuffer_cache_get_info,
+  NULL                                    /* get_multi */
 };
 
 /* Implement svn_cache__vtable_t.get and serialize all cache access.
@@ -3299,7 +5097,8 @@ static svn_cache__vtable_t membuffer_cache_synced_vtable = {
   svn_membuffer_cache_is_cachable,        /* no sync required */
   svn_membuffer_cache_get_partial_synced,
   svn_membuffer_cache_set_partial_synced,
-  svn_membuffer_cache_get_info            /* no sync required */
+  svn_membuffer_cache_get_info,           /* no sync required */
+  NULL                                    /* get_multi */
 };
 
 /* standard serialization function for svn_stringbuf_t items.
@@ -3407,6 +5206,14 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
   else
     cache->prefix.prefix_idx = NO_INDEX;
 
+  /* Short-lived caches would fill the statistics table with prefixes
+   * that soon become meaningless. */
+  if (short_lived)
+    cache->stats = &membuffer->prefix_stats->other;
+  else
+    SVN_ERR(prefix_stats_get(&cache->stats, membuffer->prefix_stats,
+                             prefix));
+
   /* If key combining is not guaranteed to produce unique results, we have
    * to handle full keys.  Otherwise, leave it NULL. */
   if (cache->prefix.prefix_idx == NO_INDEX)
@@ -3478,3 +5285,118 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   return info;
 }
+
+/* Add the sizes of all entries in LEVEL of segment CACHE to USED_SIZE and
+ * count them in USED_ENTRIES.  Both arrays are indexed by the prefix
+ * statistics slot and have MAX_PREFIX_STATS + 1 elements, the last one
+ * being used for the "other" slot.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static void
+accumulate_level_usage(svn_membuffer_t *cache,
+                       cache_level_t *level,
+                       apr_uint64_t *used_size,
+                       apr_uint64_t *used_entries)
+{
+  prefix_stats_table_t *table = cache->prefix_stats;
+  apr_uint32_t idx;
+
+  for (idx = level->first; idx != NO_INDEX; idx = get_entry(cache, idx)->next)
+    {
+      entry_t *entry = get_entry(cache, idx);
+      prefix_stats_t *stats
+        = prefix_stats_find(table, get_entry_prefix(cache, entry));
+      apr_size_t slot = stats == &table->other
+                      ? MAX_PREFIX_STATS
+                      : stats - table->slots;
+
+      used_size[slot] += entry->size;
+      used_entries[slot]++;
+    }
+}
+
+/* Call accumulate_level_usage() for all levels of segment CACHE.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+accumulate_segment_usage(svn_membuffer_t *cache,
+                         apr_uint64_t *used_size,
+                         apr_uint64_t *used_entries)
+{
+  accumulate_level_usage(cache, &cache->l1, used_size, used_entries);
+  accumulate_level_usage(cache, &cache->l2, used_size, used_entries);
+
+  return SVN_NO_ERROR;
+}
+
+/* Sort svn_cache__prefix_info_t * by prefix.  Put the one without prefix
+ * last.  Implements the comparison function type of svn_sort__array(). */
+static int
+compare_prefix_info(const void *lhs, const void *rhs)
+{
+  const svn_cache__prefix_info_t *lhs_info
+    = *(const svn_cache__prefix_info_t * const *)lhs;
+  const svn_cache__prefix_info_t *rhs_info
+    = *(const svn_cache__prefix_info_t * const *)rhs;
+
+  if (lhs_info->prefix == NULL)
+    return rhs_info->prefix == NULL ? 0 : 1;
+  if (rhs_info->prefix == NULL)
+    return -1;
+
+  return strcmp(lhs_info->prefix, rhs_info->prefix);
+}
+
+svn_error_t *
+svn_cache__membuffer_get_prefix_info(apr_array_header_t **info,
+                                     svn_membuffer_t *cache,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool)
+{
+  prefix_stats_table_t *table = cache->prefix_stats;
+  apr_uint64_t *used_size
+    = apr_pcalloc(scratch_pool, (MAX_PREFIX_STATS + 1) * sizeof(*used_size));
+  apr_uint64_t *used_entries
+    = apr_pcalloc(scratch_pool,
+                  (MAX_PREFIX_STATS + 1) * sizeof(*used_entries));
+  apr_uint32_t seg;
+  apr_size_t i;
+
+  /* The prefix of an entry is only known to the segment it lives in. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    WITH_READ_LOCK(&cache[seg],
+                   accumulate_segment_usage(&cache[seg], used_size,
+                                            used_entries));
+
+  *info = apr_array_make(result_pool, table->used + 1,
+                         sizeof(svn_cache__prefix_info_t *));
+  for (i = 0; i <= MAX_PREFIX_STATS; ++i)
+    {
+      prefix_stats_t *stats = i < MAX_PREFIX_STATS ? &table->slots[i]
+                                                   : &table->other;
+      svn_cache__prefix_info_t *prefix_info;
+
+      /* Skip unused slots but always report the "other" slot. */
+      if (stats->prefix == NULL && stats != &table->other)
+        continue;
+
+      prefix_info = apr_pcalloc(result_pool, sizeof(*prefix_info));
+      prefix_info->prefix = stats->prefix
+                          ? apr_pstrdup(result_pool, stats->prefix)
+                          : NULL;
+      prefix_info->gets = svn_atomic_read(&stats->gets);
+      prefix_info->hits = svn_atomic_read(&stats->hits);
+      prefix_info->sets = svn_atomic_read(&stats->sets);
+      prefix_info->evictions = svn_atomic_read(&stats->evictions);
+      prefix_info->used_size = used_size[i];
+      prefix_info->used_entries = used_entries[i];
+
+      APR_ARRAY_PUSH(*info, svn_cache__prefix_info_t *) = prefix_info;
+    }
+
+  svn_sort__array(*info, compare_prefix_info);
+
+  return SVN_NO_ERROR;
+}
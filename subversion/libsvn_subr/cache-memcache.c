@@ -23,6 +23,7 @@
 
 #include <apr_md5.h>
 
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_base64.h"
 #include "svn_path.h"
@@ -390,6 +391,101 @@ memcache_get_info(void *cache_void,
   return SVN_NO_ERROR;
 }
 
+/* Core functionality of memcache_get_multi().  Send all COUNT KEYS to
+ * the memcached servers of CACHE in a single pipelined request instead of
+ * waiting for each reply in turn.  If VALUES is NULL, only set FOUND.
+ * Allocate the values in RESULT_POOL and temporaries in SCRATCH_POOL.
+ */
+static svn_error_t *
+memcache_internal_get_multi(void **values,
+                            svn_boolean_t *found,
+                            memcache_t *cache,
+                            const void *const *keys,
+                            int count,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  apr_hash_t *requests = apr_hash_make(scratch_pool);
+  const char **mc_keys = apr_pcalloc(scratch_pool, count * sizeof(*mc_keys));
+  apr_status_t apr_err;
+  int i;
+
+  for (i = 0; i < count; ++i)
+    if (keys[i])
+      {
+        SVN_ERR(build_key(&mc_keys[i], cache, keys[i], scratch_pool));
+        apr_memcache_add_multget_key(scratch_pool, mc_keys[i], &requests);
+      }
+
+  /* Nothing to look up? */
+  if (apr_hash_count(requests) == 0)
+    return SVN_NO_ERROR;
+
+  /* The values are allocated in RESULT_POOL and the protocol overhead
+     in SCRATCH_POOL. */
+  apr_err = apr_memcache_multgetp(cache->memcache, scratch_pool, result_pool,
+                                  requests);
+  if (apr_err != APR_SUCCESS)
+    return svn_error_wrap_apr(apr_err,
+                              _("Unknown memcached error while reading"));
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_memcache_value_t *reply;
+      if (mc_keys[i] == NULL)
+        continue;
+
+      reply = svn_hash_gets(requests, mc_keys[i]);
+      if (reply->status == APR_NOTFOUND)
+        continue;
+      else if (reply->status != APR_SUCCESS || !reply->data)
+        return svn_error_wrap_apr(reply->status,
+                                  _("Unknown memcached error while reading"));
+
+      found[i] = TRUE;
+      if (values == NULL)
+        continue;
+
+      /* Same as in memcache_get(). */
+      if (cache->deserialize_func)
+        {
+          SVN_ERR((cache->deserialize_func)(&values[i], reply->data,
+                                            reply->len, result_pool));
+        }
+      else
+        {
+          svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+          value->data = reply->data;
+          value->blocksize = reply->len;
+          value->len = reply->len - 1; /* account for trailing NUL */
+          values[i] = value;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement vtable.get_multi by calling memcache_internal_get_multi()
+ * and releasing its temporaries even if it fails.
+ */
+static svn_error_t *
+memcache_get_multi(void **values,
+                   svn_boolean_t *found,
+                   void *cache_void,
+                   const void *const *keys,
+                   int count,
+                   apr_pool_t *result_pool)
+{
+  /* The protocol overhead may be large, so release it right away. */
+  apr_pool_t *subpool = svn_pool_create(result_pool);
+  svn_error_t *err = memcache_internal_get_multi(values, found, cache_void,
+                                                 keys, count, result_pool,
+                                                 subpool);
+  svn_pool_destroy(subpool);
+
+  return svn_error_trace(err);
+}
+
 static svn_cache__vtable_t memcache_vtable = {
   memcache_get,
   memcache_has_key,
@@ -398,7 +494,8 @@ static svn_cache__vtable_t memcache_vtable = {
   memcache_is_cachable,
   memcache_get_partial,
   memcache_set_partial,
-  memcache_get_info
+  memcache_get_info,
+  memcache_get_multi
 };
 
 svn_error_t *
@@ -115,6 +115,72 @@ svn_cache__has_key(svn_boolean_t *found,
                       scratch_pool);
 }
 
+/* Default implementation of svn_cache__vtable_t.get_multi for cache
+   implementations that can't batch lookups: query each of the COUNT KEYS
+   in CACHE individually.  If VALUES is NULL, only check for presence. */
+static svn_error_t *
+get_multi_one_by_one(void **values,
+                     svn_boolean_t *found,
+                     svn_cache__t *cache,
+                     const void *const *keys,
+                     int count,
+                     apr_pool_t *result_pool)
+{
+  int i;
+  for (i = 0; i < count; ++i)
+    if (values)
+      SVN_ERR((cache->vtable->get)(&values[i], &found[i],
+                                   cache->cache_internal, keys[i],
+                                   result_pool));
+    else
+      SVN_ERR((cache->vtable->has_key)(&found[i], cache->cache_internal,
+                                       keys[i], result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__get_multi(void **values,
+                     svn_boolean_t *found,
+                     svn_cache__t *cache,
+                     const void *const *keys,
+                     int count,
+                     apr_pool_t *result_pool)
+{
+  svn_error_t *err;
+  int i;
+
+  /* In case any errors happen and are quelched, make sure we start
+     out with all of FOUND set to false. */
+  for (i = 0; i < count; ++i)
+    found[i] = FALSE;
+#ifdef SVN_DEBUG
+  if (cache->pretend_empty)
+    return SVN_NO_ERROR;
+#endif
+
+  if (count == 0)
+    return SVN_NO_ERROR;
+
+  if (cache->vtable->get_multi)
+    err = (cache->vtable->get_multi)(values, found, cache->cache_internal,
+                                     keys, count, result_pool);
+  else
+    err = get_multi_one_by_one(values, found, cache, keys, count,
+                               result_pool);
+
+  /* Presence checks don't count as reads, just like svn_cache__has_key. */
+  if (values)
+    {
+      cache->reads += count;
+      for (i = 0; i < count; ++i)
+        if (found[i])
+          cache->hits++;
+    }
+
+  return handle_error(cache, err, result_pool);
+}
+
 svn_error_t *
 svn_cache__set(svn_cache__t *cache,
                const void *key,
@@ -252,6 +318,14 @@ svn_cache__format_info(const svn_cache__info_t *info,
                   / (double)(info->gets ? info->gets : 1);
   double write_rate = (100.0 * (double)info->sets)
                     / (double)(misses ? misses : 1);
+  double reject_rate = (100.0 * (double)info->rejects)
+                     / (double)(info->sets ? info->sets : 1);
+  double compression_rate = (100.0 * (double)info->compressed_size)
+                 / (double)(info->uncompressed_size ? info->uncompressed_size
+                                                    : 1);
+  double contention_rate = (100.0 * (double)info->lock_contentions)
+                 / (double)(info->lock_acquisitions ? info->lock_acquisitions
+                                                    : 1);
   double data_usage_rate = (100.0 * (double)info->used_size)
                          / (double)(info->data_size ? info->data_size : 1);
   double data_entry_rate = (100.0 * (double)info->used_entries)
@@ -295,7 +369,14 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             ", %" APR_UINT64_T_FMT " hits (%5.2f%%)\n"
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
+                            "rejects : %" APR_UINT64_T_FMT
+                            " (%5.2f%% of sets)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "compress: %" APR_UINT64_T_FMT " items"
+                            " to %5.2f%% of %" APR_UINT64_T_FMT " kB"
+                            ", %" APR_UINT64_T_FMT " expansions\n"
+                            "locks   : %" APR_UINT64_T_FMT
+                            ", %" APR_UINT64_T_FMT " contended (%5.2f%%)\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
@@ -307,7 +388,13 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->gets,
                             info->hits, hit_rate,
                             info->sets, write_rate,
+                            info->rejects, reject_rate,
                             info->failures,
+                            info->compressions, compression_rate,
+                            info->uncompressed_size / 1024,
+                            info->decompressions,
+                            info->lock_acquisitions,
+                            info->lock_contentions, contention_rate,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
@@ -317,3 +404,45 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->total_entries,
                             histogram);
 }
+
+svn_string_t *
+svn_cache__format_prefix_info(const apr_array_header_t *info,
+                              apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
+  int i;
+
+  for (i = 0; i < info->nelts; ++i)
+    {
+      const svn_cache__prefix_info_t *prefix_info
+        = APR_ARRAY_IDX(info, i, const svn_cache__prefix_info_t *);
+
+      double hit_rate = (100.0 * (double)prefix_info->hits)
+                      / (double)(prefix_info->gets ? prefix_info->gets : 1);
+      apr_uint64_t average_size
+        = prefix_info->used_size
+        / (prefix_info->used_entries ? prefix_info->used_entries : 1);
+
+      svn_stringbuf_appendcstr(text,
+                               apr_psprintf(result_pool,
+                            "%s\n"
+                            "gets    : %" APR_UINT64_T_FMT
+                            ", %" APR_UINT64_T_FMT " hits (%5.2f%%)\n"
+                            "sets    : %" APR_UINT64_T_FMT
+                            ", %" APR_UINT64_T_FMT " evictions\n"
+                            "used    : %" APR_UINT64_T_FMT " kB"
+                            " in %" APR_UINT64_T_FMT " entries"
+                            " (%" APR_UINT64_T_FMT " bytes avg.)\n",
+                            prefix_info->prefix ? prefix_info->prefix
+                                                : "(other prefixes)",
+                            prefix_info->gets,
+                            prefix_info->hits, hit_rate,
+                            prefix_info->sets,
+                            prefix_info->evictions,
+                            prefix_info->used_size / 1024,
+                            prefix_info->used_entries,
+                            average_size));
+    }
+
+  return svn_string_create_from_buf(text, result_pool);
+}
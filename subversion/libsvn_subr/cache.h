@@ -82,6 +82,15 @@ typedef struct svn_cache__vtable_t {
                            svn_cache__info_t *info,
                            svn_boolean_t reset,
                            apr_pool_t *result_pool);
+
+  /* See svn_cache__get_multi().  May be NULL, in which case the keys
+     will be looked up one-by-one using get() or has_key(). */
+  svn_error_t *(*get_multi)(void **values,
+                            svn_boolean_t *found,
+                            void *cache_implementation,
+                            const void *const *keys,
+                            int count,
+                            apr_pool_t *result_pool);
 } svn_cache__vtable_t;
 
 struct svn_cache__t {
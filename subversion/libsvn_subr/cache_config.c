@@ -64,6 +64,18 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* Whether the process-global membuffer cache shall be allocated in shared
+ * memory and which file, if any, shall back it.
+ * See svn_cache__set_global_membuffer_shared().
+ */
+static svn_boolean_t cache_shared = FALSE;
+static const char *cache_shm_file = NULL;
+
+/* Compression threshold for the process-global membuffer cache.
+ * See svn_cache__set_global_membuffer_compression().
+ */
+static apr_size_t cache_compression_threshold = 0;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +132,24 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      if (cache_shared)
+        err = svn_cache__membuffer_cache_create_shared(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            cache_shm_file,
+            FALSE,
+            pool);
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -143,6 +165,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
           return svn_error_trace(err);
         }
 
+      svn_cache__membuffer_set_compression(cache,
+                                           cache_compression_threshold);
+
       /* done */
       *cache_p = cache;
     }
@@ -173,6 +198,20 @@ svn_cache__get_global_membuffer_cache(void)
   return cache;
 }
 
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared,
+                                       const char *shm_file)
+{
+  cache_shared = shared;
+  cache_shm_file = shm_file;
+}
+
+void
+svn_cache__set_global_membuffer_compression(apr_size_t threshold)
+{
+  cache_compression_threshold = threshold;
+}
+
 void
 svn_cache_config_set(const svn_cache_config_t *settings)
 {
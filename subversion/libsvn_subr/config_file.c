@@ -1511,6 +1511,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### to show meaningful differences for binary file formats.  [New"  NL
         "### in 1.9]"                                                        NL
         "# diff-ignore-content-type = no"                                    NL
+        "### Set diff-threads to the number of files that 'svn diff' may"    NL
+        "### compare concurrently when using the built-in diff.  The output" NL
+        "### is the same in any case.  [New in 1.14]"                        NL
+        "# diff-threads = 1"                                                 NL
         ""                                                                   NL
         "### Section for configuring automatic properties."                  NL
         "[auto-props]"                                                       NL
@@ -29,10 +29,35 @@
 #include "svn_io.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_string_private.h"
+
+#if SVN__SSE2_AVAILABLE
+#include <emmintrin.h>
+#endif
 
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len)
 {
+#if SVN__SSE2_AVAILABLE
+
+  /* Skip 16 bytes at a time.  The word loop below will narrow down the
+   * first chunk that contains an EOL char. */
+  {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    for (; len > sizeof(__m128i)
+         ; buf += sizeof(__m128i), len -= sizeof(__m128i))
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)buf);
+        __m128i eols = _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                    _mm_cmpeq_epi8(chunk, lf));
+        if (_mm_movemask_epi8(eols))
+          break;
+      }
+  }
+
+#endif
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
@@ -35,8 +35,37 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_dep_compat.h"
 
+
+/* Thread-safe object pools are split into this many shards, each with its
+ * own lock, such that lookups of different keys from different threads
+ * rarely contend.  Must be a power of 2.
+ */
+#define SHARD_COUNT 16
+
 
 
+/* A part of an object pool, holding all objects whose keys hash to it.
+ * All access to it must be serialized using MUTEX.
+ */
+typedef struct object_pool_shard_t
+{
+  /* serialization object for all non-atomic data in this struct */
+  svn_mutex__t *mutex;
+
+  /* OBJECTS and all temporaries are allocated in this pool.  For
+   * thread-safe object pools, this is a private root pool, such that
+   * no two shards ever allocate from the same pool. */
+  apr_pool_t *pool;
+
+  /* object_ref_t.KEY -> object_ref_t* mapping.
+   *
+   * In shared object mode, there is at most one such entry per key and it
+   * may or may not be in use.  In exclusive mode, only unused references
+   * will be put here and they form chains if there are multiple unused
+   * instances for the key. */
+  apr_hash_t *objects;
+} object_pool_shard_t;
+
 /* A reference counting wrapper around the user-provided object.
  */
 typedef struct object_ref_t
@@ -60,22 +89,16 @@ typedef struct object_ref_t
 } object_ref_t;
 
 
-/* Core data structure.  All access to it must be serialized using MUTEX.
+/* Core data structure.  Objects live in SHARDS, all other data is only
+ * modified atomically.
  */
 struct svn_object_pool__t
 {
-  /* serialization object for all non-atomic data in this struct */
-  svn_mutex__t *mutex;
+  /* SHARD_COUNT shards for thread-safe object pools, 1 otherwise. */
+  object_pool_shard_t *shards;
+  apr_uint32_t shard_count;
 
-  /* object_ref_t.KEY -> object_ref_t* mapping.
-   *
-   * In shared object mode, there is at most one such entry per key and it
-   * may or may not be in use.  In exclusive mode, only unused references
-   * will be put here and they form chains if there are multiple unused
-   * instances for the key. */
-  apr_hash_t *objects;
-
-  /* same as objects->count but allows for non-sync'ed access */
+  /* total number of objects in all shards; allows for non-sync'ed access */
   volatile svn_atomic_t object_count;
 
   /* Number of entries in OBJECTS with a reference count 0.
@@ -102,18 +125,31 @@ object_pool_cleanup(void *baton)
   return APR_SUCCESS;
 }
 
-/* Remove entries from OBJECTS in OBJECT_POOL that have a ref-count of 0.
+/* Return the shard of OBJECT_POOL that is responsible for KEY.
+ */
+static object_pool_shard_t *
+get_shard(svn_object_pool__t *object_pool,
+          const svn_membuf_t *key)
+{
+  apr_ssize_t klen = key->size;
+  unsigned int hash = apr_hashfunc_default(key->data, &klen);
+
+  return &object_pool->shards[hash & (object_pool->shard_count - 1)];
+}
+
+/* Remove entries from SHARD in OBJECT_POOL that have a ref-count of 0.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
-static void
-remove_unused_objects(svn_object_pool__t *object_pool)
+static svn_error_t *
+remove_unused_objects(svn_object_pool__t *object_pool,
+                      object_pool_shard_t *shard)
 {
-  apr_pool_t *subpool = svn_pool_create(object_pool->pool);
+  apr_pool_t *subpool = svn_pool_create(shard->pool);
 
   /* process all hash buckets */
   apr_hash_index_t *hi;
-  for (hi = apr_hash_first(subpool, object_pool->objects);
+  for (hi = apr_hash_first(subpool, shard->objects);
        hi != NULL;
        hi = apr_hash_next(hi))
     {
@@ -123,7 +159,7 @@ remove_unused_objects(svn_object_pool__t *object_pool)
          to the hash is serialized */
       if (svn_atomic_read(&object_ref->ref_count) == 0)
         {
-          apr_hash_set(object_pool->objects, object_ref->key.data,
+          apr_hash_set(shard->objects, object_ref->key.data,
                        object_ref->key.size, NULL);
           svn_atomic_dec(&object_pool->object_count);
           svn_atomic_dec(&object_pool->unused_count);
@@ -133,6 +169,18 @@ remove_unused_objects(svn_object_pool__t *object_pool)
     }
 
   svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function destroying the private root pool BATON of a
+ * shard.
+ */
+static apr_status_t
+destroy_shard_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+  return APR_SUCCESS;
 }
 
 /* Cleanup function called when an object_ref_t gets released.
@@ -181,16 +229,16 @@ add_object_ref(object_ref_t *object_ref,
 
 /* Actual implementation of svn_object_pool__lookup.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
 static svn_error_t *
 lookup(void **object,
-       svn_object_pool__t *object_pool,
+       object_pool_shard_t *shard,
        svn_membuf_t *key,
        apr_pool_t *result_pool)
 {
   object_ref_t *object_ref
-    = apr_hash_get(object_pool->objects, key->data, key->size);
+    = apr_hash_get(shard->objects, key->data, key->size);
 
   if (object_ref)
     {
@@ -205,20 +253,22 @@ lookup(void **object,
   return SVN_NO_ERROR;
 }
 
-/* Actual implementation of svn_object_pool__insert.
+/* Actual implementation of svn_object_pool__insert.  SHARD is the
+ * shard of OBJECT_POOL that is responsible for KEY.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
 static svn_error_t *
 insert(void **object,
        svn_object_pool__t *object_pool,
+       object_pool_shard_t *shard,
        const svn_membuf_t *key,
        void *item,
        apr_pool_t *item_pool,
        apr_pool_t *result_pool)
 {
   object_ref_t *object_ref
-    = apr_hash_get(object_pool->objects, key->data, key->size);
+    = apr_hash_get(shard->objects, key->data, key->size);
   if (object_ref)
     {
       /* Destroy the new one and return a reference to the existing one
@@ -238,7 +288,7 @@ insert(void **object,
       object_ref->key.size = key->size;
       memcpy(object_ref->key.data, key->data, key->size);
 
-      apr_hash_set(object_pool->objects, object_ref->key.data,
+      apr_hash_set(shard->objects, object_ref->key.data,
                    object_ref->key.size, object_ref);
       svn_atomic_inc(&object_pool->object_count);
 
@@ -252,11 +302,6 @@ insert(void **object,
   *object = object_ref->object;
   add_object_ref(object_ref, result_pool);
 
-  /* limit memory usage */
-  if (svn_atomic_read(&object_pool->unused_count) * 2
-      > apr_hash_count(object_pool->objects) + 2)
-    remove_unused_objects(object_pool);
-
   return SVN_NO_ERROR;
 }
 
@@ -269,15 +314,39 @@ svn_object_pool__create(svn_object_pool__t **object_pool,
                         apr_pool_t *pool)
 {
   svn_object_pool__t *result;
+  apr_uint32_t i;
 
   /* construct the object pool in our private ROOT_POOL to survive POOL
    * cleanup and to prevent threading issues with the allocator
    */
   result = apr_pcalloc(pool, sizeof(*result));
-  SVN_ERR(svn_mutex__init(&result->mutex, thread_safe, pool));
-
   result->pool = pool;
-  result->objects = svn_hash__make(result->pool);
+
+  /* Only thread-safe object pools benefit from sharding. */
+  result->shard_count = thread_safe ? SHARD_COUNT : 1;
+  result->shards = apr_pcalloc(pool,
+                               result->shard_count * sizeof(*result->shards));
+  for (i = 0; i < result->shard_count; ++i)
+    {
+      object_pool_shard_t *shard = &result->shards[i];
+
+      /* Shards get modified concurrently, so they must not share a pool
+       * (and its allocator). */
+      if (thread_safe)
+        {
+          shard->pool
+            = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+          apr_pool_cleanup_register(pool, shard->pool, destroy_shard_pool,
+                                    apr_pool_cleanup_null);
+        }
+      else
+        {
+          shard->pool = pool;
+        }
+
+      SVN_ERR(svn_mutex__init(&shard->mutex, thread_safe, pool));
+      shard->objects = svn_hash__make(shard->pool);
+    }
 
   /* make sure we clean up nicely.
    * We need two cleanup functions of which exactly one will be run
@@ -305,9 +374,11 @@ svn_object_pool__lookup(void **object,
                         svn_membuf_t *key,
                         apr_pool_t *result_pool)
 {
+  object_pool_shard_t *shard = get_shard(object_pool, key);
+
   *object = NULL;
-  SVN_MUTEX__WITH_LOCK(object_pool->mutex,
-                       lookup(object, object_pool, key, result_pool));
+  SVN_MUTEX__WITH_LOCK(shard->mutex,
+                       lookup(object, shard, key, result_pool));
   return SVN_NO_ERROR;
 }
 
@@ -319,9 +390,22 @@ svn_object_pool__insert(void **object,
                         apr_pool_t *item_pool,
                         apr_pool_t *result_pool)
 {
+  object_pool_shard_t *shard = get_shard(object_pool, key);
+  apr_uint32_t i;
+
   *object = NULL;
-  SVN_MUTEX__WITH_LOCK(object_pool->mutex,
-                       insert(object, object_pool, key, item, 
+  SVN_MUTEX__WITH_LOCK(shard->mutex,
+                       insert(object, object_pool, shard, key, item,
                               item_pool, result_pool));
+
+  /* limit memory usage.
+   * Lock one shard at a time to not deadlock with other inserters. */
+  if (svn_atomic_read(&object_pool->unused_count) * 2
+      > svn_atomic_read(&object_pool->object_count) + 2)
+    for (i = 0; i < object_pool->shard_count; ++i)
+      SVN_MUTEX__WITH_LOCK(object_pool->shards[i].mutex,
+                           remove_unused_objects(object_pool,
+                                                 &object_pool->shards[i]));
+
   return SVN_NO_ERROR;
 }
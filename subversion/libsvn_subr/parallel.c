@@ -0,0 +1,374 @@
+/*
+ * parallel.c: running independent jobs on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_parallel.h"
+#include "private/svn_thread_cond.h"
+
+#include "svn_private_config.h"
+
+
+#if APR_HAS_THREADS
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated. */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Thread pool shared by all users of svn_parallel__get_thread_pool(). */
+static apr_thread_pool_t *job_thread_pool = NULL;
+
+/* Keep track on whether we already created the JOB_THREAD_POOL. */
+static svn_atomic_t job_thread_pool_initialized = FALSE;
+
+/* Destructor function that implicitly cleans up any running threads
+   in the JOB_THREAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+job_thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = job_thread_pool;
+  if (!job_thread_pool)
+    return APR_SUCCESS;
+
+  job_thread_pool = NULL;
+  job_thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+/* Implements svn_atomic__init_once's init_func.  Create the
+   JOB_THREAD_POOL. */
+static svn_error_t *
+create_job_thread_pool(void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  /* The thread-pool must be allocated from a thread-safe pool that lives
+     as long as the process. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  WRAP_APR_ERR(apr_thread_pool_create(&job_thread_pool, 0,
+                                      SVN_PARALLEL__MAX_THREADS, pool),
+               _("Can't create job thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, job_thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more requests are
+     coming in */
+  apr_thread_pool_idle_wait_set(job_thread_pool,
+                                THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(job_thread_pool, 0);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_parallel__get_thread_pool(apr_thread_pool_t **thread_pool,
+                              apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_atomic__init_once(&job_thread_pool_initialized,
+                                create_job_thread_pool, NULL, scratch_pool));
+  *thread_pool = job_thread_pool;
+
+  return SVN_NO_ERROR;
+}
+
+typedef struct run_state_t run_state_t;
+
+/* A job slot in the ring buffer of a run_state_t. */
+typedef struct job_slot_t
+{
+  /* Private, thread-safe pool for the job.  It gets cleared whenever the
+     job's results have been processed. */
+  apr_pool_t *pool;
+
+  /* Number of the job currently using this slot. */
+  int index;
+
+  /* Result of the job. */
+  svn_error_t *err;
+
+  /* Set once the job has been completed.  Protected by the mutex in
+     STATE. */
+  svn_boolean_t done;
+
+  /* The run that this slot belongs to. */
+  run_state_t *state;
+} job_slot_t;
+
+/* State of a svn_parallel__run_jobs() call. */
+struct run_state_t
+{
+  /* The thread pool to run the jobs in. */
+  apr_thread_pool_t *thread_pool;
+
+  /* Parameters as passed to svn_parallel__run_jobs(). */
+  int job_count;
+  int max_threads;
+  svn_parallel__job_func_t job_func;
+  void *baton;
+
+  /* Ring buffer of SLOT_COUNT job slots.  Job number I uses slot I modulo
+     SLOT_COUNT. */
+  job_slot_t *slots;
+  int slot_count;
+
+  /* Number of jobs started and number of jobs whose results have been
+     processed, respectively. */
+  int started;
+  int finished;
+
+  /* Number of jobs being run by worker threads.  Protected by MUTEX. */
+  int running;
+
+  /* Synchronize the workers with the thread waiting for results. */
+  svn_mutex__t *mutex;
+  svn_thread_cond__t *cond;
+};
+
+/* Thread-pool task: Run the job in the job_slot_t given by DATA. */
+static void * APR_THREAD_FUNC
+job_task(apr_thread_t *tid,
+         void *data)
+{
+  job_slot_t *slot = data;
+  run_state_t *state = slot->state;
+  svn_error_t *err;
+
+  slot->err = state->job_func(state->baton, slot->index, slot->pool);
+
+  /* There is no way to tell the caller about synchronization problems,
+     so they will simply be ignored here. */
+  err = svn_mutex__lock(state->mutex);
+  if (!err)
+    {
+      slot->done = TRUE;
+      state->running--;
+      err = svn_thread_cond__broadcast(state->cond);
+      err = svn_mutex__unlock(state->mutex, err);
+    }
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+/* Start the next job in STATE. */
+static svn_error_t *
+start_job(run_state_t *state)
+{
+  job_slot_t *slot = &state->slots[state->started % state->slot_count];
+  apr_status_t status;
+
+  slot->index = state->started++;
+  slot->err = SVN_NO_ERROR;
+  slot->done = FALSE;
+
+  SVN_ERR(svn_mutex__lock(state->mutex));
+  state->running++;
+  SVN_ERR(svn_mutex__unlock(state->mutex, SVN_NO_ERROR));
+
+  status = apr_thread_pool_push(state->thread_pool, job_task, slot, 0,
+                                state);
+  if (status)
+    {
+      /* Run it ourselves then. */
+      job_task(NULL, slot);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait until the job in the oldest unprocessed slot of STATE has been
+   completed or, if WAIT_FOR_ANY is set, a worker thread became available
+   for another job.  Set *DONE to whether the oldest job has been
+   completed. */
+static svn_error_t *
+wait_for_job(svn_boolean_t *done,
+             run_state_t *state,
+             svn_boolean_t wait_for_any)
+{
+  job_slot_t *slot = &state->slots[state->finished % state->slot_count];
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__lock(state->mutex));
+
+  /* This loop implicitly handles spurious wake-ups. */
+  while (   !slot->done
+         && (!wait_for_any || state->running >= state->max_threads)
+         && !err)
+    err = svn_thread_cond__wait(state->cond, state->mutex);
+
+  *done = slot->done;
+
+  return svn_error_trace(svn_mutex__unlock(state->mutex, err));
+}
+
+/* Pool cleanup function for the run_state_t DATA.  Wait for all running
+   jobs, discard their results and release the job pools. */
+static apr_status_t
+run_state_cleanup(void *data)
+{
+  run_state_t *state = data;
+  int i;
+
+  for (; state->finished < state->started; state->finished++)
+    {
+      job_slot_t *slot = &state->slots[state->finished % state->slot_count];
+      svn_boolean_t done;
+
+      /* We can't do anything about errors at this point. */
+      svn_error_clear(wait_for_job(&done, state, FALSE));
+      svn_error_clear(slot->err);
+    }
+
+  for (i = 0; i < state->slot_count; ++i)
+    svn_pool_destroy(state->slots[i].pool);
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+svn_error_t *
+svn_parallel__run_jobs(int job_count,
+                       int max_threads,
+                       svn_parallel__job_func_t job_func,
+                       svn_parallel__job_done_t done_func,
+                       void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = svn_pool_create(scratch_pool);
+  int i;
+
+#if APR_HAS_THREADS
+  if (max_threads > 1 && job_count > 1)
+    {
+      run_state_t *state = apr_pcalloc(pool, sizeof(*state));
+
+      SVN_ERR(svn_parallel__get_thread_pool(&state->thread_pool, pool));
+
+      state->job_count = job_count;
+      state->max_threads = MIN(max_threads, SVN_PARALLEL__MAX_THREADS);
+      state->job_func = job_func;
+      state->baton = baton;
+      SVN_ERR(svn_mutex__init(&state->mutex, TRUE, pool));
+      SVN_ERR(svn_thread_cond__create(&state->cond, pool));
+
+      /* Allow for the next set of jobs to be run while the results of
+         the oldest one are still outstanding. */
+      state->slot_count = 2 * state->max_threads;
+      state->slots = apr_pcalloc(pool,
+                                 state->slot_count * sizeof(*state->slots));
+      for (i = 0; i < state->slot_count; ++i)
+        {
+          /* Each slot must have its own thread-safe root pool, so all
+             threads can allocate memory at the same time. */
+          state->slots[i].pool = svn_pool_create(NULL);
+          state->slots[i].state = state;
+        }
+
+      /* Registered after creating the mutex and the condition variable,
+         so this runs before their cleanups. */
+      apr_pool_cleanup_register(pool, state, run_state_cleanup,
+                                apr_pool_cleanup_null);
+
+      while (state->finished < job_count)
+        {
+          job_slot_t *slot
+            = &state->slots[state->finished % state->slot_count];
+          svn_boolean_t can_start, done;
+          svn_error_t *err;
+
+          /* Keep MAX_THREADS jobs running, as far as the ring buffer
+             allows. */
+          SVN_ERR(svn_mutex__lock(state->mutex));
+          can_start = state->running < state->max_threads;
+          SVN_ERR(svn_mutex__unlock(state->mutex, SVN_NO_ERROR));
+
+          can_start = can_start
+                   && state->started < job_count
+                   && state->started - state->finished < state->slot_count;
+          if (can_start)
+            {
+              SVN_ERR(start_job(state));
+              continue;
+            }
+
+          /* Wait for the oldest job.  Other jobs finishing allow us to
+             start more jobs, though. */
+          SVN_ERR(wait_for_job(&done, state,
+                               state->started < job_count
+                               && state->started - state->finished
+                                  < state->slot_count));
+          if (!done)
+            continue;
+
+          err = slot->err;
+          slot->err = SVN_NO_ERROR;
+          err = done_func(baton, slot->index, err, slot->pool);
+          svn_pool_clear(slot->pool);
+          state->finished++;
+
+          if (err)
+            {
+              /* Wait for the remaining jobs before returning. */
+              svn_pool_destroy(pool);
+              return svn_error_trace(err);
+            }
+        }
+
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  for (i = 0; i < job_count; ++i)
+    {
+      svn_pool_clear(pool);
+      SVN_ERR(done_func(baton, i, job_func(baton, i, pool), pool));
+    }
+
+  svn_pool_destroy(pool);
+  return SVN_NO_ERROR;
+}
@@ -29,6 +29,7 @@
 #include <apr_strings.h>
 #include <apr_file_io.h>
 #include <apr_errno.h>
+#include <apr_mmap.h>
 #include <apr_poll.h>
 #include <apr_portable.h>
 
@@ -62,6 +63,7 @@ struct svn_stream_t {
   svn_stream_seek_fn_t seek_fn;
   svn_stream_data_available_fn_t data_available_fn;
   svn_stream_readline_fn_t readline_fn;
+  svn_stream__view_fn_t view_fn;
   apr_file_t *file; /* Maybe NULL */
 };
 
@@ -145,6 +147,13 @@ svn_stream_set_readline(svn_stream_t *stream,
   stream->readline_fn = readline_fn;
 }
 
+void
+svn_stream__set_view(svn_stream_t *stream,
+                     svn_stream__view_fn_t view_fn)
+{
+  stream->view_fn = view_fn;
+}
+
 /* Standard implementation for svn_stream_read_full() based on
    multiple svn_stream_read2() calls (in separate function to make
    it more likely for svn_stream_read_full to be inlined) */
@@ -194,6 +203,17 @@ svn_stream_read_full(svn_stream_t *stream, char *buffer, apr_size_t *len)
   return svn_error_trace(stream->read_full_fn(stream->baton, buffer, len));
 }
 
+svn_error_t *
+svn_stream__view(svn_stream_t *stream,
+                 const char **data,
+                 apr_size_t *len)
+{
+  if (stream->view_fn == NULL)
+    return svn_error_create(SVN_ERR_STREAM_NOT_SUPPORTED, NULL, NULL);
+
+  return svn_error_trace(stream->view_fn(stream->baton, data, len));
+}
+
 svn_error_t *
 svn_stream_skip(svn_stream_t *stream, apr_size_t len)
 {
@@ -1406,6 +1426,23 @@ read_full_handler_checksum(void *baton, char *buffer, apr_size_t *len)
 }
 
 
+static svn_error_t *
+view_handler_checksum(void *baton, const char **data, apr_size_t *len)
+{
+  struct checksum_stream_baton *btn = baton;
+  apr_size_t saved_len = *len;
+
+  SVN_ERR(svn_stream__view(btn->proxy, data, len));
+
+  if (btn->read_checksum)
+    SVN_ERR(svn_checksum_update(btn->read_ctx, *data, *len));
+
+  if (saved_len != *len)
+    btn->read_more = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 write_handler_checksum(void *baton, const char *buffer, apr_size_t *len)
 {
@@ -1518,6 +1555,8 @@ svn_stream_checksummed2(svn_stream_t *stream,
   svn_stream_set_close(s, close_handler_checksum);
   if (svn_stream_supports_reset(stream))
     svn_stream_set_seek(s, seek_handler_checksum);
+  if (stream->view_fn)
+    svn_stream__set_view(s, view_handler_checksum);
   return s;
 }
 
@@ -1815,6 +1854,18 @@ skip_handler_string(void *baton, apr_size_t len)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+view_handler_string(void *baton, const char **data, apr_size_t *len)
+{
+  struct string_stream_baton *btn = baton;
+  apr_size_t left_to_read = btn->str->len - btn->amt_read;
+
+  *len = (*len > left_to_read) ? left_to_read : *len;
+  *data = btn->str->data + btn->amt_read;
+  btn->amt_read += *len;
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 data_available_handler_string(void *baton, svn_boolean_t *data_available)
 {
@@ -1824,6 +1875,36 @@ data_available_handler_string(void *baton, svn_boolean_t *data_available)
   return SVN_NO_ERROR;
 }
 
+/* Return the first occurrence of EOL within the LEN bytes at DATA or NULL
+   if there is none.  Unlike strstr(), this does not require DATA to be
+   NUL-terminated. */
+static const char *
+find_eol(const char *data,
+         apr_size_t len,
+         const char *eol)
+{
+  apr_size_t eol_len = strlen(eol);
+  const char *end = data + len;
+  const char *pos = data;
+
+  if (eol_len == 0)
+    return data;
+
+  while ((apr_size_t)(end - pos) >= eol_len)
+    {
+      pos = memchr(pos, eol[0], (end - pos) - eol_len + 1);
+      if (!pos)
+        return NULL;
+
+      if (memcmp(pos, eol, eol_len) == 0)
+        return pos;
+
+      ++pos;
+    }
+
+  return NULL;
+}
+
 static svn_error_t *
 readline_handler_string(void *baton,
                         svn_stringbuf_t **stringbuf,
@@ -1835,7 +1916,8 @@ readline_handler_string(void *baton,
   const char *pos = btn->str->data + btn->amt_read;
   const char *eol_pos;
 
-  eol_pos = strstr(pos, eol);
+  /* The string may be a view into memory that is not NUL-terminated. */
+  eol_pos = find_eol(pos, btn->str->len - btn->amt_read, eol);
   if (eol_pos)
     {
       apr_size_t eol_len = strlen(eol);
@@ -1875,10 +1957,91 @@ svn_stream_from_string(const svn_string_t *str,
   svn_stream_set_skip(stream, skip_handler_string);
   svn_stream_set_data_available(stream, data_available_handler_string);
   svn_stream_set_readline(stream, readline_handler_string);
+  svn_stream__set_view(stream, view_handler_string);
   return stream;
 }
 
 
+/* Memory-mapped file streams. */
+
+/* Baton for streams returned by svn_stream__from_mapped_file().  The
+   mapped contents are read through the string stream handlers. */
+struct mapped_stream_baton
+{
+  /* Must be the first member, so we can pass the whole baton to the
+     string stream handlers. */
+  struct string_stream_baton string;
+
+  svn_string_t contents;
+  apr_mmap_t *mmap;
+  apr_file_t *file;
+  svn_boolean_t disown;
+  apr_pool_t *pool;
+};
+
+static svn_error_t *
+close_handler_mapped(void *baton)
+{
+  struct mapped_stream_baton *btn = baton;
+  apr_status_t status = apr_mmap_delete(btn->mmap);
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't unmap file"));
+
+  if (!btn->disown)
+    SVN_ERR(svn_io_file_close(btn->file, btn->pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_stream__from_mapped_file(svn_stream_t **stream,
+                             apr_file_t *file,
+                             svn_boolean_t disown,
+                             apr_pool_t *result_pool)
+{
+#if APR_HAS_MMAP
+  struct mapped_stream_baton *baton;
+  apr_finfo_t finfo;
+  apr_mmap_t *mmap;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, result_pool));
+
+  /* Empty files can't be mapped and neither can files larger than our
+     address space.  Just use a standard file stream then. */
+  if (   finfo.size > 0
+      && finfo.size <= APR_SIZE_MAX
+      && apr_mmap_create(&mmap, file, 0, (apr_size_t)finfo.size,
+                         APR_MMAP_READ, result_pool) == APR_SUCCESS)
+    {
+      baton = apr_pcalloc(result_pool, sizeof(*baton));
+      baton->contents.data = mmap->mm;
+      baton->contents.len = mmap->size;
+      baton->string.str = &baton->contents;
+      baton->string.amt_read = 0;
+      baton->mmap = mmap;
+      baton->file = file;
+      baton->disown = disown;
+      baton->pool = result_pool;
+
+      *stream = svn_stream_create(baton, result_pool);
+      svn_stream_set_read2(*stream, read_handler_string, read_handler_string);
+      svn_stream_set_mark(*stream, mark_handler_string);
+      svn_stream_set_seek(*stream, seek_handler_string);
+      svn_stream_set_skip(*stream, skip_handler_string);
+      svn_stream_set_data_available(*stream, data_available_handler_string);
+      svn_stream_set_close(*stream, close_handler_mapped);
+      svn_stream__set_view(*stream, view_handler_string);
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  *stream = svn_stream_from_aprfile2(file, disown, result_pool);
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_stream_for_stdin2(svn_stream_t **in,
                       svn_boolean_t buffered,
@@ -2044,6 +2207,20 @@ read_full_handler_lazyopen(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_stream__view_fn_t */
+static svn_error_t *
+view_handler_lazyopen(void *baton,
+                      const char **data,
+                      apr_size_t *len)
+{
+  lazyopen_baton_t *b = baton;
+
+  SVN_ERR(lazyopen_if_unopened(b));
+  SVN_ERR(svn_stream__view(b->real_stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_stream_skip_fn_t */
 static svn_error_t *
 skip_handler_lazyopen(void *baton,
@@ -2163,6 +2340,7 @@ svn_stream_lazyopen_create(svn_stream_lazyopen_func_t open_func,
   svn_stream_set_seek(stream, seek_handler_lazyopen);
   svn_stream_set_data_available(stream, data_available_handler_lazyopen);
   svn_stream_set_readline(stream, readline_handler_lazyopen);
+  svn_stream__set_view(stream, view_handler_lazyopen);
 
   return stream;
 }
@@ -396,7 +396,6 @@ do_text_merge(svn_boolean_t *contains_conflicts,
               void *cancel_baton,
               apr_pool_t *pool)
 {
-  svn_diff_t *diff;
   svn_stream_t *ostream;
   const char *target_marker;
   const char *left_marker;
@@ -413,24 +412,21 @@ do_text_merge(svn_boolean_t *contains_conflicts,
   init_conflict_markers(&target_marker, &left_marker, &right_marker,
                         target_label, left_label, right_label, pool);
 
-  SVN_ERR(svn_diff_file_diff3_2(&diff, left, detranslated_target, right,
-                                diff3_options, pool));
-
   ostream = svn_stream_from_aprfile2(result_f, TRUE, pool);
 
-  SVN_ERR(svn_diff_file_output_merge3(ostream, diff,
-                                      left, detranslated_target, right,
-                                      left_marker,
-                                      target_marker,
-                                      right_marker,
-                                      "=======", /* separator */
-                                      svn_diff_conflict_display_modified_original_latest,
-                                      cancel_func, cancel_baton,
-                                      pool));
+  /* This honors the --memory-budget merge option. */
+  SVN_ERR(svn_diff_file_merge3(NULL, contains_conflicts, ostream,
+                               left, detranslated_target, right,
+                               diff3_options,
+                               left_marker,
+                               target_marker,
+                               right_marker,
+                               "=======", /* separator */
+                               svn_diff_conflict_display_modified_original_latest,
+                               cancel_func, cancel_baton,
+                               pool));
   SVN_ERR(svn_stream_close(ostream));
 
-  *contains_conflicts = svn_diff_contains_conflicts(diff);
-
   return SVN_NO_ERROR;
 }
 
@@ -40,6 +40,10 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Pristine texts of at least this size get read through a memory mapping.
+   Applying a delta against them then does not copy the source data. */
+#define MAPPED_PRISTINE_MIN_SIZE (1024 * 1024)
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
@@ -176,6 +180,7 @@ pristine_read_txn(svn_stream_t **contents,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_filesize_t pristine_size;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -184,8 +189,9 @@ pristine_read_txn(svn_stream_t **contents,
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
 
+  pristine_size = svn_sqlite__column_int64(stmt, 0);
   if (size)
-    *size = svn_sqlite__column_int64(stmt, 0);
+    *size = pristine_size;
 
   SVN_ERR(svn_sqlite__reset(stmt));
   if (! have_row)
@@ -208,7 +214,15 @@ pristine_read_txn(svn_stream_t **contents,
       apr_file_t *file;
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
-      *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+#ifndef WIN32
+      /* Mapped files could not be deleted on Windows. */
+      if (pristine_size >= MAPPED_PRISTINE_MIN_SIZE)
+        SVN_ERR(svn_stream__from_mapped_file(contents, file, FALSE,
+                                             result_pool));
+      else
+#endif
+        *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
     }
 
   return SVN_NO_ERROR;
@@ -42,6 +42,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -57,6 +58,15 @@
  * subreq mechanism and make a call directly to mod_authz_svn. */
 #define PATHAUTHZ_BYPASS_ARG "short_circuit"
 
+/* Whether SVNInMemoryCacheShared has been enabled.  This is a process-wide
+ * setting just like the cache itself. */
+static svn_boolean_t shared_cache = FALSE;
+
+/* Path of the in-memory cache snapshot file as set by
+ * SVNInMemoryCacheSnapshot.  NULL if snapshots are disabled.  Allocated
+ * in the configuration pool and reset before each configuration pass. */
+static const char *cache_snapshot = NULL;
+
 /* per-server configuration */
 typedef struct server_conf_t {
   const char *special_uri;
@@ -120,6 +130,72 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Baton for save_cache_snapshot(). */
+typedef struct snapshot_baton_t
+{
+  svn_membuffer_t *cache;
+  const char *path;
+  server_rec *s;
+} snapshot_baton_t;
+
+/* Pool cleanup function writing the cache snapshot described by the
+ * snapshot_baton_t in DATA. */
+static apr_status_t
+save_cache_snapshot(void *data)
+{
+  snapshot_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *serr = svn_cache__membuffer_save(baton->cache, baton->path,
+                                                pool);
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_ERR, serr->apr_err, baton->s,
+                   "mod_dav_svn: error writing cache snapshot: '%s'",
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(pool);
+  return APR_SUCCESS;
+}
+
+/* If SVNInMemoryCacheSnapshot has been set, load the snapshot into CACHE
+ * and make sure it gets written back when POOL gets cleaned up.  Log
+ * errors for server S.  CACHE may be NULL. */
+static void
+setup_cache_snapshot(svn_membuffer_t *cache, apr_pool_t *pool, server_rec *s)
+{
+  /* The configuration gets read more than once in the same process but
+   * the cache lives on.  Don't load the same contents again. */
+  static svn_boolean_t loaded = FALSE;
+
+  snapshot_baton_t *baton;
+  svn_error_t *serr;
+
+  if (cache == NULL || cache_snapshot == NULL)
+    return;
+
+  if (!loaded)
+    {
+      loaded = TRUE;
+      serr = svn_cache__membuffer_load(cache, cache_snapshot, pool);
+      if (serr)
+        {
+          ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err, s,
+                       "mod_dav_svn: ignoring cache snapshot: '%s'",
+                       serr->message ? serr->message : "(no more info)");
+          svn_error_clear(serr);
+        }
+    }
+
+  baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->cache = cache;
+  baton->path = apr_pstrdup(pool, cache_snapshot);
+  baton->s = s;
+  apr_pool_cleanup_register(pool, baton, save_cache_snapshot,
+                            apr_pool_cleanup_null);
+}
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -150,9 +226,40 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* A shared cache must exist before the parent forks its children.
+   * This returns NULL upon failure, in which case the children will
+   * simply create their own process-local caches. */
+  if (shared_cache)
+    setup_cache_snapshot(svn_cache__get_global_membuffer_cache(), p, s);
+
   return OK;
 }
 
+/* Implements the #child_init hook.  Attach the new child process to the
+ * shared in-memory cache, if one has been created by the parent.
+ * Otherwise, populate the process-local cache from the snapshot. */
+static void
+child_init(apr_pool_t *p, server_rec *s)
+{
+  svn_error_t *serr;
+
+  if (!shared_cache)
+    {
+      setup_cache_snapshot(svn_cache__get_global_membuffer_cache(), p, s);
+      return;
+    }
+
+  serr = svn_cache__membuffer_child_init(
+             svn_cache__get_global_membuffer_cache(), p);
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_ERR, serr->apr_err, s,
+                   "mod_dav_svn: error attaching to shared cache: '%s'",
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+}
+
 static svn_error_t *
 malfunction_handler(svn_boolean_t can_return,
                     const char *file, int line,
@@ -182,6 +289,10 @@ init_dso(apr_pool_t *pconf, apr_pool_t *plog, apr_pool_t *ptemp)
 
   svn_error_t *serr = svn_dso_initialize2();
 
+  /* The previous value, if any, has been allocated in the last
+   * configuration pool. */
+  cache_snapshot = NULL;
+
   if (serr)
     {
       ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, plog,
@@ -631,6 +742,41 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheShared_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  shared_cache = arg;
+  svn_cache__set_global_membuffer_shared(arg, NULL);
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCacheCompression_cmd(cmd_parms *cmd, void *config,
+                                const char *arg1)
+{
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg1);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN cache compression "
+             "threshold.";
+    }
+
+  svn_cache__set_global_membuffer_compression((apr_size_t)(value * 0x400));
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCacheSnapshot_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  cache_snapshot = svn_dirent_internal_style(arg1, cmd->pool);
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1396,6 +1542,27 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheShared", SVNInMemoryCacheShared_cmd, NULL,
+               RSRC_CONF,
+               "enables sharing Subversion's in-memory object cache between "
+               "all child processes of a pre-fork server. The whole cache "
+               "is then SVNInMemoryCacheSize large instead of per process "
+               "(default is Off)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheCompression",
+                SVNInMemoryCacheCompression_cmd, NULL, RSRC_CONF,
+                "specifies the minimum size in kBytes of items that "
+                "Subversion's in-memory object cache will compress, "
+                "trading CPU time for a larger effective cache size "
+                "(default value is 0, i.e. no compression)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheSnapshot", SVNInMemoryCacheSnapshot_cmd,
+                NULL, RSRC_CONF,
+                "specifies a file that the contents of Subversion's "
+                "in-memory object cache will be written to when the "
+                "server shuts down and that they will be restored from "
+                "upon start-up (default is none)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
@@ -1436,6 +1603,7 @@ register_hooks(apr_pool_t *pconf)
 {
   ap_hook_pre_config(init_dso, NULL, NULL, APR_HOOK_REALLY_FIRST);
   ap_hook_post_config(init, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_hook_child_init(child_init, NULL, NULL, APR_HOOK_MIDDLE);
 
   /* our provider */
   dav_register_provider(pconf, "svn", &provider);
@@ -72,6 +72,9 @@ int dav_svn__status(request_rec *r)
   svn_cache__info_t *info;
   svn_string_t *text_stats;
   apr_array_header_t *lines;
+  svn_membuffer_t *membuffer;
+  apr_array_header_t *prefix_info;
+  svn_error_t *err;
   int i;
 
   if (r->method_number != M_GET || strcmp(r->handler, "svn-status"))
@@ -113,7 +116,36 @@ int dav_svn__status(request_rec *r)
       ap_rvputs(r, "<dt>", line, "</dt>\n", SVN_VA_NULL);
     }
 
-  ap_rvputs(r, "</dl></body></html>\n", SVN_VA_NULL);
+  ap_rvputs(r, "</dl>\n", SVN_VA_NULL);
+
+  /* Break the numbers down by cache prefix, i.e. by repository and
+     type of cached data. */
+  membuffer = svn_cache__get_global_membuffer_cache();
+  if (membuffer)
+    {
+      err = svn_cache__membuffer_get_prefix_info(&prefix_info, membuffer,
+                                                 r->pool, r->pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          prefix_info = apr_array_make(r->pool, 0,
+                                       sizeof(svn_cache__prefix_info_t *));
+        }
+
+      text_stats = svn_cache__format_prefix_info(prefix_info, r->pool);
+      lines = svn_cstring_split(text_stats->data, "\n", FALSE, r->pool);
+
+      ap_rvputs(r, "<h2>Cache Usage by Prefix</h2>\n<dl>\n", SVN_VA_NULL);
+      for (i = 0; i < lines->nelts; ++i)
+        {
+          const char *line = APR_ARRAY_IDX(lines, i, const char *);
+          ap_rvputs(r, "<dt>", ap_escape_html(r->pool, line), "</dt>\n",
+                    SVN_VA_NULL);
+        }
+      ap_rvputs(r, "</dl>\n", SVN_VA_NULL);
+    }
+
+  ap_rvputs(r, "</body></html>\n", SVN_VA_NULL);
 
   return 0;
 }
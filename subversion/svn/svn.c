@@ -227,7 +227,17 @@ const apr_getopt_option_t svn_cl__options[] =
                        "                             "
                        "  -U ARG, --context ARG: Show ARG lines of context\n"
                        "                             "
-                       "  -p, --show-c-function: Show C function name")},
+                       "  -p, --show-c-function: Show C function name\n"
+                       "                             "
+                       "  --diff-algorithm ARG: Use 'myers' (minimal),\n"
+                       "                             "
+                       "    'histogram' or 'auto' (default; switches to\n"
+                       "                             "
+                       "    histogram for very different files)\n"
+                       "                             "
+                       "  --memory-budget ARG: Merge large files in\n"
+                       "                             "
+                       "    segments using about ARG MB of memory")},
   {"targets",       opt_targets, 1,
                     N_("pass contents of file ARG as additional args")},
   {"depth",         opt_depth, 1,
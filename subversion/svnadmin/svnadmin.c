@@ -44,6 +44,7 @@
 #include "svn_xml.h"
 #include "svn_fs.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_opt_private.h"
 #include "private/svn_sorts_private.h"
@@ -51,6 +52,7 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_fs_private.h"
+#include "private/svn_repos_private.h"
 
 #include "svn_private_config.h"
 
@@ -124,7 +126,8 @@ static svn_opt_subcommand_t
   subcommand_setuuid,
   subcommand_unlock,
   subcommand_upgrade,
-  subcommand_verify;
+  subcommand_verify,
+  subcommand_warm_cache;
 
 enum svnadmin__cmdline_options_t
   {
@@ -158,7 +161,10 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__recent_revisions,
+    svnadmin__snapshot,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -297,6 +303,18 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"recent-revisions", svnadmin__recent_revisions, 1,
+     N_("also load the nodes changed in the latest ARG\n"
+        "                             revisions")},
+
+    {"snapshot", svnadmin__snapshot, 1,
+     N_("write the cache contents to snapshot file ARG")},
+
+    {"jobs", svnadmin__jobs, 1,
+     N_("use up to ARG threads to process independent\n"
+        "                             revisions or shards concurrently.\n"
+        "                             Default: 1.")},
+
     {NULL}
   };
 
@@ -509,7 +527,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"
    )},
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
 
   {"recover", subcommand_recover, {0}, {N_(
     "usage: svnadmin recover REPOS_PATH\n"
@@ -619,7 +637,23 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
+
+  {"warm-cache", subcommand_warm_cache, {0}, {N_(
+    "usage: svnadmin warm-cache REPOS_PATH [PATH[@REV]...]\n"
+    "\n"), N_(
+    "Load the node revisions, directories and file contents of the given\n"
+    "paths and everything below them into the in-memory cache.  If no\n"
+    "PATH is given, use the ones listed in the --file, one per line.\n"
+    "Without either, load the latest revision of the whole repository.\n"
+    "\n"), N_(
+    "The cache only lives as long as this command runs.  Use --snapshot\n"
+    "to save it to a file that a server can load at startup, e.g. using\n"
+    "the SVNInMemoryCacheSnapshot directive of mod_dav_svn.  Choose -M to\n"
+    "match the server's cache size.\n"
+   )},
+   {'F', 'M', 'q', svnadmin__recent_revisions, svnadmin__snapshot} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -659,6 +693,9 @@ struct svnadmin_opt_state
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
   const char *parent_dir;                           /* --parent-dir */
   const char *file;                                 /* --file */
+  int recent_revisions;                             /* --recent-revisions */
+  const char *snapshot;                             /* --snapshot */
+  int jobs;                                         /* --jobs */
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
@@ -668,12 +705,14 @@ struct svnadmin_opt_state
 
 
 /* Helper to open a repository and set a warning func (so we don't
- * SEGFAULT when libsvn_fs's default handler gets run).  */
+ * SEGFAULT when libsvn_fs's default handler gets run).  Use CACHE_NS as
+ * the namespace for the FS caches.  */
 static svn_error_t *
-open_repos(svn_repos_t **repos,
-           const char *path,
-           struct svnadmin_opt_state *opt_state,
-           apr_pool_t *pool)
+open_repos_with_cache_ns(svn_repos_t **repos,
+                         const char *path,
+                         struct svnadmin_opt_state *opt_state,
+                         const char *cache_ns,
+                         apr_pool_t *pool)
 {
   /* Enable the "block-read" feature (where it applies)? */
   svn_boolean_t use_block_read
@@ -685,8 +724,7 @@ open_repos(svn_repos_t **repos,
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS, "1");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NODEPROPS, "1");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS, "2");
-  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
-                           svn_uuid_generate(pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS, cache_ns);
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
@@ -698,6 +736,19 @@ open_repos(svn_repos_t **repos,
   return SVN_NO_ERROR;
 }
 
+/* Like open_repos_with_cache_ns() but use a new, unique cache namespace,
+ * i.e. don't share cached data with any other repository instance. */
+static svn_error_t *
+open_repos(svn_repos_t **repos,
+           const char *path,
+           struct svnadmin_opt_state *opt_state,
+           apr_pool_t *pool)
+{
+  return svn_error_trace(open_repos_with_cache_ns(repos, path, opt_state,
+                                                  svn_uuid_generate(pool),
+                                                  pool));
+}
+
 
 /* Set *REVNUM to the revision specified by REVISION (or to
    SVN_INVALID_REVNUM if that has the type 'unspecified'),
@@ -1004,7 +1055,7 @@ struct repos_verify_callback_baton
 };
 
 /* Implementation of svn_repos_verify_callback_t to handle errors coming
-   from svn_repos_verify_fs3(). */
+   from svn_repos_verify_fs4(). */
 static svn_error_t *
 repos_verify_callback(void *baton,
                       svn_revnum_t revision,
@@ -1075,6 +1126,12 @@ repos_notify_handler(void *baton,
                                         notify->revision));
       return;
 
+    case svn_repos_notify_warm_cache_path:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                                        _("* Loaded '%s' in revision %ld.\n"),
+                                        notify->path, notify->revision));
+      return;
+
     case svn_repos_notify_verify_rev_structure:
       if (notify->revision == SVN_INVALID_REVNUM)
         svn_error_clear(svn_stream_puts(feedback_stream,
@@ -2195,7 +2252,8 @@ subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     feedback_stream = recode_stream_create(stdout, pool);
 
   return svn_error_trace(
-    svn_repos_fs_pack2(repos, !opt_state->quiet ? repos_notify_handler : NULL,
+    svn_repos_fs_pack3(repos, opt_state->jobs,
+                       !opt_state->quiet ? repos_notify_handler : NULL,
                        feedback_stream, check_cancel, NULL, pool));
 }
 
@@ -2261,9 +2319,10 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     apr_array_make(pool, 0, sizeof(struct verification_error *));
   verify_baton.result_pool = pool;
 
-  SVN_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                opt_state->check_normalization,
                                opt_state->metadata_only,
+                               opt_state->jobs,
                                !opt_state->quiet
                                  ? repos_notify_handler : NULL,
                                feedback_stream,
@@ -2343,6 +2402,85 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_warm_cache(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  apr_array_header_t *args;
+  apr_array_header_t *targets;
+  svn_stream_t *feedback_stream = NULL;
+  int i;
+
+  SVN_ERR(parse_args(&args, os, 0, -1, pool));
+
+  if (args->nelts)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+      for (i = 0; i < args->nelts; ++i)
+        {
+          svn_stringbuf_appendcstr(buf, APR_ARRAY_IDX(args, i, const char *));
+          svn_stringbuf_appendbyte(buf, '\n');
+        }
+
+      SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, buf->data, pool));
+    }
+  else if (opt_state->file)
+    {
+      svn_stringbuf_t *buf;
+      const char *utf8;
+
+      SVN_ERR(svn_stringbuf_from_file2(&buf, opt_state->file, pool));
+      SVN_ERR(svn_utf_cstring_to_utf8(&utf8, buf->data, pool));
+      SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, utf8, pool));
+    }
+  else
+    {
+      SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, "/", pool));
+    }
+
+  for (i = 0; i < targets->nelts; ++i)
+    {
+      svn_repos_warm_cache_target_t *target
+        = APR_ARRAY_IDX(targets, i, svn_repos_warm_cache_target_t *);
+      SVN_ERR(target_arg_to_fspath(&target->path, target->path, pool, pool));
+    }
+
+  /* Servers use the default, empty cache namespace.  We must do the same
+   * or else none of the cached data could be used by them. */
+  SVN_ERR(open_repos_with_cache_ns(&repos, opt_state->repository_path,
+                                   opt_state, "", pool));
+
+  /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
+  if (! opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  SVN_ERR(svn_repos_warm_cache(repos, targets, svn_depth_infinity,
+                               opt_state->recent_revisions,
+                               !opt_state->quiet ? repos_notify_handler : NULL,
+                               feedback_stream, check_cancel, NULL, pool));
+
+  if (opt_state->snapshot)
+    {
+      svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+      if (!membuffer)
+        return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                                _("Can't write a snapshot without a cache; "
+                                  "see --memory-cache-size"));
+
+      SVN_ERR(svn_cache__membuffer_save(membuffer, opt_state->snapshot,
+                                        pool));
+      if (! opt_state->quiet)
+        SVN_ERR(svn_cmdline_printf(pool,
+                                   _("Cache snapshot written to '%s'.\n"),
+                                   svn_dirent_local_style(opt_state->snapshot,
+                                                          pool)));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 svn_error_t *
 subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2964,6 +3102,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3178,6 +3317,23 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__glob:
         opt_state.glob = TRUE;
         break;
+      case svnadmin__recent_revisions:
+        SVN_ERR(svn_cstring_atoi(&opt_state.recent_revisions, opt_arg));
+        if (opt_state.recent_revisions < 0)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                  _("--recent-revisions must not be "
+                                    "negative"));
+        break;
+      case svnadmin__snapshot:
+        SVN_ERR(svn_utf_cstring_to_utf8(&utf8_opt_arg, opt_arg, pool));
+        opt_state.snapshot = svn_dirent_internal_style(utf8_opt_arg, pool);
+        break;
+      case svnadmin__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                  _("--jobs must be positive"));
+        break;
       default:
         {
           SVN_ERR(subcommand_help(NULL, NULL, pool));
@@ -3305,7 +3461,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    /* Worker threads share the caches with the main thread. */
+    settings.single_threaded = opt_state.jobs <= 1;
 
     svn_cache_config_set(&settings);
   }
@@ -0,0 +1,68 @@
+/* recompress-cmd.c -- implements the recompress sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* Our progress function simply prints the REVISION number and makes it
+ * appear immediately.
+ */
+static void
+print_progress(svn_revnum_t revision,
+               void *baton,
+               apr_pool_t *pool)
+{
+  printf("%8ld", revision);
+  fflush(stdout);
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__recompress(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  svn_fs_t *fs;
+  svn_fs_fs__ioctl_recompress_input_t input = {0};
+  svn_fs_fs__ioctl_recompress_output_t *output;
+
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+
+  if (!opt_state->quiet)
+    {
+      printf("Recompressing revisions\n");
+      input.progress_func = print_progress;
+    }
+
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_RECOMPRESS, &input,
+                       (void **)&output, check_cancel, NULL, pool, pool));
+
+  if (!opt_state->quiet)
+    printf(_("\n%" APR_INT64_T_FMT " representations recompressed, "
+             "%" APR_INT64_T_FMT " kept.\n"),
+           output->stats->reps_recompressed, output->stats->reps_kept);
+
+  return SVN_NO_ERROR;
+}
@@ -162,6 +162,21 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
    )},
    {'M'} },
 
+  {"recompress", subcommand__recompress, {0}, {N_(
+    "usage: svnfsfs recompress REPOS_PATH\n"
+    "\n"), N_(
+    "Re-encode all deltas stored with svndiff versions 0 to 2 such that they use\n"
+    "Zstandard compression.  Only the compression of the delta data changes, the\n"
+    "deltas themselves are not recomputed.  Every representation keeps its size\n"
+    "and location;  those that would not fit are left unchanged.  This is only\n"
+    "available for FSFS format 9 repositories using logical addressing.\n"
+    "\n"), N_(
+    "Commits and packing will wait for this command to finish but readers will\n"
+    "not.  Modified revision / pack files are replaced atomically, so readers\n"
+    "always see either the old or the new data.\n"
+   )},
+   {'q', 'M'} },
+
   {"stats", subcommand__stats, {0}, {N_(
     "usage: svnfsfs stats REPOS_PATH\n"
     "\n"), N_(
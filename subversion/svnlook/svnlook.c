@@ -200,7 +200,13 @@ static const apr_getopt_option_t options_table[] =
       "                             "
       "  -U ARG, --context ARG: Show ARG lines of context\n"
       "                             "
-      "  -p, --show-c-function: Show C function name")},
+      "  -p, --show-c-function: Show C function name\n"
+      "                             "
+      "  --diff-algorithm ARG: Use 'myers' (minimal),\n"
+      "                             "
+      "    'histogram' or 'auto' (default; switches to\n"
+      "                             "
+      "    histogram for very different files)")},
 
   {"quiet",             'q', 0,
    N_("no progress (only errors) to stderr")},
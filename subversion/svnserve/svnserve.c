@@ -55,7 +55,10 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_fspath.h"
 #include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 
 #if APR_HAS_THREADS
@@ -222,6 +225,9 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_SHARED_CACHE    277
+#define SVNSERVE_OPT_WARM_CACHE      278
+#define SVNSERVE_OPT_CACHE_COMPRESSION 279
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -325,6 +331,36 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+#if APR_HAS_FORK
+    {"shared-memory-cache", SVNSERVE_OPT_SHARED_CACHE, 0,
+     N_("share the in-memory cache between all forked\n"
+        "                             "
+        "server processes instead of using one cache per\n"
+        "                             "
+        "connection process.\n"
+        "                             "
+        "[mode: daemon with fork]")},
+#endif
+    {"cache-compression", SVNSERVE_OPT_CACHE_COMPRESSION, 1,
+     N_("compress items of at least ARG KB in the\n"
+        "                             "
+        "in-memory cache.  This trades CPU time for a\n"
+        "                             "
+        "larger effective cache size.\n"
+        "                             "
+        "Default is 0 (no compression).\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
+    {"warm-cache", SVNSERVE_OPT_WARM_CACHE, 1,
+     N_("before accepting connections, preload the caches\n"
+        "                             "
+        "with the paths listed in file ARG, one\n"
+        "                             "
+        "PATH[@REV] per line, relative to the root\n"
+        "                             "
+        "directory (see -r).\n"
+        "                             "
+        "[used for FSFS repositories only]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -492,6 +528,127 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+#ifdef SIGUSR1
+/* Set when the administrator asked for the cache statistics to be logged.
+ * Reset once they have been written. */
+static volatile sig_atomic_t cache_stats_requested = 0;
+
+static void sigusr1_handler(int signo)
+{
+  cache_stats_requested = 1;
+}
+#endif
+
+/* Preload the FS caches with the node given by TARGET.  Its path is a
+ * local path relative to the root directory in PARAMS and may point into
+ * any repository below it.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+warm_cache_target(const svn_repos_warm_cache_target_t *target,
+                  serve_params_t *params,
+                  apr_pool_t *scratch_pool)
+{
+  svn_repos_warm_cache_target_t *fs_target;
+  apr_array_header_t *fs_targets;
+  const char *local_path;
+  const char *repos_root;
+  svn_repos_t *repos;
+
+  local_path = svn_dirent_join(params->root,
+                               svn_relpath_canonicalize(target->path,
+                                                        scratch_pool),
+                               scratch_pool);
+  repos_root = svn_repos_find_root_path(local_path, scratch_pool);
+  if (!repos_root)
+    return svn_error_createf(SVN_ERR_RA_SVN_REPOS_NOT_FOUND, NULL,
+                             _("No repository found in '%s'"),
+                             svn_dirent_local_style(local_path,
+                                                    scratch_pool));
+
+  fs_target = apr_pcalloc(scratch_pool, sizeof(*fs_target));
+  fs_target->path = svn_fspath__canonicalize(
+                      svn_dirent_skip_ancestor(repos_root, local_path),
+                      scratch_pool);
+  fs_target->revision = target->revision;
+
+  fs_targets = apr_array_make(scratch_pool, 1, sizeof(fs_target));
+  APR_ARRAY_PUSH(fs_targets, svn_repos_warm_cache_target_t *) = fs_target;
+
+  SVN_ERR(svn_repos_open3(&repos, repos_root, params->fs_config,
+                          scratch_pool, scratch_pool));
+  return svn_error_trace(svn_repos_warm_cache(repos, fs_targets,
+                                              svn_depth_infinity, 0,
+                                              NULL, NULL, NULL, NULL,
+                                              scratch_pool));
+}
+
+/* Read the list of PATH[@REV] lines from FILENAME and preload the FS
+ * caches with these nodes, see warm_cache_target().  Targets that cannot
+ * be loaded are reported as warnings and skipped.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+warm_caches(const char *filename,
+            serve_params_t *params,
+            apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  apr_array_header_t *targets;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, filename, scratch_pool));
+  SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, contents->data,
+                                              scratch_pool));
+
+  for (i = 0; i < targets->nelts; ++i)
+    {
+      svn_repos_warm_cache_target_t *target
+        = APR_ARRAY_IDX(targets, i, svn_repos_warm_cache_target_t *);
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      err = warm_cache_target(target, params, iterpool);
+      if (err)
+        {
+          logger__log_warning(params->logger, err, NULL, NULL);
+          svn_handle_warning2(stderr, err, "svnserve: ");
+          svn_error_clear(err);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Write the statistics of the global membuffer cache, including their
+ * break-down by cache prefix, to LOGGER.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+log_cache_stats(logger_t *logger,
+                apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  apr_array_header_t *prefix_info;
+  svn_string_t *text;
+
+  if (logger == NULL || membuffer == NULL)
+    return SVN_NO_ERROR;
+
+  text = svn_cache__format_info(
+             svn_cache__membuffer_get_global_info(scratch_pool),
+             FALSE, scratch_pool);
+  SVN_ERR(logger__write(logger, text->data, text->len));
+
+  SVN_ERR(svn_cache__membuffer_get_prefix_info(&prefix_info, membuffer,
+                                               scratch_pool, scratch_pool));
+  text = svn_cache__format_prefix_info(prefix_info, scratch_pool);
+  SVN_ERR(logger__write(logger, text->data, text->len));
+
+  return SVN_NO_ERROR;
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -556,6 +713,14 @@ accept_connection(connection_t **connection,
             connection_pool) == APR_CHILD_DONE)
             ;
         }
+
+#ifdef SIGUSR1
+      if (cache_stats_requested)
+        {
+          cache_stats_requested = 0;
+          svn_error_clear(log_cache_stats(params->logger, connection_pool));
+        }
+#endif
     }
   while (APR_STATUS_IS_EINTR(status)
     || APR_STATUS_IS_ECONNABORTED(status)
@@ -725,6 +890,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t shared_cache = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -738,6 +904,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   int handling_opt_count = 0;
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
+  const char *warm_cache_filename = NULL;
   const char *log_filename = NULL;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
@@ -929,6 +1096,20 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_SHARED_CACHE:
+          shared_cache = TRUE;
+          break;
+
+        case SVNSERVE_OPT_CACHE_COMPRESSION:
+          {
+            apr_uint64_t sz_val;
+            SVN_ERR(svn_cstring_atoui64(&sz_val, arg));
+
+            svn_cache__set_global_membuffer_compression(
+                (apr_size_t)(0x400 * sz_val));
+          }
+          break;
+
         case SVNSERVE_OPT_CLIENT_SPEED:
           {
             apr_size_t bandwidth = (apr_size_t)apr_strtoi64(arg, NULL, 0);
@@ -985,6 +1166,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&pid_filename, pid_filename, pool));
           break;
 
+        case SVNSERVE_OPT_WARM_CACHE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&warm_cache_filename, arg, pool));
+          warm_cache_filename = svn_dirent_internal_style(warm_cache_filename,
+                                                          pool);
+          SVN_ERR(svn_dirent_get_absolute(&warm_cache_filename,
+                                          warm_cache_filename, pool));
+          break;
+
          case SVNSERVE_OPT_VIRTUAL_HOST:
            params.vhost = TRUE;
            break;
@@ -1249,6 +1438,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   apr_signal(SIGPIPE, SIG_IGN);
 #endif
 
+#ifdef SIGUSR1
+  /* Let the administrator request the cache statistics.  Forked children
+   * that don't share their caches with us have no way to report them. */
+  if (handling_mode != connection_mode_fork || shared_cache)
+    apr_signal(SIGUSR1, sigusr1_handler);
+#endif
+
 #ifdef SIGXFSZ
   /* Disable SIGXFSZ generation for the platforms that have it, otherwise
    * working with large files when compiled against an APR that doesn't have
@@ -1295,8 +1491,30 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* In fork mode, create the cache in shared memory before forking the
+     * first child, so all of them will use the same cache. */
+    if (shared_cache && handling_mode == connection_mode_fork)
+      {
+        svn_cache__set_global_membuffer_shared(TRUE, NULL);
+        svn_cache__get_global_membuffer_cache();
+      }
   }
 
+  /* Forked children and worker threads alike will find the data in the
+   * caches we just configured.  A failed warm-up only costs performance,
+   * so don't refuse to start because of it. */
+  if (warm_cache_filename)
+    {
+      err = warm_caches(warm_cache_filename, &params, pool);
+      if (err)
+        {
+          logger__log_error(params.logger, err, NULL, NULL);
+          svn_handle_warning2(stderr, err, "svnserve: ");
+          svn_error_clear(err);
+        }
+    }
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1352,6 +1570,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child would't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* attach to the locks of the shared cache */
+              if (shared_cache)
+                {
+                  err = svn_cache__membuffer_child_init(
+                            svn_cache__get_global_membuffer_cache(),
+                            connection->pool);
+                  if (err)
+                    {
+                      logger__log_error(params.logger, err, NULL, NULL);
+                      svn_error_clear(err);
+                      close_connection(connection);
+                      return SVN_NO_ERROR;
+                    }
+                }
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
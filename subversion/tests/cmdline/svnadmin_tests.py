@@ -4037,6 +4037,30 @@ PROPS-END
     raise svntest.Failure("Unexpected property value %s" % output)
 
 
+def verify_jobs(sbox):
+  "svnadmin verify --jobs"
+
+  sbox.build(create_wc = False)
+  for i in range(20):
+    svntest.main.run_svnmucc('propset', 'prop', str(i),
+                             sbox.repo_url + '/iota', '-m', 'log msg')
+
+  # The output must not depend on the number of threads.
+  exit_code, expected_output, errput = \
+    svntest.main.run_svnadmin("verify", sbox.repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+
+  exit_code, output, errput = \
+    svntest.main.run_svnadmin("verify", "--jobs", "4", sbox.repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+
+  svntest.verify.compare_and_display_lines(
+    "Unexpected output of 'svnadmin verify --jobs 4'.",
+    'STDOUT', expected_output, output)
+
+
 ########################################################################
 # Run the tests
 
@@ -4116,6 +4140,7 @@ test_list = [ None,
               recover_prunes_rep_cache_when_disabled,
               dump_include_copied_directory,
               load_normalize_node_props,
+              verify_jobs,
              ]
 
 if __name__ == '__main__':
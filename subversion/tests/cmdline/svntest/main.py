@@ -2306,7 +2306,7 @@ def tweak_options_for_precooked_repos():
   global options
 
   # Server versions that introduced the respective FSFS formats:
-  introducing_version = { 1:1, 2:4, 3:5, 4:6, 6:8, 7:9 }
+  introducing_version = { 1:1, 2:4, 3:5, 4:6, 6:8, 7:9, 8:10, 9:14 }
   if options.fsfs_version:
     if options.fsfs_version in introducing_version:
       introduced_in = introducing_version[options.fsfs_version]
@@ -1419,6 +1419,129 @@ test_copy_pin_externals_select_subtree(const svn_test_opts_t *opts, apr_pool_t *
   return SVN_NO_ERROR;
 }
 
+/* Run 'svn diff' on WC_PATH with CTX in unified and in git format and set
+ * *OUTPUT to the concatenated results.
+ */
+static svn_error_t *
+diff_wc_to_string(svn_stringbuf_t **output,
+                  const char *wc_path,
+                  svn_client_ctx_t *ctx,
+                  apr_pool_t *pool)
+{
+  svn_opt_revision_t base_rev, working_rev;
+  svn_stream_t *outstream;
+  svn_stream_t *errstream = svn_stream_empty(pool);
+
+  base_rev.kind = svn_opt_revision_base;
+  working_rev.kind = svn_opt_revision_working;
+
+  *output = svn_stringbuf_create_empty(pool);
+  outstream = svn_stream_from_stringbuf(*output, pool);
+
+  SVN_ERR(svn_client_diff7(NULL, wc_path, &base_rev, wc_path, &working_rev,
+                           wc_path, svn_depth_infinity,
+                           FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE,
+                           FALSE /* use_git_diff_format */, FALSE,
+                           "UTF-8", outstream, errstream,
+                           NULL, ctx, pool));
+  SVN_ERR(svn_client_diff7(NULL, wc_path, &base_rev, wc_path, &working_rev,
+                           wc_path, svn_depth_infinity,
+                           FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE,
+                           TRUE /* use_git_diff_format */, FALSE,
+                           "UTF-8", outstream, errstream,
+                           NULL, ctx, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_diff_threads(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  static const char *files[] = {
+    "iota", "A/mu", "A/B/lambda", "A/B/E/alpha", "A/B/E/beta",
+    "A/D/gamma", "A/D/G/pi", "A/D/G/rho", "A/D/G/tau",
+    "A/D/H/chi", "A/D/H/omega", NULL
+  };
+  svn_opt_revision_t rev;
+  svn_opt_revision_t peg_rev;
+  svn_client_ctx_t *ctx;
+  svn_config_t *cfg;
+  const char *repos_url;
+  const char *wc_path;
+  const char *new_path;
+  apr_array_header_t *targets;
+  svn_stringbuf_t *serial_output, *parallel_output;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(create_greek_repos(&repos_url, "test-diff-threads", opts, pool));
+
+  wc_path = svn_test_data_path("test-diff-threads-wc", pool);
+  SVN_ERR(svn_io_remove_dir2(wc_path, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(wc_path, pool));
+  svn_test_add_dir_cleanup(wc_path);
+
+  rev.kind = svn_opt_revision_head;
+  peg_rev.kind = svn_opt_revision_unspecified;
+  SVN_ERR(svn_client_create_context(&ctx, pool));
+  SVN_ERR(svn_client_checkout3(NULL, repos_url, wc_path,
+                               &peg_rev, &rev, svn_depth_infinity,
+                               TRUE, FALSE, ctx, pool));
+
+  /* Modify most files in different ways, delete another one and add a
+     new file. */
+  for (i = 0; files[i]; i++)
+    {
+      const char *path;
+      svn_stringbuf_t *contents;
+      int j;
+
+      svn_pool_clear(iterpool);
+      path = svn_dirent_join(wc_path, files[i], iterpool);
+      contents = svn_stringbuf_create_empty(iterpool);
+      for (j = 0; j < 20 * (i + 1); j++)
+        {
+          if (j % (i + 2) == 0)
+            svn_stringbuf_appendcstr(contents, "changed line\n");
+          else
+            svn_stringbuf_appendcstr(contents,
+                                     apr_psprintf(iterpool, "line %d\n", j));
+        }
+
+      SVN_ERR(svn_io_remove_file2(path, FALSE, iterpool));
+      SVN_ERR(svn_io_file_create(path, contents->data, iterpool));
+    }
+
+  targets = apr_array_make(pool, 1, sizeof(const char *));
+  APR_ARRAY_PUSH(targets, const char *)
+    = svn_dirent_join(wc_path, "A/D/H/psi", pool);
+  SVN_ERR(svn_client_delete4(targets, FALSE, FALSE, NULL, NULL, NULL,
+                             ctx, pool));
+
+  new_path = svn_dirent_join(wc_path, "A/new", pool);
+  SVN_ERR(svn_io_file_create(new_path, "new file\n", pool));
+  SVN_ERR(svn_client_add5(new_path, svn_depth_empty, FALSE, FALSE, FALSE,
+                          FALSE, ctx, pool));
+
+  SVN_ERR(diff_wc_to_string(&serial_output, wc_path, ctx, pool));
+
+  /* Let up to 4 threads do the diffs.  The output must not change. */
+  SVN_ERR(svn_config_create2(&cfg, FALSE, FALSE, pool));
+  svn_config_set(cfg, SVN_CONFIG_SECTION_MISCELLANY,
+                 SVN_CONFIG_OPTION_DIFF_THREADS, "4");
+  ctx->config = apr_hash_make(pool);
+  svn_hash_sets(ctx->config, SVN_CONFIG_CATEGORY_CONFIG, cfg);
+
+  SVN_ERR(diff_wc_to_string(&parallel_output, wc_path, ctx, pool));
+
+  SVN_TEST_ASSERT(strstr(serial_output->data, "+new file") != NULL);
+  SVN_TEST_STRING_ASSERT(parallel_output->data, serial_output->data);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1447,6 +1570,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_client_copy7 with externals_to_pin"),
     SVN_TEST_OPTS_PASS(test_copy_pin_externals_select_subtree,
                        "pin externals on selected subtrees only"),
+    SVN_TEST_OPTS_PASS(test_diff_threads,
+                       "test svn_client_diff7 with diff-threads"),
     SVN_TEST_NULL
   };
 
@@ -37,6 +37,8 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_subr_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -605,6 +607,431 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Fill BUF of LEN bytes with pseudo-random text drawn from a small
+   alphabet, so the xdelta checksum pre-filter sees realistic hit rates. */
+static void
+fill_random_text(char *buf, apr_size_t len, apr_uint32_t *seed)
+{
+  static const char alphabet[] = "etaoin shrdlu\n{};()=";
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    buf[i] = alphabet[svn_test_rand(seed) % (sizeof(alphabet) - 1)];
+}
+
+/* Implements svn_test_driver_t.
+   Run the xdelta engine over full-sized windows of slightly modified
+   text, verify that the resulting windows reproduce the target and
+   report the throughput in verbose mode. */
+static svn_error_t *
+xdelta_throughput_test(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  enum { ITERATIONS = 50, EDITS = 200 };
+  apr_uint32_t seed = 4711;
+  apr_size_t window_size = SVN_DELTA_WINDOW_SIZE;
+  char *data = apr_palloc(pool, 2 * window_size);
+  char *target = data + window_size;
+  char *regen = apr_palloc(pool, window_size);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start, duration = 0;
+  apr_size_t total = 0;
+  int i, k;
+
+  fill_random_text(data, window_size, &seed);
+
+  for (i = 0; i < ITERATIONS; ++i)
+    {
+      svn_txdelta__ops_baton_t build_baton = { 0 };
+      svn_txdelta_window_t *window;
+      apr_size_t regen_len = window_size;
+
+      svn_pool_clear(iterpool);
+
+      /* The target is the source with a few short random replacements
+         and a shift by a random offset. */
+      memcpy(target, data, window_size);
+      for (k = 0; k < EDITS; ++k)
+        fill_random_text(target + svn_test_rand(&seed) % (window_size - 16),
+                         svn_test_rand(&seed) % 16, &seed);
+      k = svn_test_rand(&seed) % 64;
+      memmove(target + k, target, window_size - k);
+
+      build_baton.new_data = svn_stringbuf_create_empty(iterpool);
+
+      start = apr_time_now();
+      svn_txdelta__xdelta(&build_baton, data, window_size, window_size,
+                          iterpool);
+      duration += apr_time_now() - start;
+      total += window_size;
+
+      window = svn_txdelta__make_window(&build_baton, iterpool);
+      window->sview_offset = 0;
+      window->sview_len = window_size;
+      window->tview_len = window_size;
+
+      svn_txdelta_apply_instructions(window, data, regen, &regen_len);
+      SVN_TEST_INT_ASSERT(regen_len, window_size);
+      SVN_TEST_ASSERT(memcmp(regen, target, window_size) == 0);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  if (opts->verbose)
+    printf("xdelta: %.1f MB/s\n",
+           duration ? (double)total / (double)duration : 0.0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the svndiff representation of the delta between SOURCE and TARGET
+   to *RESULT, using svndiff VERSION and up to MAX_THREADS encoder threads.
+   Allocate *RESULT in POOL. */
+static svn_error_t *
+encode_delta(svn_stringbuf_t **result,
+             const svn_string_t *source,
+             const svn_string_t *target,
+             int version,
+             int max_threads,
+             apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  *result = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                           svn_stream_from_stringbuf(*result,
+                                                                     pool),
+                                           version,
+                                           SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                           max_threads, pool));
+  svn_txdelta2(&txdelta_stream,
+               svn_stream_from_string(source, pool),
+               svn_stream_from_string(target, pool),
+               FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(txdelta_stream,
+                                                   handler, handler_baton,
+                                                   pool));
+}
+
+/* Implements svn_test_driver_t.
+   Verify that the parallel svndiff encoder produces the same output as
+   the sequential one. */
+static svn_error_t *
+parallel_svndiff_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 815;
+  apr_size_t len = 20 * SVN_DELTA_WINDOW_SIZE + 1234;
+  char *source_data = apr_palloc(pool, len);
+  char *target_data = apr_palloc(pool, len);
+  svn_string_t *source, *target;
+  int version, k;
+
+  fill_random_text(source_data, len, &seed);
+  memcpy(target_data, source_data, len);
+  for (k = 0; k < 500; ++k)
+    fill_random_text(target_data + svn_test_rand(&seed) % (len - 100),
+                     svn_test_rand(&seed) % 100, &seed);
+
+  source = svn_string_ncreate(source_data, len, pool);
+  target = svn_string_ncreate(target_data, len, pool);
+
+  for (version = 0; version <= (svn__zstd_available() ? 3 : 2); ++version)
+    {
+      svn_stringbuf_t *expected, *actual;
+
+      SVN_ERR(encode_delta(&expected, source, target, version, 1, pool));
+      SVN_ERR(encode_delta(&actual, source, target, version, 4, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t.
+   Round-trip a file's worth of fresh text through every svndiff version
+   and report the resulting size and the encode / decode throughput in
+   verbose mode. */
+static svn_error_t *
+svndiff_versions_test(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  apr_uint32_t seed = 1234;
+  apr_size_t len = 64 * SVN_DELTA_WINDOW_SIZE;
+  char *data = apr_palloc(pool, len);
+  svn_string_t *source = svn_string_create_empty(pool);
+  svn_string_t *target;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int version;
+
+  fill_random_text(data, len, &seed);
+  target = svn_string_ncreate(data, len, pool);
+
+  for (version = 0; version <= 3; ++version)
+    {
+      svn_stringbuf_t *encoded, *decoded;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *parser;
+      apr_size_t encoded_len;
+      apr_time_t start, encode_time, decode_time;
+
+      if (version == 3 && !svn__zstd_available())
+        continue;
+
+      svn_pool_clear(iterpool);
+
+      start = apr_time_now();
+      SVN_ERR(encode_delta(&encoded, source, target, version, 1, iterpool));
+      encode_time = apr_time_now() - start;
+
+      decoded = svn_stringbuf_create_empty(iterpool);
+      svn_txdelta_apply(svn_stream_from_string(source, iterpool),
+                        svn_stream_from_stringbuf(decoded, iterpool),
+                        NULL, NULL, iterpool, &handler, &handler_baton);
+      parser = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                         iterpool);
+
+      start = apr_time_now();
+      encoded_len = encoded->len;
+      SVN_ERR(svn_stream_write(parser, encoded->data, &encoded_len));
+      SVN_ERR(svn_stream_close(parser));
+      decode_time = apr_time_now() - start;
+
+      SVN_TEST_INT_ASSERT(decoded->len, len);
+      SVN_TEST_ASSERT(memcmp(decoded->data, data, len) == 0);
+
+      if (opts->verbose)
+        printf("svndiff%d: %8" APR_SIZE_T_FMT " bytes, "
+               "encode %.1f MB/s, decode %.1f MB/s\n",
+               version, encoded->len,
+               encode_time ? (double)len / (double)encode_time : 0.0,
+               decode_time ? (double)len / (double)decode_time : 0.0);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the xdelta window that transforms SOURCE into TARGET, both of
+   LEN bytes.  Allocate the result in POOL. */
+static svn_txdelta_window_t *
+make_xdelta_window(const char *source,
+                   const char *target,
+                   apr_size_t len,
+                   apr_pool_t *pool)
+{
+  svn_txdelta__ops_baton_t build_baton = { 0 };
+  svn_txdelta_window_t *window;
+  char *data = apr_palloc(pool, 2 * len);
+
+  memcpy(data, source, len);
+  memcpy(data + len, target, len);
+
+  build_baton.new_data = svn_stringbuf_create_empty(pool);
+  svn_txdelta__xdelta(&build_baton, data, len, len, pool);
+
+  window = svn_txdelta__make_window(&build_baton, pool);
+  window->sview_offset = 0;
+  window->sview_len = len;
+  window->tview_len = len;
+  return window;
+}
+
+/* Implements svn_test_driver_t.
+   Build delta chains of increasing length over a series of slightly
+   modified texts, compose them with svn_txdelta__compose_window_chain()
+   and verify the result against the newest text.  In verbose mode,
+   compare the time taken with pairwise composition and with expanding
+   every window on its own. */
+static svn_error_t *
+compose_window_chain_test(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  enum { MAX_DEPTH = 32, EDITS = 8, ITERATIONS = 20 };
+  apr_uint32_t seed = 2718;
+  apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+  char *texts[MAX_DEPTH + 1];
+  svn_txdelta_window_t *deltas[MAX_DEPTH];
+  char *result = apr_palloc(pool, len);
+  char *scratch = apr_palloc(pool, len);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int depth, i, k;
+
+  /* TEXTS[0] is the oldest version and DELTAS[I] produces TEXTS[I+1]
+     from TEXTS[I]. */
+  texts[0] = apr_palloc(pool, len);
+  fill_random_text(texts[0], len, &seed);
+  for (i = 0; i < MAX_DEPTH; ++i)
+    {
+      texts[i + 1] = apr_pmemdup(pool, texts[i], len);
+      for (k = 0; k < EDITS; ++k)
+        fill_random_text(texts[i + 1] + svn_test_rand(&seed) % (len - 64),
+                         svn_test_rand(&seed) % 64, &seed);
+
+      deltas[i] = make_xdelta_window(texts[i], texts[i + 1], len, pool);
+    }
+
+  for (depth = 2; depth <= MAX_DEPTH; depth *= 2)
+    {
+      apr_array_header_t *chain
+        = apr_array_make(pool, depth, sizeof(svn_txdelta_window_t *));
+      apr_time_t chain_time = 0, pairwise_time = 0, expand_time = 0;
+      apr_time_t start;
+      int iteration;
+
+      /* Newest window first, as the FS backends read them. */
+      for (i = depth - 1; i >= 0; --i)
+        APR_ARRAY_PUSH(chain, svn_txdelta_window_t *) = deltas[i];
+
+      for (iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+          svn_txdelta_window_t *composite;
+          apr_size_t result_len = len;
+
+          svn_pool_clear(iterpool);
+
+          start = apr_time_now();
+          composite = svn_txdelta__compose_window_chain(chain, iterpool,
+                                                        iterpool);
+          svn_txdelta_apply_instructions(composite, texts[0], result,
+                                         &result_len);
+          chain_time += apr_time_now() - start;
+
+          SVN_TEST_INT_ASSERT(result_len, len);
+          SVN_TEST_ASSERT(memcmp(result, texts[depth], len) == 0);
+
+          start = apr_time_now();
+          composite = deltas[0];
+          for (i = 1; i < depth; ++i)
+            composite = svn_txdelta_compose_windows(composite, deltas[i],
+                                                    iterpool);
+          svn_txdelta_apply_instructions(composite, texts[0], result,
+                                         &result_len);
+          pairwise_time += apr_time_now() - start;
+
+          SVN_TEST_ASSERT(memcmp(result, texts[depth], len) == 0);
+
+          start = apr_time_now();
+          memcpy(result, texts[0], len);
+          for (i = 0; i < depth; ++i)
+            {
+              memcpy(scratch, result, len);
+              svn_txdelta_apply_instructions(deltas[i], scratch, result,
+                                             &result_len);
+            }
+          expand_time += apr_time_now() - start;
+
+          SVN_TEST_ASSERT(memcmp(result, texts[depth], len) == 0);
+        }
+
+      if (opts->verbose)
+        printf("depth %2d: chain %5.1f us, pairwise %5.1f us, "
+               "expand %5.1f us\n", depth,
+               (double)chain_time / ITERATIONS,
+               (double)pairwise_time / ITERATIONS,
+               (double)expand_time / ITERATIONS);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t.
+   Re-encode the svndiff data of all older versions as svndiff3, once with
+   minimal window lengths and once padded to the original lengths, and
+   verify that the result still produces the target text. */
+static svn_error_t *
+transcode_svndiff_test(apr_pool_t *pool)
+{
+  enum { EDITS = 64 };
+  apr_uint32_t seed = 4711;
+  apr_size_t len = 16 * SVN_DELTA_WINDOW_SIZE;
+  char *data = apr_palloc(pool, len);
+  svn_string_t *source, *target;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int version, keep_length, i;
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Zstandard compression is not available");
+
+  fill_random_text(data, len, &seed);
+  source = svn_string_ncreate(data, len, pool);
+  for (i = 0; i < EDITS; ++i)
+    fill_random_text(data + svn_test_rand(&seed) % (len - 64),
+                     svn_test_rand(&seed) % 64, &seed);
+  target = svn_string_ncreate(data, len, pool);
+
+  for (version = 0; version <= 2; ++version)
+    for (keep_length = FALSE; keep_length <= TRUE; ++keep_length)
+      {
+        svn_stringbuf_t *encoded, *transcoded, *decoded;
+        svn_stream_t *input, *parser;
+        svn_txdelta_window_handler_t handler;
+        void *handler_baton;
+        svn_boolean_t all_fit = TRUE;
+        apr_size_t consumed = 4;
+        apr_size_t transcoded_len;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(encode_delta(&encoded, source, target, version, 1,
+                             iterpool));
+
+        transcoded = svn_stringbuf_ncreate("SVN\3", 4, iterpool);
+        input = svn_stream_from_stringbuf(encoded, iterpool);
+        SVN_ERR(svn_stream_skip(input, consumed));
+        while (consumed < encoded->len)
+          {
+            svn_boolean_t fits;
+            apr_size_t window_len;
+            apr_size_t old_len = transcoded->len;
+
+            SVN_ERR(svn_txdelta__transcode_svndiff_window(transcoded, &fits,
+                                                          &window_len, input,
+                                                          version, 3, 0,
+                                                          keep_length,
+                                                          iterpool));
+            if (fits && keep_length)
+              SVN_TEST_INT_ASSERT(transcoded->len - old_len, window_len);
+
+            all_fit = all_fit && fits;
+            consumed += window_len;
+          }
+
+        SVN_TEST_INT_ASSERT(consumed, encoded->len);
+
+        /* Uncompressed text always leaves room for the padding. */
+        if (version == 0)
+          SVN_TEST_ASSERT(all_fit);
+        if (!all_fit)
+          continue;
+
+        if (keep_length)
+          SVN_TEST_INT_ASSERT(transcoded->len, encoded->len);
+
+        decoded = svn_stringbuf_create_empty(iterpool);
+        svn_txdelta_apply(svn_stream_from_string(source, iterpool),
+                          svn_stream_from_stringbuf(decoded, iterpool),
+                          NULL, NULL, iterpool, &handler, &handler_baton);
+        parser = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                           iterpool);
+        transcoded_len = transcoded->len;
+        SVN_ERR(svn_stream_write(parser, transcoded->data, &transcoded_len));
+        SVN_ERR(svn_stream_close(parser));
+
+        SVN_TEST_STRING_ASSERT(decoded->data, target->data);
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +1052,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(xdelta_throughput_test,
+                       "xdelta engine throughput"),
+    SVN_TEST_PASS2(parallel_svndiff_test,
+                   "parallel svndiff encoding"),
+    SVN_TEST_OPTS_PASS(svndiff_versions_test,
+                       "svndiff versions size and throughput"),
+    SVN_TEST_OPTS_PASS(compose_window_chain_test,
+                       "compose delta window chains"),
+    SVN_TEST_PASS2(transcode_svndiff_test,
+                   "transcode svndiff data to version 3"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -3065,6 +3065,283 @@ three_way_double_add(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Like random_trivial_merge() but use the histogram diff algorithm. */
+static svn_error_t *
+random_trivial_merge_histogram(apr_pool_t *pool)
+{
+  int i;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+
+  const char *base_filename1 = "histogram1";
+  const char *base_filename2 = "histogram2";
+
+  const char *filename1 = svn_test_data_path(base_filename1, pool);
+  const char *filename2 = svn_test_data_path(base_filename2, pool);
+
+  diff_opts->algorithm = svn_diff_algorithm_histogram;
+  seed_val();
+
+  for (i = 0; i < 5; ++i)
+    {
+      int min_lines = 1000;
+      int max_lines = 1100;
+      int var_lines = 50;
+      int block_lines = 10;
+      svn_stringbuf_t *contents1, *contents2;
+
+      SVN_ERR(make_random_file(filename1,
+                               min_lines, max_lines, var_lines, block_lines,
+                               i % 3, subpool));
+      SVN_ERR(make_random_file(filename2,
+                               min_lines, max_lines, var_lines, block_lines,
+                               i % 2, subpool));
+
+      SVN_ERR(svn_stringbuf_from_file2(&contents1, filename1, subpool));
+      SVN_ERR(svn_stringbuf_from_file2(&contents2, filename2, subpool));
+
+      SVN_ERR(three_way_merge(base_filename1, base_filename2, base_filename1,
+                              contents1->data, contents2->data,
+                              contents1->data, contents2->data, diff_opts,
+                              svn_diff_conflict_display_modified_latest,
+                              subpool));
+      SVN_ERR(three_way_merge(base_filename2, base_filename1, base_filename2,
+                              contents2->data, contents1->data,
+                              contents2->data, contents1->data, diff_opts,
+                              svn_diff_conflict_display_modified_latest,
+                              subpool));
+      svn_pool_clear(subpool);
+    }
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Reversing a file makes the O(NP) algorithm go quadratic.  The default
+   algorithm must detect that and switch to the histogram algorithm. */
+static svn_error_t *
+trivial_merge_reversed_file(apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents1 = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *contents2 = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < 5000; ++i)
+    {
+      svn_stringbuf_appendcstr(contents1,
+                               apr_psprintf(pool, "line %d" NL, i));
+      svn_stringbuf_appendcstr(contents2,
+                               apr_psprintf(pool, "line %d" NL, 4999 - i));
+    }
+
+  SVN_ERR(three_way_merge("reversed1", "reversed2", "reversed1",
+                          contents1->data, contents2->data,
+                          contents1->data, contents2->data, NULL,
+                          svn_diff_conflict_display_modified_latest,
+                          pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_diff_algorithm_option(apr_pool_t *pool)
+{
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+  apr_array_header_t *args = apr_array_make(pool, 2, sizeof(const char *));
+
+  SVN_TEST_ASSERT(diff_opts->algorithm == svn_diff_algorithm_auto);
+
+  APR_ARRAY_PUSH(args, const char *) = "--diff-algorithm";
+  APR_ARRAY_PUSH(args, const char *) = "histogram";
+  SVN_ERR(svn_diff_file_options_parse(diff_opts, args, pool));
+  SVN_TEST_ASSERT(diff_opts->algorithm == svn_diff_algorithm_histogram);
+
+  APR_ARRAY_IDX(args, 1, const char *) = "myers";
+  SVN_ERR(svn_diff_file_options_parse(diff_opts, args, pool));
+  SVN_TEST_ASSERT(diff_opts->algorithm == svn_diff_algorithm_myers);
+
+  APR_ARRAY_IDX(args, 1, const char *) = "patience";
+  SVN_TEST_ASSERT_ERROR(svn_diff_file_options_parse(diff_opts, args, pool),
+                        SVN_ERR_INVALID_DIFF_OPTION);
+
+  return SVN_NO_ERROR;
+}
+
+/* Diff two files of a few megabytes that differ in a handful of lines,
+   using various normalization options.  Verify that the file diff agrees
+   with the in-memory diff and report the throughput in verbose mode. */
+static svn_error_t *
+diff_large_files(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  static const char *const option_sets[][3] = {
+    { NULL },
+    { "-b", NULL },
+    { "-w", "--ignore-eol-style", NULL }
+  };
+  svn_stringbuf_t *contents1 = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *contents2 = svn_stringbuf_create_empty(pool);
+  svn_string_t *original, *modified;
+  const char *filename1 = svn_test_data_path("large1", pool);
+  const char *filename2 = svn_test_data_path("large2", pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, k;
+
+  for (i = 0; i < 100000; ++i)
+    {
+      char line[80];
+      apr_snprintf(line, sizeof(line), "%*sstatic int value_%d = %d;%s",
+                   (i % 4) * 2, "", i, i * 7, i % 3 ? "\n" : "\r\n");
+      svn_stringbuf_appendcstr(contents1, line);
+
+      if (i % 25000 == 12345)
+        apr_snprintf(line, sizeof(line), "static int changed_%d;\n", i);
+      svn_stringbuf_appendcstr(contents2, line);
+    }
+
+  original = svn_string_create_from_buf(contents1, pool);
+  modified = svn_string_create_from_buf(contents2, pool);
+  SVN_ERR(make_file(filename1, original->data, pool));
+  SVN_ERR(make_file(filename2, modified->data, pool));
+
+  for (k = 0; k < (int)(sizeof(option_sets) / sizeof(option_sets[0])); ++k)
+    {
+      svn_diff_file_options_t *diff_opts;
+      apr_array_header_t *args;
+      svn_stringbuf_t *file_output, *mem_output;
+      svn_diff_t *diff;
+      apr_time_t start, duration;
+
+      svn_pool_clear(iterpool);
+      diff_opts = svn_diff_file_options_create(iterpool);
+      args = apr_array_make(iterpool, 2, sizeof(const char *));
+      file_output = svn_stringbuf_create_empty(iterpool);
+      mem_output = svn_stringbuf_create_empty(iterpool);
+
+      for (i = 0; option_sets[k][i]; ++i)
+        APR_ARRAY_PUSH(args, const char *) = option_sets[k][i];
+      SVN_ERR(svn_diff_file_options_parse(diff_opts, args, iterpool));
+
+      start = apr_time_now();
+      SVN_ERR(svn_diff_file_diff_2(&diff, filename1, filename2, diff_opts,
+                                   iterpool));
+      duration = apr_time_now() - start;
+
+      SVN_TEST_ASSERT(svn_diff_contains_diffs(diff));
+      SVN_ERR(svn_diff_file_output_unified2(
+                  svn_stream_from_stringbuf(file_output, iterpool), diff,
+                  filename1, filename2, "large1", "large2",
+                  SVN_APR_LOCALE_CHARSET, iterpool));
+
+      SVN_ERR(svn_diff_mem_string_diff(&diff, original, modified, diff_opts,
+                                       iterpool));
+      SVN_ERR(svn_diff_mem_string_output_unified(
+                  svn_stream_from_stringbuf(mem_output, iterpool), diff,
+                  "large1", "large2", SVN_APR_LOCALE_CHARSET,
+                  original, modified, iterpool));
+
+      SVN_TEST_STRING_ASSERT(file_output->data, mem_output->data);
+
+      if (opts->verbose)
+        printf("diff '%s': %.1f MB/s\n",
+               svn_cstring_join2(args, " ", FALSE, iterpool),
+               (double)(original->len + modified->len)
+                 / (double)(duration ? duration : 1));
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_ERR(svn_io_remove_file2(filename1, TRUE, pool));
+  SVN_ERR(svn_io_remove_file2(filename2, TRUE, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Merge random modifications, some of them conflicting, of a file of a few
+   hundred kilobytes with a small memory budget and verify that the result
+   is the same as that of a merge of the whole files. */
+static svn_error_t *
+bounded_merge(apr_pool_t *pool)
+{
+  const char *filename1 = svn_test_data_path("bounded-original", pool);
+  const char *filename2 = svn_test_data_path("bounded-modified", pool);
+  const char *filename3 = svn_test_data_path("bounded-latest", pool);
+  apr_array_header_t *args = apr_array_make(pool, 2, sizeof(const char *));
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_TEST_ASSERT(diff_opts->memory_budget == 0);
+
+  APR_ARRAY_PUSH(args, const char *) = "--memory-budget";
+  APR_ARRAY_PUSH(args, const char *) = "1";
+  SVN_ERR(svn_diff_file_options_parse(diff_opts, args, pool));
+  SVN_TEST_ASSERT(diff_opts->memory_budget == 1024 * 1024);
+
+  seed_val();
+
+  for (i = 0; i < 5; ++i)
+    {
+      int num_lines = 20000, num_src = 40, num_dst = 40, j;
+      svn_boolean_t *lines;
+      struct random_mod *src_lines, *dst_lines;
+      svn_stringbuf_t *full_output, *bounded_output;
+      svn_boolean_t full_conflicts, bounded_conflicts;
+      svn_boolean_t full_diffs, bounded_diffs;
+
+      svn_pool_clear(iterpool);
+      lines = apr_pcalloc(iterpool, sizeof(*lines) * num_lines);
+      src_lines = apr_palloc(iterpool, sizeof(*src_lines) * num_src);
+      dst_lines = apr_palloc(iterpool, sizeof(*dst_lines) * num_dst);
+      full_output = svn_stringbuf_create_empty(iterpool);
+      bounded_output = svn_stringbuf_create_empty(iterpool);
+
+      /* Let every fourth change conflict with the other side. */
+      select_lines(src_lines, num_src, lines, num_lines);
+      select_lines(dst_lines, num_dst, lines, num_lines);
+      for (j = 0; j < num_dst; j += 4)
+        {
+          dst_lines[j].index = src_lines[j].index;
+          dst_lines[j].mod = (src_lines[j].mod + 1) % 3;
+        }
+
+      SVN_ERR(make_random_merge_file(filename1, num_lines, NULL, 0,
+                                     iterpool));
+      SVN_ERR(make_random_merge_file(filename2, num_lines, src_lines, num_src,
+                                     iterpool));
+      SVN_ERR(make_random_merge_file(filename3, num_lines, dst_lines, num_dst,
+                                     iterpool));
+
+      diff_opts->memory_budget = 0;
+      SVN_ERR(svn_diff_file_merge3(&full_diffs, &full_conflicts,
+                                   svn_stream_from_stringbuf(full_output,
+                                                             iterpool),
+                                   filename1, filename2, filename3,
+                                   diff_opts, NULL, NULL, NULL, NULL,
+                                   svn_diff_conflict_display_modified_latest,
+                                   NULL, NULL, iterpool));
+
+      diff_opts->memory_budget = 64 * 1024;
+      SVN_ERR(svn_diff_file_merge3(&bounded_diffs, &bounded_conflicts,
+                                   svn_stream_from_stringbuf(bounded_output,
+                                                             iterpool),
+                                   filename1, filename2, filename3,
+                                   diff_opts, NULL, NULL, NULL, NULL,
+                                   svn_diff_conflict_display_modified_latest,
+                                   NULL, NULL, iterpool));
+
+      SVN_TEST_ASSERT(full_diffs && bounded_diffs);
+      SVN_TEST_ASSERT(full_conflicts && bounded_conflicts);
+      SVN_TEST_STRING_ASSERT(bounded_output->data, full_output->data);
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_ERR(svn_io_remove_file2(filename1, TRUE, pool));
+  SVN_ERR(svn_io_remove_file2(filename2, TRUE, pool));
+  SVN_ERR(svn_io_remove_file2(filename3, TRUE, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -3109,6 +3386,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "2-way issue #3362 test v2"),
     SVN_TEST_XFAIL2(three_way_double_add,
                    "3-way merge, double add"),
+    SVN_TEST_PASS2(random_trivial_merge_histogram,
+                   "random trivial merge using histogram diff"),
+    SVN_TEST_PASS2(trivial_merge_reversed_file,
+                   "trivial merge of a reversed file"),
+    SVN_TEST_PASS2(test_diff_algorithm_option,
+                   "parse the --diff-algorithm option"),
+    SVN_TEST_OPTS_PASS(diff_large_files,
+                       "diff multi-megabyte files"),
+    SVN_TEST_PASS2(bounded_merge,
+                   "3-way merge with a memory budget"),
     SVN_TEST_NULL
   };
 
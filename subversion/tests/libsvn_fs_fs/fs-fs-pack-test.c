@@ -23,23 +23,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_thread_proc.h>
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
 #include "../../libsvn_fs_fs/fs.h"
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rep-cache.h"
+#include "../../libsvn_fs_fs/rev_file.h"
 #include "../../libsvn_fs_fs/util.h"
 
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test_fs.h"
 
+#if APR_HAS_FORK
+#include <unistd.h>   /* For _exit() */
+#endif
+
 
 
 /*** Helper Functions ***/
@@ -1795,7 +1806,7 @@ pack_with_limited_memory(const svn_test_opts_t *opts,
 
       /* Pack it with a narrow memory budget. */
       SVN_ERR(svn_fs_open2(&fs, dir, NULL, iterpool, iterpool));
-      SVN_ERR(svn_fs_fs__pack(fs, max_mem, NULL, NULL, NULL, NULL,
+      SVN_ERR(svn_fs_fs__pack(fs, max_mem, 1, NULL, NULL, NULL, NULL,
                               iterpool));
 
       /* To be sure: Verify that we didn't break the repo. */
@@ -1887,8 +1898,747 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+/* Create a log-addressed FSFS repository called NAME in format 9, as
+ * created by Subversion 1.14, independent of the format requested by
+ * OPTS.  Return it in *FS_P.  Use POOL for allocations. */
+static svn_error_t *
+create_format9_fs(svn_fs_t **fs_p,
+                  const char *name,
+                  const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_test_opts_t opts9 = *opts;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  opts9.server_minor_version = 0;
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_COMPATIBLE_VERSION, "1.14.0");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_LOG_ADDRESSING, "true");
+  SVN_ERR(svn_test__create_fs2(fs_p, name, &opts9, fs_config, pool));
+
+  SVN_ERR_ASSERT(((fs_fs_data_t *)(*fs_p)->fsap_data)->format == 9);
+  return SVN_NO_ERROR;
+}
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large_file_delta_windows"
+
+/* Set *WINDOW_SIZE to the delta window size of the data rep of PATH in
+ * ROOT of FS.  Use POOL for allocations. */
+static svn_error_t *
+get_window_size(apr_size_t *window_size,
+                svn_fs_t *fs,
+                svn_fs_root_t *root,
+                const char *path,
+                apr_pool_t *pool)
+{
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__rep_window_size(window_size, noderev->data_rep, fs,
+                                     pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+large_file_delta_windows(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root, *base_root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *big, *small, *read;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  apr_size_t window_size;
+  apr_hash_t *fs_config;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(create_format9_fs(&fs, REPO_NAME, opts, pool));
+
+  big = svn_stringbuf_create_empty(pool);
+  for (i = 0; big->len <= 3 * SVN_DELTA__MAX_WINDOW_SIZE; ++i)
+    svn_stringbuf_appendcstr(big, apr_psprintf(pool, "line %d\n", i));
+
+  small = svn_stringbuf_create_empty(pool);
+  for (i = 0; small->len <= 50000; ++i)
+    svn_stringbuf_appendcstr(small, apr_psprintf(pool, "line %d\n", i));
+
+  /* Revision 1: a large and a small file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "big", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", big->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", small->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: modify both.  The new reps will be deltas. */
+  big->data[big->len / 2] = '#';
+  svn_stringbuf_appendcstr(big, "tail\n");
+  svn_stringbuf_appendcstr(small, "tail\n");
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", big->data, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", small->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Read everything back from disk, using disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  /* Only the large file uses large windows, also for its delta. */
+  SVN_ERR(svn_fs_revision_root(&base_root, fs, 1, pool));
+  SVN_ERR(get_window_size(&window_size, fs, base_root, "big", pool));
+  SVN_TEST_ASSERT(window_size == SVN_DELTA__MAX_WINDOW_SIZE);
+  SVN_ERR(get_window_size(&window_size, fs, base_root, "small", pool));
+  SVN_TEST_ASSERT(window_size == 0);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(get_window_size(&window_size, fs, root, "big", pool));
+  SVN_TEST_ASSERT(window_size == SVN_DELTA__MAX_WINDOW_SIZE);
+
+  SVN_ERR(svn_test__get_file_contents(root, "big", &read, pool));
+  SVN_TEST_STRING_ASSERT(read->data, big->data);
+  SVN_ERR(svn_test__get_file_contents(root, "small", &read, pool));
+  SVN_TEST_STRING_ASSERT(read->data, small->data);
+
+  /* Deltas handed out by the FS must still use standard windows. */
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, base_root, "big",
+                                       root, "big", pool));
+  do
+    {
+      SVN_ERR(svn_txdelta_next_window(&window, delta_stream, pool));
+      SVN_TEST_ASSERT(!window || window->tview_len <= 102400);
+    }
+  while (window);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-recompress_deltas"
+
+static svn_error_t *
+recompress_deltas(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev = 0;
+  svn_stringbuf_t *contents, *read;
+  svn_fs_fs__recompress_stats_t *stats;
+  apr_hash_t *fs_config;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Zstandard compression is not available");
+
+  SVN_ERR(create_format9_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+
+  /* Write zlib-compressed deltas, as older releases would. */
+  ffd->delta_compression_type = compression_type_zlib;
+
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len <= 400000; ++i)
+    svn_stringbuf_appendcstr(contents, apr_psprintf(pool, "line %d\n", i));
+
+  for (i = 0; i < 4; ++i)
+    {
+      svn_stringbuf_appendcstr(contents, apr_psprintf(pool, "tail %d\n", i));
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (i == 0)
+        SVN_ERR(svn_fs_make_file(root, "file", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "file", contents->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  SVN_ERR(svn_fs_fs__recompress(&stats, fs, NULL, NULL, NULL, NULL, pool,
+                                pool));
+  SVN_TEST_ASSERT(stats->reps_recompressed > 0);
+
+  /* Nothing left to do the second time around. */
+  SVN_ERR(svn_fs_fs__recompress(&stats, fs, NULL, NULL, NULL, NULL, pool,
+                                pool));
+  SVN_TEST_ASSERT(stats->reps_recompressed == 0);
+
+  /* Read everything back from disk, using disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "file", &read, pool));
+  SVN_TEST_STRING_ASSERT(read->data, contents->data);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+/* Verify that packing multiple shards concurrently still reports and
+   switches over to them in order. */
+#define REPO_NAME "test-repo-pack-with-threads"
+#define SHARD_SIZE 4
+#define MAX_REV (8 * SHARD_SIZE + 1)
+static svn_error_t *
+pack_with_threads(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  struct pack_notify_baton pnb;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* pack_notify() checks that notifications arrive in order. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_PACK_JOBS, "4");
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All complete shards must have been packed. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev, fs,
+                                           pool));
+  SVN_TEST_ASSERT(ffd->min_unpacked_rev
+                  == (MAX_REV + 1) / SHARD_SIZE * SHARD_SIZE);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+/* Read all data of a packed repository through memory mappings. */
+#define REPO_NAME "test-repo-read-mapped-packed-fs"
+#define SHARD_SIZE 5
+#define MAX_REV 11
+static svn_error_t *
+read_mapped_packed_fs(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__revision_file_t *rev_file2;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_int64_t mapped_size;
+  svn_revnum_t i;
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Use cold caches to make sure we actually read the pack files. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_MMAP_BUDGET, "1000000000");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (i = 1; i < (MAX_REV + 1); i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *rstream;
+      svn_stringbuf_t *rstring;
+      svn_stringbuf_t *sb;
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+      SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+
+      if (i == 1)
+        sb = svn_stringbuf_create("This is the file 'iota'.\n", pool);
+      else
+        sb = svn_stringbuf_create(get_rev_contents(i, pool), pool);
+
+      if (! svn_stringbuf_compare(rstring, sb))
+        return svn_error_createf(SVN_ERR_FS_GENERAL, NULL,
+                                 "Bad data in revision %ld.", i);
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, MAX_REV, NULL, NULL,
+                        NULL, NULL, pool));
+
+  /* Pack files get mapped and all readers of the same pack file share
+   * the mapping.  It is kept for reuse after the files got closed. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_TEST_ASSERT(rev_file->is_packed);
+  mapped_size = svn_fs_fs__rev_file_mapped_size();
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file2, fs, 2, pool, pool));
+  SVN_TEST_ASSERT(rev_file2->is_packed);
+#if APR_HAS_MMAP
+  SVN_TEST_ASSERT(rev_file->mmap != NULL);
+  SVN_TEST_ASSERT(rev_file2->mmap == rev_file->mmap);
+  SVN_TEST_ASSERT(mapped_size >= (apr_int64_t)rev_file->mmap->size);
+#endif
+  SVN_TEST_ASSERT(svn_fs_fs__rev_file_mapped_size() == mapped_size);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file2));
+  SVN_TEST_ASSERT(svn_fs_fs__rev_file_mapped_size() == mapped_size);
+
+  /* Rewriting the pack file replaces it.  Readers of the old file are not
+   * affected while new readers get a new mapping. */
+  if (svn_fs_fs__use_log_addressing(fs))
+    {
+      apr_array_header_t *entries = apr_array_make(pool, 4, sizeof(void *));
+      char old_data[16], new_data[16];
+
+      SVN_ERR(svn_fs_fs__dump_index(fs, 1, receive_index, entries,
+                                    NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__load_index(fs, 1, entries, pool));
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file2, fs, 1, pool,
+                                               pool));
+#if APR_HAS_MMAP
+      SVN_TEST_ASSERT(rev_file2->mmap != NULL);
+      SVN_TEST_ASSERT(rev_file2->mmap != rev_file->mmap);
+#endif
+
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 0));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, old_data,
+                                       sizeof(old_data)));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file2, NULL, 0));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file2, new_data,
+                                       sizeof(new_data)));
+      SVN_TEST_ASSERT(memcmp(old_data, new_data, sizeof(old_data)) == 0);
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file2));
+    }
+
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Non-packed revisions don't. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, MAX_REV, pool,
+                                           pool));
+  SVN_TEST_ASSERT(!rev_file->is_packed);
+  SVN_TEST_ASSERT(rev_file->mmap == NULL);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep_cache_filter"
+
+static svn_error_t *
+rep_cache_filter(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *fs2;
+  svn_fs_t *fs3;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  svn_stringbuf_t *str;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *world_str = multiply_string("World!", pool);
+  const char *goodbye_str = multiply_string("Goodbye!", pool);
+  const char *filter_path;
+  const char *fsfs_conf = "[" CONFIG_SECTION_REP_SHARING "]\n"
+                          CONFIG_OPTION_ENABLE_REP_CACHE_FILTER " = true\n";
+  svn_stringbuf_t *filter_before, *filter_after;
+  int count;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create a repo and explicitly enable rep sharing and the filter. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->rep_sharing_allowed = TRUE;
+  ffd->use_rep_cache_filter = TRUE;
+
+  /* Revision 1: add a file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", hello_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: one file that shares the r1 contents, one that doesn't. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", hello_str, pool));
+  SVN_ERR(svn_fs_make_file(root, "baz", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "baz", world_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The filter got persisted. */
+  filter_path = svn_dirent_join(fs->path, REP_CACHE_FILTER_NAME, pool);
+  SVN_ERR(svn_io_check_path(filter_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+  SVN_ERR(svn_stringbuf_from_file2(&filter_before, filter_path, pool));
+
+  /* Revision 3: commit through a second FS instance, which shares the
+                 filter and must still find the r2 contents. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER, "true");
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, fs_config, pool, pool));
+  ffd = fs2->fsap_data;
+  ffd->rep_sharing_allowed = TRUE;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs2, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "qux", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "qux", world_str, pool));
+  SVN_ERR(svn_fs_make_file(root, "quux", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "quux", goodbye_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The new keys got appended to the filter file instead of rewriting
+   * it. */
+  SVN_ERR(svn_stringbuf_from_file2(&filter_after, filter_path, pool));
+  SVN_TEST_ASSERT(filter_after->len > filter_before->len);
+  SVN_TEST_ASSERT(memcmp(filter_after->data, filter_before->data,
+                         filter_before->len) == 0);
+
+  /* Only the root directory and the new contents got written. */
+  SVN_ERR(count_representations(&count, fs, 1, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(count_representations(&count, fs, 2, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(count_representations(&count, fs, 3, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  /* Shared contents can be read back. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "qux", &str, pool));
+  SVN_TEST_STRING_ASSERT(str->data, world_str);
+  SVN_ERR(svn_test__get_file_contents(root, "bar", &str, pool));
+  SVN_TEST_STRING_ASSERT(str->data, hello_str);
+
+  /* The filter can also be enabled in fsfs.conf. */
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join(fs->path, PATH_CONFIG, pool),
+                               fsfs_conf, strlen(fsfs_conf), NULL, FALSE,
+                               pool));
+  SVN_ERR(svn_fs_open2(&fs3, REPO_NAME, NULL, pool, pool));
+  ffd = fs3->fsap_data;
+  SVN_TEST_ASSERT(ffd->use_rep_cache_filter);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep_cache_filter_commit"
+
+#if APR_HAS_FORK
+/* Commit CONTENTS as r2 through a new FS instance, like another process
+ * would.  Send a byte to TO_PARENT once 'current' has been bumped and
+ * wait for a byte from FROM_PARENT before adding the new representation
+ * to the rep-cache.  Use POOL for allocations. */
+static svn_error_t *
+commit_in_child(apr_file_t *to_parent,
+                apr_file_t *from_parent,
+                const char *contents,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  char c = 0;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER, "true");
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+
+  /* Commit without touching the rep-cache and add the entry manually
+   * afterwards, bracketed like a regular commit. */
+  ffd->rep_sharing_allowed = FALSE;
+  SVN_ERR(svn_fs_fs__begin_rep_cache_filter_commit(fs, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", contents, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_io_file_putc(c, to_parent, pool));
+  SVN_ERR(svn_io_file_getc(&c, from_parent, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, "bar", pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+
+  ffd->rep_sharing_allowed = TRUE;
+  SVN_ERR(svn_fs_fs__set_rep_reference(fs, noderev->data_rep, pool));
+  SVN_ERR(svn_fs_fs__update_rep_cache_filter(fs, rev, pool));
+  SVN_ERR(svn_fs_fs__end_rep_cache_filter_commit(fs, pool));
+
+  return SVN_NO_ERROR;
+}
+#endif
+
+static svn_error_t *
+rep_cache_filter_commit(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  representation_t *rep;
+  svn_checksum_t *checksum;
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *goodbye_str = multiply_string("Goodbye!", pool);
+  apr_file_t *child_read, *child_write, *parent_read, *parent_write;
+  apr_proc_t proc;
+  apr_status_t status;
+  apr_exit_why_e exitwhy;
+  int exitcode;
+  char c = 0;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Revision 1: add a file.  Don't build the filter, yet. */
+  ffd->rep_sharing_allowed = TRUE;
+  ffd->use_rep_cache_filter = FALSE;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", hello_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  ffd->use_rep_cache_filter = TRUE;
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, goodbye_str,
+                       strlen(goodbye_str), pool));
+
+  /* SQLite connections must not be used across fork(). */
+  SVN_ERR(svn_fs_fs__close_rep_cache(fs));
+
+  status = apr_file_pipe_create(&child_read, &parent_write, pool);
+  if (status)
+    return svn_error_wrap_apr(status, "apr_file_pipe_create");
+  status = apr_file_pipe_create(&parent_read, &child_write, pool);
+  if (status)
+    return svn_error_wrap_apr(status, "apr_file_pipe_create");
+
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_error_t *err;
+
+      svn_error_clear(svn_io_file_close(parent_read, pool));
+      svn_error_clear(svn_io_file_close(parent_write, pool));
+
+      err = commit_in_child(child_write, child_read, goodbye_str, pool);
+      exitcode = err ? EXIT_FAILURE : EXIT_SUCCESS;
+      svn_error_clear(err);
+
+      /* Don't run the test harness' exit handlers in the child. */
+      _exit(exitcode);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  /* Make reads fail if the child dies early. */
+  SVN_ERR(svn_io_file_close(child_read, pool));
+  SVN_ERR(svn_io_file_close(child_write, pool));
+
+  /* The child has bumped 'current' to r2 but not added its entry to the
+   * rep-cache.  We may not build a filter that claims to cover r2. */
+  SVN_ERR(svn_io_file_getc(&c, parent_read, pool));
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, pool));
+  SVN_TEST_ASSERT(rep == NULL);
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, REP_CACHE_FILTER_NAME,
+                                            pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  SVN_ERR(svn_io_file_putc(c, parent_write, pool));
+  SVN_ERR(svn_io_wait_for_cmd(&proc, "child", &exitcode, &exitwhy, pool));
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exitwhy) && exitcode == EXIT_SUCCESS);
+
+  /* Now, the filter gets built and persisted.  It must contain the r2
+   * entry, both while building it and afterwards. */
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, pool));
+  SVN_TEST_ASSERT(rep && rep->revision == 2);
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, REP_CACHE_FILTER_NAME,
+                                            pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, pool));
+  SVN_TEST_ASSERT(rep && rep->revision == 2);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "this platform cannot fork processes");
+#endif
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-zstd_compression"
+
+/* Set *VERSION to the svndiff version of the data rep of PATH in ROOT of
+ * FS.  Use POOL for allocations. */
+static svn_error_t *
+get_svndiff_version(int *version,
+                    svn_fs_t *fs,
+                    svn_fs_root_t *root,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *header;
+  apr_off_t offset;
+  char magic[4];
+  apr_size_t len = sizeof(magic);
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs,
+                                           noderev->data_rep->revision,
+                                           pool, pool));
+  SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file,
+                                 noderev->data_rep->revision, NULL,
+                                 noderev->data_rep->item_index, pool));
+  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, rev_file->stream, pool, pool));
+  SVN_ERR(svn_stream_read_full(rev_file->stream, magic, &len));
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  SVN_TEST_ASSERT(len == sizeof(magic) && memcmp(magic, "SVN", 3) == 0);
+  *version = magic[3];
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+zstd_compression(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev = 0;
+  svn_stringbuf_t *contents, *read;
+  apr_hash_t *fs_config;
+  int version;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Zstandard compression is not available");
+
+  SVN_ERR(create_format9_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->delta_compression_type = compression_type_zstd;
+  ffd->delta_compression_level = SVN__ZSTD_DEFAULT_LEVEL;
+
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len <= 300000; ++i)
+    svn_stringbuf_appendcstr(contents, apr_psprintf(pool, "line %d\n", i));
+
+  /* A fulltext in r1, followed by deltas. */
+  for (i = 0; i < 3; ++i)
+    {
+      svn_stringbuf_appendcstr(contents, apr_psprintf(pool, "tail %d\n", i));
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (i == 0)
+        SVN_ERR(svn_fs_make_file(root, "file", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "file", contents->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  /* Read everything back from disk, using disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(get_svndiff_version(&version, fs, root, "file", pool));
+  SVN_TEST_ASSERT(version == 3);
+
+  SVN_ERR(svn_test__get_file_contents(root, "file", &read, pool));
+  SVN_TEST_STRING_ASSERT(read->data, contents->data);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+
 
-
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1942,6 +2692,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(large_file_delta_windows,
+                       "large delta windows for large files"),
+    SVN_TEST_OPTS_PASS(recompress_deltas,
+                       "recompress deltas in place"),
+    SVN_TEST_OPTS_PASS(pack_with_threads,
+                       "pack multiple shards concurrently"),
+    SVN_TEST_OPTS_PASS(read_mapped_packed_fs,
+                       "read from memory-mapped FSFS pack files"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter,
+                       "skip rep-cache lookups using a Bloom filter"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter_commit,
+                       "rebuild rep-cache filter while another process commits"),
+    SVN_TEST_OPTS_PASS(zstd_compression,
+                       "commit and read zstd-compressed deltas"),
     SVN_TEST_NULL
   };
 
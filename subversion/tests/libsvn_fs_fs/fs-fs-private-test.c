@@ -440,6 +440,102 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-readahead-stats-test"
+
+/* Append SIZE bytes of pseudo-random, i.e. incompressible, data to STR,
+   using and updating SEED. */
+static void
+append_random_data(svn_stringbuf_t *str,
+                   apr_size_t size,
+                   apr_uint32_t *seed)
+{
+  apr_size_t i;
+  for (i = 0; i < size; ++i)
+    svn_stringbuf_appendbyte(str, (char)(svn_test_rand(seed) >> 24));
+}
+
+static svn_error_t *
+readahead_stats(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev = 0;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  svn_stringbuf_t *read_back;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_fs__ioctl_get_readahead_stats_output_t *before, *after;
+  apr_uint32_t seed = 0x4d595df4;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have block-read");
+
+  /* Create a delta chain for a file whose reps each span several of the
+     default 64k blocks. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  for (i = 0; i < 4; ++i)
+    {
+      append_random_data(contents, 0x30000, &seed);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (i == 0)
+        SVN_ERR(svn_fs_make_file(root, "big", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "big", contents->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  /* Re-open it with readahead enabled and a cold cache. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_READAHEAD, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_READAHEAD_STATS,
+                       NULL, (void **)&before, NULL, NULL, pool, pool));
+
+  /* Reading the file walks the whole delta chain. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, root, "big", pool));
+  SVN_ERR(svn_stringbuf_from_stream(&read_back, stream, 0, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, contents));
+
+  /* The statistics are process-wide and may only grow. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_READAHEAD_STATS,
+                       NULL, (void **)&after, NULL, NULL, pool, pool));
+
+  SVN_TEST_ASSERT(after->stats->block_reads > before->stats->block_reads);
+  SVN_TEST_ASSERT(after->stats->block_read_usecs
+                  >= before->stats->block_read_usecs);
+  SVN_TEST_ASSERT(after->stats->completed <= after->stats->requests);
+  SVN_TEST_ASSERT(after->stats->bytes_read >= before->stats->bytes_read);
+
+  /* The reps extend beyond the blocks being read, so the remainders got
+     requested.  Without threads, all requests are dropped. */
+#if APR_HAS_THREADS
+  SVN_TEST_ASSERT(after->stats->requests > before->stats->requests);
+#else
+  SVN_TEST_ASSERT(after->stats->dropped > before->stats->dropped);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
 
 
 /* The test table.  */
@@ -455,6 +551,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
                        "load the P2L index"),
+    SVN_TEST_OPTS_PASS(readahead_stats,
+                       "get FSFS readahead statistics"),
     SVN_TEST_NULL
   };
 
@@ -4466,6 +4466,95 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Notification receiver for test_warm_cache.  Appends "PATH@REV" for each
+ * svn_repos_notify_warm_cache_path to the array in BATON. */
+static void
+warm_cache_notify(void *baton,
+                  const svn_repos_notify_t *notify,
+                  apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *paths = baton;
+
+  if (notify->action == svn_repos_notify_warm_cache_path)
+    APR_ARRAY_PUSH(paths, const char *)
+      = apr_psprintf(paths->pool, "%s@%ld", notify->path, notify->revision);
+}
+
+static svn_error_t *
+test_warm_cache(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_array_header_t *targets;
+  apr_array_header_t *paths = apr_array_make(pool, 4, sizeof(const char *));
+  svn_repos_warm_cache_target_t *target;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-warm-cache", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: the greek tree */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: modify A/mu */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(youngest_rev == 2);
+
+  /* Comments get skipped, revisions default to HEAD. */
+  SVN_ERR(svn_repos__parse_warm_cache_targets(&targets,
+                                              "# comment\n"
+                                              "/A/B@1\n"
+                                              "/iota\n"
+                                              "/A/D/H@HEAD\n"
+                                              "/A/no-such-path\n",
+                                              pool));
+  SVN_TEST_ASSERT(targets->nelts == 4);
+  target = APR_ARRAY_IDX(targets, 0, svn_repos_warm_cache_target_t *);
+  SVN_TEST_STRING_ASSERT(target->path, "/A/B");
+  SVN_TEST_ASSERT(target->revision == 1);
+  target = APR_ARRAY_IDX(targets, 2, svn_repos_warm_cache_target_t *);
+  SVN_TEST_STRING_ASSERT(target->path, "/A/D/H");
+  SVN_TEST_ASSERT(target->revision == SVN_INVALID_REVNUM);
+
+  /* Missing paths are silently skipped. */
+  SVN_ERR(svn_repos_warm_cache(repos, targets, svn_depth_infinity, 0,
+                               warm_cache_notify, paths, NULL, NULL, pool));
+  SVN_TEST_ASSERT(paths->nelts == 3);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, 0, const char *), "/A/B@1");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, 1, const char *), "/iota@2");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, 2, const char *), "/A/D/H@2");
+
+  /* Recent changes come first. */
+  apr_array_clear(paths);
+  SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, "/A\n", pool));
+  SVN_ERR(svn_repos_warm_cache(repos, targets, svn_depth_empty, 1,
+                               warm_cache_notify, paths, NULL, NULL, pool));
+  SVN_TEST_ASSERT(paths->nelts == 2);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, 0, const char *), "/A/mu@2");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, 1, const char *), "/A@2");
+
+  /* Invalid input. */
+  SVN_TEST_ASSERT_ERROR(svn_repos__parse_warm_cache_targets(&targets,
+                                                            "/A@-1\n", pool),
+                        SVN_ERR_REVNUM_PARSE_FAILURE);
+  SVN_ERR(svn_repos__parse_warm_cache_targets(&targets, "/A@3\n", pool));
+  SVN_TEST_ASSERT_ERROR(svn_repos_warm_cache(repos, targets,
+                                             svn_depth_empty, 0,
+                                             NULL, NULL, NULL, NULL, pool),
+                        SVN_ERR_FS_NO_SUCH_REVISION);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4537,6 +4626,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_warm_cache,
+                       "test svn_repos_warm_cache"),
     SVN_TEST_NULL
   };
 
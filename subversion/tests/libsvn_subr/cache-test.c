@@ -22,18 +22,27 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 #include <apr_lib.h>
+#include <apr_thread_proc.h>
 #include <apr_time.h>
 
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
 
 #include "../svn_test.h"
 
+#if APR_HAS_FORK
+#include <unistd.h>   /* For _exit() */
+#endif
+
 /* Create memcached cache if configured */
 static svn_error_t *
 create_memcache(svn_memcache_t **memcache,
@@ -168,6 +177,7 @@ test_inprocess_cache_basic(apr_pool_t *pool)
                                       APR_HASH_KEY_STRING,
                                       1,
                                       1,
+                                      0,
                                       TRUE,
                                       "",
                                       pool));
@@ -591,6 +601,828 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
 }
 
 
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+
+  /* Without a fork, the shared cache must behave like a local one. */
+  SVN_ERR(svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1,
+                                                   0, NULL, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_child_init(membuffer, pool));
+
+  /* Create a cache with just one entry. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  return basic_cache_test(cache, FALSE, pool);
+}
+
+
+static svn_error_t *
+test_membuffer_cache_shared_fork(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  apr_pool_t *cache_pool = svn_pool_create(pool);
+  const char *sandbox, *shm_file;
+  svn_node_kind_t kind_before, kind_after;
+  svn_revnum_t fifty = 50, sixty = 60;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  apr_proc_t proc;
+  apr_status_t status;
+  apr_exit_why_e exitwhy;
+  int exitcode;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "membuffer-cache-shared-fork",
+                                    pool));
+  shm_file = svn_dirent_join(sandbox, "shm", pool);
+
+  /* Whether APR backs the shared memory with a file depends on the
+   * platform.  If it does, the file must live as long as the cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1,
+                                                   0, shm_file, TRUE,
+                                                   cache_pool));
+  SVN_ERR(svn_io_check_path(shm_file, &kind_before, pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            cache_pool, pool));
+  SVN_ERR(svn_cache__set(cache, "fifty", &fifty, pool));
+
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      /* Attach to the cache, check the parent's entry, add one of our own
+       * and then clean up the inherited pool like an exiting child. */
+      svn_error_t *err = svn_cache__membuffer_child_init(membuffer, pool);
+      if (!err)
+        err = svn_cache__get((void **)&answer, &found, cache, "fifty",
+                             pool);
+      if (!err && !(found && *answer == 50))
+        err = svn_error_create(SVN_ERR_TEST_FAILED, NULL, NULL);
+      if (!err)
+        err = svn_cache__set(cache, "sixty", &sixty, pool);
+
+      exitcode = err ? EXIT_FAILURE : EXIT_SUCCESS;
+      svn_error_clear(err);
+      svn_pool_destroy(cache_pool);
+
+      /* Don't run the test harness' exit handlers in the child. */
+      _exit(exitcode);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  SVN_ERR(svn_io_wait_for_cmd(&proc, "child", &exitcode, &exitwhy, pool));
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exitwhy) && exitcode == EXIT_SUCCESS);
+
+  /* The child's entry is visible to us and the child's exit did not
+   * release the shared memory. */
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "sixty", pool));
+  SVN_TEST_ASSERT(found && *answer == 60);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "fifty", pool));
+  SVN_TEST_ASSERT(found && *answer == 50);
+
+  SVN_ERR(svn_io_check_path(shm_file, &kind_after, pool));
+  SVN_TEST_ASSERT(kind_after == kind_before);
+
+  /* Only the creator releases it. */
+  svn_pool_destroy(cache_pool);
+  SVN_ERR(svn_io_check_path(shm_file, &kind_after, pool));
+  SVN_TEST_ASSERT(kind_after == svn_node_none);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "this platform cannot fork processes");
+#endif
+}
+
+
+static svn_error_t *
+test_membuffer_cache_snapshot(apr_pool_t *pool)
+{
+  svn_cache__t *string_cache, *fixed_cache;
+  svn_membuffer_t *membuffer;
+  const char *sandbox, *path;
+  apr_hash_t *dirents;
+  svn_revnum_t fifty = 50, sixty = 60;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "membuffer-cache-snapshot",
+                                    pool));
+  path = svn_dirent_join(sandbox, "snapshot", pool);
+
+  /* Loading a non-existent snapshot is a no-op. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer, path, pool));
+
+  /* Fill one cache with full keys and one with shared key prefixes. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "string-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8, "fixed-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__set(string_cache, "fifty", &fifty, pool));
+  SVN_ERR(svn_cache__set(fixed_cache, "12345678", &sixty, pool));
+  SVN_ERR(svn_cache__membuffer_save(membuffer, path, pool));
+
+  /* Only the snapshot and its lock file remain, no temporaries. */
+  SVN_ERR(svn_io_get_dirents3(&dirents, sandbox, TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "snapshot"));
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "snapshot.lock"));
+
+  /* Restore into a new cache.  Load before creating the front-ends,
+   * which is the typical server start-up sequence. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer, path, pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "string-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8, "fixed-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache, "fifty",
+                         pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 50);
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, fixed_cache, "12345678",
+                         pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 60);
+
+  /* Different key prefixes must not see the restored data. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "other-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache, "fifty",
+                         pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_snapshot_corrupt(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  const char *sandbox, *path;
+  svn_stringbuf_t *contents;
+  svn_revnum_t sixty = 60;
+  apr_uint32_t huge = 0x7fffffff;
+
+  /* Offset of the first record's ITEM_SIZE within the snapshot file:
+   * 56 bytes of snapshot_header_t plus the FINGERPRINT, PREFIX_LEN and
+   * KEY_LEN fields of snapshot_record_t. */
+  const apr_size_t item_size_offset = 56 + 16 + 4 + 4;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox,
+                                    "membuffer-cache-snapshot-corrupt",
+                                    pool));
+  path = svn_dirent_join(sandbox, "snapshot", pool);
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8, "fixed-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__set(cache, "12345678", &sixty, pool));
+  SVN_ERR(svn_cache__membuffer_save(membuffer, path, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, pool));
+  SVN_TEST_ASSERT(contents->len > item_size_offset + sizeof(huge));
+
+  /* A truncated snapshot gets rejected. */
+  SVN_ERR(svn_io_remove_file2(path, FALSE, pool));
+  SVN_ERR(svn_io_file_create_bytes(path, contents->data, contents->len - 1,
+                                   pool));
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_load(membuffer, path, pool),
+                        SVN_ERR_MALFORMED_FILE);
+
+  /* So does a record that claims to be huge.  We must not even try to
+   * allocate a buffer for it. */
+  memcpy(contents->data + item_size_offset, &huge, sizeof(huge));
+  SVN_ERR(svn_io_remove_file2(path, FALSE, pool));
+  SVN_ERR(svn_io_file_create_bytes(path, contents->data, contents->len,
+                                   pool));
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_load(membuffer, path, pool),
+                        SVN_ERR_MALFORMED_FILE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t.  Return the size of the
+ * serialized svn_stringbuf_t in DATA, including the terminating NUL. */
+static svn_error_t *
+get_stringbuf_len(void **out,
+                  const void *data,
+                  apr_size_t data_len,
+                  void *baton,
+                  apr_pool_t *result_pool)
+{
+  apr_size_t *len = apr_palloc(result_pool, sizeof(*len));
+  *len = data_len;
+  *out = len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_compression(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_cache__info_t info;
+  svn_stringbuf_t *value = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *small = svn_stringbuf_create("small", pool);
+  svn_stringbuf_t *answer;
+  apr_size_t *len;
+  svn_boolean_t found;
+  int i;
+
+  /* Large and well compressible. */
+  for (i = 0; i < 1000; ++i)
+    svn_stringbuf_appendcstr(value, "compress me ");
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024, 0, 1,
+                                            TRUE, TRUE, pool));
+  svn_cache__membuffer_set_compression(membuffer, 256);
+
+  /* Use the default serializers for svn_stringbuf_t. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING,
+                                            "compressed-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_cache__set(cache, "large", value, pool));
+  SVN_ERR(svn_cache__set(cache, "small", small, pool));
+
+  /* Only the large item gets compressed. */
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.compressions == 1);
+  SVN_TEST_ASSERT(info.compressed_size < info.uncompressed_size);
+
+  /* Compression must be transparent to all getters. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "large", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, value->data);
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "small", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, small->data);
+
+  SVN_ERR(svn_cache__get_partial((void **) &len, &found, cache, "large",
+                                 get_stringbuf_len, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*len == value->len + 1);
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.decompressions == 2);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_prefix_info(apr_pool_t *pool)
+{
+  svn_cache__t *string_cache, *fixed_cache;
+  svn_membuffer_t *membuffer;
+  apr_array_header_t *info;
+  const svn_cache__prefix_info_t *fixed_info, *string_info, *other_info;
+  svn_revnum_t seventy = 70;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+
+  /* One cache storing full keys and one using a shared key prefix. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "string-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8, "fixed-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_cache__set(string_cache, "seventy", &seventy, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache, "seventy",
+                         pool));
+  SVN_TEST_ASSERT(found);
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache, "eighty",
+                         pool));
+  SVN_TEST_ASSERT(!found);
+
+  SVN_ERR(svn_cache__set(fixed_cache, "12345678", &seventy, pool));
+
+  /* Sorted by prefix, "other" last. */
+  SVN_ERR(svn_cache__membuffer_get_prefix_info(&info, membuffer, pool, pool));
+  SVN_TEST_ASSERT(info->nelts == 3);
+  fixed_info = APR_ARRAY_IDX(info, 0, const svn_cache__prefix_info_t *);
+  string_info = APR_ARRAY_IDX(info, 1, const svn_cache__prefix_info_t *);
+  other_info = APR_ARRAY_IDX(info, 2, const svn_cache__prefix_info_t *);
+
+  SVN_TEST_STRING_ASSERT(fixed_info->prefix, "fixed-cache:");
+  SVN_TEST_ASSERT(fixed_info->gets == 0);
+  SVN_TEST_ASSERT(fixed_info->sets == 1);
+  SVN_TEST_ASSERT(fixed_info->used_entries == 1);
+
+  SVN_TEST_STRING_ASSERT(string_info->prefix, "string-cache:");
+  SVN_TEST_ASSERT(string_info->gets == 2);
+  SVN_TEST_ASSERT(string_info->hits == 1);
+  SVN_TEST_ASSERT(string_info->sets == 1);
+  SVN_TEST_ASSERT(string_info->used_entries == 1);
+  SVN_TEST_ASSERT(string_info->used_size > sizeof(seventy));
+
+  SVN_TEST_ASSERT(other_info->prefix == NULL);
+  SVN_TEST_ASSERT(other_info->used_entries == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_inprocess_cache_size_limit(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__info_t info;
+  svn_boolean_t found;
+  svn_revnum_t *answer;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const apr_size_t max_size = 4096;
+  svn_boolean_t thread_safe;
+  svn_revnum_t i;
+  int pass;
+
+  for (thread_safe = 0; thread_safe < 2; ++thread_safe)
+    {
+      /* Plenty of pages but only a few kB. */
+      SVN_ERR(svn_cache__create_inprocess(&cache,
+                                          serialize_revnum,
+                                          deserialize_revnum,
+                                          sizeof(i),
+                                          1000,
+                                          4,
+                                          max_size,
+                                          thread_safe,
+                                          "",
+                                          pool));
+
+      /* The second pass replaces the values of the first one. */
+      for (pass = 0; pass < 2; ++pass)
+        for (i = 0; i < 1000; ++i)
+          {
+            svn_revnum_t value = i + pass;
+
+            svn_pool_clear(iterpool);
+            SVN_ERR(svn_cache__set(cache, &i, &value, iterpool));
+
+            /* The memory charged for cached data must never exceed
+             * the limit. */
+            SVN_ERR(svn_cache__get_info(cache, &info, FALSE, iterpool));
+            SVN_TEST_ASSERT(info.data_size <= max_size);
+            SVN_TEST_ASSERT(info.used_size <= info.data_size);
+          }
+
+      SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+      SVN_TEST_ASSERT(info.used_entries > 0);
+      SVN_TEST_ASSERT(info.used_entries < 1000);
+      SVN_TEST_ASSERT(info.used_size == info.used_entries * sizeof(i));
+
+      /* LRU: the latest entry must be there but not the first one. */
+      i = 999;
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &i, pool));
+      SVN_TEST_ASSERT(found && *answer == 1000);
+      i = 0;
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &i, pool));
+      SVN_TEST_ASSERT(!found);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_iter_apr_hash_cb_t.  Counts the entries in *BATON. */
+static svn_error_t *
+iter_count_cb(void *baton,
+              const void *key,
+              apr_ssize_t klen,
+              void *val,
+              apr_pool_t *pool)
+{
+  int *count = baton;
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_inprocess_cache_sharded(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__info_t info;
+  svn_boolean_t found;
+  svn_revnum_t *answer;
+  svn_revnum_t i;
+  svn_boolean_t completed;
+  int count = 0;
+
+  /* Thread-safe caches are sharded. */
+  SVN_ERR(svn_cache__create_inprocess(&cache,
+                                      serialize_revnum,
+                                      deserialize_revnum,
+                                      sizeof(i),
+                                      64,
+                                      1,
+                                      0,
+                                      TRUE,
+                                      "",
+                                      pool));
+
+  for (i = 0; i < 8; ++i)
+    SVN_ERR(svn_cache__set(cache, &i, &i, pool));
+
+  for (i = 0; i < 8; ++i)
+    {
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &i, pool));
+      SVN_TEST_ASSERT(!found || *answer == i);
+    }
+
+  SVN_ERR(svn_cache__iter(&completed, cache, iter_count_cb, &count, pool));
+  SVN_TEST_ASSERT(completed);
+
+  SVN_ERR(svn_cache__get_info(cache, &info, TRUE, pool));
+  SVN_TEST_ASSERT(info.used_entries == count);
+
+#if APR_HAS_THREADS
+  /* 8 sets, 8 gets and all shards being iterated. */
+  SVN_TEST_ASSERT(info.lock_acquisitions > 16);
+  SVN_TEST_ASSERT(info.lock_contentions == 0);
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.lock_acquisitions == 0);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Store a few revnums in CACHE and fetch them back, together with keys
+ * that are missing, in a single svn_cache__get_multi() call. */
+static svn_error_t *
+multi_get_cache_test(svn_cache__t *cache,
+                     apr_pool_t *pool)
+{
+  svn_revnum_t twenty = 20, thirty = 30;
+  const void *keys[] = { "twenty", "forty", NULL, "thirty" };
+  void *values[4] = { NULL };
+  svn_boolean_t found[4];
+
+  SVN_ERR(svn_cache__set(cache, "twenty", &twenty, pool));
+  SVN_ERR(svn_cache__set(cache, "thirty", &thirty, pool));
+
+  SVN_ERR(svn_cache__get_multi(values, found, cache, keys, 4, pool));
+  SVN_TEST_ASSERT(found[0] && *(svn_revnum_t *)values[0] == 20);
+  SVN_TEST_ASSERT(!found[1]);
+  SVN_TEST_ASSERT(!found[2]);
+  SVN_TEST_ASSERT(found[3] && *(svn_revnum_t *)values[3] == 30);
+
+  /* Presence check only. */
+  SVN_ERR(svn_cache__get_multi(NULL, found, cache, keys, 4, pool));
+  SVN_TEST_ASSERT(found[0] && !found[1] && !found[2] && found[3]);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_inprocess_cache_get_multi(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+
+  SVN_ERR(svn_cache__create_inprocess(&cache,
+                                      serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING,
+                                      4,
+                                      1,
+                                      0,
+                                      TRUE,
+                                      "",
+                                      pool));
+
+  return multi_get_cache_test(cache, pool);
+}
+
+static svn_error_t *
+test_memcache_get_multi(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_memcache_t *memcache = NULL;
+  const char *prefix = apr_psprintf(pool,
+                                    "test_memcache_get_multi-%" APR_TIME_T_FMT,
+                                    apr_time_now());
+
+  SVN_ERR(create_memcache(&memcache, opts, pool, pool));
+  if (! memcache)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "not configured to use memcached");
+
+  SVN_ERR(svn_cache__create_memcache(&cache,
+                                    memcache,
+                                    serialize_revnum,
+                                    deserialize_revnum,
+                                    APR_HASH_KEY_STRING,
+                                    prefix,
+                                    pool));
+
+  return multi_get_cache_test(cache, pool);
+}
+
+#if APR_HAS_THREADS
+
+/* Per-thread state in test_membuffer_cache_optimistic_reads. */
+typedef struct optimistic_reads_baton_t
+{
+  /* The thread's own front-end to the shared membuffer. */
+  svn_cache__t *cache;
+
+  /* Number of bytes in each value. */
+  apr_size_t value_size;
+
+  /* The writer keeps going until this gets set. */
+  volatile svn_atomic_t *stop;
+} optimistic_reads_baton_t;
+
+/* Thread function: Keep replacing the value of key "seqlock" with strings
+ * of a single repeated character until the test tells us to stop. */
+static void * APR_THREAD_FUNC
+seqlock_writer(apr_thread_t *tid,
+               void *data)
+{
+  optimistic_reads_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_stringbuf_t *value = svn_stringbuf_create_ensure(baton->value_size,
+                                                       pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t status;
+  int i;
+
+  for (i = 0; !err && !svn_atomic_read(baton->stop); ++i)
+    {
+      svn_stringbuf_setempty(value);
+      svn_stringbuf_appendfill(value, (char)('a' + i % 26),
+                               baton->value_size);
+      err = svn_cache__set(baton->cache, "seqlock", value, pool);
+    }
+
+  status = err ? err->apr_err : APR_SUCCESS;
+  svn_error_clear(err);
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, status);
+
+  return NULL;
+}
+
+/* Thread function: Read the value of key "seqlock" many times and verify
+ * that we never see a mix of different values. */
+static void * APR_THREAD_FUNC
+seqlock_reader(apr_thread_t *tid,
+               void *data)
+{
+  optimistic_reads_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status = APR_SUCCESS;
+  int i;
+
+  for (i = 0; i < 20000 && status == APR_SUCCESS; ++i)
+    {
+      svn_stringbuf_t *value;
+      svn_boolean_t found;
+      svn_error_t *err;
+      apr_size_t k;
+
+      svn_pool_clear(pool);
+      err = svn_cache__get((void **)&value, &found, baton->cache,
+                           "seqlock", pool);
+      if (err)
+        {
+          status = err->apr_err;
+          svn_error_clear(err);
+        }
+      else if (found)
+        {
+          if (value->len != baton->value_size)
+            status = APR_EGENERAL;
+
+          for (k = 1; k < value->len; ++k)
+            if (value->data[k] != value->data[0])
+              status = APR_EGENERAL;
+        }
+    }
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, status);
+
+  return NULL;
+}
+
+#define APR_ERR(expr)                           \
+  do {                                          \
+    apr_status_t status = (expr);               \
+    if (status)                                 \
+      return svn_error_wrap_apr(status, NULL);  \
+  } while (0)
+
+#endif
+
+static svn_error_t *
+test_membuffer_cache_optimistic_reads(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* Thread 0 is the writer, all others are readers. */
+  enum { THREAD_COUNT = 5 };
+  apr_thread_t *threads[THREAD_COUNT];
+  optimistic_reads_baton_t batons[THREAD_COUNT];
+  volatile svn_atomic_t stop = FALSE;
+  apr_status_t retval;
+  svn_membuffer_t *membuffer;
+  svn_cache__info_t info;
+  int i;
+
+  /* A single segment, so all threads contend for the same lock and
+   * sequence counter. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 4*1024*1024, 0, 1,
+                                            TRUE, TRUE, pool));
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      /* Like in FSFS, every thread uses its own front-end and relies on
+       * the membuffer's segment locking.  Use the default serializers
+       * for svn_stringbuf_t. */
+      SVN_ERR(svn_cache__create_membuffer_cache(&batons[i].cache, membuffer,
+                                                NULL, NULL,
+                                                APR_HASH_KEY_STRING,
+                                                "seqlock-cache:",
+                                                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                                FALSE, FALSE, pool, pool));
+
+      /* Large values take long to copy, making collisions between
+       * readers and the writer likely.  Values of equal size get
+       * overwritten in-place, so readers that don't notice a collision
+       * see torn data. */
+      batons[i].value_size = 32 * 1024;
+      batons[i].stop = &stop;
+    }
+
+  APR_ERR(apr_thread_create(&threads[0], NULL, seqlock_writer, &batons[0],
+                            pool));
+  for (i = 1; i < THREAD_COUNT; ++i)
+    APR_ERR(apr_thread_create(&threads[i], NULL, seqlock_reader, &batons[i],
+                              pool));
+
+  /* All readers must only have seen consistent data. */
+  for (i = 1; i < THREAD_COUNT; ++i)
+    {
+      APR_ERR(apr_thread_join(&retval, threads[i]));
+      APR_ERR(retval);
+    }
+
+  svn_atomic_set(&stop, TRUE);
+  APR_ERR(apr_thread_join(&retval, threads[0]));
+  APR_ERR(retval);
+
+  /* The lock-free path needs the __atomic intrinsics, see
+   * cache-membuffer.c.  If available, some reads must have collided with
+   * the writer and been retried. */
+  SVN_ERR(svn_cache__get_info(batons[0].cache, &info, FALSE, pool));
+#if defined(__clang__) \
+    || (defined(__GNUC__) \
+        && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+  SVN_TEST_ASSERT(info.read_retries > 0);
+#endif
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_admission(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_stringbuf_t *value, *hot_value;
+  svn_cache__info_t info;
+  svn_boolean_t found;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* A single segment with a large directory, so that there are plenty of
+   * frequency counters and the sketch won't age during this test. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 256 * 1024,
+                                            64 * 1024, 1, TRUE, TRUE,
+                                            pool));
+
+  /* Use the default serializers for svn_stringbuf_t. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING,
+                                            "admission-cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  hot_value = svn_stringbuf_create_ensure(1024, pool);
+  svn_stringbuf_appendfill(hot_value, 'h', 1024);
+  SVN_ERR(svn_cache__set(cache, "hot", hot_value, pool));
+
+  /* Make the item part of the working set. */
+  for (i = 0; i < 100; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get((void **)&value, &found, cache, "hot",
+                             iterpool));
+      SVN_TEST_ASSERT(found);
+    }
+
+  /* Scan through more one-shot items than the cache can hold, like
+   * 'svnadmin verify' would. */
+  value = svn_stringbuf_create_ensure(1024, pool);
+  svn_stringbuf_appendfill(value, 'x', 1024);
+  for (i = 0; i < 1000; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__set(cache, apr_psprintf(iterpool, "one-shot-%d", i),
+                             value, iterpool));
+    }
+
+  /* The working set survived and the filter turned items away. */
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "hot", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(svn_stringbuf_compare(value, hot_value));
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.rejects > 0);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -616,6 +1448,31 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "basic shared memory membuffer svn_cache test"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared_fork,
+                   "attach forked children to a shared membuffer cache"),
+    SVN_TEST_PASS2(test_membuffer_cache_snapshot,
+                   "save and restore membuffer svn_cache contents"),
+    SVN_TEST_PASS2(test_membuffer_cache_snapshot_corrupt,
+                   "reject damaged membuffer svn_cache snapshots"),
+    SVN_TEST_PASS2(test_membuffer_cache_compression,
+                   "transparent compression in membuffer svn_cache"),
+    SVN_TEST_PASS2(test_membuffer_cache_prefix_info,
+                   "per-prefix statistics of membuffer svn_cache"),
+    SVN_TEST_PASS2(test_inprocess_cache_size_limit,
+                   "byte-limited inprocess svn_cache"),
+    SVN_TEST_PASS2(test_inprocess_cache_sharded,
+                   "sharded thread-safe inprocess svn_cache"),
+    SVN_TEST_PASS2(test_inprocess_cache_get_multi,
+                   "batched lookups in inprocess svn_cache"),
+    SVN_TEST_OPTS_PASS(test_memcache_get_multi,
+                       "pipelined batched lookups in memcache svn_cache"),
+    SVN_TEST_SKIP2(test_membuffer_cache_optimistic_reads,
+                   ! APR_HAS_THREADS,
+                   "concurrent lock-free membuffer reads"),
+    SVN_TEST_PASS2(test_membuffer_cache_admission,
+                   "membuffer admission filter keeps the working set"),
     SVN_TEST_NULL
   };
 
@@ -1065,6 +1065,65 @@ test_stream_readline_file_nul(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_stream_mapped_view(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *tmp_file;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  apr_file_t *file;
+  const char *view1, *view2;
+  apr_size_t len1, len2;
+  svn_checksum_t *expected, *actual;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(svn_dirent_get_absolute(&tmp_dir, "test_stream_mapped_view",
+                                  pool));
+  SVN_ERR(svn_io_remove_dir2(tmp_dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(tmp_dir, pool));
+  svn_test_add_dir_cleanup(tmp_dir);
+
+  for (i = 0; data->len < 200000; ++i)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "%d,", i));
+
+  tmp_file = svn_dirent_join(tmp_dir, "file", pool);
+  SVN_ERR(svn_io_file_create_bytes(tmp_file, data->data, data->len, pool));
+  SVN_ERR(svn_checksum(&expected, svn_checksum_md5, data->data, data->len,
+                       pool));
+
+  /* Plain file streams don't provide views and don't lose data trying. */
+  SVN_ERR(svn_stream_open_readonly(&stream, tmp_file, pool, pool));
+  len1 = 10;
+  err = svn_stream__view(stream, &view1, &len1);
+  SVN_TEST_ASSERT_ERROR(err, SVN_ERR_STREAM_NOT_SUPPORTED);
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Consecutive views are contiguous and the checksumming wrapper passes
+     them on. */
+  SVN_ERR(svn_io_file_open(&file, tmp_file, APR_READ, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_stream__from_mapped_file(&stream, file, FALSE, pool));
+  stream = svn_stream_checksummed2(stream, &actual, NULL, svn_checksum_md5,
+                                   TRUE, pool);
+
+  len1 = 70000;
+  SVN_ERR(svn_stream__view(stream, &view1, &len1));
+  SVN_TEST_ASSERT(len1 == 70000);
+  SVN_TEST_ASSERT(memcmp(view1, data->data, len1) == 0);
+
+  len2 = data->len;
+  SVN_ERR(svn_stream__view(stream, &view2, &len2));
+  SVN_TEST_ASSERT(len2 == data->len - len1);
+  SVN_TEST_ASSERT(view2 == view1 + len1);
+  SVN_TEST_ASSERT(memcmp(view2, data->data + len1, len2) == 0);
+
+  SVN_ERR(svn_stream_close(stream));
+  SVN_TEST_ASSERT(svn_checksum_match(expected, actual));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1104,6 +1163,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading CRLF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_nul,
                    "test reading line from file with nul bytes"),
+    SVN_TEST_PASS2(test_stream_mapped_view,
+                   "test memory-mapped stream views"),
     SVN_TEST_NULL
   };
 